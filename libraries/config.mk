@@ -49,6 +49,7 @@ SW_AES=yes
 endif
 
 ifeq ($(PROVISIONING_PROXY), yes)
+scheduler_tasks+= + 1
 SHARED_DATA=yes
 TINY_CBOR=yes
 SW_AES=yes
@@ -17,6 +17,7 @@
 #include "waps/waps_frames.h" // For frame min/max length constants
 #include "mcu.h"
 #include "wms_settings.h"
+#include "api.h"
 
 
 /* SLIP special characters */
@@ -57,6 +58,8 @@ typedef struct {
     uint32_t    way_too_short_frame_error;
     uint32_t    frame_size_out_of_bounds_error;
     uint32_t    crc_error;
+    uint32_t    rejected_frame;
+    uint32_t    sent_frame;
 } waps_diagnostics_t;
 static volatile waps_diagnostics_t m_waps_diagnostics;
 #endif /* WAPS_DIAGNOSTICS */
@@ -147,9 +150,34 @@ bool Waps_uart_send(const void * buffer, uint32_t size)
         return false;
     }
     ret = Usart_sendBuffer((void *)m_tx_buffer, m_tx_buffer_idx);
+#if defined WAPS_DIAGNOSTICS
+    if (ret == m_tx_buffer_idx)
+    {
+        m_waps_diagnostics.sent_frame++;
+    }
+#endif /* WAPS_DIAGNOSTICS */
     return (bool)(ret == m_tx_buffer_idx);
 }
 
+bool Waps_uart_getStats(waps_uart_stats_t * stats)
+{
+#if defined WAPS_DIAGNOSTICS
+    Sys_enterCriticalSection();
+    stats->rx_frames = m_waps_diagnostics.successful_frame;
+    stats->rx_errors = m_waps_diagnostics.escape_error +
+                       m_waps_diagnostics.way_too_short_frame_error +
+                       m_waps_diagnostics.frame_size_out_of_bounds_error +
+                       m_waps_diagnostics.crc_error;
+    stats->rx_rejected = m_waps_diagnostics.rejected_frame;
+    stats->tx_frames = m_waps_diagnostics.sent_frame;
+    Sys_exitCriticalSection();
+    return true;
+#else
+    (void)stats;
+    return false;
+#endif /* WAPS_DIAGNOSTICS */
+}
+
 void Waps_uart_flush(void)
 {
     Usart_flush();
@@ -202,8 +230,14 @@ static void frame_completed(void)
                 {
 #if defined WAPS_DIAGNOSTICS
                     m_waps_diagnostics.successful_frame++;
-#endif /* WAPS_DIAGNOSTICS */
+                    if (!m_frame_cb((void *)m_rx_buffer, pld_size))
+                    {
+                        /* No room for the request or invalid length */
+                        m_waps_diagnostics.rejected_frame++;
+                    }
+#else
                     (void)m_frame_cb((void *)m_rx_buffer, pld_size);
+#endif /* WAPS_DIAGNOSTICS */
                 }
             }
 #if defined WAPS_DIAGNOSTICS
@@ -17,6 +17,35 @@
  *          receiving data via UART.
  */
 
+/** UART link statistics, as exposed through CSAP attribute */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Amount of valid frames received */
+    uint32_t    rx_frames;
+    /** Amount of frames discarded because of framing, size or CRC error */
+    uint32_t    rx_errors;
+    /** Amount of valid frames rejected by upper layer (no free item) */
+    uint32_t    rx_rejected;
+    /** Amount of frames sent */
+    uint32_t    tx_frames;
+} waps_uart_stats_t;
+
+/** UART auto-power statistics, as exposed through CSAP attribute */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Time spent with UART powered off, in ms */
+    uint32_t    time_off_ms;
+    /** Time spent with UART powering up or on, in ms */
+    uint32_t    time_on_ms;
+    /** Amount of UART wake-ups triggered by the host */
+    uint32_t    wakeups;
+    /** Amount of frames received before shutdown timeout (no wake-up),
+     *  saturates at 0xFFFF */
+    uint16_t    held_frames;
+    /** Current time to keep UART on after a valid frame, in ms */
+    uint16_t    shutdown_timeout_ms;
+} waps_uart_power_stats_t;
+
 /**
  * \brief   WAPS UART initialize, after this, WAPS UART is ready to transmit
  *          and receive serial data
@@ -55,6 +84,14 @@ void Waps_uart_powerReset(void);
  */
 bool Waps_uart_send(const void * buffer, uint32_t size);
 
+/**
+ * \brief   Get UART link statistics
+ * \param   stats
+ *          Out: link statistics
+ * \return  True if statistics are available (enabled with waps_diagnostics)
+ */
+bool Waps_uart_getStats(waps_uart_stats_t * stats);
+
 /**
  * \brief   Flush UART module TX buffer.
  *          Waits for operation (pend) to complete before returning.
@@ -90,6 +127,14 @@ void Waps_uart_keepPowerOn(void);
  */
 void Waps_uart_powerOff(void);
 
+/**
+ * \brief   Get UART auto-power statistics
+ * \param   stats
+ *          Out: auto-power statistics. Times only advance while auto-power
+ *          is in use
+ */
+void Waps_uart_getPowerStats(waps_uart_power_stats_t * stats);
+
 /**
  * \brief   Callback task for power manager
  */
@@ -5,6 +5,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 #include "waps_private.h"
 
@@ -27,6 +28,12 @@
  *          A low level on the line starts the power-up procedure, and triggers
  *          a high level interrupt. When the high level is present, the UART +
  *          receiver are turned on.
+ *
+ *          With WAPS_UART_ADAPTIVE_POWER, the UART is not powered off right
+ *          after a valid frame but kept on for a shutdown timeout learnt from
+ *          the gaps between host frames: if the host usually sends its next
+ *          frame shortly (request followed by a poll, burst of data), staying
+ *          on costs less than waking up again.
  */
 
 /** USART power-up procedure states */
@@ -48,12 +55,76 @@ typedef enum
 /** Exec time to shutdown uart. 100us is more than enough */
 #define USART_SHUTDOWN_EXEC_TIME_US       100
 
+#if defined WAPS_UART_ADAPTIVE_POWER
+
+/** Longest shutdown timeout the policy may select */
+#ifndef WAPS_UART_POWER_MAX_HOLD_MS
+#define WAPS_UART_POWER_MAX_HOLD_MS         USART_SHUTDOWN_TIMEOUT_MS
+#endif
+
+/** Energy of a wake-up, as milliseconds of UART on-time */
+#ifndef WAPS_UART_POWER_WAKEUP_COST_MS
+#define WAPS_UART_POWER_WAKEUP_COST_MS      5
+#endif
+
+/** Max share (in %) of host frames that may need a wake-up. The policy
+ *  selects a longer timeout than the cheapest one to stay below it */
+#ifndef WAPS_UART_POWER_COLD_FRAMES_PCT
+#define WAPS_UART_POWER_COLD_FRAMES_PCT     100
+#endif
+
+#if WAPS_UART_POWER_MAX_HOLD_MS > USART_SHUTDOWN_TIMEOUT_MS
+#error "WAPS_UART_POWER_MAX_HOLD_MS cannot exceed USART_SHUTDOWN_TIMEOUT_MS"
+#endif
+
+/** Amount of gaps in the histogram before older ones are aged out */
+#define GAP_HISTORY                         64
+
+/** Amount of new gaps before the shutdown timeout is computed again */
+#define GAP_UPDATE_PERIOD                   8
+
+/** Upper bounds of the gap histogram bins in ms. The extra last bin counts
+ *  the longer gaps. Bounds are also the shutdown timeout candidates */
+static const uint16_t m_gap_bounds_ms[] =
+{
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000
+};
+
+#define GAP_BINS    (sizeof(m_gap_bounds_ms) / sizeof(m_gap_bounds_ms[0]) + 1)
+
+/** Histogram of the gaps between end of a frame and start of the next one */
+static volatile uint16_t m_gap_hist[GAP_BINS];
+
+/** Amount of gaps in the histogram */
+static volatile uint16_t m_gap_count;
+
+/** Amount of gaps added since the last shutdown timeout update */
+static volatile uint8_t m_gap_new;
+
+#endif /* WAPS_UART_ADAPTIVE_POWER */
+
 /** \brief  Is autopower enabled? */
 static bool m_autopower_enabled = false;
 
 // Current state of receiver power-up
 static volatile usart_power_state_e m_power_on = USART_POWER_OFF;
 
+/** Time to keep UART on after a valid frame (0: power off immediately) */
+static uint16_t m_shutdown_timeout_ms = 0;
+
+/** End of last valid frame, gap to the next one not measured yet */
+static volatile bool m_gap_pending = false;
+static app_lib_time_timestamp_hp_t m_frame_end_hp;
+static app_lib_time_timestamp_coarse_t m_frame_end_coarse;
+
+/** Coarse time spent in each power state while autopower is enabled */
+static uint32_t m_state_time[3];
+static app_lib_time_timestamp_coarse_t m_state_since;
+
+/** Power statistics counters */
+static volatile uint32_t m_wakeups;
+static volatile uint16_t m_held_frames;
+
 /**
  * \brief   Callback for RX pin state change
  */
@@ -69,10 +140,29 @@ static void                         power_off(void);
  */
 static uint32_t                     shutdown_uart();
 
+/**
+ * \brief   Change power state and account the time spent in the old one
+ */
+static void                         set_state(usart_power_state_e state);
+
+/**
+ * \brief   Measure the gap from the end of last valid frame, if not done yet
+ */
+static void                         gap_end(void);
+
+#if defined WAPS_UART_ADAPTIVE_POWER
+/**
+ * \brief   Select the shutdown timeout from the gap histogram
+ */
+static void                         update_shutdown_timeout(void);
+#endif
+
 void Waps_uart_AutoPowerOn(void)
 {
     Sys_enterCriticalSection();
     m_power_on = USART_POWER_OFF;
+    m_state_since = lib_time->getTimestampCoarse();
+    m_gap_pending = false;
     Wakeup_pinInit(uart_gpio_isr);
     // Expecting falling edge interrupt
     Wakeup_setEdgeIRQ(EXTI_IRQ_FALLING_EDGE, true);
@@ -83,7 +173,8 @@ void Waps_uart_AutoPowerOn(void)
 void Waps_uart_AutoPowerOff(void)
 {
     Sys_enterCriticalSection();
-    m_power_on = USART_POWER_OFF;
+    set_state(USART_POWER_OFF);
+    m_gap_pending = false;
     Wakeup_setEdgeIRQ(EXTI_IRQ_FALLING_EDGE, false);
     Wakeup_clearIrq();
     Wakeup_off();
@@ -99,6 +190,22 @@ void Waps_uart_keepPowerOn(void)
         return;
     }
 
+    if (m_power_on == USART_POWER_ON)
+    {
+        Sys_enterCriticalSection();
+        if (m_gap_pending)
+        {
+            // Next frame started before shutdown timeout: wake-up avoided.
+            // Counter saturates, it must fit the 16 bytes of the attribute
+            if (m_held_frames < UINT16_MAX)
+            {
+                m_held_frames++;
+            }
+            gap_end();
+        }
+        Sys_exitCriticalSection();
+    }
+
     // Inform us that UART power is to be kept on (receiving frame)
     // Just in case UART was receiving garbage or incomplete frame,
     // activate (or update) a task to automatically shutdown the uart
@@ -117,15 +224,54 @@ void Waps_uart_powerOff(void)
         return;
     }
 
+    Sys_enterCriticalSection();
+    m_frame_end_hp = lib_time->getTimestampHp();
+    m_frame_end_coarse = lib_time->getTimestampCoarse();
+    m_gap_pending = true;
+    Sys_exitCriticalSection();
+
     // Valid frame received (can shut down UART now)
-    // No need to wait for timeout and shutdown uart immediately
+    // Without shutdown timeout, no need to wait and shutdown uart immediately
     // Stopping the uart could be done directly but let's schedule
     // the task asap instead to be more symmetric
     App_Scheduler_addTask_execTime(shutdown_uart,
-                                   APP_SCHEDULER_SCHEDULE_ASAP,
+                                   m_shutdown_timeout_ms == 0 ?
+                                        APP_SCHEDULER_SCHEDULE_ASAP :
+                                        m_shutdown_timeout_ms,
                                    USART_SHUTDOWN_EXEC_TIME_US);
 }
 
+void Waps_uart_getPowerStats(waps_uart_power_stats_t * stats)
+{
+    uint32_t time_off;
+    uint32_t time_on;
+
+    Sys_enterCriticalSection();
+    time_off = m_state_time[USART_POWER_OFF];
+    time_on = m_state_time[USART_POWER_UP] + m_state_time[USART_POWER_ON];
+    if (m_autopower_enabled)
+    {
+        // Add time spent in the current state
+        uint32_t elapsed = lib_time->getTimestampCoarse() - m_state_since;
+        if (m_power_on == USART_POWER_OFF)
+        {
+            time_off += elapsed;
+        }
+        else
+        {
+            time_on += elapsed;
+        }
+    }
+    stats->wakeups = m_wakeups;
+    stats->held_frames = m_held_frames;
+    stats->shutdown_timeout_ms = m_shutdown_timeout_ms;
+    Sys_exitCriticalSection();
+
+    // Coarse timestamps are in 1/128 s
+    stats->time_off_ms = (uint32_t)(((uint64_t)time_off * 1000) >> 7);
+    stats->time_on_ms = (uint32_t)(((uint64_t)time_on * 1000) >> 7);
+}
+
 /** This function expects three preamble bytes, will not work otherwise */
 static void uart_gpio_isr(void)
 {
@@ -135,7 +281,9 @@ static void uart_gpio_isr(void)
         Sys_enterCriticalSection();
         /* Change sense direction and enable rising edge trigger */
         Wakeup_setEdgeIRQ(EXTI_IRQ_RISING_EDGE, true);
-        m_power_on = USART_POWER_UP;
+        set_state(USART_POWER_UP);
+        m_wakeups++;
+        gap_end();
         Sys_exitCriticalSection();
         // Rising edge comes very fast, may not be safe to enter deep sleep
         DS_Disable(DS_SOURCE_USART_POWER);
@@ -148,7 +296,7 @@ static void uart_gpio_isr(void)
         /* UART must be enabled here (after receiver is on), don't know why */
         Usart_setEnabled(true);
         Usart_receiverOn();
-        m_power_on = USART_POWER_ON;
+        set_state(USART_POWER_ON);
         Sys_exitCriticalSection();
         // Uart is now awake, safe to enable deep sleep
         DS_Enable(DS_SOURCE_USART_POWER);
@@ -160,6 +308,12 @@ static uint32_t shutdown_uart(void)
 {
     // The delay without uart activity has elapsed
     power_off();
+#if defined WAPS_UART_ADAPTIVE_POWER
+    if (m_gap_new >= GAP_UPDATE_PERIOD)
+    {
+        update_shutdown_timeout();
+    }
+#endif
     return APP_SCHEDULER_STOP_TASK;
 }
 
@@ -186,7 +340,133 @@ static void power_off(void)
     }
 
     /* Power is now off */
-    m_power_on = USART_POWER_OFF;
+    Sys_enterCriticalSection();
+    set_state(USART_POWER_OFF);
+    Sys_exitCriticalSection();
     /* Change edge to falling edge and enable power-up pin */
     Wakeup_setEdgeIRQ(EXTI_IRQ_FALLING_EDGE, true);
 }
+
+static void set_state(usart_power_state_e state)
+{
+    app_lib_time_timestamp_coarse_t now = lib_time->getTimestampCoarse();
+    if (m_autopower_enabled)
+    {
+        m_state_time[m_power_on] += now - m_state_since;
+    }
+    m_state_since = now;
+    m_power_on = state;
+}
+
+static void gap_end(void)
+{
+    if (!m_gap_pending)
+    {
+        return;
+    }
+    m_gap_pending = false;
+
+#if defined WAPS_UART_ADAPTIVE_POWER
+    uint32_t gap_ms = UINT32_MAX;
+    uint8_t bin;
+
+    // High precision timestamps have a limited range, use them only for
+    // gaps up to one second (128 coarse ticks)
+    if (lib_time->getTimestampCoarse() - m_frame_end_coarse <= 128)
+    {
+        gap_ms = lib_time->getTimeDiffUs(lib_time->getTimestampHp(),
+                                         m_frame_end_hp) / 1000;
+    }
+
+    for (bin = 0; bin < GAP_BINS - 1; bin++)
+    {
+        if (gap_ms <= m_gap_bounds_ms[bin])
+        {
+            break;
+        }
+    }
+
+    if (m_gap_count >= GAP_HISTORY)
+    {
+        // Age out older gaps so that policy follows the host behavior
+        m_gap_count = 0;
+        for (uint8_t b = 0; b < GAP_BINS; b++)
+        {
+            m_gap_hist[b] /= 2;
+            m_gap_count += m_gap_hist[b];
+        }
+    }
+    m_gap_hist[bin]++;
+    m_gap_count++;
+    if (m_gap_new < UINT8_MAX)
+    {
+        m_gap_new++;
+    }
+#endif
+}
+
+#if defined WAPS_UART_ADAPTIVE_POWER
+static void update_shutdown_timeout(void)
+{
+    uint16_t hist[GAP_BINS];
+    uint32_t count = 0;
+    uint32_t best_cost = UINT32_MAX;
+    uint16_t best_timeout = 0;
+    uint16_t timeout = 0;
+    uint8_t candidate = 0;
+
+    Sys_enterCriticalSection();
+    for (uint8_t b = 0; b < GAP_BINS; b++)
+    {
+        hist[b] = m_gap_hist[b];
+        count += hist[b];
+    }
+    m_gap_new = 0;
+    Sys_exitCriticalSection();
+
+    // Candidates are 0 (power off immediately) and the bin bounds. For a
+    // candidate timeout, a gap shorter than it costs the gap as on-time and
+    // a longer one costs the timeout plus a wake-up
+    while (true)
+    {
+        uint32_t cost = 0;
+        uint32_t cold = 0;
+
+        for (uint8_t b = 0; b < GAP_BINS; b++)
+        {
+            if ((b < GAP_BINS - 1) && (m_gap_bounds_ms[b] <= timeout))
+            {
+                cost += (uint32_t)hist[b] * m_gap_bounds_ms[b];
+            }
+            else
+            {
+                cost += (uint32_t)hist[b] *
+                        (timeout + WAPS_UART_POWER_WAKEUP_COST_MS);
+                cold += hist[b];
+            }
+        }
+
+        if ((cold * 100 <= count * WAPS_UART_POWER_COLD_FRAMES_PCT) &&
+            (cost < best_cost))
+        {
+            best_cost = cost;
+            best_timeout = timeout;
+        }
+
+        if ((candidate >= GAP_BINS - 1) ||
+            (m_gap_bounds_ms[candidate] > WAPS_UART_POWER_MAX_HOLD_MS))
+        {
+            break;
+        }
+        timeout = m_gap_bounds_ms[candidate++];
+    }
+
+    if (best_cost == UINT32_MAX)
+    {
+        // Cold frame target not reachable: use the longest timeout allowed
+        best_timeout = timeout;
+    }
+
+    m_shutdown_timeout_ms = best_timeout;
+}
+#endif /* WAPS_UART_ADAPTIVE_POWER */
@@ -9,6 +9,7 @@
 #include "waps/sap/function_codes.h"
 #include "waps_frames.h"
 #include "waps_private.h"
+#include "waps_ind_queue.h"
 #include "waps/protocol/waps_protocol.h"
 #include "waps/protocol/waps_protocol_private.h"
 
@@ -84,8 +85,8 @@ static void send_indication(waps_frame_t * rx_frame)
     }
     if(prot_indication == NULL)
     {
-        /* New frame start (get oldest frame) */
-        prot_indication = (waps_item_t *)sl_list_pop_front(&waps_ind_queue);
+        /* New frame start (get oldest frame of the highest class) */
+        prot_indication = Waps_ind_pop();
     }
     if(prot_indication != NULL)
     {
@@ -94,7 +95,7 @@ static void send_indication(waps_frame_t * rx_frame)
         if (!prot_send_item(prot_indication))
         {
             /* Failed, put back to front of queue (minimize delays) */
-            sl_list_push_front(&waps_ind_queue, (sl_list_t *)prot_indication);
+            Waps_ind_pushFront(prot_indication);
             prot_indication = NULL;
         }
     }
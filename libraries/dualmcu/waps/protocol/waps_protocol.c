@@ -12,6 +12,7 @@
 #include "waps_buffer_sizes.h"
 #include "waps_item.h"
 #include "waps_protocol.h"
+#include "waps_ind_queue.h"
 #include "uart/waps_uart_protocol.h"
 #include "usart.h"
 #include "sl_list.h"
@@ -75,7 +76,7 @@ bool Waps_prot_hasIndication(void)
 void Waps_prot_updateIrqPin(void)
 {
     /* Pin control */
-    if((sl_list_size(&waps_ind_queue)) ||
+    if((Waps_ind_count() != 0) ||
        (prot_indication != NULL))
     {
         /* We have stuff to send */
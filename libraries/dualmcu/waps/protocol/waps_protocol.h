@@ -57,7 +57,6 @@ bool Waps_prot_hasIndication(void);
 void Waps_prot_updateIrqPin(void);
 
 /** WAPS Global queues */
-extern sl_list_head_t                   waps_ind_queue;
 extern sl_list_head_t                   waps_reply_queue;
 
 #endif /* WAPS_PROTOCOL_H_ */
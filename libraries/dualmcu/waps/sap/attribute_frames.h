@@ -63,6 +63,64 @@ typedef struct __attribute__ ((__packed__))
     uint8_t result;
 } write_cnf_t;
 
+/** Maximum amount of attributes in a multi-attribute request */
+#define WAPS_MAX_MULTI_ATTR         16
+
+/** Space for attribute entries in multi-attribute frames. Kept below the
+ *  biggest existing frame payload, not to grow the items */
+#define WAPS_MAX_MULTI_ATTR_DATA    112
+
+/** Multi-attribute read request */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Amount of attributes to read */
+    uint8_t     count;
+    attr_t      attr_ids[WAPS_MAX_MULTI_ATTR];
+} multi_read_req_t;
+
+#define FRAME_MULTI_READ_REQ_HEADER_SIZE    \
+    (sizeof(multi_read_req_t) - WAPS_MAX_MULTI_ATTR * sizeof(attr_t))
+
+/** Header of an attribute entry in multi-attribute frames. In a read
+ *  confirmation, entry starts with the result of reading the attribute */
+typedef struct __attribute__ ((__packed__))
+{
+    attr_t      attr_id;
+    uint8_t     attr_len;
+} multi_attr_entry_t;
+
+/** Multi-attribute read confirmation */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Amount of attributes read: the ones that did not fit must be read
+     *  with another request */
+    uint8_t     count;
+    /** \ref attribute_result_e, \ref multi_attr_entry_t and value of each
+     *  attribute, value being present only on success */
+    uint8_t     data[WAPS_MAX_MULTI_ATTR_DATA];
+} multi_read_cnf_t;
+
+/** Multi-attribute write request */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Amount of attributes to write */
+    uint8_t     count;
+    /** \ref multi_attr_entry_t and value of each attribute */
+    uint8_t     data[WAPS_MAX_MULTI_ATTR_DATA];
+} multi_write_req_t;
+
+/** Multi-attribute write confirmation */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Amount of attributes written */
+    uint8_t     count;
+    /** \ref attribute_result_e of each attribute, in request order */
+    uint8_t     results[WAPS_MAX_MULTI_ATTR];
+} multi_write_cnf_t;
+
+#define FRAME_MULTI_WRITE_CNF_HEADER_SIZE   \
+    (sizeof(multi_write_cnf_t) - WAPS_MAX_MULTI_ATTR)
+
 //assert_static(sizeof(read_cnf_t)  == 20);
 //assert_static(sizeof(read_req_t)  == 2);
 //assert_static(sizeof(write_req_t) == 19);
@@ -74,6 +132,10 @@ typedef union
     read_req_t  read_req;
     write_req_t write_req;
     write_cnf_t write_cnf;
+    multi_read_req_t    multi_read_req;
+    multi_read_cnf_t    multi_read_cnf;
+    multi_write_req_t   multi_write_req;
+    multi_write_cnf_t   multi_write_cnf;
 } frame_attr;
 
 #endif /* ATTRIBUTE_FRAMES_H_ */
@@ -13,6 +13,8 @@
 #include "api.h"
 #include "comm/uart/waps_uart.h"
 #include "sap/persistent.h"
+#include "sap/multicast.h"
+#include "sap/multi_attr.h"
 
 /** Key for reset command ("DoIt" in ASCII) */
 #define RESET_KEY 0x74496f44
@@ -61,13 +63,22 @@ static const uint8_t m_attr_size_lut[] =
     CSAP_ATTR_FEATURE_LOCK_KEY_SIZE,
     CSAP_ATTR_RESERVED_2_SIZE,
     CSAP_ATTR_RESERVED_CHANNELS_SIZE,
+    CSAP_ATTR_WAPS_ITEM_STATS_SIZE,
+    CSAP_ATTR_WAPS_LINK_STATS_SIZE,
+    CSAP_ATTR_WAPS_POWER_STATS_SIZE,
 };
 
 static bool attrReadReq(waps_item_t * item);
+static attribute_result_e readAttrChecked(attr_t attr_id,
+                                          uint8_t * value,
+                                          uint8_t * attr_size_p);
 static attribute_result_e readAttr(attr_t attr_id,
                                    uint8_t * value,
                                    uint8_t * attr_size_p);
 static bool attrWriteReq(waps_item_t * item);
+static attribute_result_e writeAttrChecked(attr_t attr_id,
+                                           const uint8_t * value,
+                                           uint8_t attr_len);
 static attribute_result_e writeAttr(attr_t attr_id,
                                     const uint8_t * value,
                                     uint8_t attr_size);
@@ -113,6 +124,14 @@ bool Csap_handleFrame(waps_item_t * item)
             return attrReadReq(item);
         case WAPS_FUNC_CSAP_ATTR_WRITE_REQ:
             return attrWriteReq(item);
+        case WAPS_FUNC_CSAP_MULTI_ATTR_READ_REQ:
+            return MultiAttr_read(item,
+                                  WAPS_FUNC_CSAP_MULTI_ATTR_READ_CNF,
+                                  readAttrChecked);
+        case WAPS_FUNC_CSAP_MULTI_ATTR_WRITE_REQ:
+            return MultiAttr_write(item,
+                                   WAPS_FUNC_CSAP_MULTI_ATTR_WRITE_CNF,
+                                   writeAttrChecked);
         case WAPS_FUNC_CSAP_FACTORY_RESET_REQ:
             return resetReq(item);
         default:
@@ -120,23 +139,18 @@ bool Csap_handleFrame(waps_item_t * item)
     }
 }
 
-static bool attrReadReq(waps_item_t * item)
+static attribute_result_e readAttrChecked(attr_t attr_id,
+                                          uint8_t * value,
+                                          uint8_t * attr_size_p)
 {
-    read_req_t * req_ptr = &item->frame.attr.read_req;
-    attr_t attr_id = req_ptr->attr_id;
-    attribute_result_e result = ATTR_UNSUPPORTED_ATTRIBUTE;
     uint32_t idx = attr_id - 1;
-    uint8_t attr_size = 0;
 
-    if (item->frame.splen != sizeof(read_req_t))
-    {
-        return false;
-    }
+    *attr_size_p = 0;
+
     /* Check attribute ID */
     if (idx >= sizeof(m_attr_size_lut))
     {
-        result = ATTR_UNSUPPORTED_ATTRIBUTE;
-        goto build_response;
+        return ATTR_UNSUPPORTED_ATTRIBUTE;
     }
 
     /* Check that CSAP attribute read feature is permitted */
@@ -144,27 +158,39 @@ static bool attrReadReq(waps_item_t * item)
     {
         if (!LockBits_isFeaturePermitted(LOCK_BITS_MSAP_SCRATCHPAD_STATUS))
         {
-            result = ATTR_ACCESS_DENIED;
-            goto build_response;
+            return ATTR_ACCESS_DENIED;
         }
     }
     else
     {
         if (!LockBits_isFeaturePermitted(LOCK_BITS_CSAP_ATTR_READ))
         {
-            result = ATTR_ACCESS_DENIED;
-            goto build_response;
+            return ATTR_ACCESS_DENIED;
         }
     }
 
     /* attribute found in LUT */
-    attr_size = m_attr_size_lut[idx];
+    *attr_size_p = m_attr_size_lut[idx];
 
     /* Read attribute with attribute manager */
-    result = readAttr(attr_id, item->frame.attr.read_cnf.attr, &attr_size);
+    return readAttr(attr_id, value, attr_size_p);
+}
+
+static bool attrReadReq(waps_item_t * item)
+{
+    read_req_t * req_ptr = &item->frame.attr.read_req;
+    attr_t attr_id = req_ptr->attr_id;
+    attribute_result_e result;
+    uint8_t attr_size = 0;
+
+    if (item->frame.splen != sizeof(read_req_t))
+    {
+        return false;
+    }
+
+    result = readAttrChecked(attr_id, item->frame.attr.read_cnf.attr, &attr_size);
 
     /* Processing done, build response over request */
-build_response:
     Waps_item_init(item,
                    WAPS_FUNC_CSAP_ATTR_READ_CNF,
                    FRAME_READ_CNF_HEADER_SIZE);
@@ -361,6 +387,40 @@ static attribute_result_e readAttr(attr_t attr_id,
             *attr_size_p = attr_size;
             attr_size = 0;
             break;
+        case CSAP_ATTR_WAPS_ITEM_STATS:
+            {
+                waps_item_stats_t stats;
+                Waps_itemGetStats(&stats);
+                /* Too big for tmp, copy directly to value buffer */
+                memcpy(value, &stats, sizeof(stats));
+                attr_size = 0;
+            }
+            break;
+        case CSAP_ATTR_WAPS_LINK_STATS:
+            {
+                waps_uart_stats_t stats;
+                if (Waps_uart_getStats(&stats))
+                {
+                    /* Too big for tmp, copy directly to value buffer */
+                    memcpy(value, &stats, sizeof(stats));
+                    attr_size = 0;
+                }
+                else
+                {
+                    /* Not enabled in this build */
+                    result = APP_RES_NOT_IMPLEMENTED;
+                }
+            }
+            break;
+        case CSAP_ATTR_WAPS_POWER_STATS:
+            {
+                waps_uart_power_stats_t stats;
+                Waps_uart_getPowerStats(&stats);
+                /* Too big for tmp, copy directly to value buffer */
+                memcpy(value, &stats, sizeof(stats));
+                attr_size = 0;
+            }
+            break;
         case CSAP_ATTR_RESERVED_1:
         case CSAP_ATTR_RESERVED_2:
         default:
@@ -377,39 +437,30 @@ static attribute_result_e readAttr(attr_t attr_id,
     return appRes2attrRes(result);
 }
 
-static bool attrWriteReq(waps_item_t * item)
+static attribute_result_e writeAttrChecked(attr_t attr_id,
+                                           const uint8_t * value,
+                                           uint8_t attr_len)
 {
-    write_req_t * req_ptr = &item->frame.attr.write_req;
-    attr_t attr_id = req_ptr->attr_id;
     uint32_t idx = attr_id - 1;
-    uint8_t attr_size = 0;
-    attribute_result_e result;
+    uint8_t attr_size;
 
-    if (item->frame.splen != (FRAME_WRITE_REQ_HEADER_SIZE +
-                             req_ptr->attr_len))
-    {
-        return false;
-    }
     /* Check attribute ID */
     if (idx >= sizeof(m_attr_size_lut))
     {
-        result = ATTR_UNSUPPORTED_ATTRIBUTE;
-        goto build_response;
+        return ATTR_UNSUPPORTED_ATTRIBUTE;
     }
 
     /* Check that CSAP attribute feature lock bits write is permitted */
     if ((attr_id == CSAP_ATTR_FEATURE_LOCK_BITS) && LockBits_isKeySet())
     {
-        result = ATTR_ACCESS_DENIED;
-        goto build_response;
+        return ATTR_ACCESS_DENIED;
     }
 
     /* Check that CSAP attribute write feature is permitted */
     if ((attr_id != CSAP_ATTR_FEATURE_LOCK_KEY) &&
         !LockBits_isFeaturePermitted(LOCK_BITS_CSAP_ATTR_WRITE))
     {
-        result = ATTR_ACCESS_DENIED;
-        goto build_response;
+        return ATTR_ACCESS_DENIED;
     }
 
     /* attribute found in LUT */
@@ -419,19 +470,31 @@ static bool attrWriteReq(waps_item_t * item)
     if (attr_size == 0)
     {
         /* Allow variable size attribute */
-        attr_size = req_ptr->attr_len;
+        attr_size = attr_len;
     }
-    else if (attr_size != req_ptr->attr_len)
+    else if (attr_size != attr_len)
     {
-        result = ATTR_INV_LENGTH;
-        goto build_response;
+        return ATTR_INV_LENGTH;
     }
 
     /* Write attribute with attribute manager */
-    result = writeAttr(attr_id, req_ptr->attr, attr_size);
+    return writeAttr(attr_id, value, attr_size);
+}
+
+static bool attrWriteReq(waps_item_t * item)
+{
+    write_req_t * req_ptr = &item->frame.attr.write_req;
+    attribute_result_e result;
+
+    if (item->frame.splen != (FRAME_WRITE_REQ_HEADER_SIZE +
+                             req_ptr->attr_len))
+    {
+        return false;
+    }
+
+    result = writeAttrChecked(req_ptr->attr_id, req_ptr->attr, req_ptr->attr_len);
 
     /* Processing done, build response over request */
-build_response:
     Waps_item_init(item,
                    WAPS_FUNC_CSAP_ATTR_WRITE_CNF,
                    sizeof(simple_cnf_t));
@@ -594,6 +657,7 @@ static bool resetReq(waps_item_t * item)
         {
             // Need to re-init as flash content is modified by the stack.
             Persistent_init();
+            Multicast_init();
         }
     }
 create_response:
@@ -51,6 +51,9 @@ typedef enum
     CSAP_ATTR_HWMAGIC = 17,
     CSAP_ATTR_STACK_PROFILE = 18,
     CSAP_ATTR_RESERVED_1 = 19,
+    CSAP_ATTR_WAPS_ITEM_STATS = 26,
+    CSAP_ATTR_WAPS_LINK_STATS = 27,
+    CSAP_ATTR_WAPS_POWER_STATS = 28,
 } csap_attr_e;
 
 /** CSAP attributes lengths */
@@ -81,6 +84,9 @@ typedef enum
     CSAP_ATTR_RESERVED_CHANNELS_SIZE = 0,   /* Variable size */
     CSAP_ATTR_RESERVED_1_SIZE = 0,
     CSAP_ATTR_RESERVED_2_SIZE = 0,
+    CSAP_ATTR_WAPS_ITEM_STATS_SIZE = 16,    /* \see waps_item_stats_t */
+    CSAP_ATTR_WAPS_LINK_STATS_SIZE = 16,    /* \see waps_uart_stats_t */
+    CSAP_ATTR_WAPS_POWER_STATS_SIZE = 16,   /* \see waps_uart_power_stats_t */
 } csap_attr_size_e;
 
 
@@ -21,6 +21,260 @@
  */
 static void update_packet_delay(waps_item_t * item);
 
+#ifdef WAPS_RX_REASSEMBLY
+
+/** Amount of packets reassembled at the same time */
+#ifndef WAPS_RX_REASSEMBLY_SESSIONS
+#define WAPS_RX_REASSEMBLY_SESSIONS     2
+#endif
+
+/** Biggest packet that can be reassembled, in bytes */
+#ifndef WAPS_RX_REASSEMBLY_MAX_SIZE
+#define WAPS_RX_REASSEMBLY_MAX_SIZE     1500
+#endif
+
+/** Time after which an incomplete packet is dropped, in seconds */
+#ifndef WAPS_RX_REASSEMBLY_TIMEOUT_S
+#define WAPS_RX_REASSEMBLY_TIMEOUT_S    30
+#endif
+
+#if WAPS_RX_REASSEMBLY_MAX_SIZE > (DSAP_FRAG_LENGTH_MASK + 1)
+#error "WAPS_RX_REASSEMBLY_MAX_SIZE exceeds the fragment offset range"
+#endif
+
+/** Packet being reassembled */
+typedef struct
+{
+    /** Coarse timestamp of the first fragment, then of the last missing
+     *  one while packet is given to the host */
+    uint32_t    start_time;
+    w_addr_t    src_addr;
+    uint16_t    packet_id;
+    ep_t        src_endpoint;
+    ep_t        dst_endpoint;
+    /** Distinct bytes received so far */
+    uint16_t    received;
+    /** End of the furthest fragment received so far */
+    uint16_t    max_end;
+    /** Full packet size, 0 until last fragment is received */
+    uint16_t    total;
+    /** Indications already given to the host, once packet is complete */
+    uint8_t     delivered;
+    /** Packet did not fit or its fragments do not match: its fragments are
+     *  dropped until timeout */
+    bool        discarded;
+    bool        in_use;
+    /** Bytes received so far, one bit per byte, so that duplicated
+     *  fragments are not counted twice */
+    uint8_t     bitmap[(WAPS_RX_REASSEMBLY_MAX_SIZE + 7) / 8];
+    uint8_t     bytes[WAPS_RX_REASSEMBLY_MAX_SIZE];
+} reassembly_session_t;
+
+static reassembly_session_t m_sessions[WAPS_RX_REASSEMBLY_SESSIONS];
+
+static bool is_complete(const reassembly_session_t * session)
+{
+    return (session->total != 0) && (session->received == session->total);
+}
+
+/**
+ * \brief   Find the session of a fragment or allocate a new one
+ * \return  Session, or NULL if all sessions are in use
+ */
+static reassembly_session_t * get_session(const app_lib_data_received_t * data)
+{
+    uint32_t now = lib_time->getTimestampCoarse();
+    reassembly_session_t * free_session = NULL;
+
+    for (uint8_t i = 0; i < WAPS_RX_REASSEMBLY_SESSIONS; i++)
+    {
+        reassembly_session_t * session = &m_sessions[i];
+        if (session->in_use &&
+            (now - session->start_time > WAPS_RX_REASSEMBLY_TIMEOUT_S * 128u))
+        {
+            // Missing fragments will not come anymore, or stack gave up
+            // the last fragment while there was no room for the packet
+            session->in_use = false;
+        }
+
+        if (!session->in_use)
+        {
+            if (free_session == NULL)
+            {
+                free_session = session;
+            }
+        }
+        else if ((session->src_addr == data->src_address) &&
+                 (session->packet_id == data->fragment_info->packet_id) &&
+                 (session->src_endpoint == data->src_endpoint) &&
+                 (session->dst_endpoint == data->dest_endpoint))
+        {
+            return session;
+        }
+    }
+
+    if (free_session != NULL)
+    {
+        free_session->start_time = now;
+        free_session->src_addr = data->src_address;
+        free_session->packet_id = data->fragment_info->packet_id;
+        free_session->src_endpoint = data->src_endpoint;
+        free_session->dst_endpoint = data->dest_endpoint;
+        free_session->received = 0;
+        free_session->max_end = 0;
+        free_session->total = 0;
+        free_session->delivered = 0;
+        free_session->discarded = false;
+        free_session->in_use = true;
+        memset(free_session->bitmap, 0, sizeof(free_session->bitmap));
+    }
+    return free_session;
+}
+
+/**
+ * \brief   Copy a fragment to its place in the session
+ * \return  Amount of bytes not received before
+ */
+static uint16_t store_fragment(reassembly_session_t * session,
+                               uint16_t offset,
+                               const uint8_t * bytes,
+                               uint16_t num_bytes)
+{
+    uint16_t new_bytes = 0;
+
+    for (uint16_t i = offset; i < offset + num_bytes; i++)
+    {
+        uint8_t mask = 1u << (i & 7);
+        if ((session->bitmap[i >> 3] & mask) == 0)
+        {
+            session->bitmap[i >> 3] |= mask;
+            new_bytes++;
+        }
+    }
+    memcpy(&session->bytes[offset], bytes, num_bytes);
+    return new_bytes;
+}
+
+/**
+ * \brief   Give a complete packet to the host: a single data RX indication
+ *          if it fits, otherwise a sequence of full sized fragment
+ *          indications. Indications are built as long as there are free
+ *          items, next call continues from where this one stopped
+ * \return  False if some indications are still to be given
+ */
+static bool deliver_session(reassembly_session_t * session,
+                            const app_lib_data_received_t * data,
+                            w_addr_t dst_addr,
+                            dsap_add_ind_cb_f add_cb)
+{
+    uint8_t num_items = (session->total + APDU_MAX_SIZE - 1) / APDU_MAX_SIZE;
+    app_lib_data_received_t part = *data;
+    app_lib_data_fragment_t fragment_info =
+    {
+        .packet_id = session->packet_id,
+    };
+
+    part.fragment_info = (num_items > 1) ? &fragment_info : NULL;
+    while (session->delivered < num_items)
+    {
+        uint16_t offset = session->delivered * APDU_MAX_SIZE;
+        waps_item_t * item = Waps_itemReserve(WAPS_ITEM_TYPE_INDICATION);
+        if (item == NULL)
+        {
+            return false;
+        }
+
+        part.bytes = &session->bytes[offset];
+        part.num_bytes = session->total - offset;
+        if (part.num_bytes > APDU_MAX_SIZE)
+        {
+            part.num_bytes = APDU_MAX_SIZE;
+        }
+        fragment_info.fragment_offset = offset;
+        fragment_info.last_fragment = (session->delivered == num_items - 1);
+        Dsap_packetReceived(&part, dst_addr, item);
+        add_cb(item);
+        session->delivered++;
+    }
+    return true;
+}
+
+app_lib_data_receive_res_e Dsap_fragmentReceived(
+                                const app_lib_data_received_t * data,
+                                w_addr_t dst_addr,
+                                dsap_add_ind_cb_f add_cb)
+{
+    const app_lib_data_fragment_t * frag = data->fragment_info;
+    reassembly_session_t * session = get_session(data);
+    uint32_t end = frag->fragment_offset + data->num_bytes;
+
+    if (session == NULL)
+    {
+        // Stack keeps the fragment until a session is free
+        return APP_LIB_DATA_RECEIVE_RES_NO_SPACE;
+    }
+
+    if (!session->discarded && !is_complete(session))
+    {
+        if (end > WAPS_RX_REASSEMBLY_MAX_SIZE)
+        {
+            // Too big packet
+            session->discarded = true;
+        }
+        else if (((session->total != 0) && (end > session->total)) ||
+                 (frag->last_fragment &&
+                  ((end < session->max_end) ||
+                   ((session->total != 0) && (end != session->total)))))
+        {
+            // Fragment beyond the end of the packet or two different ends
+            session->discarded = true;
+        }
+        else
+        {
+            session->received += store_fragment(session,
+                                                frag->fragment_offset,
+                                                data->bytes,
+                                                data->num_bytes);
+            if (end > session->max_end)
+            {
+                session->max_end = end;
+            }
+            if (frag->last_fragment)
+            {
+                session->total = end;
+            }
+            if (is_complete(session))
+            {
+                session->start_time = lib_time->getTimestampCoarse();
+            }
+        }
+    }
+
+    if (session->discarded)
+    {
+        // Drop all its fragments until timeout
+        if (frag->last_fragment)
+        {
+            session->in_use = false;
+        }
+        return APP_LIB_DATA_RECEIVE_RES_HANDLED;
+    }
+
+    if (is_complete(session))
+    {
+        // Fragment that completed the packet, or the same fragment given
+        // again by the stack: it keeps it until the whole packet is given
+        if (!deliver_session(session, data, dst_addr, add_cb))
+        {
+            return APP_LIB_DATA_RECEIVE_RES_NO_SPACE;
+        }
+        session->in_use = false;
+    }
+    return APP_LIB_DATA_RECEIVE_RES_HANDLED;
+}
+
+#endif // WAPS_RX_REASSEMBLY
+
 static uint8_t get_singlemcu_flag_from_dualmcu_tx_option(uint8_t tx_opts)
 {
     uint8_t flags = 0;
@@ -297,7 +551,7 @@ static void update_packet_delay(waps_item_t * item)
         {
             item->frame.dsap.data_rx_ind.delay += local_delay;
         }
-        else if (item->frame.sfunc == WAPS_FUNC_DSAP_DATA_RX_IND)
+        else if (item->frame.sfunc == WAPS_FUNC_DSAP_DATA_RX_FRAG_IND)
         {
             item->frame.dsap.data_rx_frag_ind.delay += local_delay;
         }
@@ -57,4 +57,28 @@ void Dsap_packetReceived(const app_lib_data_received_t * data,
                          w_addr_t dst_addr,
                          waps_item_t * output_ptr);
 
+#ifdef WAPS_RX_REASSEMBLY
+/** Callback to queue an indication */
+typedef void (*dsap_add_ind_cb_f)(waps_item_t * item);
+
+/**
+ * \brief   Reassemble a received fragment
+ * \param   data
+ *          Information on incoming fragment
+ * \param   dst_addr
+ *          Destination address of packet, either unicast address or broadcast
+ * \param   add_cb
+ *          Called to queue the indications once the packet is complete
+ * \return  Result to give back to the stack. If no space, the stack gives
+ *          the fragment again later
+ * \note    Packets up to APDU_MAX_SIZE bytes are given as a single data RX
+ *          indication, bigger ones as consecutive data RX fragment
+ *          indications filled up to APDU_MAX_SIZE bytes
+ */
+app_lib_data_receive_res_e Dsap_fragmentReceived(
+                                const app_lib_data_received_t * data,
+                                w_addr_t dst_addr,
+                                dsap_add_ind_cb_f add_cb);
+#endif
+
 #endif /* WAPS_DSAP_H_ */
@@ -8,56 +8,143 @@
 #include <stdbool.h>
 #include "function_codes.h"
 
-static const uint8_t m_dsap_req[] = DSAP_REQUESTS;
-static const uint8_t m_msap_req[] = MSAP_REQUESTS;
-static const uint8_t m_csap_req[] = CSAP_REQUESTS;
-static const uint8_t m_cnf[] = WAPS_CONFIRMATIONS;
-static const uint8_t m_ind[] = WAPS_INDICATIONS;
-static const uint8_t m_rsp[] = WAPS_RESPONSES;
-
-#define DSAP_REQ_COUNT  (sizeof(m_dsap_req)/sizeof(m_dsap_req[0]))
-#define MSAP_REQ_COUNT  (sizeof(m_msap_req)/sizeof(m_msap_req[0]))
-#define CSAP_REQ_COUNT  (sizeof(m_csap_req)/sizeof(m_csap_req[0]))
-#define CNF_COUNT       (sizeof(m_cnf)/sizeof(m_cnf[0]))
-#define IND_COUNT       (sizeof(m_ind)/sizeof(m_ind[0]))
-#define RSP_COUNT       (sizeof(m_rsp)/sizeof(m_rsp[0]))
-
 /**
- * \brief   Helper function for finding an entry in an array
- * \param   array
- *          Search array
- * \param   size
- *          Elements in search array
- * \param   value
- *          The value to search
+ * \brief   Class of each function code, indexed by function code.
+ *          Function codes not listed here are \ref WAPS_FUNC_CLASS_UNKNOWN
  */
-static bool find(const uint8_t * array,
-                 const uint8_t size,
-                 const uint8_t value)
+static const uint8_t m_func_class[256] =
+{
+    /* DSAP requests */
+    [WAPS_FUNC_DSAP_DATA_TX_REQ]                     = WAPS_FUNC_CLASS_DSAP_REQUEST,
+    [WAPS_FUNC_DSAP_DATA_TX_TT_REQ]                  = WAPS_FUNC_CLASS_DSAP_REQUEST,
+    [WAPS_FUNC_DSAP_DATA_TX_FRAG_REQ]                = WAPS_FUNC_CLASS_DSAP_REQUEST,
+
+    /* MSAP requests */
+    [WAPS_FUNC_MSAP_INDICATION_POLL_REQ]             = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_STACK_START_REQ]                 = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_STACK_STOP_REQ]                  = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_ATTR_WRITE_REQ]                  = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_ATTR_READ_REQ]                   = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_START_REQ]            = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_BLOCK_REQ]            = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_STATUS_REQ]           = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_BOOTABLE_REQ]         = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_CLEAR_REQ]            = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_REMOTE_STATUS_REQ]               = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_REMOTE_UPDATE_REQ]               = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_GET_NBORS_REQ]                   = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SCAN_NBORS_REQ]                  = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_GET_INSTALL_QUALITY_REQ]         = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SINK_COST_WRITE_REQ]             = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SINK_COST_READ_REQ]              = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_APP_CONFIG_WRITE_REQ]            = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_APP_CONFIG_READ_REQ]             = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_STACK_SLEEP_REQ]                 = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_STACK_SLEEP_STOP_REQ]            = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_STACK_SLEEP_STATE_GET_REQ]       = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_STACK_SLEEP_GOTOSLEEPINFO_REQ]   = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_MAX_MSG_QUEUEING_TIME_WRITE_REQ] = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_MAX_MSG_QUEUEING_TIME_READ_REQ]  = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_TARGET_READ_REQ]      = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_TARGET_WRITE_REQ]     = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_BLOCK_READ_REQ]       = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_FUNC_STATS_READ_REQ]             = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_START_REQ]     = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_BLOCK_REQ]     = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_IND_QUEUE_STATS_READ_REQ]        = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_MULTI_ATTR_READ_REQ]             = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_MULTI_ATTR_WRITE_REQ]            = WAPS_FUNC_CLASS_MSAP_REQUEST,
+    [WAPS_FUNC_MSAP_GET_NBORS_DELTA_REQ]             = WAPS_FUNC_CLASS_MSAP_REQUEST,
+
+    /* CSAP requests */
+    [WAPS_FUNC_CSAP_ATTR_WRITE_REQ]                  = WAPS_FUNC_CLASS_CSAP_REQUEST,
+    [WAPS_FUNC_CSAP_ATTR_READ_REQ]                   = WAPS_FUNC_CLASS_CSAP_REQUEST,
+    [WAPS_FUNC_CSAP_FACTORY_RESET_REQ]               = WAPS_FUNC_CLASS_CSAP_REQUEST,
+    [WAPS_FUNC_CSAP_MULTI_ATTR_READ_REQ]             = WAPS_FUNC_CLASS_CSAP_REQUEST,
+    [WAPS_FUNC_CSAP_MULTI_ATTR_WRITE_REQ]            = WAPS_FUNC_CLASS_CSAP_REQUEST,
+
+    /* Confirmations */
+    [WAPS_FUNC_DSAP_DATA_TX_CNF]                     = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_DSAP_DATA_TX_FRAG_CNF]                = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_INDICATION_POLL_CNF]             = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_STACK_START_CNF]                 = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_STACK_STOP_CNF]                  = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_APP_CONFIG_WRITE_CNF]            = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_APP_CONFIG_READ_CNF]             = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_ATTR_WRITE_CNF]                  = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_ATTR_READ_CNF]                   = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_GET_NBORS_CNF]                   = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SCAN_NBORS_CNF]                  = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_GET_INSTALL_QUALITY_CNF]         = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SINK_COST_WRITE_CNF]             = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SINK_COST_READ_CNF]              = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_CSAP_ATTR_WRITE_CNF]                  = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_CSAP_ATTR_READ_CNF]                   = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_CSAP_FACTORY_RESET_CNF]               = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_START_CNF]            = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_BLOCK_CNF]            = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_STATUS_CNF]           = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_BOOTABLE_CNF]         = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_CLEAR_CNF]            = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_REMOTE_STATUS_CNF]               = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_REMOTE_UPDATE_CNF]               = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_DSAP_DATA_TX_TT_CNF]                  = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_STACK_SLEEP_REQ_CNF]             = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_STACK_SLEEP_STOP_CNF]            = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_MAX_MSG_QUEUEING_TIME_WRITE_CNF] = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_MAX_MSG_QUEUEING_TIME_READ_CNF]  = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_TARGET_READ_CNF]      = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_TARGET_WRITE_CNF]     = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_BLOCK_READ_CNF]       = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_FUNC_STATS_READ_CNF]             = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_START_CNF]     = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_BLOCK_CNF]     = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_IND_QUEUE_STATS_READ_CNF]        = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_MULTI_ATTR_READ_CNF]             = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_MULTI_ATTR_WRITE_CNF]            = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_CSAP_MULTI_ATTR_READ_CNF]             = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_CSAP_MULTI_ATTR_WRITE_CNF]            = WAPS_FUNC_CLASS_CONFIRMATION,
+    [WAPS_FUNC_MSAP_GET_NBORS_DELTA_CNF]             = WAPS_FUNC_CLASS_CONFIRMATION,
+
+    /* Indications */
+    [WAPS_FUNC_DSAP_DATA_TX_IND]                     = WAPS_FUNC_CLASS_INDICATION,
+    [WAPS_FUNC_DSAP_DATA_RX_FRAG_IND]                = WAPS_FUNC_CLASS_INDICATION,
+    [WAPS_FUNC_DSAP_DATA_RX_IND]                     = WAPS_FUNC_CLASS_INDICATION,
+    [WAPS_FUNC_MSAP_STACK_STATE_IND]                 = WAPS_FUNC_CLASS_INDICATION,
+    [WAPS_FUNC_MSAP_APP_CONFIG_RX_IND]               = WAPS_FUNC_CLASS_INDICATION,
+    [WAPS_FUNC_MSAP_REMOTE_STATUS_IND]               = WAPS_FUNC_CLASS_INDICATION,
+    [WAPS_FUNC_MSAP_SCAN_NBORS_IND]                  = WAPS_FUNC_CLASS_INDICATION,
+
+    /* Responses */
+    [WAPS_FUNC_DSAP_DATA_TX_RSP]                     = WAPS_FUNC_CLASS_RESPONSE,
+    [WAPS_FUNC_DSAP_DATA_RX_FRAG_RSP]                = WAPS_FUNC_CLASS_RESPONSE,
+    [WAPS_FUNC_DSAP_DATA_RX_RSP]                     = WAPS_FUNC_CLASS_RESPONSE,
+    [WAPS_FUNC_MSAP_STACK_STATE_RSP]                 = WAPS_FUNC_CLASS_RESPONSE,
+    [WAPS_FUNC_MSAP_APP_CONFIG_RX_RSP]               = WAPS_FUNC_CLASS_RESPONSE,
+    [WAPS_FUNC_MSAP_REMOTE_STATUS_RSP]               = WAPS_FUNC_CLASS_RESPONSE,
+    [WAPS_FUNC_MSAP_SCAN_NBORS_RSP]                  = WAPS_FUNC_CLASS_RESPONSE,
+    [WAPS_FUNC_MSAP_STACK_SLEEP_STATE_GET_RSP]       = WAPS_FUNC_CLASS_RESPONSE,
+    [WAPS_FUNC_MSAP_STACK_SLEEP_GOTOSLEEPINFO_RSP]   = WAPS_FUNC_CLASS_RESPONSE,
+};
+
+waps_func_class_e WapsFunc_getClass(uint8_t func)
 {
-    for (uint32_t i = 0; i < size; i++)
-    {
-        if (array[i] == value)
-        {
-            return true;
-        }
-    }
-    return false;
+    return (waps_func_class_e)m_func_class[func];
 }
 
 bool WapsFunc_isDsapRequest(uint8_t func)
 {
-    return find(m_dsap_req, DSAP_REQ_COUNT, func);
+    return m_func_class[func] == WAPS_FUNC_CLASS_DSAP_REQUEST;
 }
 
 bool WapsFunc_isMsapRequest(uint8_t func)
 {
-    return find(m_msap_req, MSAP_REQ_COUNT, func);
+    return m_func_class[func] == WAPS_FUNC_CLASS_MSAP_REQUEST;
 }
 
 bool WapsFunc_isCsapRequest(uint8_t func)
 {
-    return find(m_csap_req, CSAP_REQ_COUNT, func);
+    return m_func_class[func] == WAPS_FUNC_CLASS_CSAP_REQUEST;
 }
 
 bool WapsFunc_isRequest(const uint8_t func)
@@ -70,15 +157,15 @@ bool WapsFunc_isRequest(const uint8_t func)
 
 bool WapsFunc_isConfirmation(const uint8_t func)
 {
-    return find(m_cnf, CNF_COUNT, func);
+    return m_func_class[func] == WAPS_FUNC_CLASS_CONFIRMATION;
 }
 
 bool WapsFunc_isIndication(const uint8_t func)
 {
-    return find(m_ind, IND_COUNT, func);
+    return m_func_class[func] == WAPS_FUNC_CLASS_INDICATION;
 }
 
 bool WapsFunc_isResponse(const uint8_t func)
 {
-    return find(m_rsp, RSP_COUNT, func);
+    return m_func_class[func] == WAPS_FUNC_CLASS_RESPONSE;
 }
@@ -131,6 +131,39 @@ typedef enum
     WAPS_FUNC_MSAP_MAX_MSG_QUEUEING_TIME_READ_REQ = 0x50,
     WAPS_FUNC_MSAP_MAX_MSG_QUEUEING_TIME_READ_CNF = 0xD0,
 
+    /* MSAP-FUNC_STATS_READ REQ */
+    WAPS_FUNC_MSAP_FUNC_STATS_READ_REQ = 0x51,
+    WAPS_FUNC_MSAP_FUNC_STATS_READ_CNF = 0xD1,
+
+    /* MSAP-SCRATCHPAD_STREAM_START REQ */
+    WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_START_REQ = 0x52,
+    WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_START_CNF = 0xD2,
+    /* MSAP-SCRATCHPAD_STREAM_BLOCK REQ */
+    WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_BLOCK_REQ = 0x53,
+    WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_BLOCK_CNF = 0xD3,
+
+    /* MSAP-IND_QUEUE_STATS_READ REQ */
+    WAPS_FUNC_MSAP_IND_QUEUE_STATS_READ_REQ = 0x54,
+    WAPS_FUNC_MSAP_IND_QUEUE_STATS_READ_CNF = 0xD4,
+
+    /* MSAP-MULTI_ATTR_READ REQ */
+    WAPS_FUNC_MSAP_MULTI_ATTR_READ_REQ = 0x55,
+    WAPS_FUNC_MSAP_MULTI_ATTR_READ_CNF = 0xD5,
+    /* MSAP-MULTI_ATTR_WRITE REQ */
+    WAPS_FUNC_MSAP_MULTI_ATTR_WRITE_REQ = 0x56,
+    WAPS_FUNC_MSAP_MULTI_ATTR_WRITE_CNF = 0xD6,
+
+    /* CSAP-MULTI_ATTR_READ REQ */
+    WAPS_FUNC_CSAP_MULTI_ATTR_READ_REQ = 0x57,
+    WAPS_FUNC_CSAP_MULTI_ATTR_READ_CNF = 0xD7,
+    /* CSAP-MULTI_ATTR_WRITE REQ */
+    WAPS_FUNC_CSAP_MULTI_ATTR_WRITE_REQ = 0x58,
+    WAPS_FUNC_CSAP_MULTI_ATTR_WRITE_CNF = 0xD8,
+
+    /* MSAP-GET_NBORS_DELTA REQ */
+    WAPS_FUNC_MSAP_GET_NBORS_DELTA_REQ = 0x59,
+    WAPS_FUNC_MSAP_GET_NBORS_DELTA_CNF = 0xD9,
+
     /* Reserved request ids (only present in Remote API). */
     WAPS_FUNC_RESERVED_REMOTE_API_1_REQ = 0x60,
     WAPS_FUNC_RESERVED_REMOTE_API_1_CNF = 0xE0,
@@ -143,115 +176,27 @@ typedef enum
 
 } waps_func_e;
 
-/* When you add/remove functions, make sure you update the tables below */
-
-#define DSAP_REQUESTS                   \
-{                                       \
-    WAPS_FUNC_DSAP_DATA_TX_REQ,         \
-    WAPS_FUNC_DSAP_DATA_TX_TT_REQ,      \
-    WAPS_FUNC_DSAP_DATA_TX_FRAG_REQ,    \
-}
-
-#define MSAP_REQUESTS                               \
-{                                                   \
-    WAPS_FUNC_MSAP_INDICATION_POLL_REQ,             \
-    WAPS_FUNC_MSAP_STACK_START_REQ,                 \
-    WAPS_FUNC_MSAP_STACK_STOP_REQ,                  \
-    WAPS_FUNC_MSAP_ATTR_WRITE_REQ,                  \
-    WAPS_FUNC_MSAP_ATTR_READ_REQ,                   \
-    WAPS_FUNC_MSAP_SCRATCHPAD_START_REQ,            \
-    WAPS_FUNC_MSAP_SCRATCHPAD_BLOCK_REQ,            \
-    WAPS_FUNC_MSAP_SCRATCHPAD_STATUS_REQ,           \
-    WAPS_FUNC_MSAP_SCRATCHPAD_BOOTABLE_REQ,         \
-    WAPS_FUNC_MSAP_SCRATCHPAD_CLEAR_REQ,            \
-    WAPS_FUNC_MSAP_REMOTE_STATUS_REQ,               \
-    WAPS_FUNC_MSAP_REMOTE_UPDATE_REQ,               \
-    WAPS_FUNC_MSAP_GET_NBORS_REQ,                   \
-    WAPS_FUNC_MSAP_SCAN_NBORS_REQ,                  \
-    WAPS_FUNC_MSAP_GET_INSTALL_QUALITY_REQ,         \
-    WAPS_FUNC_MSAP_SINK_COST_WRITE_REQ,             \
-    WAPS_FUNC_MSAP_SINK_COST_READ_REQ,              \
-    WAPS_FUNC_MSAP_APP_CONFIG_WRITE_REQ,            \
-    WAPS_FUNC_MSAP_APP_CONFIG_READ_REQ,             \
-    WAPS_FUNC_MSAP_STACK_SLEEP_REQ,                 \
-    WAPS_FUNC_MSAP_STACK_SLEEP_STOP_REQ,            \
-    WAPS_FUNC_MSAP_STACK_SLEEP_STATE_GET_REQ,       \
-    WAPS_FUNC_MSAP_STACK_SLEEP_GOTOSLEEPINFO_REQ,   \
-    WAPS_FUNC_MSAP_MAX_MSG_QUEUEING_TIME_WRITE_REQ, \
-    WAPS_FUNC_MSAP_MAX_MSG_QUEUEING_TIME_READ_REQ,  \
-    WAPS_FUNC_MSAP_SCRATCHPAD_TARGET_READ_REQ,      \
-    WAPS_FUNC_MSAP_SCRATCHPAD_TARGET_WRITE_REQ,     \
-    WAPS_FUNC_MSAP_SCRATCHPAD_BLOCK_READ_REQ        \
-}
-
-#define CSAP_REQUESTS                   \
-{                                       \
-    WAPS_FUNC_CSAP_ATTR_WRITE_REQ,      \
-    WAPS_FUNC_CSAP_ATTR_READ_REQ,       \
-    WAPS_FUNC_CSAP_FACTORY_RESET_REQ,   \
-}
-
-#define WAPS_CONFIRMATIONS                          \
-{                                                   \
-    WAPS_FUNC_DSAP_DATA_TX_CNF,                     \
-    WAPS_FUNC_DSAP_DATA_TX_FRAG_CNF,                \
-    WAPS_FUNC_MSAP_INDICATION_POLL_CNF,             \
-    WAPS_FUNC_MSAP_STACK_START_CNF,                 \
-    WAPS_FUNC_MSAP_STACK_STOP_CNF,                  \
-    WAPS_FUNC_MSAP_APP_CONFIG_WRITE_CNF,            \
-    WAPS_FUNC_MSAP_APP_CONFIG_READ_CNF,             \
-    WAPS_FUNC_MSAP_ATTR_WRITE_CNF,                  \
-    WAPS_FUNC_MSAP_ATTR_READ_CNF,                   \
-    WAPS_FUNC_MSAP_GET_NBORS_CNF,                   \
-    WAPS_FUNC_MSAP_SCAN_NBORS_CNF,                  \
-    WAPS_FUNC_MSAP_GET_INSTALL_QUALITY_CNF,         \
-    WAPS_FUNC_MSAP_SINK_COST_WRITE_CNF,             \
-    WAPS_FUNC_MSAP_SINK_COST_READ_CNF,              \
-    WAPS_FUNC_CSAP_ATTR_WRITE_CNF,                  \
-    WAPS_FUNC_CSAP_ATTR_READ_CNF,                   \
-    WAPS_FUNC_CSAP_FACTORY_RESET_CNF,               \
-    WAPS_FUNC_MSAP_SCRATCHPAD_START_CNF,            \
-    WAPS_FUNC_MSAP_SCRATCHPAD_BLOCK_CNF,            \
-    WAPS_FUNC_MSAP_SCRATCHPAD_STATUS_CNF,           \
-    WAPS_FUNC_MSAP_SCRATCHPAD_BOOTABLE_CNF,         \
-    WAPS_FUNC_MSAP_SCRATCHPAD_CLEAR_CNF,            \
-    WAPS_FUNC_MSAP_REMOTE_STATUS_CNF,               \
-    WAPS_FUNC_MSAP_REMOTE_UPDATE_CNF,               \
-    WAPS_FUNC_DSAP_DATA_TX_TT_CNF,                  \
-    WAPS_FUNC_MSAP_APP_CONFIG_WRITE_CNF,            \
-    WAPS_FUNC_MSAP_APP_CONFIG_READ_CNF,             \
-    WAPS_FUNC_MSAP_STACK_SLEEP_REQ_CNF,             \
-    WAPS_FUNC_MSAP_STACK_SLEEP_STOP_CNF,            \
-    WAPS_FUNC_MSAP_MAX_MSG_QUEUEING_TIME_WRITE_CNF, \
-    WAPS_FUNC_MSAP_MAX_MSG_QUEUEING_TIME_READ_CNF,  \
-    WAPS_FUNC_MSAP_SCRATCHPAD_TARGET_READ_CNF,      \
-    WAPS_FUNC_MSAP_SCRATCHPAD_TARGET_WRITE_CNF,     \
-    WAPS_FUNC_MSAP_SCRATCHPAD_BLOCK_READ_CNF,       \
-}
-
-#define WAPS_INDICATIONS                            \
-{                                                   \
-    WAPS_FUNC_DSAP_DATA_TX_IND,                     \
-    WAPS_FUNC_DSAP_DATA_RX_FRAG_IND,                \
-    WAPS_FUNC_DSAP_DATA_RX_IND,                     \
-    WAPS_FUNC_MSAP_STACK_STATE_IND,                 \
-    WAPS_FUNC_MSAP_APP_CONFIG_RX_IND,               \
-    WAPS_FUNC_MSAP_REMOTE_STATUS_IND,               \
-    WAPS_FUNC_MSAP_SCAN_NBORS_IND,                  \
-}
+/* When you add/remove functions, make sure you update the table in
+ * function_codes.c */
 
-#define WAPS_RESPONSES                              \
-{                                                   \
-    WAPS_FUNC_DSAP_DATA_TX_RSP,                     \
-    WAPS_FUNC_DSAP_DATA_RX_FRAG_RSP,                \
-    WAPS_FUNC_DSAP_DATA_RX_RSP,                     \
-    WAPS_FUNC_MSAP_STACK_STATE_RSP,                 \
-    WAPS_FUNC_MSAP_APP_CONFIG_RX_RSP,               \
-    WAPS_FUNC_MSAP_REMOTE_STATUS_RSP,               \
-    WAPS_FUNC_MSAP_SCAN_NBORS_RSP,                  \
-    WAPS_FUNC_MSAP_STACK_SLEEP_STATE_GET_RSP,       \
-    WAPS_FUNC_MSAP_STACK_SLEEP_GOTOSLEEPINFO_RSP,   \
-}
+/** Function code classes */
+typedef enum
+{
+    WAPS_FUNC_CLASS_UNKNOWN = 0,
+    WAPS_FUNC_CLASS_DSAP_REQUEST,
+    WAPS_FUNC_CLASS_MSAP_REQUEST,
+    WAPS_FUNC_CLASS_CSAP_REQUEST,
+    WAPS_FUNC_CLASS_CONFIRMATION,
+    WAPS_FUNC_CLASS_INDICATION,
+    WAPS_FUNC_CLASS_RESPONSE,
+} waps_func_class_e;
+
+/** \brief  Get class of given func code, in constant time
+ *  \param  func
+ *          Function code to check
+ *  \return Class of the function code
+ */
+waps_func_class_e WapsFunc_getClass(uint8_t func);
 
 /** \brief  Check if given func code is a request
  *  \param  func
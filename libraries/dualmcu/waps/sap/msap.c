@@ -19,6 +19,9 @@
 #include "shared_appconfig.h"
 #include "stack_state.h"
 #include "ds.h"
+#include "crc.h"
+#include "waps_ind_queue.h"
+#include "multi_attr.h"
 
 /* Request handlers */
 static bool stackStart(waps_item_t * item);
@@ -57,19 +60,30 @@ static bool writeInterest(waps_item_t * item);
 static bool readInterest(waps_item_t * item);
 
 static bool getNbors(waps_item_t * item);
+static void fillNborEntry(msap_neighbor_entry_t * nbor_entry,
+                          const app_lib_state_nbor_info_t * info);
+static bool getNborsDelta(waps_item_t * item);
 static bool startScanNbors(waps_item_t * item);
 static bool getInstallQuality(waps_item_t * item);
 static bool attrReadReq(waps_item_t * item);
+static attribute_result_e readAttrChecked(attr_t attr_id,
+                                          uint8_t * value,
+                                          uint8_t * attr_size_p);
 static attribute_result_e readAttr(attr_t attr_id,
                                    uint8_t * value,
                                    uint8_t attr_size);
 static bool attrWriteReq(waps_item_t * item);
+static attribute_result_e writeAttrChecked(attr_t attr_id,
+                                           const uint8_t * value,
+                                           uint8_t attr_len);
 static attribute_result_e writeAttr(attr_t attr_id,
                                     const uint8_t * value,
                                     uint8_t attr_size);
 static bool pollRequest(waps_item_t * item);
 static bool scratchpadStart(waps_item_t * item);
 static bool scratchpadBlock(waps_item_t * item);
+static bool scratchpadStreamStart(waps_item_t * item);
+static bool scratchpadStreamBlock(waps_item_t * item);
 static bool scratchpadStatus(waps_item_t * item);
 static bool scratchpadSetUpdate(waps_item_t * item);
 static bool scratchpadClear(waps_item_t * item);
@@ -85,6 +99,8 @@ static bool sleep_state_request(waps_item_t * item);
 static bool sleep_gotosleepinfo_request(waps_item_t * item);
 static bool max_msg_queuing_time_write_req(waps_item_t * item);
 static bool max_msg_queuing_time_read_req(waps_item_t * item);
+static bool func_stats_read_req(waps_item_t * item);
+static bool ind_queue_stats_read_req(waps_item_t * item);
 
 /* Map attr id to attr length */
 static const uint8_t m_attr_size_lut[] =
@@ -105,6 +121,76 @@ static const uint8_t m_attr_size_lut[] =
     MSAP_ATTR_SCRATCHPAD_NUM_BYTES_SIZE,
 };
 
+#ifndef WAPS_SCRATCHPAD_STREAM_WINDOW
+/** Blocks the host may send ahead of the acknowledgements. Each one in flight
+ *  holds a WAPS item, so keep it below the item pool size */
+#define WAPS_SCRATCHPAD_STREAM_WINDOW   4
+#endif
+
+#if (WAPS_SCRATCHPAD_STREAM_WINDOW < 1) || (WAPS_SCRATCHPAD_STREAM_WINDOW > 255)
+#error "WAPS_SCRATCHPAD_STREAM_WINDOW must be between 1 and 255"
+#endif
+
+/** State of an ongoing streamed scratchpad upload */
+typedef struct
+{
+    /** Offset where the next block is written */
+    uint32_t    offset;
+    /** CRC of the data written so far */
+    uint16_t    crc;
+    /** CRC of the whole data, given by the host */
+    uint16_t    expected_crc;
+    /** Sequence of the next block to write */
+    uint16_t    next_seq;
+    /** In-order blocks between acknowledgements */
+    uint8_t     ack_interval;
+    /** In-order blocks written since last acknowledgement */
+    uint8_t     unacked;
+    /** Out-of-sequence block already reported for the current gap */
+    bool        gap_reported;
+    /** Stream is ongoing */
+    bool        ongoing;
+    /** Stream ended with its last block written, blocks resent after that
+     *  get completed_result */
+    bool        completed;
+    /** Result of the last block of a completed stream */
+    uint8_t     completed_result;
+} scratchpad_stream_t;
+
+static scratchpad_stream_t m_stream;
+
+/** Neighbors with their removed ones kept for MSAP-GET_NBORS_DELTA */
+#define MSAP_NBOR_CACHE_SIZE    (MSAP_MAX_NBORS + MSAP_NBORS_DELTA_MAX_REMOVED)
+
+/** Neighbor as last reported to the host */
+typedef struct
+{
+    /** Latest neighbor values */
+    msap_neighbor_entry_t   entry;
+    /** Values when neighbor was last reported, to compare with thresholds */
+    int8_t                  ref_rssi_norm;
+    int8_t                  ref_rx_power;
+    uint8_t                 ref_link_rel;
+    /** Generation of last report (added, changed or removed) */
+    uint16_t                generation;
+    /** Entry is in use */
+    bool                    used;
+    /** Neighbor is still present, otherwise removal is kept for delta */
+    bool                    present;
+} nbor_cache_entry_t;
+
+typedef struct
+{
+    nbor_cache_entry_t      entries[MSAP_NBOR_CACHE_SIZE];
+    /** Generation of the latest change */
+    uint16_t                generation;
+    /** Hosts with older generation may miss removals and get all */
+    uint16_t                horizon;
+    bool                    initialized;
+} nbor_cache_t;
+
+static nbor_cache_t m_nbor_cache;
+
 /** App stack state flags */
 typedef enum
 {
@@ -305,12 +391,24 @@ bool Msap_handleFrame(waps_item_t * item)
             return attrReadReq(item);
         case WAPS_FUNC_MSAP_ATTR_WRITE_REQ:
             return attrWriteReq(item);
+        case WAPS_FUNC_MSAP_MULTI_ATTR_READ_REQ:
+            return MultiAttr_read(item,
+                                  WAPS_FUNC_MSAP_MULTI_ATTR_READ_CNF,
+                                  readAttrChecked);
+        case WAPS_FUNC_MSAP_MULTI_ATTR_WRITE_REQ:
+            return MultiAttr_write(item,
+                                   WAPS_FUNC_MSAP_MULTI_ATTR_WRITE_CNF,
+                                   writeAttrChecked);
         case WAPS_FUNC_MSAP_INDICATION_POLL_REQ:
             return pollRequest(item);
         case WAPS_FUNC_MSAP_SCRATCHPAD_START_REQ:
             return scratchpadStart(item);
         case WAPS_FUNC_MSAP_SCRATCHPAD_BLOCK_REQ:
             return scratchpadBlock(item);
+        case WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_START_REQ:
+            return scratchpadStreamStart(item);
+        case WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_BLOCK_REQ:
+            return scratchpadStreamBlock(item);
         case WAPS_FUNC_MSAP_SCRATCHPAD_STATUS_REQ:
             return scratchpadStatus(item);
         case WAPS_FUNC_MSAP_SCRATCHPAD_BOOTABLE_REQ:
@@ -329,6 +427,8 @@ bool Msap_handleFrame(waps_item_t * item)
             return remoteUpdate(item);
         case WAPS_FUNC_MSAP_GET_NBORS_REQ:
             return getNbors(item);
+        case WAPS_FUNC_MSAP_GET_NBORS_DELTA_REQ:
+            return getNborsDelta(item);
         case WAPS_FUNC_MSAP_SCAN_NBORS_REQ:
             return startScanNbors(item);
         case WAPS_FUNC_MSAP_GET_INSTALL_QUALITY_REQ:
@@ -349,6 +449,10 @@ bool Msap_handleFrame(waps_item_t * item)
             return max_msg_queuing_time_write_req(item);
         case WAPS_FUNC_MSAP_MAX_MSG_QUEUEING_TIME_READ_REQ:
             return max_msg_queuing_time_read_req(item);
+        case WAPS_FUNC_MSAP_FUNC_STATS_READ_REQ:
+            return func_stats_read_req(item);
+        case WAPS_FUNC_MSAP_IND_QUEUE_STATS_READ_REQ:
+            return ind_queue_stats_read_req(item);
         default:
             return false;
     }
@@ -525,24 +629,18 @@ static void updateTime(waps_item_t * item)
     memcpy(&item->frame.attr.read_cnf.attr[0], &time, sizeof(uint32_t));
 }
 
-static bool attrReadReq(waps_item_t * item)
+static attribute_result_e readAttrChecked(attr_t attr_id,
+                                          uint8_t * value,
+                                          uint8_t * attr_size_p)
 {
-    read_req_t * req_ptr = &item->frame.attr.read_req;
-    attr_t attr_id = req_ptr->attr_id;
-    attribute_result_e result = ATTR_UNSUPPORTED_ATTRIBUTE;
     uint32_t idx = attr_id - 1;
-    uint8_t attr_size = 0;
 
-    if (item->frame.splen != sizeof(read_req_t))
-    {
-        return false;
-    }
+    *attr_size_p = 0;
 
     /* Check attribute ID */
     if (idx >= sizeof(m_attr_size_lut))
     {
-        result = ATTR_UNSUPPORTED_ATTRIBUTE;
-        goto build_response;
+        return ATTR_UNSUPPORTED_ATTRIBUTE;
     }
 
     /* Check that MSAP attribute read feature is permitted */
@@ -552,8 +650,7 @@ static bool attrReadReq(waps_item_t * item)
         if (!LockBits_isFeaturePermitted(
                 LOCK_BITS_MSAP_SCRATCHPAD_STATUS))
         {
-            result = ATTR_ACCESS_DENIED;
-            goto build_response;
+            return ATTR_ACCESS_DENIED;
         }
     }
     else if ((attr_id == MSAP_ATTR_NBOR_COUNT) ||
@@ -561,27 +658,39 @@ static bool attrReadReq(waps_item_t * item)
     {
         if (!LockBits_isFeaturePermitted(LOCK_BITS_MSAP_GET_NBORS))
         {
-            result = ATTR_ACCESS_DENIED;
-            goto build_response;
+            return ATTR_ACCESS_DENIED;
         }
     }
     else
     {
         if (!LockBits_isFeaturePermitted(LOCK_BITS_MSAP_ATTR_READ))
         {
-            result = ATTR_ACCESS_DENIED;
-            goto build_response;
+            return ATTR_ACCESS_DENIED;
         }
     }
 
     /* attribute found in LUT */
-    attr_size = m_attr_size_lut[idx];
+    *attr_size_p = m_attr_size_lut[idx];
 
     /* Read attribute with attribute manager */
-    result = readAttr(attr_id, item->frame.attr.read_cnf.attr, attr_size);
+    return readAttr(attr_id, value, *attr_size_p);
+}
+
+static bool attrReadReq(waps_item_t * item)
+{
+    read_req_t * req_ptr = &item->frame.attr.read_req;
+    attr_t attr_id = req_ptr->attr_id;
+    attribute_result_e result;
+    uint8_t attr_size = 0;
+
+    if (item->frame.splen != sizeof(read_req_t))
+    {
+        return false;
+    }
+
+    result = readAttrChecked(attr_id, item->frame.attr.read_cnf.attr, &attr_size);
 
     /* Processing done, build response over request */
-build_response:
     Waps_item_init(item,
                    WAPS_FUNC_MSAP_ATTR_READ_CNF,
                    FRAME_READ_CNF_HEADER_SIZE);
@@ -641,7 +750,8 @@ static attribute_result_e readAttr(attr_t attr_id,
             result = lib_state->getRouteCount((size_t*)&tmp);
             break;
         case MSAP_ATTR_SYSTEM_TIME:
-            tmp = 0;    /* Not handled here */
+            /* Single attribute read updates it again just before sending */
+            tmp = lib_time->getTimestampCoarse();
             break;
         case MSAP_ATTR_AC_RANGE:
         {
@@ -689,50 +799,48 @@ static attribute_result_e readAttr(attr_t attr_id,
     return appRes2attrRes(result);
 }
 
-static bool attrWriteReq(waps_item_t * item)
+static attribute_result_e writeAttrChecked(attr_t attr_id,
+                                           const uint8_t * value,
+                                           uint8_t attr_len)
 {
-    write_req_t * req_ptr = &item->frame.attr.write_req;
-    attr_t attr_id = req_ptr->attr_id;
     uint32_t idx = attr_id - 1;
-    uint8_t attr_size = 0;
-    attribute_result_e result = ATTR_SUCCESS;
-
-    if (item->frame.splen != (FRAME_WRITE_REQ_HEADER_SIZE +
-                             req_ptr->attr_len))
-    {
-        return false;
-    }
 
     /* Check attribute ID */
     if (idx >= sizeof(m_attr_size_lut))
     {
-        result = ATTR_UNSUPPORTED_ATTRIBUTE;
-        goto build_response;
+        return ATTR_UNSUPPORTED_ATTRIBUTE;
     }
 
-
     /* Check that MSAP attribute write feature is permitted */
     if (!LockBits_isFeaturePermitted(LOCK_BITS_MSAP_ATTR_WRITE))
     {
-        result = ATTR_ACCESS_DENIED;
-        goto build_response;
+        return ATTR_ACCESS_DENIED;
     }
 
-    /* attribute found in LUT */
-    attr_size = m_attr_size_lut[idx];
-
-    /* Check length */
-    if (attr_size != req_ptr->attr_len)
+    /* Check length against the one in LUT */
+    if (m_attr_size_lut[idx] != attr_len)
     {
-        result = ATTR_INV_LENGTH;
-        goto build_response;
+        return ATTR_INV_LENGTH;
     }
 
     /* Write attribute with attribute manager */
-    result = writeAttr(attr_id, req_ptr->attr, attr_size);
+    return writeAttr(attr_id, value, attr_len);
+}
+
+static bool attrWriteReq(waps_item_t * item)
+{
+    write_req_t * req_ptr = &item->frame.attr.write_req;
+    attribute_result_e result;
+
+    if (item->frame.splen != (FRAME_WRITE_REQ_HEADER_SIZE +
+                             req_ptr->attr_len))
+    {
+        return false;
+    }
+
+    result = writeAttrChecked(req_ptr->attr_id, req_ptr->attr, req_ptr->attr_len);
 
     /* Processing done, build response over request */
-build_response:
     Waps_item_init(item,
                    WAPS_FUNC_MSAP_ATTR_WRITE_CNF,
                    sizeof(simple_cnf_t));
@@ -972,31 +1080,7 @@ static bool getNbors(waps_item_t * item)
         app_lib_state_nbor_info_t * info = &nbors[0];
         for(idx = 0; idx < nbors_list.number_nbors; idx++)
         {
-            // Clear
-            memset(&nbor_entry, 0, sizeof(msap_neighbor_entry_t));
-            // Copy
-            nbor_entry.addr = Addr_to_Waddr((app_addr_t)info->address);
-            nbor_entry.channel = info->channel;
-            nbor_entry.cost_0 = info->cost;
-            // Convert last update time-stamp to time since last update
-            nbor_entry.last_update = info->last_update;
-            nbor_entry.link_rel = info->link_reliability;
-            nbor_entry.rssi_norm = info->norm_rssi;
-            nbor_entry.rx_power = info->rx_power;
-            nbor_entry.tx_power = info->tx_power;
-            // Do the switcharoo
-            if(info->type == APP_LIB_STATE_NEIGHBOR_IS_NEXT_HOP)
-            {
-                nbor_entry.type = APP_LIB_STATE_NEIGHBOR_IS_NEXT_HOP;
-            }
-            else if(info->type == APP_LIB_STATE_NEIGHBOR_IS_MEMBER)
-            {
-                nbor_entry.type = NEIGHBOR_IS_MEMBER;
-            }
-            else
-            {
-                nbor_entry.type = NEIGHBOR_IS_CLUSTER;
-            }
+            fillNborEntry(&nbor_entry, info);
             // Copy out
             memcpy(&item->frame.msap.nbor_cnf.neighbors[idx],
                    &nbor_entry,
@@ -1014,6 +1098,331 @@ static bool getNbors(waps_item_t * item)
     return true;
 }
 
+static void fillNborEntry(msap_neighbor_entry_t * nbor_entry,
+                          const app_lib_state_nbor_info_t * info)
+{
+    // Clear
+    memset(nbor_entry, 0, sizeof(msap_neighbor_entry_t));
+    // Copy
+    nbor_entry->addr = Addr_to_Waddr((app_addr_t)info->address);
+    nbor_entry->channel = info->channel;
+    nbor_entry->cost_0 = info->cost;
+    // Convert last update time-stamp to time since last update
+    nbor_entry->last_update = info->last_update;
+    nbor_entry->link_rel = info->link_reliability;
+    nbor_entry->rssi_norm = info->norm_rssi;
+    nbor_entry->rx_power = info->rx_power;
+    nbor_entry->tx_power = info->tx_power;
+    // Do the switcharoo
+    if(info->type == APP_LIB_STATE_NEIGHBOR_IS_NEXT_HOP)
+    {
+        nbor_entry->type = APP_LIB_STATE_NEIGHBOR_IS_NEXT_HOP;
+    }
+    else if(info->type == APP_LIB_STATE_NEIGHBOR_IS_MEMBER)
+    {
+        nbor_entry->type = NEIGHBOR_IS_MEMBER;
+    }
+    else
+    {
+        nbor_entry->type = NEIGHBOR_IS_CLUSTER;
+    }
+}
+
+/** Is generation a newer than generation b (with wrap-around) */
+static inline bool isNewerGeneration(uint16_t a, uint16_t b)
+{
+    return (int16_t)(a - b) > 0;
+}
+
+/** Is the difference between a and b bigger than threshold */
+static inline bool isBeyond(int16_t a, int16_t b, uint8_t threshold)
+{
+    int16_t diff = a - b;
+    return (diff > threshold) || (-diff > threshold);
+}
+
+static bool nborChanged(const nbor_cache_entry_t * cached,
+                        const msap_neighbor_entry_t * nbor_entry,
+                        const msap_nbors_delta_req_t * req)
+{
+    return (cached->entry.type != nbor_entry->type) ||
+           (cached->entry.channel != nbor_entry->channel) ||
+           (cached->entry.cost_0 != nbor_entry->cost_0) ||
+           (cached->entry.tx_power != nbor_entry->tx_power) ||
+           isBeyond(cached->ref_rssi_norm,
+                    nbor_entry->rssi_norm,
+                    req->rssi_threshold) ||
+           isBeyond(cached->ref_rx_power,
+                    nbor_entry->rx_power,
+                    req->rssi_threshold) ||
+           isBeyond(cached->ref_link_rel,
+                    nbor_entry->link_rel,
+                    req->link_rel_threshold);
+}
+
+static void setNborReference(nbor_cache_entry_t * cached)
+{
+    cached->ref_rssi_norm = cached->entry.rssi_norm;
+    cached->ref_rx_power = cached->entry.rx_power;
+    cached->ref_link_rel = cached->entry.link_rel;
+}
+
+/** Find oldest removed neighbor from cache, or NULL if none */
+static nbor_cache_entry_t * oldestRemovedNbor(uint8_t * count_p)
+{
+    nbor_cache_entry_t * oldest = NULL;
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MSAP_NBOR_CACHE_SIZE; i++)
+    {
+        nbor_cache_entry_t * cached = &m_nbor_cache.entries[i];
+        if (cached->used && !cached->present)
+        {
+            count++;
+            if ((oldest == NULL) ||
+                isNewerGeneration(oldest->generation, cached->generation))
+            {
+                oldest = cached;
+            }
+        }
+    }
+    *count_p = count;
+    return oldest;
+}
+
+/** Forget a removed neighbor. Hosts older than the removal can not get a
+ *  delta anymore */
+static void evictNbor(nbor_cache_entry_t * cached)
+{
+    if (isNewerGeneration(cached->generation, m_nbor_cache.horizon))
+    {
+        m_nbor_cache.horizon = cached->generation;
+    }
+    cached->used = false;
+}
+
+/** Find cache entry of a neighbor, NULL if not cached */
+static nbor_cache_entry_t * findNbor(w_addr_t addr)
+{
+    for (uint8_t i = 0; i < MSAP_NBOR_CACHE_SIZE; i++)
+    {
+        if (m_nbor_cache.entries[i].used &&
+            (m_nbor_cache.entries[i].entry.addr == addr))
+        {
+            return &m_nbor_cache.entries[i];
+        }
+    }
+    return NULL;
+}
+
+/** Update neighbor cache from stack, return false if neighbors not read */
+static bool refreshNborCache(const msap_nbors_delta_req_t * req)
+{
+    app_lib_state_nbor_info_t nbors[MSAP_MAX_NBORS];
+    app_lib_state_nbor_list_t nbors_list =
+    {
+        .number_nbors = MSAP_MAX_NBORS,
+        .nbors = &nbors[0],
+    };
+    msap_neighbor_entry_t nbor_entries[MSAP_MAX_NBORS];
+    uint16_t generation = m_nbor_cache.generation + 1;
+    nbor_cache_entry_t * cached;
+    uint8_t removed;
+    bool changed = false;
+
+    if (generation == 0)
+    {
+        // 0 is reserved for hosts with no table
+        generation = 1;
+    }
+
+    if (lib_state->getNbors(&nbors_list) != APP_RES_OK)
+    {
+        return false;
+    }
+
+    for (uint32_t idx = 0; idx < nbors_list.number_nbors; idx++)
+    {
+        fillNborEntry(&nbor_entries[idx], &nbors[idx]);
+    }
+
+    // Removed neighbors first, so that there is room for the added ones
+    for (uint8_t i = 0; i < MSAP_NBOR_CACHE_SIZE; i++)
+    {
+        cached = &m_nbor_cache.entries[i];
+        if (!cached->present)
+        {
+            continue;
+        }
+        cached->present = false;
+        for (uint32_t idx = 0; idx < nbors_list.number_nbors; idx++)
+        {
+            if (nbor_entries[idx].addr == cached->entry.addr)
+            {
+                cached->present = true;
+                break;
+            }
+        }
+        if (!cached->present)
+        {
+            cached->generation = generation;
+            changed = true;
+        }
+    }
+
+    // Only a confirmation worth of removed neighbors is remembered
+    while (((cached = oldestRemovedNbor(&removed)) != NULL) &&
+           (removed > MSAP_NBORS_DELTA_MAX_REMOVED))
+    {
+        evictNbor(cached);
+    }
+
+    for (uint32_t idx = 0; idx < nbors_list.number_nbors; idx++)
+    {
+        msap_neighbor_entry_t * nbor_entry = &nbor_entries[idx];
+        cached = findNbor(nbor_entry->addr);
+
+        if (cached == NULL)
+        {
+            // Cache is sized for all neighbors and removed ones, so if there
+            // is no free entry, there is a removed one
+            for (uint8_t i = 0; i < MSAP_NBOR_CACHE_SIZE; i++)
+            {
+                if (!m_nbor_cache.entries[i].used)
+                {
+                    cached = &m_nbor_cache.entries[i];
+                    break;
+                }
+            }
+            if (cached == NULL)
+            {
+                cached = oldestRemovedNbor(&removed);
+                evictNbor(cached);
+            }
+            cached->used = true;
+            cached->present = false;
+        }
+
+        if (!cached->present || nborChanged(cached, nbor_entry, req))
+        {
+            // Added or changed enough to be reported
+            memcpy(&cached->entry, nbor_entry, sizeof(msap_neighbor_entry_t));
+            setNborReference(cached);
+            cached->present = true;
+            cached->generation = generation;
+            changed = true;
+        }
+        else
+        {
+            // Keep reference values, so that slow drifts are reported too
+            memcpy(&cached->entry, nbor_entry, sizeof(msap_neighbor_entry_t));
+        }
+    }
+
+    if (changed)
+    {
+        m_nbor_cache.generation = generation;
+    }
+    return true;
+}
+
+static bool getNborsDelta(waps_item_t * item)
+{
+    msap_nbors_delta_req_t req;
+    uint8_t changed_count = 0;
+    uint8_t removed_count = 0;
+    bool full;
+
+    if (item->frame.splen != sizeof(msap_nbors_delta_req_t))
+    {
+        return false;
+    }
+    memcpy(&req, &item->frame.msap.nbors_delta_req, sizeof(req));
+
+    // Check that neighbors info feature is permitted
+    if (!LockBits_isFeaturePermitted(LOCK_BITS_MSAP_GET_NBORS))
+    {
+        Waps_item_init(item,
+                       WAPS_FUNC_MSAP_GET_NBORS_DELTA_CNF,
+                       FRAME_MSAP_NBORS_DELTA_CNF_HEADER_SIZE);
+        memset(&item->frame.msap.nbors_delta_cnf,
+               0,
+               FRAME_MSAP_NBORS_DELTA_CNF_HEADER_SIZE);
+        item->frame.msap.nbors_delta_cnf.result =
+            MSAP_NBORS_DELTA_ACCESS_DENIED;
+        return true;
+    }
+
+    if (!m_nbor_cache.initialized)
+    {
+        // Start from a varying generation, so that a host table from before
+        // a reboot is unlikely to be taken as valid
+        m_nbor_cache.generation = (uint16_t)lib_time->getTimestampHp();
+        if (m_nbor_cache.generation == 0)
+        {
+            m_nbor_cache.generation = 1;
+        }
+        m_nbor_cache.horizon = m_nbor_cache.generation;
+        m_nbor_cache.initialized = true;
+    }
+
+    if (!refreshNborCache(&req))
+    {
+        return false;
+    }
+
+    // Host must get everything if its table is unknown, from before the
+    // oldest removal still in the cache, or from the future (reboot)
+    full = (req.generation == 0) ||
+           isNewerGeneration(m_nbor_cache.horizon, req.generation) ||
+           isNewerGeneration(req.generation, m_nbor_cache.generation);
+
+    // Start building response
+    Waps_item_init(item,
+                   WAPS_FUNC_MSAP_GET_NBORS_DELTA_CNF,
+                   FRAME_MSAP_NBORS_DELTA_CNF_HEADER_SIZE);
+    msap_nbors_delta_cnf_t * cnf = &item->frame.msap.nbors_delta_cnf;
+    uint8_t * data = cnf->data;
+
+    // Added and changed neighbors first
+    for (uint8_t i = 0; i < MSAP_NBOR_CACHE_SIZE; i++)
+    {
+        nbor_cache_entry_t * cached = &m_nbor_cache.entries[i];
+        if (cached->present &&
+            (full || isNewerGeneration(cached->generation, req.generation)))
+        {
+            if (full)
+            {
+                // Host gets current values
+                setNborReference(cached);
+            }
+            memcpy(data, &cached->entry, sizeof(msap_neighbor_entry_t));
+            data += sizeof(msap_neighbor_entry_t);
+            changed_count++;
+        }
+    }
+
+    // Then removed ones, as addresses only
+    for (uint8_t i = 0; i < MSAP_NBOR_CACHE_SIZE && !full; i++)
+    {
+        nbor_cache_entry_t * cached = &m_nbor_cache.entries[i];
+        if (cached->used && !cached->present &&
+            isNewerGeneration(cached->generation, req.generation))
+        {
+            memcpy(data, &cached->entry.addr, sizeof(w_addr_t));
+            data += sizeof(w_addr_t);
+            removed_count++;
+        }
+    }
+
+    cnf->result = MSAP_NBORS_DELTA_SUCCESS;
+    cnf->full = full ? 1 : 0;
+    cnf->generation = m_nbor_cache.generation;
+    cnf->changed_count = changed_count;
+    cnf->removed_count = removed_count;
+    item->frame.splen = (uint8_t)(data - (uint8_t *)cnf);
+    return true;
+}
+
 static bool startScanNbors(waps_item_t * item)
 {
     if (item->frame.splen != 0)
@@ -1091,6 +1500,8 @@ static bool scratchpadClear(waps_item_t * item)
          * won't know when the clearing is done.
          */
         lib_otap->clear();
+        m_stream.ongoing = false;
+        m_stream.completed = false;
     }
     /* Build response */
     Waps_item_init(item,
@@ -1129,6 +1540,8 @@ static bool scratchpadStart(waps_item_t * item)
         {
             result = MSAP_SCRATCHPAD_START_INVALID_NUM_BYTES;
         }
+        m_stream.ongoing = false;
+        m_stream.completed = false;
     }
     /* Build response */
     Waps_item_init(item,
@@ -1193,6 +1606,200 @@ static bool scratchpadBlock(waps_item_t * item)
     return true;
 }
 
+/** \brief  Start a streamed scratchpad upload */
+static bool scratchpadStreamStart(waps_item_t * item)
+{
+    if (item->frame.splen != sizeof(msap_scratchpad_stream_start_req_t))
+    {
+        return false;
+    }
+    msap_scratchpad_start_e result = MSAP_SCRATCHPAD_START_SUCCESS;
+    msap_scratchpad_stream_start_req_t * req =
+        &item->frame.msap.scratchpad_stream_start_req;
+    uint8_t ack_interval = req->ack_interval;
+    if ((ack_interval == 0) || (ack_interval > WAPS_SCRATCHPAD_STREAM_WINDOW))
+    {
+        ack_interval = WAPS_SCRATCHPAD_STREAM_WINDOW;
+    }
+
+    /* Same permissions as the block by block upload */
+    if (!LockBits_isFeaturePermitted(LOCK_BITS_MSAP_SCRATCHPAD_START))
+    {
+        result = MSAP_SCRATCHPAD_START_ACCESS_DENIED;
+    }
+    else if (lib_state->getStackState() == APP_LIB_STATE_STARTED)
+    {
+        result = MSAP_SCRATCHPAD_START_INVALID_STATE;
+    }
+    else if (lib_otap->begin(req->num_bytes, req->seq) != APP_RES_OK)
+    {
+        result = MSAP_SCRATCHPAD_START_INVALID_NUM_BYTES;
+        m_stream.ongoing = false;
+        m_stream.completed = false;
+    }
+    else
+    {
+        m_stream.offset = 0;
+        m_stream.crc = Crc_initValue();
+        m_stream.expected_crc = req->crc;
+        m_stream.next_seq = 0;
+        m_stream.ack_interval = ack_interval;
+        m_stream.unacked = 0;
+        m_stream.gap_reported = false;
+        m_stream.ongoing = true;
+        m_stream.completed = false;
+    }
+    /* Build response */
+    Waps_item_init(item,
+                   WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_START_CNF,
+                   sizeof(msap_scratchpad_stream_start_cnf_t));
+    msap_scratchpad_stream_start_cnf_t * cnf =
+        &item->frame.msap.scratchpad_stream_start_cnf;
+    cnf->result = result;
+    cnf->window = WAPS_SCRATCHPAD_STREAM_WINDOW;
+    cnf->ack_interval = ack_interval;
+    return true;
+}
+
+/**
+ * \brief  Write a block of a streamed scratchpad upload
+ *
+ * Host keeps up to WAPS_SCRATCHPAD_STREAM_WINDOW blocks in flight. Blocks
+ * are written in sequence order and acknowledged cumulatively, only every
+ * ack_interval blocks, on error or when the stream ends. A missing block is
+ * reported once, after which the host resends from the acknowledged sequence
+ * (go-back-N). Already written blocks are acknowledged again but not
+ * rewritten, so that a lost acknowledgement does not stall the host. This
+ * holds after the last block too: a resent block then gets the result of
+ * the completed stream.
+ */
+static bool scratchpadStreamBlock(waps_item_t * item)
+{
+    msap_scratchpad_stream_block_e result = MSAP_SCRATCHPAD_STREAM_BLOCK_SUCCESS;
+    msap_scratchpad_stream_block_req_t * req =
+        &item->frame.msap.scratchpad_stream_block_req;
+    if (item->frame.splen !=
+        (FRAME_MSAP_SCRATCHPAD_STREAM_BLOCK_REQ_HEADER_SIZE + req->num_bytes))
+    {
+        return false;
+    }
+    /* Store frame id, so we won't lose it later */
+    uint8_t sfid = item->frame.sfid;
+    /* Distance from the expected block, with wrap around */
+    int16_t ahead = (int16_t)(req->block_seq - m_stream.next_seq);
+
+    if (lib_state->getStackState() == APP_LIB_STATE_STARTED)
+    {
+        result = MSAP_SCRATCHPAD_STREAM_BLOCK_INVALID_STATE;
+    }
+    else if (!m_stream.ongoing)
+    {
+        if (m_stream.completed && (ahead < 0))
+        {
+            /* Acknowledgement of the last block was lost */
+            result = m_stream.completed_result;
+        }
+        else
+        {
+            result = MSAP_SCRATCHPAD_STREAM_BLOCK_NOT_ONGOING;
+        }
+    }
+    else if (ahead < 0)
+    {
+        /* Already written: acknowledge again */
+        m_stream.unacked = 0;
+    }
+    else if (ahead > 0)
+    {
+        if (m_stream.gap_reported)
+        {
+            /* Rest of the window in flight, host already knows */
+            return false;
+        }
+        m_stream.gap_reported = true;
+        m_stream.unacked = 0;
+        result = MSAP_SCRATCHPAD_STREAM_BLOCK_OUT_OF_SEQUENCE;
+    }
+    else
+    {
+        switch(lib_otap->write(m_stream.offset, req->num_bytes, req->bytes))
+        {
+            case APP_LIB_OTAP_WRITE_RES_OK:
+                result = MSAP_SCRATCHPAD_STREAM_BLOCK_SUCCESS;
+                break;
+            case APP_LIB_OTAP_WRITE_RES_COMPLETED_OK:
+                result = MSAP_SCRATCHPAD_STREAM_BLOCK_COMPLETED_OK;
+                break;
+            case APP_LIB_OTAP_WRITE_RES_COMPLETED_ERROR:
+                result = MSAP_SCRATCHPAD_STREAM_BLOCK_COMPLETED_ERROR;
+                break;
+            case APP_LIB_OTAP_WRITE_RES_NOT_ONGOING:
+                result = MSAP_SCRATCHPAD_STREAM_BLOCK_NOT_ONGOING;
+                break;
+            case APP_LIB_OTAP_WRITE_RES_INVALID_NUM_BYTES:
+                result = MSAP_SCRATCHPAD_STREAM_BLOCK_INVALID_NUM_BYTES;
+                break;
+            case APP_LIB_OTAP_WRITE_RES_INVALID_START:
+            case APP_LIB_OTAP_WRITE_RES_INVALID_HEADER:
+            case APP_LIB_OTAP_WRITE_RES_INVALID_NULL_BYTES:
+            default:
+                result = MSAP_SCRATCHPAD_STREAM_BLOCK_INVALID_DATA;
+                break;
+        }
+
+        if ((result == MSAP_SCRATCHPAD_STREAM_BLOCK_SUCCESS) ||
+            (result == MSAP_SCRATCHPAD_STREAM_BLOCK_COMPLETED_OK) ||
+            (result == MSAP_SCRATCHPAD_STREAM_BLOCK_COMPLETED_ERROR))
+        {
+            for (uint8_t i = 0; i < req->num_bytes; i++)
+            {
+                m_stream.crc = Crc_addByte(m_stream.crc, req->bytes[i]);
+            }
+            m_stream.offset += req->num_bytes;
+            m_stream.next_seq++;
+            m_stream.gap_reported = false;
+            m_stream.unacked++;
+        }
+
+        if ((result == MSAP_SCRATCHPAD_STREAM_BLOCK_COMPLETED_OK) &&
+            (m_stream.crc != m_stream.expected_crc))
+        {
+            /* Stored data is not what the host sent: do not keep it */
+            lib_otap->clear();
+            result = MSAP_SCRATCHPAD_STREAM_BLOCK_CRC_MISMATCH;
+        }
+
+        if (result != MSAP_SCRATCHPAD_STREAM_BLOCK_SUCCESS)
+        {
+            /* Stream is over, either completed or failed */
+            m_stream.ongoing = false;
+            m_stream.completed =
+                (result == MSAP_SCRATCHPAD_STREAM_BLOCK_COMPLETED_OK) ||
+                (result == MSAP_SCRATCHPAD_STREAM_BLOCK_COMPLETED_ERROR) ||
+                (result == MSAP_SCRATCHPAD_STREAM_BLOCK_CRC_MISMATCH);
+            m_stream.completed_result = result;
+        }
+        else if (m_stream.unacked < m_stream.ack_interval)
+        {
+            /* No acknowledgement needed yet, drop the request */
+            return false;
+        }
+        m_stream.unacked = 0;
+    }
+
+    /* Build response */
+    Waps_item_init(item,
+                   WAPS_FUNC_MSAP_SCRATCHPAD_STREAM_BLOCK_CNF,
+                   sizeof(msap_scratchpad_stream_block_cnf_t));
+    item->frame.sfid = sfid;
+    msap_scratchpad_stream_block_cnf_t * cnf =
+        &item->frame.msap.scratchpad_stream_block_cnf;
+    cnf->result = result;
+    cnf->next_seq = m_stream.next_seq;
+    cnf->crc = m_stream.crc;
+    return true;
+}
+
 /** \brief  Report scratchpad contents */
 static bool scratchpadStatus(waps_item_t * item)
 {
@@ -1659,3 +2266,90 @@ static bool max_msg_queuing_time_read_req(waps_item_t * item)
 
     return status;
 }
+
+/**
+ * \brief  Check if WAPS diagnostics (request and indication queue
+ *         statistics) may be read. They are guarded by the same lock bit as
+ *         the diagnostic MSAP attributes
+ */
+static bool diagnostics_readable(void)
+{
+    return LockBits_isFeaturePermitted(LOCK_BITS_MSAP_ATTR_READ);
+}
+
+static bool func_stats_read_req(waps_item_t * item)
+{
+    msap_func_stats_read_e result = MSAP_FUNC_STATS_READ_ACCESS_DENIED;
+    waps_func_stats_t stats = { 0 };
+
+    if (item->frame.splen != sizeof(msap_func_stats_read_req_t))
+    {
+        return false;
+    }
+
+    uint8_t func = item->frame.msap.func_stats_read_req.func;
+    if (diagnostics_readable())
+    {
+        if (Waps_getFuncStats(func, &stats))
+        {
+            result = MSAP_FUNC_STATS_READ_SUCCESS;
+        }
+        else
+        {
+            result = MSAP_FUNC_STATS_READ_UNAVAILABLE;
+        }
+    }
+
+    /* Build response */
+    Waps_item_init(item,
+                   WAPS_FUNC_MSAP_FUNC_STATS_READ_CNF,
+                   sizeof(msap_func_stats_read_cnf_t));
+    msap_func_stats_read_cnf_t * cnf = &item->frame.msap.func_stats_read_cnf;
+    cnf->result = result;
+    cnf->func = func;
+    cnf->calls = stats.calls;
+    cnf->total_time_us = stats.total_time_us;
+    cnf->max_time_us = stats.max_time_us;
+    return true;
+}
+
+static bool ind_queue_stats_read_req(waps_item_t * item)
+{
+    msap_ind_queue_stats_read_e result = MSAP_IND_QUEUE_STATS_READ_ACCESS_DENIED;
+    waps_ind_stats_t stats = { 0 };
+
+    if (item->frame.splen != sizeof(msap_ind_queue_stats_read_req_t))
+    {
+        return false;
+    }
+
+    uint8_t ind_class = item->frame.msap.ind_queue_stats_read_req.ind_class;
+    if (diagnostics_readable())
+    {
+        if (Waps_ind_getStats(ind_class, &stats))
+        {
+            result = MSAP_IND_QUEUE_STATS_READ_SUCCESS;
+        }
+        else
+        {
+            result = MSAP_IND_QUEUE_STATS_READ_INVALID_CLASS;
+        }
+    }
+
+    /* Build response */
+    Waps_item_init(item,
+                   WAPS_FUNC_MSAP_IND_QUEUE_STATS_READ_CNF,
+                   sizeof(msap_ind_queue_stats_read_cnf_t));
+    msap_ind_queue_stats_read_cnf_t * cnf =
+        &item->frame.msap.ind_queue_stats_read_cnf;
+    cnf->result = result;
+    cnf->ind_class = ind_class;
+    cnf->depth = stats.depth;
+    cnf->high_water = stats.high_water;
+    cnf->dequeued = stats.dequeued;
+    cnf->coalesced = stats.coalesced;
+    cnf->deferred = stats.deferred;
+    cnf->total_delay_ms = stats.total_delay_ms;
+    cnf->max_delay_ms = stats.max_delay_ms;
+    return true;
+}
@@ -378,6 +378,51 @@ typedef struct __attribute__ ((__packed__))
     msap_neighbor_entry_t   neighbors[MSAP_MAX_NBORS];
 } msap_neighbors_cnf_t;
 
+/** Max removed neighbors reported by a single MSAP-GET_NBORS_DELTA */
+#define MSAP_NBORS_DELTA_MAX_REMOVED    3
+
+/** MSAP-GET_NBORS_DELTA request frame */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Generation got from previous confirmation, 0 to get all neighbors */
+    uint16_t    generation;
+    /** Normalized RSSI and RX power change (in dB) to report a neighbor */
+    uint8_t     rssi_threshold;
+    /** Link reliability change to report a neighbor */
+    uint8_t     link_rel_threshold;
+} msap_nbors_delta_req_t;
+
+/** Result of MSAP-GET_NBORS_DELTA request */
+typedef enum
+{
+    MSAP_NBORS_DELTA_SUCCESS = 0,
+    MSAP_NBORS_DELTA_ACCESS_DENIED = 1,
+} msap_nbors_delta_e;
+
+/** MSAP-GET_NBORS_DELTA confirmation frame */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Result of query: \see msap_nbors_delta_e */
+    uint8_t     result;
+    /** 1 if all neighbors are reported and host must drop its own table */
+    uint8_t     full;
+    /** Generation to use in next request */
+    uint16_t    generation;
+    /** Amount of added or changed neighbors */
+    uint8_t     changed_count;
+    /** Amount of removed neighbors */
+    uint8_t     removed_count;
+    /** changed_count msap_neighbor_entry_t followed by removed_count
+     *  addresses (w_addr_t) */
+    uint8_t     data[MSAP_MAX_NBORS * sizeof(msap_neighbor_entry_t) +
+                     MSAP_NBORS_DELTA_MAX_REMOVED * sizeof(w_addr_t)];
+} msap_nbors_delta_cnf_t;
+
+#define FRAME_MSAP_NBORS_DELTA_CNF_HEADER_SIZE \
+    (sizeof(msap_nbors_delta_cnf_t) - \
+     (MSAP_MAX_NBORS * sizeof(msap_neighbor_entry_t) + \
+      MSAP_NBORS_DELTA_MAX_REMOVED * sizeof(w_addr_t)))
+
 /** Result of MSAP-SLEEP start/stop request */
 typedef enum
 {
@@ -539,6 +584,157 @@ typedef struct __attribute__ ((__packed__))
 #define FRAME_MSAP_SCRATCHPAD_BLOCK_READ_CNF_HEADER_SIZE  \
     (sizeof(msap_scratchpad_block_read_cnf_t) - MSAP_SCRATCHPAD_BLOCK_READ_MAX_NUM_BYTES)
 
+/** MSAP-FUNC_STATS_READ request frame */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Function code of the request to get statistics for */
+    uint8_t     func;
+} msap_func_stats_read_req_t;
+
+/** Result of MSAP-FUNC_STATS_READ request */
+typedef enum
+{
+    /** Statistics read successfully */
+    MSAP_FUNC_STATS_READ_SUCCESS = 0,
+    /** Statistics not enabled in build or invalid function code */
+    MSAP_FUNC_STATS_READ_UNAVAILABLE = 1,
+    /** Access denied due to feature lock bits */
+    MSAP_FUNC_STATS_READ_ACCESS_DENIED = 2,
+} msap_func_stats_read_e;
+
+/** MSAP-FUNC_STATS_READ confirmation frame */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Read result: \see msap_func_stats_read_e */
+    uint8_t     result;
+    /** Function code the statistics are for */
+    uint8_t     func;
+    /** Amount of requests handled */
+    uint32_t    calls;
+    /** Cumulated handling time in microseconds */
+    uint32_t    total_time_us;
+    /** Longest handling time in microseconds */
+    uint32_t    max_time_us;
+} msap_func_stats_read_cnf_t;
+
+/** MSAP-SCRATCHPAD_STREAM_START request frame */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Total number of bytes of data */
+    uint32_t    num_bytes;
+    /** Sequence number of the scratchpad */
+    otap_seq_t  seq;
+    /** CRC of the whole data, checked once all of it is written */
+    uint16_t    crc;
+    /** Acknowledge every Nth in-order block (0: once per window) */
+    uint8_t     ack_interval;
+} msap_scratchpad_stream_start_req_t;
+
+/** MSAP-SCRATCHPAD_STREAM_START confirmation frame */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Start result: \see msap_scratchpad_start_e */
+    uint8_t     result;
+    /** Maximum number of blocks that can be sent without acknowledgement */
+    uint8_t     window;
+    /** Acknowledgement interval actually used */
+    uint8_t     ack_interval;
+} msap_scratchpad_stream_start_cnf_t;
+
+/** MSAP-SCRATCHPAD_STREAM_BLOCK request frame */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Block sequence number, starting from zero. Block is written right
+     *  after the previous one, so no address is needed */
+    uint16_t        block_seq;
+    /** Number of bytes of data */
+    uint8_t         num_bytes;
+    /** Byte data */
+    uint8_t         bytes[MSAP_SCRATCHPAD_BLOCK_MAX_NUM_BYTES];
+} msap_scratchpad_stream_block_req_t;
+
+#define FRAME_MSAP_SCRATCHPAD_STREAM_BLOCK_REQ_HEADER_SIZE  \
+    (sizeof(msap_scratchpad_stream_block_req_t) - \
+     MSAP_SCRATCHPAD_BLOCK_MAX_NUM_BYTES)
+
+/** Result of MSAP-SCRATCHPAD_STREAM_BLOCK request */
+typedef enum
+{
+    /** Blocks up to \ref msap_scratchpad_stream_block_cnf_t::next_seq
+     *  written successfully */
+    MSAP_SCRATCHPAD_STREAM_BLOCK_SUCCESS = 0,
+    /** All data received OK and CRC matches */
+    MSAP_SCRATCHPAD_STREAM_BLOCK_COMPLETED_OK = 1,
+    /** All data received but error in data */
+    MSAP_SCRATCHPAD_STREAM_BLOCK_COMPLETED_ERROR = 2,
+    /** Stack in invalid state */
+    MSAP_SCRATCHPAD_STREAM_BLOCK_INVALID_STATE = 3,
+    /** No stream has been started */
+    MSAP_SCRATCHPAD_STREAM_BLOCK_NOT_ONGOING = 4,
+    /** Block(s) missing: resend from
+     *  \ref msap_scratchpad_stream_block_cnf_t::next_seq */
+    MSAP_SCRATCHPAD_STREAM_BLOCK_OUT_OF_SEQUENCE = 5,
+    /** Invalid \ref msap_scratchpad_stream_block_req_t::num_bytes */
+    MSAP_SCRATCHPAD_STREAM_BLOCK_INVALID_NUM_BYTES = 6,
+    /** Data does not appear to be a valid scratchpad file */
+    MSAP_SCRATCHPAD_STREAM_BLOCK_INVALID_DATA = 7,
+    /** All data received but CRC does not match, scratchpad is cleared */
+    MSAP_SCRATCHPAD_STREAM_BLOCK_CRC_MISMATCH = 8,
+} msap_scratchpad_stream_block_e;
+
+/** MSAP-SCRATCHPAD_STREAM_BLOCK confirmation frame */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Block result: \see msap_scratchpad_stream_block_e */
+    uint8_t     result;
+    /** Cumulative acknowledgement: sequence of the next expected block */
+    uint16_t    next_seq;
+    /** CRC of the data written so far */
+    uint16_t    crc;
+} msap_scratchpad_stream_block_cnf_t;
+
+/** MSAP-IND_QUEUE_STATS_READ request frame */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Indication class: 0 control, 1 data TX, 2 data RX */
+    uint8_t     ind_class;
+} msap_ind_queue_stats_read_req_t;
+
+/** Result of MSAP-IND_QUEUE_STATS_READ request */
+typedef enum
+{
+    /** Statistics read successfully */
+    MSAP_IND_QUEUE_STATS_READ_SUCCESS = 0,
+    /** Invalid indication class */
+    MSAP_IND_QUEUE_STATS_READ_INVALID_CLASS = 1,
+    /** Access denied due to feature lock bits */
+    MSAP_IND_QUEUE_STATS_READ_ACCESS_DENIED = 2,
+} msap_ind_queue_stats_read_e;
+
+/** MSAP-IND_QUEUE_STATS_READ confirmation frame */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Read result: \see msap_ind_queue_stats_read_e */
+    uint8_t     result;
+    /** Indication class the statistics are for */
+    uint8_t     ind_class;
+    /** Amount of indications currently queued */
+    uint16_t    depth;
+    /** Highest amount of indications queued at the same time */
+    uint16_t    high_water;
+    /** Amount of indications taken from the queue for sending */
+    uint32_t    dequeued;
+    /** Amount of indications merged into an older one */
+    uint32_t    coalesced;
+    /** Amount of times received data was left to the stack because of the
+     *  class quota */
+    uint32_t    deferred;
+    /** Cumulated queuing time in milliseconds */
+    uint32_t    total_delay_ms;
+    /** Longest queuing time in milliseconds */
+    uint32_t    max_delay_ms;
+} msap_ind_queue_stats_read_cnf_t;
+
 typedef union
 {
     msap_start_req_t                    start_req;
@@ -567,6 +763,16 @@ typedef union
     msap_scratchpad_target_read_cnf_t   scratchpad_target_read_cnf;
     msap_scratchpad_block_read_req_t    scratchpad_block_read_req;
     msap_scratchpad_block_read_cnf_t    scratchpad_block_read_cnf;
+    msap_func_stats_read_req_t          func_stats_read_req;
+    msap_func_stats_read_cnf_t          func_stats_read_cnf;
+    msap_scratchpad_stream_start_req_t  scratchpad_stream_start_req;
+    msap_scratchpad_stream_start_cnf_t  scratchpad_stream_start_cnf;
+    msap_scratchpad_stream_block_req_t  scratchpad_stream_block_req;
+    msap_scratchpad_stream_block_cnf_t  scratchpad_stream_block_cnf;
+    msap_ind_queue_stats_read_req_t     ind_queue_stats_read_req;
+    msap_ind_queue_stats_read_cnf_t     ind_queue_stats_read_cnf;
+    msap_nbors_delta_req_t              nbors_delta_req;
+    msap_nbors_delta_cnf_t              nbors_delta_cnf;
 } frame_msap;
 
 #endif /* MSAP_FRAMES_H_ */
@@ -0,0 +1,128 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "multi_attr.h"
+
+/** Size of the result and header of an entry in a read confirmation */
+#define READ_ENTRY_HEADER_SIZE  (1 + sizeof(multi_attr_entry_t))
+
+bool MultiAttr_read(waps_item_t * item,
+                    uint8_t cnf_func,
+                    multi_attr_read_f read_f)
+{
+    multi_read_req_t * req_ptr = &item->frame.attr.multi_read_req;
+    attr_t attr_ids[WAPS_MAX_MULTI_ATTR];
+    uint8_t count = req_ptr->count;
+
+    if ((count == 0) ||
+        (count > WAPS_MAX_MULTI_ATTR) ||
+        (item->frame.splen != (FRAME_MULTI_READ_REQ_HEADER_SIZE +
+                               count * sizeof(attr_t))))
+    {
+        return false;
+    }
+
+    /* Reply is built over the request, so keep the attribute ids */
+    memcpy(attr_ids, req_ptr->attr_ids, count * sizeof(attr_t));
+
+    multi_read_cnf_t * cnf_ptr = &item->frame.attr.multi_read_cnf;
+    uint8_t value[WAPS_MAX_MULTI_ATTR_DATA];
+    uint8_t used = 0;
+    uint8_t done;
+
+    for (done = 0; done < count; done++)
+    {
+        uint8_t attr_size = 0;
+        attribute_result_e result = read_f(attr_ids[done], value, &attr_size);
+        if (result != ATTR_SUCCESS)
+        {
+            attr_size = 0;
+        }
+
+        if (used + READ_ENTRY_HEADER_SIZE + attr_size > WAPS_MAX_MULTI_ATTR_DATA)
+        {
+            /* No room left, host reads the rest with another request */
+            break;
+        }
+
+        multi_attr_entry_t entry =
+        {
+            .attr_id = attr_ids[done],
+            .attr_len = attr_size,
+        };
+        cnf_ptr->data[used] = (uint8_t)result;
+        memcpy(&cnf_ptr->data[used + 1], &entry, sizeof(entry));
+        memcpy(&cnf_ptr->data[used + READ_ENTRY_HEADER_SIZE], value, attr_size);
+        used += READ_ENTRY_HEADER_SIZE + attr_size;
+    }
+
+    Waps_item_init(item, cnf_func, 1 + used);
+    cnf_ptr->count = done;
+    return true;
+}
+
+bool MultiAttr_write(waps_item_t * item,
+                     uint8_t cnf_func,
+                     multi_attr_write_f write_f)
+{
+    multi_write_req_t * req_ptr = &item->frame.attr.multi_write_req;
+    uint8_t results[WAPS_MAX_MULTI_ATTR];
+    uint8_t count = req_ptr->count;
+    uint8_t offset = 0;
+    uint8_t len = item->frame.splen;
+
+    if ((count == 0) || (count > WAPS_MAX_MULTI_ATTR) || (len < 1))
+    {
+        return false;
+    }
+    len -= 1;
+
+    /* Whole frame is checked before writing anything */
+    for (uint8_t i = 0; i < count; i++)
+    {
+        multi_attr_entry_t entry;
+        if (offset + sizeof(entry) > len)
+        {
+            return false;
+        }
+        memcpy(&entry, &req_ptr->data[offset], sizeof(entry));
+        offset += sizeof(entry);
+        if (offset + entry.attr_len > len)
+        {
+            return false;
+        }
+        offset += entry.attr_len;
+    }
+    if (offset != len)
+    {
+        return false;
+    }
+
+    offset = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        multi_attr_entry_t entry;
+        uint8_t value[WAPS_MAX_MULTI_ATTR_DATA];
+        memcpy(&entry, &req_ptr->data[offset], sizeof(entry));
+        offset += sizeof(entry);
+        /* Aligned copy of the value */
+        memcpy(value, &req_ptr->data[offset], entry.attr_len);
+        offset += entry.attr_len;
+        results[i] = (uint8_t)write_f(entry.attr_id, value, entry.attr_len);
+    }
+
+    Waps_item_init(item,
+                   cnf_func,
+                   FRAME_MULTI_WRITE_CNF_HEADER_SIZE + count);
+    multi_write_cnf_t * cnf_ptr = &item->frame.attr.multi_write_cnf;
+    cnf_ptr->count = count;
+    memcpy(cnf_ptr->results, results, count);
+    return true;
+}
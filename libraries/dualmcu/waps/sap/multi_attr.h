@@ -0,0 +1,70 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+#ifndef WAPS_MULTI_ATTR_H_
+#define WAPS_MULTI_ATTR_H_
+
+#include "waps_item.h"
+
+/**
+ * \brief   Read a single attribute, with all the checks of a read request
+ * \param   attr_id
+ *          Attribute to read
+ * \param   value
+ *          Out: attribute value, WAPS_MAX_MULTI_ATTR_DATA bytes available
+ *          (some attributes are bigger than WAPS_MAX_ATTR_LEN)
+ * \param   attr_size_p
+ *          Out: size of the attribute value
+ * \return  Result of the read
+ */
+typedef attribute_result_e (*multi_attr_read_f)(attr_t attr_id,
+                                                 uint8_t * value,
+                                                 uint8_t * attr_size_p);
+
+/**
+ * \brief   Write a single attribute, with all the checks of a write request
+ * \param   attr_id
+ *          Attribute to write
+ * \param   value
+ *          Attribute value
+ * \param   attr_len
+ *          Size of the attribute value
+ * \return  Result of the write
+ */
+typedef attribute_result_e (*multi_attr_write_f)(attr_t attr_id,
+                                                  const uint8_t * value,
+                                                  uint8_t attr_len);
+
+/**
+ * \brief   Handle a multi-attribute read request
+ * \param   item
+ *          Item containing the request, reply is built over it
+ * \param   cnf_func
+ *          Function code of the confirmation
+ * \param   read_f
+ *          Function reading a single attribute
+ * \return  True, if a response was generated
+ */
+bool MultiAttr_read(waps_item_t * item,
+                    uint8_t cnf_func,
+                    multi_attr_read_f read_f);
+
+/**
+ * \brief   Handle a multi-attribute write request
+ * \param   item
+ *          Item containing the request, reply is built over it
+ * \param   cnf_func
+ *          Function code of the confirmation
+ * \param   write_f
+ *          Function writing a single attribute
+ * \return  True, if a response was generated
+ * \note    Attributes are written in request order. A failing write does
+ *          not prevent writing the next attributes
+ */
+bool MultiAttr_write(waps_item_t * item,
+                     uint8_t cnf_func,
+                     multi_attr_write_f write_f);
+
+#endif /* WAPS_MULTI_ATTR_H_ */
@@ -9,6 +9,12 @@
 #include <string.h>
 #include "persistent.h"
 
+/** RAM copy of the multicast groups, sorted for binary search */
+static app_addr_t m_groups[MULTICAST_ADDRESS_AMOUNT];
+
+/** Is the RAM copy in sync with persistent storage */
+static bool m_groups_loaded = false;
+
 /**
  * \brief   Convert packed multicast address to app addr structure
  * \param   addr
@@ -51,24 +57,77 @@ static void mcast_group_addr_to_waddr(const multicast_group_addr_t * from,
     memcpy(to, &addr, sizeof(w_addr_t));
 }
 
-bool Multicast_isGroupCb(app_addr_t group_addr)
+/**
+ * \brief   Update RAM copy of the multicast groups
+ * \param   addresses
+ *          Multicast addresses, as stored in persistent storage
+ */
+static void load_groups(const multicast_group_addr_t * addresses)
+{
+    app_addr_t groups[MULTICAST_ADDRESS_AMOUNT];
+
+    // Convert and sort (insertion sort, the table is small)
+    for (uint_fast8_t i = 0; i < MULTICAST_ADDRESS_AMOUNT; i++)
+    {
+        app_addr_t addr = mcast_group_addr_to_app_addr(
+                                (multicast_group_addr_t *)&addresses[i]);
+        uint_fast8_t j = i;
+        while ((j > 0) && (groups[j - 1] > addr))
+        {
+            groups[j] = groups[j - 1];
+            j--;
+        }
+        groups[j] = addr;
+    }
+
+    lib_system->enterCriticalSection();
+    memcpy(m_groups, groups, sizeof(m_groups));
+    m_groups_loaded = true;
+    lib_system->exitCriticalSection();
+}
+
+void Multicast_init(void)
 {
     multicast_group_addr_t addresses[MULTICAST_ADDRESS_AMOUNT];
 
-    if (Persistent_getGroups(&addresses[0]) != APP_RES_OK)
+    m_groups_loaded = false;
+    if (Persistent_getGroups(&addresses[0]) == APP_RES_OK)
     {
-        // Failure, not a member of the group
-        return false;
+        load_groups(&addresses[0]);
     }
+}
 
-    for (uint_fast8_t i=0; i < MULTICAST_ADDRESS_AMOUNT; i++)
+bool Multicast_isGroupCb(app_addr_t group_addr)
+{
+    if (!m_groups_loaded)
+    {
+        // Previous load failed, retry
+        Multicast_init();
+        if (!m_groups_loaded)
+        {
+            // Failure, not a member of the group
+            return false;
+        }
+    }
+
+    // Binary search from the sorted RAM copy
+    uint_fast8_t low = 0;
+    uint_fast8_t high = MULTICAST_ADDRESS_AMOUNT;
+    while (low < high)
     {
-        // Check if group address matches
-        app_addr_t groupaddr = mcast_group_addr_to_app_addr(&addresses[i]);
-        if (groupaddr == group_addr)
+        uint_fast8_t mid = (low + high) / 2;
+        if (m_groups[mid] == group_addr)
         {
             return true;
         }
+        else if (m_groups[mid] < group_addr)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
     }
 
     return false;
@@ -78,6 +137,7 @@ app_res_e Multicast_setGroups(const uint8_t * groups)
 {
     // Storage groups used
     multicast_group_addr_t stgroups[MULTICAST_ADDRESS_AMOUNT];
+    app_res_e retval;
 
     // Copy addresses one-by-one (convert from 32-bits to 24-bits)
     for (uint_fast8_t i=0; i < MULTICAST_ADDRESS_AMOUNT; i++)
@@ -86,7 +146,18 @@ app_res_e Multicast_setGroups(const uint8_t * groups)
     }
 
     // Set to storage
-    return Persistent_setGroups(&stgroups[0]);
+    retval = Persistent_setGroups(&stgroups[0]);
+    if (retval == APP_RES_OK)
+    {
+        // Keep RAM copy in sync
+        load_groups(&stgroups[0]);
+    }
+    else
+    {
+        // Storage content is unknown, reload it on next use
+        Multicast_init();
+    }
+    return retval;
 }
 
 app_res_e Multicast_getGroups(uint8_t * groups)
@@ -17,11 +17,18 @@ typedef struct __attribute__ ((__packed__))
     uint8_t addr[3];    // LSB first
 } multicast_group_addr_t;
 
+/**
+ * \brief   Load multicast groups from persistent storage to RAM
+ * \note    Must be called after persistent storage is (re)initialized
+ */
+void Multicast_init(void);
+
 /**
  * \brief   Callback for querying group callback
  * \param   group_addr
  *          Address of the group
  * \return  true: Is part of this group, false: Is not part of this group
+ * \note    Groups are checked from RAM, without accessing persistent storage
  */
 bool Multicast_isGroupCb(app_addr_t group_addr);
 
@@ -18,6 +18,8 @@
 #include "waps.h"
 #include "waps_private.h"
 #include "sap/persistent.h"
+#include "sap/multicast.h"
+#include "waps_ind_queue.h"
 
 
 #include "api.h"
@@ -107,14 +109,12 @@ static void on_scanned_nbors_cb(const app_lib_state_neighbor_scan_info_t * scan_
 static bool process_request(waps_item_t * item);
 
 /**
- * \brief   Find similar item (for re-using memory)
- * \param   id
- *          Id to search for in indications
+ * \brief   Give request to the SAP handling its function code
+ * \return  True, if a reply was generated
  */
-static waps_item_t * find_indication(uint8_t id);
+static bool dispatch_request(waps_item_t * item);
 
 /** WAPS internal message queues */
-sl_list_head_t              waps_ind_queue;
 sl_list_head_t              waps_reply_queue;
 sl_list_head_t              waps_request_queue;
 
@@ -124,30 +124,54 @@ static uint32_t             m_signal;
 // Number of channels, cached for get_num_channels()
 static app_lib_settings_net_channel_t num_channels;
 
+#ifdef WAPS_FUNC_STATS
+/** Statistics are kept for request function codes (all below 0x80) */
+#define WAPS_FUNC_STATS_COUNT   0x80
+
+/** Request handling statistics, indexed by function code */
+static waps_func_stats_t    m_func_stats[WAPS_FUNC_STATS_COUNT];
+#endif
+
 static app_lib_data_receive_res_e data_cb(
                     const shared_data_item_t * shared_data_item,
                     const app_lib_data_received_t * data)
 {
     w_addr_t dst;
 
+    // Leave the packet to the stack if data indications reached their quota
+    // (reception is resumed when the queue drains)
+    if (Waps_ind_isFull(WAPS_IND_CLASS_DATA))
+    {
+        return APP_LIB_DATA_RECEIVE_RES_NO_SPACE;
+    }
+
+    if (data->dest_address == APP_ADDR_BROADCAST)
+    {
+        dst = WADDR_BCAST;
+    }
+    else if ((data->dest_address & 0xff000000) == APP_ADDR_MULTICAST)
+    {
+        dst = data->dest_address;
+    }
+    else
+    {
+        // Destination is obviously self
+        app_addr_t addr;
+        lib_settings->getNodeAddress(&addr);
+        dst = Addr_to_Waddr(addr);
+    }
+
+#ifdef WAPS_RX_REASSEMBLY
+    // Host gets only complete packets
+    if (data->fragment_info != NULL)
+    {
+        return Dsap_fragmentReceived(data, dst, add_indication);
+    }
+#endif
+
     waps_item_t * item = Waps_itemReserve(WAPS_ITEM_TYPE_INDICATION);
     if(item)
     {
-        if (data->dest_address == APP_ADDR_BROADCAST)
-        {
-            dst = WADDR_BCAST;
-        }
-        else if ((data->dest_address & 0xff000000) == APP_ADDR_MULTICAST)
-        {
-            dst = data->dest_address;
-        }
-        else
-        {
-            // Destination is obviously self
-            app_addr_t addr;
-            lib_settings->getNodeAddress(&addr);
-            dst = Addr_to_Waddr(addr);
-        }
         Dsap_packetReceived(data, dst, item);
         add_indication(item);
         return APP_LIB_DATA_RECEIVE_RES_HANDLED;
@@ -194,7 +218,7 @@ bool Waps_init(uint32_t baudrate, bool flow_ctrl)
     lib_data->setFragmentMode(APP_LIB_DATA_FRAGMENTED_MODE_ENABLED);
 
     sl_list_init(&waps_request_queue);
-    sl_list_init(&waps_ind_queue);
+    Waps_ind_init(item_free_threshold_cb);
     sl_list_init(&waps_reply_queue);
     // Cache number of channels. For the purposes of
     // lib_settings->setReservedChannels(), minimum channel is always 1
@@ -203,6 +227,7 @@ bool Waps_init(uint32_t baudrate, bool flow_ctrl)
     num_channels = (app_lib_settings_net_channel_t)tmp2;
     // Initialize submodules
     Persistent_init();
+    Multicast_init();
     if (Waps_prot_init(receive_request, baudrate, flow_ctrl))
     {
         // Initialize item pool with a threshold to 50%
@@ -310,7 +335,7 @@ static void app_config_received_cb(uint16_t type,
                             &appconfig_interval);
 
     // Seek if there is existing APP_CONFIG_RX_IND. If so, reuse it
-    waps_item_t * item = find_indication(WAPS_FUNC_MSAP_APP_CONFIG_RX_IND);
+    waps_item_t * item = Waps_ind_find(WAPS_FUNC_MSAP_APP_CONFIG_RX_IND);
 
     // No existing APP_CONFIG_RX_IND found, allocate new
     if (item == NULL)
@@ -342,7 +367,7 @@ static void on_scanned_nbors_cb(const app_lib_state_neighbor_scan_info_t * scan_
 // So for now, it has to be explicitly enabled.
 #ifdef GENERATE_NEIGHBORS_INDICATION
     // Find similar indication and re-use ite
-    waps_item_t * item = find_indication(WAPS_FUNC_MSAP_SCAN_NBORS_IND);
+    waps_item_t * item = Waps_ind_find(WAPS_FUNC_MSAP_SCAN_NBORS_IND);
     bool is_new = false;
     if(item == NULL)
     {
@@ -379,7 +404,7 @@ void Waps_packetSent(app_lib_data_tracking_id_t tracking_id,
 
 uint8_t queued_indications(void)
 {
-    return (sl_list_size(&waps_ind_queue) ? 1 : 0);
+    return (Waps_ind_count() ? 1 : 0);
 }
 
 void wakeup_task(void)
@@ -414,8 +439,8 @@ static void add_indication(waps_item_t * msg)
 {
     if(msg != NULL)
     {
-        /* Put to back of queue */
-        sl_list_push_back(&waps_ind_queue, (sl_list_t *)msg);
+        /* Put to back of the queue of its class */
+        Waps_ind_add(msg);
         Waps_prot_updateIrqPin();
     }
 }
@@ -445,37 +470,57 @@ static void receive_request(waps_item_t * item)
     wakeup_task();
 }
 
-static bool process_request(waps_item_t * item)
+static bool dispatch_request(waps_item_t * item)
 {
-    if (WapsFunc_isDsapRequest(item->frame.sfunc))
-    {
-        return Dsap_handleFrame(item);
-    }
-    else if (WapsFunc_isMsapRequest(item->frame.sfunc))
+    switch (WapsFunc_getClass(item->frame.sfunc))
     {
-        return Msap_handleFrame(item);
+        case WAPS_FUNC_CLASS_DSAP_REQUEST:
+            return Dsap_handleFrame(item);
+        case WAPS_FUNC_CLASS_MSAP_REQUEST:
+            return Msap_handleFrame(item);
+        case WAPS_FUNC_CLASS_CSAP_REQUEST:
+            return Csap_handleFrame(item);
+        default:
+            return false;
     }
-    else if (WapsFunc_isCsapRequest(item->frame.sfunc))
-    {
-        return Csap_handleFrame(item);
-    }
-    return false;
 }
 
-static waps_item_t * find_indication(uint8_t id)
+static bool process_request(waps_item_t * item)
 {
-    // Seek if there is existing indication with id. If so, reuse it
-    waps_item_t * item = (waps_item_t *) sl_list_begin(&waps_ind_queue);
-    while (item != NULL)
+#ifdef WAPS_FUNC_STATS
+    // Frame is reused for the reply, so keep request function code
+    uint8_t func = item->frame.sfunc;
+    app_lib_time_timestamp_hp_t start = lib_time->getTimestampHp();
+    bool res = dispatch_request(item);
+    if (func < WAPS_FUNC_STATS_COUNT)
     {
-        if (item->frame.sfunc == id)
-        {
-            break;
-        }
-        else
+        uint32_t time_us = lib_time->getTimeDiffUs(lib_time->getTimestampHp(),
+                                                   start);
+        waps_func_stats_t * stats = &m_func_stats[func];
+        stats->calls++;
+        stats->total_time_us += time_us;
+        if (time_us > stats->max_time_us)
         {
-            item = (waps_item_t *) sl_list_next((sl_list_t *) item);
+            stats->max_time_us = time_us;
         }
     }
-    return item;
+    return res;
+#else
+    return dispatch_request(item);
+#endif
+}
+
+bool Waps_getFuncStats(uint8_t func, waps_func_stats_t * stats)
+{
+#ifdef WAPS_FUNC_STATS
+    if (func < WAPS_FUNC_STATS_COUNT)
+    {
+        *stats = m_func_stats[func];
+        return true;
+    }
+#else
+    (void)func;
+    (void)stats;
+#endif
+    return false;
 }
@@ -0,0 +1,239 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "waps_ind_queue.h"
+#include "sap/function_codes.h"
+#include "api.h"
+
+/** Maximum amount of data RX indications queued (0: no limit). Other
+ *  classes have no quota: their indications cannot be left to the stack and
+ *  are bounded by the stack itself (one per tracked packet for TX) or
+ *  superseded by newer ones */
+#ifndef WAPS_IND_QUOTA_DATA
+#define WAPS_IND_QUOTA_DATA     0
+#endif
+
+/** Convert coarse timestamp difference (1/128 s) to milliseconds */
+#define COARSE_TO_MS(_coarse)   (((_coarse) * 1000u) >> 7)
+
+/** One queue per class, index is the priority (0 is the highest) */
+static sl_list_head_t           m_queues[WAPS_IND_CLASS_COUNT];
+
+static waps_ind_stats_t         m_stats[WAPS_IND_CLASS_COUNT];
+
+/** Class was reported full and room callback is expected */
+static bool                     m_full_reported[WAPS_IND_CLASS_COUNT];
+
+static waps_ind_room_cb_f       m_room_cb;
+
+/**
+ * \brief   Check if a newer indication replaces a queued one of same kind
+ *          instead of being queued after it
+ */
+static bool is_superseding(uint8_t func)
+{
+    switch (func)
+    {
+        case WAPS_FUNC_MSAP_STACK_STATE_IND:
+        case WAPS_FUNC_MSAP_APP_CONFIG_RX_IND:
+        case WAPS_FUNC_MSAP_SCAN_NBORS_IND:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** Find indication from a class queue. Must be called in critical section */
+static waps_item_t * find_in_class(waps_ind_class_e ind_class, uint8_t func)
+{
+    waps_item_t * item = (waps_item_t *) sl_list_begin(&m_queues[ind_class]);
+    while (item != NULL)
+    {
+        if (item->frame.sfunc == func)
+        {
+            break;
+        }
+        item = (waps_item_t *) sl_list_next((sl_list_t *) item);
+    }
+    return item;
+}
+
+static bool is_full(waps_ind_class_e ind_class)
+{
+#if WAPS_IND_QUOTA_DATA > 0
+    return (ind_class == WAPS_IND_CLASS_DATA) &&
+           (m_stats[ind_class].depth >= WAPS_IND_QUOTA_DATA);
+#else
+    // No limit
+    (void) ind_class;
+    return false;
+#endif
+}
+
+void Waps_ind_init(waps_ind_room_cb_f room_cb)
+{
+    for (uint8_t c = 0; c < WAPS_IND_CLASS_COUNT; c++)
+    {
+        sl_list_init(&m_queues[c]);
+        m_full_reported[c] = false;
+    }
+    memset(m_stats, 0, sizeof(m_stats));
+    m_room_cb = room_cb;
+}
+
+waps_ind_class_e Waps_ind_getClass(uint8_t func)
+{
+    switch (func)
+    {
+        case WAPS_FUNC_DSAP_DATA_RX_IND:
+        case WAPS_FUNC_DSAP_DATA_RX_FRAG_IND:
+            return WAPS_IND_CLASS_DATA;
+        case WAPS_FUNC_DSAP_DATA_TX_IND:
+            return WAPS_IND_CLASS_TX;
+        default:
+            return WAPS_IND_CLASS_CONTROL;
+    }
+}
+
+bool Waps_ind_isFull(waps_ind_class_e ind_class)
+{
+    bool full;
+    lib_system->enterCriticalSection();
+    full = is_full(ind_class);
+    if (full)
+    {
+        m_full_reported[ind_class] = true;
+        m_stats[ind_class].deferred++;
+    }
+    lib_system->exitCriticalSection();
+    return full;
+}
+
+void Waps_ind_add(waps_item_t * item)
+{
+    waps_ind_class_e ind_class = Waps_ind_getClass(item->frame.sfunc);
+    waps_ind_stats_t * stats = &m_stats[ind_class];
+    waps_item_t * older = NULL;
+
+    lib_system->enterCriticalSection();
+    if (is_superseding(item->frame.sfunc))
+    {
+        older = find_in_class(ind_class, item->frame.sfunc);
+    }
+
+    if (older != NULL)
+    {
+        // Keep the place (and queuing time) of the older indication
+        older->time = item->time;
+        older->pre_cb = item->pre_cb;
+        older->post_cb = item->post_cb;
+        memcpy(&older->frame, &item->frame, sizeof(waps_frame_t));
+        stats->coalesced++;
+    }
+    else
+    {
+        // Quota is not checked: data RX is held back in the stack before
+        // its indication is built, see Waps_ind_isFull()
+        item->queued_time = lib_time->getTimestampCoarse();
+        sl_list_push_back(&m_queues[ind_class], (sl_list_t *)item);
+        stats->depth++;
+        if (stats->depth > stats->high_water)
+        {
+            stats->high_water = stats->depth;
+        }
+        item = NULL;
+    }
+    lib_system->exitCriticalSection();
+
+    if (item != NULL)
+    {
+        // Merged into the older one
+        Waps_itemFree(item);
+    }
+}
+
+waps_item_t * Waps_ind_find(uint8_t func)
+{
+    waps_item_t * item;
+    lib_system->enterCriticalSection();
+    item = find_in_class(Waps_ind_getClass(func), func);
+    lib_system->exitCriticalSection();
+    return item;
+}
+
+waps_item_t * Waps_ind_pop(void)
+{
+    waps_item_t * item = NULL;
+    bool call_room_cb = false;
+
+    lib_system->enterCriticalSection();
+    for (uint8_t c = 0; c < WAPS_IND_CLASS_COUNT; c++)
+    {
+        item = (waps_item_t *)sl_list_pop_front(&m_queues[c]);
+        if (item != NULL)
+        {
+            waps_ind_stats_t * stats = &m_stats[c];
+            uint32_t delay_ms =
+                COARSE_TO_MS(lib_time->getTimestampCoarse() - item->queued_time);
+            stats->depth--;
+            stats->dequeued++;
+            stats->total_delay_ms += delay_ms;
+            if (delay_ms > stats->max_delay_ms)
+            {
+                stats->max_delay_ms = delay_ms;
+            }
+            if (m_full_reported[c] && !is_full(c))
+            {
+                m_full_reported[c] = false;
+                call_room_cb = true;
+            }
+            break;
+        }
+    }
+    lib_system->exitCriticalSection();
+
+    if (call_room_cb && (m_room_cb != NULL))
+    {
+        m_room_cb();
+    }
+    return item;
+}
+
+void Waps_ind_pushFront(waps_item_t * item)
+{
+    waps_ind_class_e ind_class = Waps_ind_getClass(item->frame.sfunc);
+    lib_system->enterCriticalSection();
+    // Quota is not checked: the item already had its place
+    sl_list_push_front(&m_queues[ind_class], (sl_list_t *)item);
+    m_stats[ind_class].depth++;
+    lib_system->exitCriticalSection();
+}
+
+uint32_t Waps_ind_count(void)
+{
+    uint32_t count = 0;
+    for (uint8_t c = 0; c < WAPS_IND_CLASS_COUNT; c++)
+    {
+        count += m_stats[c].depth;
+    }
+    return count;
+}
+
+bool Waps_ind_getStats(uint8_t ind_class, waps_ind_stats_t * stats)
+{
+    if (ind_class >= WAPS_IND_CLASS_COUNT)
+    {
+        return false;
+    }
+    lib_system->enterCriticalSection();
+    *stats = m_stats[ind_class];
+    lib_system->exitCriticalSection();
+    return true;
+}
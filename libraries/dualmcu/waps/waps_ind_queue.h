@@ -0,0 +1,123 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+#ifndef WAPS_IND_QUEUE_H_
+#define WAPS_IND_QUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "waps_item.h"
+
+/**
+ * Indications are queued per priority class and sent to the host highest
+ * class first, so that a burst of received data does not delay the
+ * indications the host control plane waits for.
+ */
+typedef enum
+{
+    /** Stack state, app config, remote status and scan indications */
+    WAPS_IND_CLASS_CONTROL = 0,
+    /** Data TX indications */
+    WAPS_IND_CLASS_TX = 1,
+    /** Data RX indications */
+    WAPS_IND_CLASS_DATA = 2,
+    WAPS_IND_CLASS_COUNT
+} waps_ind_class_e;
+
+/** Statistics of a single indication class */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Amount of indications currently queued */
+    uint16_t    depth;
+    /** Highest amount of indications queued at the same time */
+    uint16_t    high_water;
+    /** Amount of indications taken from the queue for sending */
+    uint32_t    dequeued;
+    /** Amount of indications merged into an older one of the same kind */
+    uint32_t    coalesced;
+    /** Amount of times the class was found full, so that received data was
+     *  left to the stack */
+    uint32_t    deferred;
+    /** Cumulated queuing time in milliseconds */
+    uint32_t    total_delay_ms;
+    /** Longest queuing time in milliseconds */
+    uint32_t    max_delay_ms;
+} waps_ind_stats_t;
+
+/** Callback called when a full class has room again */
+typedef void (*waps_ind_room_cb_f)(void);
+
+/**
+ * \brief   Initialize indication queues
+ * \param   room_cb
+ *          Called when a class that was reported full has room again
+ */
+void Waps_ind_init(waps_ind_room_cb_f room_cb);
+
+/**
+ * \brief   Get the class of an indication
+ * \param   func
+ *          Function code of the indication
+ * \return  Class of the indication
+ */
+waps_ind_class_e Waps_ind_getClass(uint8_t func);
+
+/**
+ * \brief   Check if a class has reached its quota, only data RX has one
+ * \param   ind_class
+ *          Class to check
+ * \return  True if no more indications of the class should be queued. The
+ *          room callback is called once there is room again
+ */
+bool Waps_ind_isFull(waps_ind_class_e ind_class);
+
+/**
+ * \brief   Queue an indication, it is never dropped
+ * \param   item
+ *          Indication to queue. It is merged into a queued one of the same
+ *          kind if they supersede each other, and then freed
+ */
+void Waps_ind_add(waps_item_t * item);
+
+/**
+ * \brief   Find a queued indication
+ * \param   func
+ *          Function code of the indication
+ * \return  Oldest queued indication with the function code, or NULL
+ */
+waps_item_t * Waps_ind_find(uint8_t func);
+
+/**
+ * \brief   Take the next indication to send, highest class first
+ * \return  Indication or NULL if none queued
+ */
+waps_item_t * Waps_ind_pop(void);
+
+/**
+ * \brief   Put back an indication that could not be sent
+ * \param   item
+ *          Indication got from \ref Waps_ind_pop
+ */
+void Waps_ind_pushFront(waps_item_t * item);
+
+/**
+ * \brief   Get amount of queued indications
+ * \return  Amount of indications in all the classes
+ */
+uint32_t Waps_ind_count(void);
+
+/**
+ * \brief   Get statistics of a class
+ * \param   ind_class
+ *          Class to get statistics for
+ * \param   stats
+ *          Out: statistics of the class
+ * \return  True if class is valid
+ */
+bool Waps_ind_getStats(uint8_t ind_class, waps_ind_stats_t * stats);
+
+#endif /* WAPS_IND_QUEUE_H_ */
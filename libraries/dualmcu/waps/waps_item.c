@@ -5,18 +5,42 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
 #include "waps_item.h"
 #include "api.h"
 
 /** Minimum amount of items that are needed to ensure proper functionality.
  * If the minimum amount of items won't fit in the RAM then a linker error
  * is generated.
- * This minimal value is set to 6 for now but should be validated under high load
- * of a sink attached to a gateway. Anyway, all the free remaining RAM will be used
- * for additional buffer, so this value is just a message to realize that we are
- * really low on RAM
+ * This minimal value is set to 6 by default but should be validated under high
+ * load of a sink attached to a gateway (see the failed reservation and high
+ * water counters of \ref waps_item_stats_t). Anyway, all the free remaining RAM
+ * will be used for additional buffer, so this value is just a message to
+ * realize that we are really low on RAM
 **/
+#ifndef WAPS_MIN_ITEMS
 #define WAPS_MIN_ITEMS          6
+#endif
+
+/** Amount of items kept for requests only: indications cannot use them */
+#ifndef WAPS_RESERVED_ITEMS
+#define WAPS_RESERVED_ITEMS     2
+#endif
+
+/** Maximum amount of items used for requests at the same time (0: no limit) */
+#ifndef WAPS_MAX_REQUEST_ITEMS
+#define WAPS_MAX_REQUEST_ITEMS  0
+#endif
+
+/** Maximum amount of items used for indications at the same time (0: no limit) */
+#ifndef WAPS_MAX_INDICATION_ITEMS
+#define WAPS_MAX_INDICATION_ITEMS   0
+#endif
+
+#if WAPS_RESERVED_ITEMS >= WAPS_MIN_ITEMS
+#error "WAPS_RESERVED_ITEMS must be smaller than WAPS_MIN_ITEMS"
+#endif
 
 // Addresses determined by the linker
 extern uint32_t                 __bss_end__;
@@ -26,14 +50,21 @@ extern uint32_t *               m_used_app_ram_end;
 // Memory for min items, make sure first element aligns properly
 static waps_item_t __attribute__((aligned(4))) waps_item_bank[WAPS_MIN_ITEMS];
 
-#define WAPS_RESERVED_ITEMS     2
-
 // Limit how many free items must be in the buffer in order to allow firmware to
 // send new packets to application.
 static uint32_t                 m_free_waps_items;
 
-// Memory for items, make sure first element aligns properly
-//static waps_item_t __attribute__((aligned(4))) waps_item;
+// Total amount of items in the pool
+static uint32_t                 m_total_waps_items;
+
+// Amount of items in use, per item type
+static uint32_t                 m_used_items[2];
+
+// Highest amount of items in use at the same time, per item type
+static uint32_t                 m_high_water[2];
+
+// Amount of refused reservation attempts, per item type
+static uint32_t                 m_failed_attempts[2];
 
 // List of usable (free) items
 static sl_list_head_t           free_items;
@@ -59,6 +90,10 @@ void Waps_itemInit(waps_free_item_threshold_cb_t thresold_cb,
     max_waps_items += (uint32_t)(free_bytes / sizeof(waps_item_t));
 
     m_free_waps_items = max_waps_items * thresold_percent / 100;
+    m_total_waps_items = max_waps_items;
+    memset(m_used_items, 0, sizeof(m_used_items));
+    memset(m_high_water, 0, sizeof(m_high_water));
+    memset(m_failed_attempts, 0, sizeof(m_failed_attempts));
     // Initialize free items list
     sl_list_init(&free_items);
     // Clear items
@@ -82,17 +117,62 @@ void Waps_itemInit(waps_free_item_threshold_cb_t thresold_cb,
     m_used_app_ram_end = free_ram_start;
 }
 
+/**
+ * \brief   Check if an item of given type can be taken from the pool
+ * \param   type
+ *          Type of item to reserve
+ * \return  True if reservation is allowed
+ * \note    Must be called from critical section
+ */
+static bool reservation_allowed(waps_item_type_e type)
+{
+    uint32_t free_count = sl_list_size(&free_items);
+
+    if (type == WAPS_ITEM_TYPE_REQUEST)
+    {
+#if WAPS_MAX_REQUEST_ITEMS > 0
+        if (m_used_items[type] >= WAPS_MAX_REQUEST_ITEMS)
+        {
+            return false;
+        }
+#endif
+        return (free_count > 0);
+    }
+
+#if WAPS_MAX_INDICATION_ITEMS > 0
+    if (m_used_items[type] >= WAPS_MAX_INDICATION_ITEMS)
+    {
+        return false;
+    }
+#endif
+    // Keep some items for requests, so host can always poll indications
+    return (free_count > WAPS_RESERVED_ITEMS);
+}
+
 waps_item_t * Waps_itemReserve(waps_item_type_e type)
 {
     // Reserve item from free items
     waps_item_t * item = NULL;
     lib_system->enterCriticalSection();
-    if((type == WAPS_ITEM_TYPE_REQUEST) ||
-       (sl_list_size(&free_items) > WAPS_RESERVED_ITEMS))
+    if (reservation_allowed(type))
     {
         // Either a request frame, or we have memory for new indication
         item = (waps_item_t *)sl_list_pop_front(&free_items);
     }
+
+    if (item != NULL)
+    {
+        item->type = type;
+        m_used_items[type]++;
+        if (m_used_items[type] > m_high_water[type])
+        {
+            m_high_water[type] = m_used_items[type];
+        }
+    }
+    else
+    {
+        m_failed_attempts[type]++;
+    }
     lib_system->exitCriticalSection();
     return item;
 }
@@ -101,6 +181,10 @@ void Waps_itemFree(waps_item_t * item)
 {
     // Push item to free items list
     lib_system->enterCriticalSection();
+    if (m_used_items[item->type] > 0)
+    {
+        m_used_items[item->type]--;
+    }
     sl_list_push_front(&free_items, (sl_list_t *)item);
     lib_system->exitCriticalSection();
     // If there is enough room in the buffer, announce firmware to send new
@@ -111,3 +195,19 @@ void Waps_itemFree(waps_item_t * item)
         m_threshold_cb();
     }
 }
+
+void Waps_itemGetStats(waps_item_stats_t * stats)
+{
+    lib_system->enterCriticalSection();
+    stats->total = (uint16_t)m_total_waps_items;
+    stats->free = (uint16_t)sl_list_size(&free_items);
+    stats->request_high_water =
+        (uint16_t)m_high_water[WAPS_ITEM_TYPE_REQUEST];
+    stats->indication_high_water =
+        (uint16_t)m_high_water[WAPS_ITEM_TYPE_INDICATION];
+    stats->request_failed_attempts =
+        m_failed_attempts[WAPS_ITEM_TYPE_REQUEST];
+    stats->indication_failed_attempts =
+        m_failed_attempts[WAPS_ITEM_TYPE_INDICATION];
+    lib_system->exitCriticalSection();
+}
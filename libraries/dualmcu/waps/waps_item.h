@@ -36,6 +36,10 @@ typedef struct waps_item_t
     sl_list_t           list;
     /** Creation timestamp of item */
     uint32_t            time;
+    /** Type the item was reserved as, used for pool accounting */
+    waps_item_type_e    type;
+    /** Timestamp the indication was queued at, for queuing delay metrics */
+    uint32_t            queued_time;
     waps_pre_tx_cb_f    pre_cb;
     waps_post_tx_cb_f   post_cb;
     /** Note that the frame is reused for the reply */
@@ -45,6 +49,24 @@ typedef struct waps_item_t
     STRUCT_ALIGN_4(waps_frame_t);
 } waps_item_t;
 
+/** Item pool statistics, as exposed through CSAP attribute */
+typedef struct __attribute__ ((__packed__))
+{
+    /** Total amount of items in the pool */
+    uint16_t    total;
+    /** Amount of items currently free */
+    uint16_t    free;
+    /** Highest amount of request items in use at the same time */
+    uint16_t    request_high_water;
+    /** Highest amount of indication items in use at the same time */
+    uint16_t    indication_high_water;
+    /** Amount of refused request item reservation attempts */
+    uint32_t    request_failed_attempts;
+    /** Amount of refused indication item reservation attempts. A received
+     *  packet the stack retries to deliver is counted at each attempt */
+    uint32_t    indication_failed_attempts;
+} waps_item_stats_t;
+
 /**
  * \brief   Initialize common frame fields
  * \param   item
@@ -87,4 +109,11 @@ waps_item_t * Waps_itemReserve(waps_item_type_e type);
  */
 void Waps_itemFree(waps_item_t * item);
 
+/**
+ * \brief   Get item pool statistics
+ * \param   stats
+ *          Pointer to store the statistics to
+ */
+void Waps_itemGetStats(waps_item_stats_t * stats);
+
 #endif /* WAPS_ITEM_H_ */
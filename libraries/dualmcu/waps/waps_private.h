@@ -8,9 +8,21 @@
 #define SOURCE_WAPS_APP_WAPS_WAPS_PRIVATE_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "wms_settings.h"
 
+/** Request handling statistics of a single function code */
+typedef struct
+{
+    /** Amount of requests handled */
+    uint32_t    calls;
+    /** Cumulated handling time in microseconds */
+    uint32_t    total_time_us;
+    /** Longest handling time in microseconds */
+    uint32_t    max_time_us;
+} waps_func_stats_t;
+
 /**
  * \brief   Get information about queued indications
  * \return  1 if indications queued
@@ -30,4 +42,14 @@ void wakeup_task(void);
  */
 app_lib_settings_net_channel_t get_num_channels(void);
 
+/**
+ * \brief   Get request handling statistics of a function code
+ * \param   func
+ *          Function code of the request
+ * \param   stats
+ *          Out: statistics of the function code
+ * \return  True if statistics are available (enabled with waps_func_stats)
+ */
+bool Waps_getFuncStats(uint8_t func, waps_func_stats_t * stats);
+
 #endif /* SOURCE_WAPS_APP_WAPS_WAPS_PRIVATE_H_ */
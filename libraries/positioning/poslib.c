@@ -65,6 +65,16 @@ app_lib_data_send_res_e PosLib_sendData(app_lib_data_to_send_t * data,
     return PosLibDa_sendData(data, sent_cb);
 }
 
+poslib_ret_e PosLib_getScanStats(poslib_scan_stats_t * stats)
+{
+    return PosLibCtrl_getScanStats(stats);
+}
+
+poslib_ret_e PosLib_getUpdateStats(poslib_update_stats_t * stats)
+{
+    return PosLibCtrl_getUpdateStats(stats);
+}
+
 bool PosLib_decodeMbcn(uint8_t * buf, uint8_t length, poslib_mbcn_data_t * mbcn)
 {
     return PosLibMbcn_decode(buf, length, mbcn);
@@ -196,6 +196,9 @@ typedef enum
     POSLIB_MBCN_TX_INTERVAL_250 = 250,
 } poslib_mbcn_tx_interval_e;
 
+/**< Maximum random variation of the mini-beacon tx interval [%] */
+#define POSLIB_MBCN_TX_JITTER_MAX_PCT 50
+
 /**
  * @brief  defines mini-beacon record.
  */
@@ -214,6 +217,8 @@ typedef struct
     bool enabled;
     uint16_t tx_interval_ms;
     poslib_mbcn_record_t records[POSLIB_MBCN_RECORDS];
+    /* random variation of each tx interval, +/- [0 ... POSLIB_MBCN_TX_JITTER_MAX_PCT %] */
+    uint8_t tx_jitter_pct;
 } poslib_mbcn_config_t;
 
 
@@ -270,6 +275,101 @@ typedef struct
     bool follow_network;
 } poslib_da_settings_t;
 
+/**
+ * @brief  defines the filter applied on the rss of received beacons.
+ */
+typedef enum
+{
+    POSLIB_RSS_FILTER_MEAN = 0,     // running mean of the last samples
+    POSLIB_RSS_FILTER_EWMA = 1,     // exponentially weighted moving average
+    POSLIB_RSS_FILTER_MEDIAN = 2,   // median of the last samples
+    POSLIB_RSS_FILTER_KALMAN = 3,   // 1-D Kalman filter
+} poslib_rss_filter_type_e;
+
+/**
+ * @brief position library rss filter settings.
+ *        Static and dynamic values are selected with PosLib_motion.
+ */
+typedef struct
+{
+    poslib_rss_filter_type_e type;
+    /* EWMA weight of a new sample, in 1/256 [1 ... 255] */
+    uint8_t ewma_alpha_static;
+    uint8_t ewma_alpha_dynamic;
+    /* Kalman process noise added per sample [dB^2] */
+    uint8_t kalman_q_static;
+    uint8_t kalman_q_dynamic;
+    /* Kalman measurement noise [dB^2], shall be > 0 */
+    uint8_t kalman_r;
+} poslib_rss_filter_settings_t;
+
+/** Maximum rss quantisation step of the compact measurement record [0.5 dB] */
+#define POSLIB_MEAS_RSS_STEP_MAX 20
+
+/**
+ * @brief position library measurement report settings.
+ */
+typedef struct
+{
+    /* Report rss with the compact record: sorted delta encoded addresses,
+     * quantised rss and tx power only when it changes */
+    bool compact;
+    /* Compact record rss quantisation step in 0.5 dB
+     * [1 ... POSLIB_MEAS_RSS_STEP_MAX] */
+    uint8_t rss_step;
+} poslib_meas_report_settings_t;
+
+/**
+ * @brief position library adaptive scan settings.
+ *        Used by autoscan and DA tags when motion monitoring reports the
+ *        node static. Any change of the beacons or motion goes back to
+ *        full scans.
+ */
+typedef struct
+{
+    bool enabled;
+    /* duration of the short scans checking that beacons are unchanged [ms] */
+    uint16_t short_scan_ms;
+    /* maximum scans skipped in a row, the beacons of the last scan are reported */
+    uint8_t max_skipped;
+    /* maximum rss change of a beacon still seen as unchanged [dB] */
+    uint8_t rss_threshold_db;
+} poslib_adaptive_scan_settings_t;
+
+/**
+ * @brief position library scan statistics.
+ */
+typedef struct
+{
+    uint32_t full_scans;
+    uint32_t short_scans;
+    uint32_t skipped_scans;
+    /* radio-on time saved by the short and skipped scans, estimated from
+     * the duration of the last full scan [ms] */
+    uint32_t saved_ms;
+} poslib_scan_stats_t;
+
+/**
+ * @brief position library update statistics.
+ *        Timings are of the last update, other values are cumulated.
+ */
+typedef struct
+{
+    uint32_t updates;
+    /* update start to scan end [ms] */
+    uint32_t scan_ms;
+    /* time the measurement message waited in the stack buffers [ms] */
+    uint32_t send_ms;
+    /* update start to update end [ms] */
+    uint32_t update_ms;
+    /* cumulated scan time, estimates the radio-on time of scans [ms] */
+    uint32_t scan_total_ms;
+    /* cumulated measurement message bytes */
+    uint32_t payload_bytes;
+    /* cumulated time spent processing PosLib internal events [us] */
+    uint32_t cpu_us;
+} poslib_update_stats_t;
+
 /**
  * @brief position library settings.
  */
@@ -293,6 +393,12 @@ typedef struct
     poslib_mbcn_config_t mbcn;
     /* DA settings */
     poslib_da_settings_t da;
+    /* RSS filter settings */
+    poslib_rss_filter_settings_t rss_filter;
+    /* Measurement report settings */
+    poslib_meas_report_settings_t report;
+    /* Adaptive scan settings */
+    poslib_adaptive_scan_settings_t adaptive_scan;
 } poslib_settings_t;
 
 /**
@@ -397,6 +503,21 @@ poslib_ret_e PosLib_eventRegister(poslib_events_e event,
  */
 void PosLib_eventDeregister(uint8_t id);
 
+/**
+ * @brief   Gets the scan statistics of the adaptive scan
+ * @param   stats pointer where statistics will be copied
+ * @return  See \ref poslib_ret_e
+ */
+poslib_ret_e PosLib_getScanStats(poslib_scan_stats_t * stats);
+
+/**
+ * @brief   Gets the update statistics: state machine timings, payload and
+ *          processing time, to compare settings on the field
+ * @param   stats pointer where statistics will be copied
+ * @return  See \ref poslib_ret_e
+ */
+poslib_ret_e PosLib_getUpdateStats(poslib_update_stats_t * stats);
+
 /**
  * @brief   Decodes the mini-beacon payload
  * @param[in]   buf pointer to MBCN payload
@@ -5,6 +5,7 @@
  */
 
 #include <string.h>
+#include <stddef.h>
 #define DEBUG_LOG_MODULE_NAME "POSLIB_BLE"
 #ifdef DEBUG_POSLIB_LOG_MAX_LEVEL
 #define DEBUG_LOG_MAX_LEVEL DEBUG_POSLIB_LOG_MAX_LEVEL
@@ -100,8 +101,33 @@ typedef struct
     int8_t tx_power;
 } ibeacon_frame_t;
 
+/**
+ * @brief Prepared beacon frame and the values it was built with
+ */
+typedef struct
+{
+    uint8_t data[MAX_BLE_BEACON_TX_SIZE];
+    app_addr_t node_address;
+    app_lib_settings_net_addr_t network_address;
+    int8_t tx_power;
+    bool valid;
+} beacon_frame_t;
+
+/**
+ * @brief Beacon running with a prepared frame
+ */
+typedef struct
+{
+    poslib_ble_mode_config_t cfg;  // Configuration the beacon was started with
+    bool content_changed;          // Frame patched since the beacon started
+} beacon_tx_t;
+
 #define AD_TYPE 0x42            // Non-connectable Beacon
 static uint8_t m_addresses[6];  // Storage for Node Id and Network address
+static beacon_frame_t m_eddystone_frame;
+static beacon_frame_t m_ibeacon_frame;
+static beacon_tx_t m_eddystone_tx;
+static beacon_tx_t m_ibeacon_tx;
 static uint8_t m_eddystone_idx;
 static uint8_t m_ibeacon_idx;
 static bool m_eddystone_enabled = false;
@@ -286,31 +312,183 @@ static void set_random_address()
     LOG(LVL_DEBUG, "Ble Beacon updated for node :0x%x", node_address);
 }
 
+/**
+ * @brief   Patch the fields depending on the node address
+ * @param   ble_type
+ *          Type of the frame
+ * @param   frame
+ *          Prepared frame to patch
+ */
+static void patch_node_address(poslib_ble_type_e ble_type,
+                               beacon_frame_t * frame)
+{
+    set_random_address();
+    memcpy(&frame->data[offsetof(beacon_common_frame_t, nid)],
+           m_addresses,
+           sizeof(m_addresses));
+
+#ifdef USE_EDYSTONE_UID
+    if (ble_type == POSLIB_EDDYSTONE)
+    {
+        uint8_t * bid = &frame->data[sizeof(beacon_common_frame_t) +
+                                     offsetof(eddystone_uid_frame_t, bid)];
+        bid[2] = (uint8_t)((frame->node_address >>  24) & 0xff);
+        bid[3] = (uint8_t)((frame->node_address >>  16) & 0xff);
+        bid[4] = (uint8_t)((frame->node_address >>  8) & 0xff);
+        bid[5] = (uint8_t)((frame->node_address) & 0xff);
+    }
+#else
+    (void) ble_type;
+#endif
+}
+
+/**
+ * @brief   Patch the fields depending on the network address
+ * @param   ble_type
+ *          Type of the frame
+ * @param   frame
+ *          Prepared frame to patch
+ */
+static void patch_network_address(poslib_ble_type_e ble_type,
+                                  beacon_frame_t * frame)
+{
+    uint8_t * field = NULL;
+
+    if (ble_type == POSLIB_IBEACON)
+    {
+        field = &frame->data[sizeof(beacon_common_frame_t) +
+                             offsetof(ibeacon_frame_t, uuid) + 13];
+    }
+#ifdef USE_EDYSTONE_UID
+    else
+    {
+        field = &frame->data[sizeof(beacon_common_frame_t) +
+                             offsetof(eddystone_uid_frame_t, nid) + 7];
+    }
+#endif
+
+    if (field != NULL)
+    {
+        field[0] = (uint8_t)((frame->network_address >>  16) & 0xff);
+        field[1] = (uint8_t)((frame->network_address >>  8) & 0xff);
+        field[2] = (uint8_t)((frame->network_address) & 0xff);
+    }
+}
+
+/**
+ * @brief   Patch the advertised TX power
+ * @param   ble_type
+ *          Type of the frame
+ * @param   frame
+ *          Prepared frame to patch
+ */
+static void patch_tx_power(poslib_ble_type_e ble_type, beacon_frame_t * frame)
+{
+    if (ble_type == POSLIB_IBEACON)
+    {
+        frame->data[sizeof(beacon_common_frame_t) +
+                    offsetof(ibeacon_frame_t, tx_power)] =
+                                                (uint8_t) frame->tx_power;
+    }
+#ifdef USE_EDYSTONE_UID
+    else
+    {
+        frame->data[sizeof(beacon_common_frame_t) +
+                    offsetof(eddystone_uid_frame_t, tx_power)] =
+                                                (uint8_t) frame->tx_power;
+    }
+#endif
+}
+
+/**
+ * @brief   Prepare the frame of a beacon type. The frame is fully built only
+ *          once, later calls only patch the fields whose source changed
+ * @param   ble_type
+ *          Type of the frame
+ * @param   frame
+ *          Frame to prepare
+ * @param   tx_power
+ *          TX power to advertise
+ * @return  true if the frame content changed
+ */
+static bool prepare_frame(poslib_ble_type_e ble_type,
+                          beacon_frame_t * frame,
+                          int8_t tx_power)
+{
+    app_addr_t node_address;
+    app_lib_settings_net_addr_t network_address;
+    bool changed = false;
+
+    lib_settings->getNodeAddress(&node_address);
+    lib_settings->getNetworkAddress(&network_address);
+
+    if (!frame->valid)
+    {
+        memset(frame->data, 0, sizeof(frame->data));
+        set_random_address();
+        if (ble_type == POSLIB_EDDYSTONE)
+        {
+            set_eddystone_dataframe(frame->data, tx_power);
+        }
+        else
+        {
+            set_ibeacon_dataframe(frame->data, tx_power);
+        }
+        frame->node_address = node_address;
+        frame->network_address = network_address;
+        frame->tx_power = tx_power;
+        frame->valid = true;
+        LOG(LVL_DEBUG, "BLE frame %u built", ble_type);
+        return true;
+    }
+
+    if (frame->node_address != node_address)
+    {
+        frame->node_address = node_address;
+        patch_node_address(ble_type, frame);
+        changed = true;
+    }
+
+    if (frame->network_address != network_address)
+    {
+        frame->network_address = network_address;
+        patch_network_address(ble_type, frame);
+        changed = true;
+    }
+
+    if (frame->tx_power != tx_power)
+    {
+        frame->tx_power = tx_power;
+        patch_tx_power(ble_type, frame);
+        changed = true;
+    }
+
+    if (changed)
+    {
+        LOG(LVL_DEBUG, "BLE frame %u patched", ble_type);
+    }
+    return changed;
+}
+
 bool start_beacon(poslib_ble_type_e ble_type, 
                     poslib_ble_mode_config_t * ble_cfg,
                     uint8_t * ble_index)
 {
-    uint8_t buffer[MAX_BLE_BEACON_TX_SIZE] = {0};
-
-    set_random_address(); 
+    beacon_frame_t * frame;
+    beacon_tx_t * tx;
+    bool * enabled;
 
     if (ble_type == POSLIB_EDDYSTONE)
     {
-        set_eddystone_dataframe(buffer, ble_cfg->tx_power);
-        if (m_eddystone_enabled)
-        {
-            Shared_Beacon_stopBeacon(m_eddystone_idx);
-            m_eddystone_enabled = false;
-        }
+        frame = &m_eddystone_frame;
+        tx = &m_eddystone_tx;
+        enabled = &m_eddystone_enabled;
     }
     else if (ble_type == POSLIB_IBEACON)
     {
-        set_ibeacon_dataframe(buffer, ble_cfg->tx_power);
-        if (m_ibeacon_enabled)
-        {
-           Shared_Beacon_stopBeacon(m_ibeacon_idx);
-           m_ibeacon_enabled = false; 
-        }
+        frame = &m_ibeacon_frame;
+        tx = &m_ibeacon_tx;
+        enabled = &m_ibeacon_enabled;
     }
     else
     {
@@ -318,12 +496,49 @@ bool start_beacon(poslib_ble_type_e ble_type,
         return false;
     }
 
-    return (Shared_Beacon_startBeacon(ble_cfg->tx_interval_ms,
-                                        &ble_cfg->tx_power,
-                                        ble_cfg->channels,
-                                        buffer,
-                                        sizeof(buffer),
-                                        ble_index) == SHARED_BEACON_RES_OK);
+    if (prepare_frame(ble_type, frame, ble_cfg->tx_power))
+    {
+        tx->content_changed = true;
+    }
+
+    if (*enabled &&
+        memcmp(&tx->cfg, ble_cfg, sizeof(poslib_ble_mode_config_t)) == 0)
+    {
+        // Same transmission parameters: the beacon slot is kept and only
+        // its content is swapped, in one call, if the frame was patched
+        if (!tx->content_changed ||
+            Shared_Beacon_updateContents(*ble_index,
+                                         frame->data,
+                                         sizeof(frame->data))
+                                         == SHARED_BEACON_RES_OK)
+        {
+            tx->content_changed = false;
+            return true;
+        }
+        // Slot still sends the old content: restart it below
+        LOG(LVL_ERROR, "BLE beacon %u content update failed", ble_type);
+    }
+
+    if (*enabled)
+    {
+        Shared_Beacon_stopBeacon(*ble_index);
+        *enabled = false;
+    }
+
+    if (Shared_Beacon_startBeacon(ble_cfg->tx_interval_ms,
+                                  &ble_cfg->tx_power,
+                                  ble_cfg->channels,
+                                  frame->data,
+                                  sizeof(frame->data),
+                                  ble_index) != SHARED_BEACON_RES_OK)
+    {
+        return false;
+    }
+
+    // Saved after start as the stack may adjust the requested power
+    memcpy(&tx->cfg, ble_cfg, sizeof(poslib_ble_mode_config_t));
+    tx->content_changed = false;
+    return true;
 }
 
 void start_beacons(ble_beacon_settings_t * settings)
@@ -16,7 +16,6 @@
 #include "app_scheduler.h"
 #include "random.h"
 #include "poslib.h"
-#include "posapp_settings.h"
 #include "poslib_ble_beacon.h"
 #include "poslib_control.h"
 #include "poslib_event.h"
@@ -27,6 +26,7 @@
 #include "shared_appconfig.h"
 #include "shared_offline.h"
 #include "poslib_mbcn.h"
+#include "poslib_filter.h"
 
 /** Module internal type definitions */
 
@@ -65,6 +65,22 @@ typedef struct {
     uint16_t id; //FixME: all Shared libraries should use uint8_t
 } callback_state_t;
 
+typedef enum {
+    SCAN_TYPE_FULL = 0,
+    SCAN_TYPE_SHORT = 1,
+    SCAN_TYPE_SKIPPED = 2,
+} scan_type_e;
+
+/* Adaptive scan state */
+typedef struct {
+    bool stable;            // last scan matched the reference scan
+    bool changed;           // motion or settings changed during the scan
+    uint8_t skipped;        // scans skipped in a row
+    scan_type_e type;       // type of the ongoing scan
+    uint32_t full_scan_ms;  // duration of the last full scan
+    poslib_scan_stats_t stats;
+} adaptive_scan_state_t;
+
 #define SHARED_INVALID_ID 65535
 #define MOTION_DEFAULT POSLIB_MOTION_STATIC
 
@@ -98,6 +114,8 @@ static bool m_poslib_started = false;
 static bool m_poslib_configured = false;
 static bool m_poslib_init = false;
 static control_state_t m_ctrl;
+static adaptive_scan_state_t m_adaptive;
+static poslib_update_stats_t m_update_stats;
 
 /** Events private data */
 //ToDo: generalize event private data later 
@@ -154,6 +172,8 @@ static offline_setting_conf_t m_shared_offline_cbs =
 static void data_send_cb(const app_lib_data_sent_status_t * status)
 {
     m_data_sent_success = status->success;
+    // queue time is in 1/128 s
+    m_update_stats.send_ms = (status->queue_time * 1000) >> 7;
     PosLibEvent_add(POSLIB_CTRL_EVENT_DATA_SENT);
 }
 
@@ -490,6 +510,50 @@ static poslib_ret_e check_ble_params(poslib_settings_t * settings)
     return POS_RET_OK;
 }
 
+/**
+ * @brief       Check that rss filter parameters are valid for selected filter.
+ * @param       settings
+ * @return      POS_RET_INVALID_PARAM when parameters check fails,
+ *              POS_RET_OK when parameters check success.
+ */
+static poslib_ret_e check_filter_params(poslib_settings_t * settings)
+{
+    poslib_rss_filter_settings_t * flt = &settings->rss_filter;
+
+    switch (flt->type)
+    {
+        case POSLIB_RSS_FILTER_MEAN:
+        case POSLIB_RSS_FILTER_MEDIAN:
+        {
+            break;
+        }
+        case POSLIB_RSS_FILTER_EWMA:
+        {
+            if (flt->ewma_alpha_static == 0 || flt->ewma_alpha_dynamic == 0)
+            {
+                LOG(LVL_ERROR, "EWMA alpha cannot be 0");
+                return POS_RET_INVALID_PARAM;
+            }
+            break;
+        }
+        case POSLIB_RSS_FILTER_KALMAN:
+        {
+            if (flt->kalman_r == 0)
+            {
+                LOG(LVL_ERROR, "Kalman measurement noise cannot be 0");
+                return POS_RET_INVALID_PARAM;
+            }
+            break;
+        }
+        default:
+        {
+            LOG(LVL_ERROR, "Unknown rss filter: %u", flt->type);
+            return POS_RET_INVALID_PARAM;
+        }
+    }
+    return POS_RET_OK;
+}
+
 /**
  * @brief       Checking set PosLib settings range.
  * @return      POS_RET_INVALID_PARAM when parameters check fails,
@@ -515,6 +579,37 @@ static poslib_ret_e check_ctrl_params(poslib_settings_t * settings)
         return POS_RET_INVALID_PARAM;
     }
 
+    /** Check for valid mini-beacon configuration if feature is enabled */
+    if(settings->mbcn.enabled &&
+       settings->mbcn.tx_jitter_pct > POSLIB_MBCN_TX_JITTER_MAX_PCT)
+    {
+        LOG(LVL_ERROR, "Incorrect mini-beacon jitter: %u", settings->mbcn.tx_jitter_pct);
+        return POS_RET_INVALID_PARAM;
+    }
+
+    /** Check for valid adaptive scan configuration if enabled */
+    if(settings->adaptive_scan.enabled &&
+       settings->adaptive_scan.short_scan_ms == 0)
+    {
+        LOG(LVL_ERROR, "Adaptive scan short scan duration cannot be 0");
+        return POS_RET_INVALID_PARAM;
+    }
+
+    /** Check for valid rss filter configuration */
+    if(check_filter_params(settings) == POS_RET_INVALID_PARAM)
+    {
+        return POS_RET_INVALID_PARAM;
+    }
+
+    /** Check for valid compact record rss step */
+    if(settings->report.compact &&
+       (settings->report.rss_step == 0 ||
+        settings->report.rss_step > POSLIB_MEAS_RSS_STEP_MAX))
+    {
+        LOG(LVL_ERROR, "Invalid rss step: %u", settings->report.rss_step);
+        return POS_RET_INVALID_PARAM;
+    }
+
     return POS_RET_OK;
 }
 
@@ -596,6 +691,7 @@ static void control_init(void)
         m_ctrl.next_update_s =  m_ctrl.last_update_s;
         m_ctrl.state = POSLIB_STATE_STOPPED;
         m_motion_mode = MOTION_DEFAULT;
+        PosLibFilter_setMotion(m_motion_mode);
         m_poslib_init = true;
         memset(&m_aux_settings, 0, sizeof(m_aux_settings));
     }
@@ -614,7 +710,18 @@ poslib_ret_e PosLibCtrl_setConfig(poslib_settings_t * settings)
     if (!m_poslib_configured || 
         memcmp(&m_pos_settings , settings, sizeof(m_pos_settings)) != 0)
     {
+        bool filter_change = m_poslib_configured &&
+            (m_pos_settings.rss_filter.type != settings->rss_filter.type);
+
         memcpy(&m_pos_settings , settings, sizeof(m_pos_settings));
+        PosLibFilter_configure(&m_pos_settings.rss_filter);
+        if (filter_change)
+        {
+            // beacons keep the state of the previous filter: restart them
+            PosLibMeas_resetFilters();
+        }
+        m_adaptive.stable = false;
+        m_adaptive.changed = true;
         config_change = true;
     }
    
@@ -732,12 +839,32 @@ poslib_ret_e PosLibCtrl_motion(poslib_motion_mode_e mode)
     if(m_motion_mode != mode)
     {
         m_motion_mode = mode;
+        PosLibFilter_setMotion(mode);
+        // next scan is a full one, even if this one ends later
+        m_adaptive.stable = false;
+        m_adaptive.changed = true;
         PosLibEvent_add(POSLIB_CTRL_EVENT_MOTION);
     }
     
     return POS_RET_OK;
 }
 
+poslib_ret_e PosLibCtrl_getScanStats(poslib_scan_stats_t * stats)
+{
+    *stats = m_adaptive.stats;
+    return POS_RET_OK;
+}
+
+poslib_ret_e PosLibCtrl_getUpdateStats(poslib_update_stats_t * stats)
+{
+    poslib_event_stats_t event_stats;
+
+    PosLibEvent_getStats(&event_stats);
+    *stats = m_update_stats;
+    stats->cpu_us = event_stats.processing_us;
+    return POS_RET_OK;
+}
+
 poslib_status_e PosLibCtrl_status(void)
 {
    switch (m_ctrl.state)
@@ -790,6 +917,13 @@ poslib_measurements_e get_meas_type()
         }
     }
 
+    if (m_pos_settings.report.compact)
+    {
+        meas_type = (meas_type == DEFAULT_MEASUREMENT_TYPE_ANCHOR) ?
+                        POSLIB_MEAS_RSS_SR_ANCHOR_COMPACT :
+                        POSLIB_MEAS_RSS_SR_COMPACT;
+    }
+
     return meas_type;
 }
 
@@ -858,12 +992,14 @@ static uint8_t send_measurement_message()
     get_node_info(&node_info);
 
     if (PosLibMeas_getPayload(bytes, sizeof(bytes), m_ctrl.sequence,
-                                get_meas_type(), add_voltage, &node_info, 
+                                get_meas_type(), m_pos_settings.report.rss_step,
+                                add_voltage, &node_info,
                                 &num_bytes, &num_meas))
     {
         /** add payload to be sent */
         payload.bytes = bytes;
         payload.num_bytes = num_bytes;
+        m_update_stats.payload_bytes += num_bytes;
         payload.dest_address = APP_ADDR_ANYSINK;
         payload.src_endpoint = POS_SOURCE_ENDPOINT;;
         payload.dest_endpoint = POS_DESTINATION_ENDPOINT;
@@ -905,6 +1041,102 @@ static uint32_t get_scan_duration()
     return scan_duration_us;
 }
 
+/**
+ * @brief   Adaptive scan is used by tags scanning by themselves
+ */
+static bool is_adaptive_scan_mode(void)
+{
+    return m_pos_settings.adaptive_scan.enabled &&
+           (m_pos_settings.node_mode == POSLIB_MODE_AUTOSCAN_TAG ||
+            m_pos_settings.node_mode == POSLIB_MODE_DA_TAG);
+}
+
+/**
+ * @brief   Scans are shortened or skipped only when motion monitoring
+ *          reports the tag static
+ */
+static bool is_adaptive_scan_active(void)
+{
+    return is_adaptive_scan_mode() &&
+           m_pos_settings.motion.enabled &&
+           m_motion_mode == POSLIB_MOTION_STATIC;
+}
+
+/**
+ * @brief   Selects the next scan. Until two consecutive scans see the same
+ *          beacons full scans are done, then up to max_skipped scans are
+ *          skipped between short scans checking that beacons are unchanged.
+ */
+static scan_type_e select_scan_type(void)
+{
+    if (!is_adaptive_scan_active() || !m_adaptive.stable)
+    {
+        m_adaptive.skipped = 0;
+        return SCAN_TYPE_FULL;
+    }
+
+    if (m_adaptive.skipped < m_pos_settings.adaptive_scan.max_skipped)
+    {
+        m_adaptive.skipped++;
+        return SCAN_TYPE_SKIPPED;
+    }
+
+    m_adaptive.skipped = 0;
+    return SCAN_TYPE_SHORT;
+}
+
+/**
+ * @brief   Updates adaptive scan state at scan end
+ * @param   scan_ms duration of the scan
+ */
+static void adaptive_scan_end(uint32_t scan_ms)
+{
+    poslib_scan_stats_t * stats = &m_adaptive.stats;
+
+    if (!is_adaptive_scan_mode())
+    {
+        return;
+    }
+
+    switch (m_adaptive.type)
+    {
+        case SCAN_TYPE_FULL:
+        {
+            stats->full_scans++;
+            m_adaptive.full_scan_ms = scan_ms;
+            m_adaptive.stable = !m_adaptive.changed &&
+                is_adaptive_scan_active() &&
+                PosLibMeas_isScanStable(m_pos_settings.adaptive_scan.rss_threshold_db);
+            PosLibMeas_setScanReference();
+            break;
+        }
+        case SCAN_TYPE_SHORT:
+        {
+            stats->short_scans++;
+            if (m_adaptive.full_scan_ms > scan_ms)
+            {
+                stats->saved_ms += m_adaptive.full_scan_ms - scan_ms;
+            }
+            // any change escalates back to full scans
+            m_adaptive.stable = m_adaptive.stable &&
+                PosLibMeas_isScanStable(m_pos_settings.adaptive_scan.rss_threshold_db);
+            break;
+        }
+        case SCAN_TYPE_SKIPPED:
+        {
+            stats->skipped_scans++;
+            stats->saved_ms += m_adaptive.full_scan_ms;
+            break;
+        }
+    }
+
+    LOG(LVL_DEBUG, "Adaptive scan type: %u, %u ms, stable: %u, saved: %u ms",
+        m_adaptive.type, scan_ms, m_adaptive.stable, stats->saved_ms);
+
+    // scans not started by PosLib (i.e. opportunistic) are full scans
+    m_adaptive.type = SCAN_TYPE_FULL;
+}
+
 static uint32_t trigger_update_task()
 {
     uint32_t elapsed_s;
@@ -936,9 +1168,25 @@ static uint32_t trigger_update_task()
     }
 
     //Stack online - trigger scan
+    m_adaptive.changed = false;
+    m_adaptive.type = select_scan_type();
+    if (m_adaptive.type == SCAN_TYPE_SKIPPED && PosLibMeas_repeatScan())
+    {
+        LOG(LVL_DEBUG, "Update triggered at %u, scan skipped", lib_time->getTimestampS());
+        return APP_SCHEDULER_STOP_TASK;
+    }
+
     poslib_scan_ctrl_t scan_ctrl = {
         .mode = SCAN_MODE_STANDARD,
         .max_duration_us = get_scan_duration()};
+    if (m_adaptive.type == SCAN_TYPE_SHORT)
+    {
+        scan_ctrl.max_duration_us = m_pos_settings.adaptive_scan.short_scan_ms * 1000;
+    }
+    else
+    {
+        m_adaptive.type = SCAN_TYPE_FULL;
+    }
     PosLibMeas_startScan(&scan_ctrl);
 
     LOG(LVL_DEBUG, "Update triggered at %u", lib_time->getTimestampS());
@@ -948,7 +1196,6 @@ static uint32_t trigger_update_task()
 static uint32_t timeout_task()
 {
     static poslib_internal_event_t timeout_event = {
-        .list = {NULL},
         .type = POSLIB_CTRL_EVENT_TIMEOUT,
     };
 
@@ -1198,6 +1445,7 @@ static void handle_idle_state(poslib_internal_event_t * event)
             if (!m_pos_settings.motion.enabled)
             {
                 m_motion_mode = MOTION_DEFAULT;
+                PosLibFilter_setMotion(m_motion_mode);
             }
             /* Configuration changed, re-schedule*/
             schedule_next(false);
@@ -1294,6 +1542,9 @@ static void handle_update_state(poslib_internal_event_t * event)
         {
             m_ctrl.events.scan_end = true;
             clear_timeout();
+            m_update_stats.scan_ms = MS_TIME_FROM(m_ctrl.update_start_hp);
+            m_update_stats.scan_total_ms += m_update_stats.scan_ms;
+            adaptive_scan_end(m_update_stats.scan_ms);
             update_outside_wm();
             LOG(LVL_INFO,"<state> Scan end. time: %u bcn: %u", 
                     MS_TIME_FROM(m_ctrl.update_start_hp), PosLibMeas_getBeaconNum());
@@ -1375,6 +1626,11 @@ static void handle_update_state(poslib_internal_event_t * event)
 
     if (is_update_completed())
     {
+        m_update_stats.updates++;
+        m_update_stats.update_ms = MS_TIME_FROM(m_ctrl.update_start_hp);
+        LOG(LVL_INFO, "<state> Update %u: scan: %u ms update: %u ms bytes: %u",
+            m_update_stats.updates, m_update_stats.scan_ms,
+            m_update_stats.update_ms, m_update_stats.payload_bytes);
         m_ctrl.scheduled = false;   
         m_ctrl.last_update_s = m_ctrl.next_update_s;
         PosLibEvent_add(POSLIB_CTRL_EVENT_UPDATE_END);
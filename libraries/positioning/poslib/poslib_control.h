@@ -66,6 +66,20 @@ poslib_ret_e PosLibCtrl_motion(poslib_motion_mode_e mode);
  */
 poslib_status_e PosLibCtrl_status(void);
 
+/**
+ * @brief   Gets the scan statistics of the adaptive scan
+ * @param   stats pointer where statistics will be copied
+ * @return  See \ref poslib_ret_e
+ */
+poslib_ret_e PosLibCtrl_getScanStats(poslib_scan_stats_t * stats);
+
+/**
+ * @brief   Gets the update statistics
+ * @param   stats pointer where statistics will be copied
+ * @return  See \ref poslib_ret_e
+ */
+poslib_ret_e PosLibCtrl_getUpdateStats(poslib_update_stats_t * stats);
+
 /**
  * @brief   Process the internal event
  * @param   event type of \ref poslib_internal_event_t
@@ -17,6 +17,7 @@
 #include "shared_data.h"
 #include "poslib_measurement.h"
 #include "poslib_control.h"
+#include "shared_neighbors.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -39,6 +40,10 @@ static uint16_t m_sequence = 0;  // the sequence of the rising packets
 #define MAX_NBORS 20 
 #define NBOR_LAST_SEEN_WINDOW 2
 #define NO_ROUTE_FOUND_ADDRESS 0
+/** RSSI penalty per consecutive failed delivery through a router [dB] */
+#define ROUTER_FAILURE_PENALTY_DB 6
+/** Routers failing this many deliveries in a row are tried last */
+#define ROUTER_MAX_FAILURES 3
 
 app_lib_state_nbor_info_t m_nbors[MAX_NBORS];
 app_lib_state_nbor_list_t m_nbors_list =
@@ -47,6 +52,43 @@ app_lib_state_nbor_list_t m_nbors_list =
     .nbors = m_nbors,
 };
 
+/** Router candidate of a DA tag */
+typedef struct
+{
+    app_addr_t address;
+    uint32_t seen_s;  // time of the last update of neighbour information [s]
+    int8_t norm_rssi;
+    uint8_t cost;
+    uint8_t diradv_support;
+    uint8_t failures;  // consecutive failed deliveries
+} da_router_t;
+
+/** Router candidates, best first. Kept ranked between sendings */
+static struct
+{
+    da_router_t list[MAX_NBORS];
+    uint8_t num;
+} m_routers;
+
+/** Neighbours information changed since routers were ranked */
+static bool m_nbors_changed = true;
+static uint16_t m_scan_end_cb_id;
+static bool m_scan_end_cb_reg = false;
+
+/** DA sendings tracked at the same time */
+#ifndef POSLIB_DA_MAX_TRACKED_PACKETS
+#define POSLIB_DA_MAX_TRACKED_PACKETS 4
+#endif
+
+/** Tracked DA sending: data sent callback and tracking id of the caller,
+ *  called after ranking feedback. The slot index is the tracking id given
+ *  to the stack */
+static struct
+{
+    app_lib_data_data_sent_cb_f cb;
+    app_lib_data_tracking_id_t id;
+} m_tracked[POSLIB_DA_MAX_TRACKED_PACKETS];
+
 
 /**
  * @brief   Callback for router positioning data reception
@@ -210,32 +252,36 @@ static void stop_router()
 
 
 /**
- * \brief       Compares two neigbours based on DA router status, latest update, RSSI
- * \param       pa, pb pointer to the a & b data structures
- *              Exclude this address from selectable routers. 0 if not used.
- * \return      -1 if a is selected, 1 is b is selected, 0 if equal
+ * \brief       Compares two router candidates based on DA router status,
+ *              latest update, RSSI and failed deliveries
+ * \param       a, b pointer to the a & b candidates
+ * \return      < 0 if a is selected, > 0 if b is selected, 0 if equal
  */
-
-
-static int compare_neighbours(const void * pa, const void *pb)
+static int compare_routers(const da_router_t * a, const da_router_t * b)
 {
-    app_lib_state_nbor_info_t * a = (app_lib_state_nbor_info_t* ) pa;
-    app_lib_state_nbor_info_t * b = (app_lib_state_nbor_info_t* ) pb;
     int32_t dt;
 
     // compare using last update/RSSI if A and B are both valid or both unknown
     if ((IS_DA_ROUTER(a->diradv_support) && IS_DA_ROUTER(b->diradv_support)) ||
         (IS_UNKNOWN_DA_ROUTER(a->diradv_support) && IS_UNKNOWN_DA_ROUTER(b->diradv_support)))
     {
-        dt = a->last_update - b->last_update; 
+        bool a_unreliable = a->failures >= ROUTER_MAX_FAILURES;
+        bool b_unreliable = b->failures >= ROUTER_MAX_FAILURES;
+        if (a_unreliable != b_unreliable)
+        {
+            return a_unreliable ? 1 : -1;
+        }
+
+        dt = (int32_t)(b->seen_s - a->seen_s);
         if (abs(dt) > NBOR_LAST_SEEN_WINDOW)
         {
             // select latest updated
             return dt;
         }
-        // Select strongest RSSI
-        return (b->norm_rssi - a->norm_rssi); 
-    } 
+        // Select strongest RSSI, unreliable routers are down-ranked
+        return (b->norm_rssi - b->failures * ROUTER_FAILURE_PENALTY_DB) -
+               (a->norm_rssi - a->failures * ROUTER_FAILURE_PENALTY_DB);
+    }
     else if (IS_DA_ROUTER(a->diradv_support) ||
             (IS_UNKNOWN_DA_ROUTER(a->diradv_support) && IS_NOT_DA_ROUTER(b->diradv_support)))
     {
@@ -249,26 +295,194 @@ static int compare_neighbours(const void * pa, const void *pb)
         return 1;
     }
     // A & B invalid -> equal
-    return 0;    
+    return 0;
+}
+
+/**
+ * \brief   Finds a router candidate
+ * \param   address
+ *          Router address
+ * \return  Rank of the router or m_routers.num if not found
+ */
+static uint8_t find_router(app_addr_t address)
+{
+    uint8_t rank;
+
+    for (rank = 0; rank < m_routers.num; rank++)
+    {
+        if (m_routers.list[rank].address == address)
+        {
+            break;
+        }
+    }
+    return rank;
+}
+
+/**
+ * \brief   Moves a router candidate to its place in the ranking. Other
+ *          candidates are already ranked.
+ * \param   rank
+ *          Current rank of the candidate
+ */
+static void rank_router(uint8_t rank)
+{
+    da_router_t router = m_routers.list[rank];
+
+    while (rank > 0 && compare_routers(&router, &m_routers.list[rank - 1]) < 0)
+    {
+        m_routers.list[rank] = m_routers.list[rank - 1];
+        rank--;
+    }
+    while (rank + 1 < m_routers.num &&
+           compare_routers(&m_routers.list[rank + 1], &router) < 0)
+    {
+        m_routers.list[rank] = m_routers.list[rank + 1];
+        rank++;
+    }
+    m_routers.list[rank] = router;
+}
+
+static void remove_router(uint8_t rank)
+{
+    m_routers.num--;
+    memmove(&m_routers.list[rank], &m_routers.list[rank + 1],
+            (m_routers.num - rank) * sizeof(da_router_t));
 }
 
 /**
- * \brief  Updates neiggbours list stored in m_nbors_list
- *         sorted based on criteria implemented in 
- * \return  number of neigbours valid for DA communication
+ * \brief   Updates the router ranking from the neighbours list. Only the
+ *          candidates whose information changed are moved.
  */
 static void update_neigbours()
 {
+    uint32_t now_s = lib_time->getTimestampS();
+    uint8_t rank;
+
     m_nbors_list.number_nbors = MAX_NBORS;
     lib_state->getNbors(&m_nbors_list);
 
-    qsort(m_nbors_list.nbors, m_nbors_list.number_nbors, 
-            sizeof(m_nbors_list.nbors[0]), compare_neighbours);
+    // drop candidates that are not neighbours anymore
+    rank = 0;
+    while (rank < m_routers.num)
+    {
+        uint8_t i;
+        for (i = 0; i < m_nbors_list.number_nbors; i++)
+        {
+            if (m_nbors[i].address == m_routers.list[rank].address)
+            {
+                break;
+            }
+        }
+        if (i == m_nbors_list.number_nbors)
+        {
+            remove_router(rank);
+        }
+        else
+        {
+            rank++;
+        }
+    }
 
     for (uint8_t i = 0; i < m_nbors_list.number_nbors; i++)
     {
-        LOG(LVL_DEBUG,"neigh address: %u da: %u type: %u rssi: %i cost: %u last: %u", m_nbors[i].address, 
-                m_nbors[i].diradv_support, m_nbors[i].type, m_nbors[i].norm_rssi,  m_nbors[i].cost,  m_nbors[i].last_update); 
+        app_lib_state_nbor_info_t * nbor = &m_nbors[i];
+        uint32_t seen_s = now_s - nbor->last_update;
+        da_router_t * router;
+
+        rank = find_router(nbor->address);
+        if (rank == m_routers.num)
+        {
+            // new candidate, ranked last first
+            router = &m_routers.list[m_routers.num++];
+            router->address = nbor->address;
+            router->failures = 0;
+        }
+        else
+        {
+            router = &m_routers.list[rank];
+            // last update is relative to now, allow for rounding
+            if (router->diradv_support == nbor->diradv_support &&
+                router->norm_rssi == nbor->norm_rssi &&
+                router->cost == nbor->cost &&
+                (uint32_t)(seen_s - router->seen_s + 1) <= 2)
+            {
+                continue;
+            }
+        }
+        router->seen_s = seen_s;
+        router->norm_rssi = nbor->norm_rssi;
+        router->cost = nbor->cost;
+        router->diradv_support = nbor->diradv_support;
+        rank_router(rank);
+    }
+    m_nbors_changed = false;
+
+    for (rank = 0; rank < m_routers.num; rank++)
+    {
+        LOG(LVL_DEBUG,"router address: %u da: %u rssi: %i cost: %u seen: %u fail: %u",
+                m_routers.list[rank].address, m_routers.list[rank].diradv_support,
+                m_routers.list[rank].norm_rssi, m_routers.list[rank].cost,
+                m_routers.list[rank].seen_s, m_routers.list[rank].failures);
+    }
+}
+
+/**
+ * \brief   Gets a router candidate by rank
+ * \param   rank
+ *          0 for the best router, 1 for the second best...
+ * \return  Router or NULL if there are less candidates
+ */
+static inline da_router_t * get_router(uint8_t rank)
+{
+    return (rank < m_routers.num) ? &m_routers.list[rank] : NULL;
+}
+
+/**
+ * \brief   Neighbour scan completed: neighbours information has changed
+ */
+static void tag_scan_end_cb(const app_lib_state_neighbor_scan_info_t * scan_info)
+{
+    (void) scan_info;
+    m_nbors_changed = true;
+}
+
+/**
+ * \brief   Feeds delivery result back to the router ranking, then gives it
+ *          to the caller of the sending
+ */
+static void tag_data_sent_cb(const app_lib_data_sent_status_t * status)
+{
+    uint8_t rank = find_router(status->dest_address);
+    app_lib_data_data_sent_cb_f cb = NULL;
+    app_lib_data_sent_status_t caller_status = *status;
+
+    if (rank < m_routers.num)
+    {
+        da_router_t * router = &m_routers.list[rank];
+        if (status->success)
+        {
+            router->failures = 0;
+        }
+        else if (router->failures < ROUTER_MAX_FAILURES)
+        {
+            router->failures++;
+        }
+        rank_router(rank);
+        LOG(LVL_DEBUG, "DA router: %u success: %u failures: %u",
+            status->dest_address, status->success, router->failures);
+    }
+
+    if (status->tracking_id < POSLIB_DA_MAX_TRACKED_PACKETS)
+    {
+        // free the slot before calling, callback may send again
+        cb = m_tracked[status->tracking_id].cb;
+        caller_status.tracking_id = m_tracked[status->tracking_id].id;
+        m_tracked[status->tracking_id].cb = NULL;
+    }
+
+    if (cb != NULL)
+    {
+        cb(&caller_status);
     }
 }
 
@@ -312,6 +526,22 @@ static bool start_tag(poslib_da_settings_t * da_settings)
     lib_advertiser->setOptions(&option);
     LOG(LVL_DEBUG, "DA tag - follow network: %u", option.follow_network);
 
+    m_routers.num = 0;
+    m_nbors_changed = true;
+    if (!m_scan_end_cb_reg)
+    {
+        res = Shared_Neighbors_addScanNborsCb(tag_scan_end_cb, &m_scan_end_cb_id);
+        if (res == APP_RES_OK)
+        {
+            m_scan_end_cb_reg = true;
+        }
+        else
+        {
+            // ranking is then updated before each sending
+            LOG(LVL_WARNING, "Cannot register DA scan end cb. res %u", res);
+        }
+    }
+
     init_tag_ack_item();
     res = Shared_Data_addDataReceivedCb(&m_tag_ack_item);
 
@@ -335,9 +565,14 @@ static void stop_tag()
     {
        Shared_Data_removeDataReceivedCb(&m_tag_ack_item); 
     }
+    if (m_scan_end_cb_reg)
+    {
+        Shared_Neighbors_removeScanNborsCb(m_scan_end_cb_id);
+        m_scan_end_cb_reg = false;
+    }
 }
 
-void PosLibDa_Stop()
+void PosLibDa_stop()
 {
     stop_router();
     stop_tag();
@@ -379,6 +614,7 @@ app_lib_data_send_res_e PosLibDa_sendData(app_lib_data_to_send_t * data,
 {
     app_lib_settings_role_t role;
     app_lib_data_send_res_e res = APP_LIB_DATA_SEND_RES_INVALID_DEST_ADDRESS; 
+    uint8_t slot = 0;
     lib_settings->getNodeRole(&role);
 
     /** If: role is not DA or destination_address is a unicast send directly */
@@ -388,24 +624,57 @@ app_lib_data_send_res_e PosLibDa_sendData(app_lib_data_to_send_t * data,
         return Shared_Data_sendData(data, sent_cb);
     }
 
-    /* DA data sending - loop on updated neigbours until a DA cluster is found */
-    update_neigbours();
+    /* DA data sending - loop on ranked routers until a DA cluster is found */
+    if (m_nbors_changed || !m_scan_end_cb_reg || m_routers.num == 0)
+    {
+        update_neigbours();
+    }
 
-    for (uint8_t i = 0; i < m_nbors_list.number_nbors; i++)
+    // delivery result of tracked sendings is fed back to the ranking
+    if (sent_cb != NULL)
+    {
+        for (slot = 0; slot < POSLIB_DA_MAX_TRACKED_PACKETS; slot++)
+        {
+            if (m_tracked[slot].cb == NULL)
+            {
+                break;
+            }
+        }
+        if (slot == POSLIB_DA_MAX_TRACKED_PACKETS)
+        {
+            LOG(LVL_ERROR, "No DA tracking slot left");
+            return APP_LIB_DATA_SEND_RES_OUT_OF_TRACKING_IDS;
+        }
+        m_tracked[slot].cb = sent_cb;
+        m_tracked[slot].id = data->tracking_id;
+        data->tracking_id = slot;
+    }
+
+    for (uint8_t rank = 0; rank < m_routers.num; rank++)
+    {
+        da_router_t * router = get_router(rank);
+
+        if (ROUTER_COST_INVALID(router->cost))
+        {
+            continue;
+        }
+        data->dest_address = router->address;
+        res = Shared_Data_sendData(data,
+                                   (sent_cb != NULL) ? tag_data_sent_cb : NULL);
+        if (res != APP_LIB_DATA_SEND_RES_INVALID_DEST_ADDRESS)
+        {
+            LOG(LVL_INFO, "DA data send. router: %u rank: %u res: %u",
+                router->address, rank, res);
+            break;
+        }
+        LOG(LVL_WARNING, "Fail DA data send. router: %u, res: %u", router->address, res);
+        // not reachable anymore, rank again with fresh information
+        m_nbors_changed = true;
+    }
+
+    if (res != APP_LIB_DATA_SEND_RES_SUCCESS && sent_cb != NULL)
     {
-       
-       if (ROUTER_COST_INVALID(m_nbors[i].cost))
-       {
-           continue;
-       }
-       data->dest_address = m_nbors[i].address;
-       res =  Shared_Data_sendData(data, sent_cb);
-       if (res != APP_LIB_DATA_SEND_RES_INVALID_DEST_ADDRESS)
-       {
-           LOG(LVL_INFO, "DA data send. router: %u", m_nbors[i].address, res);
-           break;
-       }
-        LOG(LVL_WARNING, "Fail DA data send. router: %u, res: %u", m_nbors[i].address, res);
+        m_tracked[slot].cb = NULL;
     }
     return res;
 }
\ No newline at end of file
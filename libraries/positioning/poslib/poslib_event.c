@@ -15,7 +15,6 @@
 #include "poslib.h"
 #include "poslib_control.h"
 #include "poslib_event.h"
-#include "sl_list.h"
 #include "app_scheduler.h"
 #include "poslib_ble_beacon.h"
 
@@ -28,10 +27,20 @@ poslib_events_listen_info_f cb;
 /** Module private function definitions */
 void generate_public_events(poslib_internal_event_t * i_event);
 
-/** Variables: internal control events */
-bool m_internal_init = false;
-static sl_list_head_t m_events_head;
-static poslib_internal_event_t m_internal_events[MAX_INTERNAL_EVENTS];
+/** Variables: internal control events
+ *  Ring of event types: m_events_head is only written when adding events and
+ *  m_events_tail only by the event task, so the task takes events without
+ *  critical section. Indexes are free running, masked on access. */
+#define EVENTS_MASK (MAX_INTERNAL_EVENTS - 1)
+
+#if (MAX_INTERNAL_EVENTS & EVENTS_MASK) != 0 || MAX_INTERNAL_EVENTS > 128
+#error "MAX_INTERNAL_EVENTS shall be a power of two, at most 128"
+#endif
+
+static volatile poslib_internal_event_type_e m_events[MAX_INTERNAL_EVENTS];
+static volatile uint8_t m_events_head = 0;
+static volatile uint8_t m_events_tail = 0;
+static poslib_event_stats_t m_events_stats;
 
 /** Variables: PosLib public events */
 bool m_public_init = false;
@@ -40,68 +49,91 @@ POSLIB_FLAG_EVENT_public_sub_t m_public_event_db[POSLIB_FLAG_EVENT_SUBSCRIBERS_M
 
 static uint32_t handle_events()
 {
-    poslib_internal_event_t * event;
+    poslib_internal_event_t event;
+    uint8_t processed = 0;
+    app_lib_time_timestamp_hp_t start_hp = lib_time->getTimestampHp();
 
-    if (sl_list_size(&m_events_head) == 0)
+    while (m_events_tail != m_events_head &&
+           processed < INTERNAL_EVENTS_BATCH)
     {
-        return APP_SCHEDULER_STOP_TASK; 
+        event.type = m_events[m_events_tail & EVENTS_MASK];
+        // Free the slot before processing: an event added meanwhile is
+        // queued instead of being merged into this one
+        m_events_tail++;
+        processed++;
+
+        LOG(LVL_DEBUG, "Event %u (left %u)", event.type,
+            (uint8_t)(m_events_head - m_events_tail));
+
+        // Event processing call for all modules
+        PosLibCtrl_processEvent(&event);
+        PosLibBle_processEvent(&event);
+        generate_public_events(&event);
     }
 
-    lib_system->enterCriticalSection();
-    event = (poslib_internal_event_t *) sl_list_pop_front(&m_events_head);
-    lib_system->exitCriticalSection();
-
-    LOG(LVL_DEBUG, "Event %u (left %u)", event->type, sl_list_size(&m_events_head));
+    m_events_stats.processing_us +=
+                lib_time->getTimeDiffUs(lib_time->getTimestampHp(), start_hp);
 
-    // Event processing call for all modules
-    PosLibCtrl_processEvent(event);
-    PosLibBle_processEvent(event);
-    generate_public_events(event);
-
-    // Free event slot
-    event->type = POSLIB_CTRL_EVENT_NONE;
-
-    return (sl_list_size(&m_events_head) == 0) ? APP_SCHEDULER_STOP_TASK : 
-                                                APP_SCHEDULER_SCHEDULE_ASAP;
+    return (m_events_tail == m_events_head) ? APP_SCHEDULER_STOP_TASK :
+                                              APP_SCHEDULER_SCHEDULE_ASAP;
 }
 
 bool PosLibEvent_add(poslib_internal_event_type_e type)
 {
-    poslib_internal_event_t * event = NULL;
-    uint8_t i;
-    
+    bool queued = false;
+    bool merged = false;
+    uint8_t used;
+
+    // Events are added from stack callbacks, tasks and interrupts
     lib_system->enterCriticalSection();
-    if (!m_internal_init)
+    used = m_events_head - m_events_tail;
+    if (used != 0 && m_events[(m_events_head - 1) & EVENTS_MASK] == type)
     {
-        sl_list_init(&m_events_head);
-        memset(m_internal_events, 0, sizeof(m_internal_events));
-        m_internal_init = true;
+        m_events_stats.coalesced++;
+        merged = true;
     }
-
-    for (i = 0; i < MAX_INTERNAL_EVENTS; i++)
+    else if (used < MAX_INTERNAL_EVENTS)
     {
-        if (m_internal_events[i].type == POSLIB_CTRL_EVENT_NONE)
+        m_events[m_events_head & EVENTS_MASK] = type;
+        m_events_head++;
+        used++;
+        if (used > m_events_stats.high_water)
         {
-            event = &m_internal_events[i];
-            event->type = type;
-            sl_list_push_back(&m_events_head, (sl_list_t *) event);
-            break; 
+            m_events_stats.high_water = used;
         }
+        queued = true;
+    }
+    else
+    {
+        m_events_stats.overflows++;
     }
     lib_system->exitCriticalSection();
 
-    if (event == NULL)
+    if (merged)
+    {
+        // task is already scheduled for the queued event
+        LOG(LVL_DEBUG, "Event %u merged", type);
+        return true;
+    }
+
+    if (!queued)
     {
         LOG(LVL_ERROR, "Cannot add event %u", type);
         return false;
     }
 
-    LOG(LVL_DEBUG, "Event %u added slot %u (left %u)", event->type, i, sl_list_size(&m_events_head));
+    LOG(LVL_DEBUG, "Event %u added (queued %u)", type, used);
 
     App_Scheduler_addTask_execTime(handle_events, APP_SCHEDULER_SCHEDULE_ASAP, 500);
     return true;
 }
 
+void PosLibEvent_getStats(poslib_event_stats_t * stats)
+{
+    lib_system->enterCriticalSection();
+    *stats = m_events_stats;
+    lib_system->exitCriticalSection();
+}
 
 poslib_ret_e PosLibEvent_register(poslib_events_e event,
                             poslib_events_listen_info_f cb, 
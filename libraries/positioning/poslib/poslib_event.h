@@ -7,10 +7,15 @@
 #ifndef _POSLIB_EVENT_H_
 #define _POSLIB_EVENT_H_
 
-#include "sl_list.h"
+#include <stdint.h>
+#include <stdbool.h>
 
+/** Size of the internal event ring, shall be a power of two */
 #define MAX_INTERNAL_EVENTS 16
 
+/** Maximum amount of events processed in one run of the event task */
+#define INTERNAL_EVENTS_BATCH 4
+
 typedef enum {
     /**< No event */
     POSLIB_CTRL_EVENT_NONE = 0,
@@ -55,12 +60,36 @@ typedef enum {
 } poslib_internal_event_type_e;
 
 typedef struct {
-    sl_list_t list;
     poslib_internal_event_type_e type;
 } poslib_internal_event_t;
 
+/** Internal events statistics */
+typedef struct {
+    /**< Events merged into the same event queued just before */
+    uint32_t coalesced;
+    /**< Events lost because the ring was full */
+    uint32_t overflows;
+    /**< Highest amount of events queued at the same time */
+    uint8_t high_water;
+    /**< Cumulated time spent processing events [us] */
+    uint32_t processing_us;
+} poslib_event_stats_t;
+
+/**
+ * @brief   Adds an internal event. Can be called from any context.
+ *          An event of the same type as the last queued one is merged into it.
+ * @param   type the event type
+ * @return  true if event is queued or merged, false if the ring is full
+ */
 bool PosLibEvent_add(poslib_internal_event_type_e type);
 
+/**
+ * @brief   Gets the internal events statistics
+ * @param   stats pointer to the statistics to fill
+ * @return  void
+ */
+void PosLibEvent_getStats(poslib_event_stats_t * stats);
+
 /**
  * @brief   Register an PosLib event subscriber for 
  * @param   event Events of interest (type of poslib_events_e)
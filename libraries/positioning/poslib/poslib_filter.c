@@ -0,0 +1,176 @@
+/**
+ * @file       poslib_filter.c
+ * @brief      Fixed-point rss filters used on received beacons.
+ * @copyright  Wirepas Ltd 2021
+ */
+
+#define DEBUG_LOG_MODULE_NAME "POSLIB_FLT"
+#ifdef DEBUG_POSLIB_LOG_MAX_LEVEL
+#define DEBUG_LOG_MAX_LEVEL DEBUG_POSLIB_LOG_MAX_LEVEL
+#else
+#define DEBUG_LOG_MAX_LEVEL LVL_NOLOG
+#endif
+#include "debug_log.h"
+#include <string.h>
+#include "api.h"
+#include "poslib.h"
+#include "poslib_filter.h"
+
+/** Fractional bits of filtered rss values */
+#define RSS_FRAC_BITS 4
+
+/** Fractional bits of EWMA alpha and Kalman gain */
+#define GAIN_FRAC_BITS 8
+
+#define TO_FIXED(_v) ((int16_t)((_v) * (1 << RSS_FRAC_BITS)))
+
+static poslib_rss_filter_settings_t m_settings;
+static poslib_motion_mode_e m_motion = POSLIB_MOTION_STATIC;
+
+/**
+ * @brief   Divides by a power of two, rounding to nearest. Ties go to the
+ *          even value: rounding them away from zero would bias the median
+ *          of two samples, often x.5 dB, by -0.25 dB on negative rss.
+ */
+static inline int32_t round_shift(int32_t value, uint8_t bits)
+{
+    int32_t half = 1 << (bits - 1);
+    int32_t magnitude = (value >= 0) ? value : -value;
+    int32_t rounded = (magnitude + half) >> bits;
+
+    if ((magnitude & ((1 << bits) - 1)) == half)
+    {
+        rounded &= ~1;
+    }
+    return (value >= 0) ? rounded : -rounded;
+}
+
+static inline int8_t to_int8(int16_t rss)
+{
+    return (rss > INT8_MAX) ? INT8_MAX : (rss < INT8_MIN) ? INT8_MIN : rss;
+}
+
+static int16_t filter_mean(poslib_filter_state_t * state, int16_t rss)
+{
+    if (state->samples < POSLIB_FILTER_MEAN_SAMPLES)
+    {
+        state->samples++;
+    }
+    state->value += (TO_FIXED(rss) - state->value) / state->samples;
+    return state->value;
+}
+
+static int16_t filter_ewma(poslib_filter_state_t * state, int16_t rss)
+{
+    uint8_t alpha = (m_motion == POSLIB_MOTION_DYNAMIC) ?
+                        m_settings.ewma_alpha_dynamic :
+                        m_settings.ewma_alpha_static;
+
+    state->value += round_shift((int32_t)alpha * (TO_FIXED(rss) - state->value),
+                                GAIN_FRAC_BITS);
+    return state->value;
+}
+
+static int16_t filter_median(poslib_filter_state_t * state, int16_t rss)
+{
+    int8_t sorted[POSLIB_FILTER_MEDIAN_SAMPLES];
+    uint8_t count;
+
+    state->history[state->samples % POSLIB_FILTER_MEDIAN_SAMPLES] =
+                                                                to_int8(rss);
+    state->samples++;
+    if (state->samples >= 2 * POSLIB_FILTER_MEDIAN_SAMPLES)
+    {
+        // keep the window position, avoid overflow
+        state->samples -= POSLIB_FILTER_MEDIAN_SAMPLES;
+    }
+
+    count = (state->samples < POSLIB_FILTER_MEDIAN_SAMPLES) ?
+                state->samples : POSLIB_FILTER_MEDIAN_SAMPLES;
+
+    // insertion sort, window is small
+    for (uint8_t i = 0; i < count; i++)
+    {
+        int8_t v = state->history[i];
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1] > v)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+
+    if (count & 1)
+    {
+        state->value = TO_FIXED(sorted[count / 2]);
+    }
+    else
+    {
+        state->value = TO_FIXED(sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+    }
+    return state->value;
+}
+
+static int16_t filter_kalman(poslib_filter_state_t * state, int16_t rss)
+{
+    uint8_t q = (m_motion == POSLIB_MOTION_DYNAMIC) ?
+                    m_settings.kalman_q_dynamic :
+                    m_settings.kalman_q_static;
+    uint32_t var = state->var + TO_FIXED(q);
+    uint32_t gain;
+
+    // gain = var / (var + r), in 1/256
+    gain = (var << GAIN_FRAC_BITS) / (var + TO_FIXED(m_settings.kalman_r));
+
+    state->value += round_shift((int32_t)gain * (TO_FIXED(rss) - state->value),
+                                GAIN_FRAC_BITS);
+    var = (var * ((1 << GAIN_FRAC_BITS) - gain)) >> GAIN_FRAC_BITS;
+    state->var = (var > UINT16_MAX) ? UINT16_MAX : var;
+    return state->value;
+}
+
+void PosLibFilter_configure(const poslib_rss_filter_settings_t * settings)
+{
+    memcpy(&m_settings, settings, sizeof(m_settings));
+    LOG(LVL_DEBUG, "RSS filter: %u", m_settings.type);
+}
+
+void PosLibFilter_setMotion(poslib_motion_mode_e mode)
+{
+    m_motion = mode;
+}
+
+void PosLibFilter_init(poslib_filter_state_t * state, int16_t rss)
+{
+    memset(state, 0, sizeof(poslib_filter_state_t));
+    state->value = TO_FIXED(rss);
+    state->samples = 1;
+    // first sample is as uncertain as any measurement
+    state->var = TO_FIXED(m_settings.kalman_r);
+    state->history[0] = to_int8(rss);
+}
+
+int16_t PosLibFilter_update(poslib_filter_state_t * state, int16_t rss)
+{
+    int16_t value;
+
+    switch (m_settings.type)
+    {
+        case POSLIB_RSS_FILTER_EWMA:
+            value = filter_ewma(state, rss);
+            break;
+        case POSLIB_RSS_FILTER_MEDIAN:
+            value = filter_median(state, rss);
+            break;
+        case POSLIB_RSS_FILTER_KALMAN:
+            value = filter_kalman(state, rss);
+            break;
+        case POSLIB_RSS_FILTER_MEAN:
+        default:
+            value = filter_mean(state, rss);
+            break;
+    }
+
+    return round_shift(value, RSS_FRAC_BITS);
+}
@@ -0,0 +1,55 @@
+/**
+* @file       poslib_filter.h
+* @brief      Header file for poslib_filter.c
+* @copyright  Wirepas Ltd 2021
+*/
+
+#ifndef _POSLIB_FILTER_H_
+#define _POSLIB_FILTER_H_
+
+/** Max samples averaged by the running mean filter */
+#define POSLIB_FILTER_MEAN_SAMPLES 8
+
+/** Window of the median filter */
+#define POSLIB_FILTER_MEDIAN_SAMPLES 5
+
+/**
+ * @brief   Filter state of one beacon. RSS values are kept in 1/16 dB
+ *          so that smoothing does not truncate.
+ */
+typedef struct
+{
+    int16_t value;    // filtered rss [1/16 dB]
+    uint16_t var;     // Kalman error variance [1/16 dB^2]
+    uint8_t samples;
+    int8_t history[POSLIB_FILTER_MEDIAN_SAMPLES]; // median window [dB]
+} poslib_filter_state_t;
+
+/**
+ * @brief   Sets the filter configuration used for all beacons
+ * @param   settings filter settings \ref poslib_rss_filter_settings_t
+ */
+void PosLibFilter_configure(const poslib_rss_filter_settings_t * settings);
+
+/**
+ * @brief   Sets the motion state. Filters track faster when dynamic.
+ * @param   mode type of \ref poslib_motion_mode_e
+ */
+void PosLibFilter_setMotion(poslib_motion_mode_e mode);
+
+/**
+ * @brief   Starts filtering a beacon
+ * @param   state filter state of the beacon
+ * @param   rss first rss sample [dB]
+ */
+void PosLibFilter_init(poslib_filter_state_t * state, int16_t rss);
+
+/**
+ * @brief   Adds a sample to the beacon filter
+ * @param   state filter state of the beacon
+ * @param   rss new rss sample [dB]
+ * @return  filtered rss [dB]
+ */
+int16_t PosLibFilter_update(poslib_filter_state_t * state, int16_t rss);
+
+#endif
@@ -21,16 +21,77 @@
 #include "poslib_mbcn.h"
 #include "app_scheduler.h"
 #include "shared_data.h"
+#include "random.h"
+
+/** Maximum back-off level when the node is congested */
+#define MBCN_MAX_BACKOFF 3
+
+/** The node is congested when less data buffers are free: its own packets
+ *  wait in the tx queue. This is local congestion, not a channel sensing. */
+#define MBCN_CONGESTED_FREE_BUFFERS 2
 
 // Local mini-beacon (mbcn) state variables
 static poslib_mbcn_payload_t m_payload;  //stores the mbcn payload
 static app_lib_data_to_send_t m_mbcn;  //stores the mbcn data frame
 static poslib_mbcn_config_t m_settings; // copy of the current mbcn settings
 static bool m_started = false;
+static uint8_t m_backoff = 0; // back-off level, 0 when not congested
+static bool m_random_seeded = false;
+
+static uint32_t random_below(uint32_t max)
+{
+    return (max == 0) ? 0 : Random_get32() % max;
+}
+
+/**
+ * @brief   Time to next mini-beacon: tx interval with random jitter, plus a
+ *          random back-off of up to (interval / 4) << m_backoff after local
+ *          congestion or a refused sending. Anchors started together drift
+ *          apart instead of colliding at every interval.
+ */
+static uint32_t next_interval(void)
+{
+    uint32_t interval = m_settings.tx_interval_ms;
+    uint32_t jitter = interval * m_settings.tx_jitter_pct / 100;
+
+    interval = interval - jitter + random_below(2 * jitter + 1);
+    if (m_backoff > 0)
+    {
+        interval += random_below((m_settings.tx_interval_ms / 4) << m_backoff);
+    }
+    return interval;
+}
+
+/**
+ * @brief   Offset of the first mini-beacon in the tx interval, spread from
+ *          the node address so that neighbour anchors get different phases
+ */
+static uint32_t first_interval(void)
+{
+    app_addr_t node_address = 0;
+
+    lib_settings->getNodeAddress(&node_address);
+    // Fibonacci hashing spreads consecutive addresses over the interval
+    return ((uint64_t)(node_address * 2654435761u) *
+            m_settings.tx_interval_ms) >> 32;
+}
 
 static uint32_t mbcn_task()
 {
     app_lib_data_send_res_e rc;
+    size_t free_buffers = 0;
+
+    lib_data->getNumFreeBuffers(&free_buffers);
+    if (free_buffers < MBCN_CONGESTED_FREE_BUFFERS)
+    {
+        // Own packets are still queued: skip this one
+        if (m_backoff < MBCN_MAX_BACKOFF)
+        {
+            m_backoff++;
+        }
+        LOG(LVL_DEBUG, "Mbcn tx queue congested, backoff: %u", m_backoff);
+        return next_interval();
+    }
 
     m_payload.seq++;
     rc = Shared_Data_sendData(&m_mbcn, NULL);
@@ -38,10 +99,17 @@ static uint32_t mbcn_task()
     if (rc != APP_LIB_DATA_SEND_RES_SUCCESS)
     {
         LOG(LVL_ERROR, "Mbcn send rc: %u, seq: %u", rc, m_payload.seq);
+        if (m_backoff < MBCN_MAX_BACKOFF)
+        {
+            m_backoff++;
+        }
+    }
+    else if (m_backoff > 0)
+    {
+        m_backoff--;
     }
 
-    //FixMe: add randomization of send interval
-    return m_settings.tx_interval_ms;
+    return next_interval();
 }
 
 static uint8_t encode_mbcn(poslib_mbcn_config_t * settings, uint8_t * buf, uint8_t length)
@@ -132,7 +200,16 @@ bool PosLibMbcn_start(poslib_mbcn_config_t * settings)
     //Add the task sending mini-beacons
     if (!m_started)
     {
-        rc = App_Scheduler_addTask_execTime(mbcn_task, settings->tx_interval_ms, 50);
+        if (!m_random_seeded)
+        {
+            // same seed on all anchors would give them the same jitter
+            app_addr_t node_address = 0;
+            lib_settings->getNodeAddress(&node_address);
+            Random_init(node_address ^ lib_time->getTimestampHp());
+            m_random_seeded = true;
+        }
+        m_backoff = 0;
+        rc = App_Scheduler_addTask_execTime(mbcn_task, first_interval(), 50);
         if (rc== APP_SCHEDULER_RES_OK)
         {
             LOG(LVL_ERROR, "Mini-beacon started. Tx: %u length:%u bytes", settings->tx_interval_ms, m_mbcn.num_bytes);
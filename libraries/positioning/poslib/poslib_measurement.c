@@ -17,6 +17,7 @@
 #include "poslib_control.h"
 #include "poslib_event.h"
 #include "poslib_measurement.h"
+#include "poslib_filter.h"
 #include "shared_neighbors.h"
 #include "shared_data.h"
 #include "api.h"
@@ -38,18 +39,46 @@ typedef struct
 {
     app_addr_t address;
     int16_t  norm_rss; // normalized to 0dB TX power
+    int16_t  scan_rss; // last normalized rss received, not filtered
     int8_t   txpower;
     poslib_meas_beacon_type_e  type;
     uint8_t samples;  
     app_lib_time_timestamp_hp_t last_update;
+    poslib_filter_state_t filter;
+    uint8_t heap_pos; // position in the rss min-heap
+    uint8_t older; // previous beacon in update order
+    uint8_t newer; // next beacon in update order
 } poslib_meas_wm_beacon_t;
 
+/** Slots of the address index: power of two, at least twice MAX_BEACONS */
+#define MEAS_INDEX_BITS 5
+#define MEAS_INDEX_SIZE (1 << MEAS_INDEX_BITS)
+#define MEAS_INDEX_MASK (MEAS_INDEX_SIZE - 1)
+
+#if MEAS_INDEX_SIZE < (2 * MAX_BEACONS)
+#error "Measurement index too small for MAX_BEACONS"
+#endif
+
+/** Empty index slot / no beacon */
+#define MEAS_NONE 0xFF
+
+/**
+ * @brief   Measurement table.
+ *
+ *          Beacons are kept packed in [0, num_beacons) so that the payload
+ *          can be built directly from the table. Beacons are found by
+ *          address through an open addressing index, the weakest one is the
+ *          root of a min-heap on rss and the oldest one is the head of a list
+ *          in update order.
+ */
 typedef struct
 {
     poslib_meas_wm_beacon_t beacons[MAX_BEACONS];
     uint8_t num_beacons;
-    uint8_t min_index;
-    int16_t min_rss;
+    uint8_t index[MEAS_INDEX_SIZE]; // beacon index or MEAS_NONE
+    uint8_t heap[MAX_BEACONS]; // beacon indexes, weakest rss first
+    uint8_t oldest;
+    uint8_t newest;
 } poslib_meas_table_t;
 
 /**
@@ -65,6 +94,29 @@ typedef struct
 static uint32_t m_scan_start_time;
 static poslib_meas_table_t m_meas_table;
 
+/** Filter states kept between scans, the table holds them at most */
+#define MEAS_FILTER_CACHE_SIZE MAX_BEACONS
+
+/** A cached filter state older than this is not used [s] */
+#ifndef POSLIB_FILTER_MAX_AGE_S
+#define POSLIB_FILTER_MAX_AGE_S 300
+#endif
+
+/**
+ * @brief   Filter state of a beacon of a previous scan. Each scan restarts
+ *          the table, the filters continue from here.
+ */
+typedef struct
+{
+    app_addr_t address;
+    int16_t norm_rss; // last reported rss
+    bool used;
+    uint32_t cached_s; // time the table was restarted [s]
+    poslib_filter_state_t filter;
+} poslib_meas_filter_cache_t;
+
+static poslib_meas_filter_cache_t m_filter_cache[MEAS_FILTER_CACHE_SIZE];
+
 
 /** Callbacks state variables */
 static uint16_t m_scan_end_cb_id = 0;
@@ -77,8 +129,8 @@ static bool m_opportunistic = false;
 
 static shared_data_item_t m_mbcn_item;
 
-// Maximum sample history in RSSI filter
-#define MAX_FLT_SAMPLES 8
+// Beacon is reported as filtered above this amount of samples
+#define MAX_FLT_SAMPLES 2
 
 /** 0 if beacons are found, otherwise time in sec when no beacons */
 static uint32_t m_time_when_no_beacons_s;
@@ -87,6 +139,17 @@ static poslib_scan_ctrl_t m_scan_ctrl;
 static bool m_scan_pending = false;
 static bool m_init = false;
 
+/** Amount of strongest beacons compared to tell if a scan is stable */
+#define REFERENCE_BEACONS 4
+
+/** Strongest beacons of the reference scan, strongest first */
+static struct
+{
+    app_addr_t address;
+    int16_t norm_rss;
+} m_reference[REFERENCE_BEACONS];
+static uint8_t m_reference_num = 0;
+
 #ifdef CONF_VOLTAGE_REPORT
 /** Voltage sampling variables */
 static uint8_t m_samples = 0;
@@ -110,16 +173,15 @@ static void insert_beacon(const poslib_meas_wm_beacon_t * beacon);
 
 #ifdef POSLIB_CLEANBEACON_USE
 /**
- * @brief   Removes ageing beacons (unfinished - wipes table)
+ * @brief   Removes ageing beacons
  *
  *          This function operates on the beacon table to remove entries
  *          older than a given amount of seconds.
  *
  * @param   older_than   Remove all beacons seen after this amount of seconds.
- * @param]  max_beacons  Perform a lookup on the top n members of the table.
  */
 
-static void void clean_beacon(uint32_t older_than, uint8_t max_beacons);
+static void clean_beacon(uint32_t older_than);
 #endif
 
 /**
@@ -288,15 +350,99 @@ static void register_callbacks(void)
     }
 }
 
-static void init_module(void)
+static bool cache_expired(const poslib_meas_filter_cache_t * entry,
+                          uint32_t now_s)
+{
+    return !entry->used ||
+           (now_s - entry->cached_s) >= POSLIB_FILTER_MAX_AGE_S;
+}
+
+/**
+ * @brief   Keeps the filter state of a beacon, in place of its previous
+ *          state, of an unused one or of the oldest one
+ */
+static void cache_filter(const poslib_meas_wm_beacon_t * bcn, uint32_t now_s)
+{
+    poslib_meas_filter_cache_t * entry = &m_filter_cache[0];
+
+    for (uint8_t i = 0; i < MEAS_FILTER_CACHE_SIZE; i++)
+    {
+        poslib_meas_filter_cache_t * e = &m_filter_cache[i];
+
+        if (e->used && e->address == bcn->address)
+        {
+            entry = e;
+            break;
+        }
+        if (entry->used && (!e->used || e->cached_s < entry->cached_s))
+        {
+            entry = e;
+        }
+    }
+
+    entry->address = bcn->address;
+    entry->norm_rss = bcn->norm_rss;
+    entry->used = true;
+    entry->cached_s = now_s;
+    entry->filter = bcn->filter;
+}
+
+/**
+ * @brief   Gets the filter state of a beacon of a previous scan
+ * @return  true if a recent enough state is copied to the beacon
+ */
+static bool restore_filter(poslib_meas_wm_beacon_t * bcn)
+{
+    for (uint8_t i = 0; i < MEAS_FILTER_CACHE_SIZE; i++)
+    {
+        poslib_meas_filter_cache_t * entry = &m_filter_cache[i];
+
+        if (entry->used && entry->address == bcn->address)
+        {
+            bool expired = cache_expired(entry, lib_time->getTimestampS());
+
+            entry->used = false;
+            if (expired)
+            {
+                return false;
+            }
+            bcn->filter = entry->filter;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief   Keeps the filter states of the table before it is restarted
+ */
+static void cache_filters(void)
+{
+    uint32_t now_s = lib_time->getTimestampS();
+
+    for (uint8_t i = 0; i < m_meas_table.num_beacons; i++)
+    {
+        cache_filter(&m_meas_table.beacons[i], now_s);
+    }
+}
+
+static void reset_table(void)
 {
     memset(&m_meas_table, 0, sizeof(m_meas_table));
+    memset(&m_meas_table.index, MEAS_NONE, sizeof(m_meas_table.index));
+    m_meas_table.oldest = MEAS_NONE;
+    m_meas_table.newest = MEAS_NONE;
+}
+
+static void init_module(void)
+{
+    reset_table();
 }
 
 static void clear_measurement_table()
 {
-    m_meas_table.num_beacons = 0;
-    memset(&m_meas_table.beacons, 0, sizeof(m_meas_table.beacons));
+    cache_filters();
+    reset_table();
 }
 
 /**
@@ -379,141 +525,305 @@ void PosLibMeas_stop(void)
     m_scan_pending = false;
 }
 
-#ifdef POSLIB_CLEANBEACON_USE
-static void clean_beacon(uint32_t older_than, uint8_t max_beacons)
+/**
+ * @brief   Address index hash (Fibonacci hashing)
+ */
+static inline uint8_t index_hash(app_addr_t address)
 {
-    uint8_t i = 0;
-    uint8_t head = 0;
+    return (uint8_t)((address * 2654435761u) >> (32 - MEAS_INDEX_BITS));
+}
 
-    app_lib_time_timestamp_hp_t now = lib_time->getTimestampHp();
+/**
+ * @brief   Finds the index slot of an address, or the empty slot where it
+ *          would be inserted
+ */
+static uint8_t index_find(app_addr_t address)
+{
+    uint8_t slot = index_hash(address);
 
-    for (i = 0; i < max_beacons && i < MAX_BEACONS
-            && m_meas_table.num_beacons > 0; i++)
+    while (m_meas_table.index[slot] != MEAS_NONE &&
+           m_meas_table.beacons[m_meas_table.index[slot]].address != address)
     {
-        if (m_meas_table.beacons[i].address != 0)
-        {
-            if ((lib_time->getTimeDiffUs(now,
-                m_meas_table.beacons[i].last_update) / 1e6) >= older_than)
+        slot = (slot + 1) & MEAS_INDEX_MASK;
+    }
+    return slot;
+}
 
-            {
-                m_meas_table.num_beacons--;
-            }
-            else
-            {
-                //moves beacon up the table
-                if(i != head)
-                {
-                    memcpy(&m_meas_table.beacons[head],
-                           &m_meas_table.beacons[i],
-                           sizeof(poslib_meas_wm_beacon_t));
-                    head++;
-                      LOG(LVL_DEBUG, " head :%d, tail :%d",head, i);
-                }
-            }
+/**
+ * @brief   Empties an index slot. Following entries are shifted back so
+ *          that lookups do not need deletion markers
+ */
+static void index_remove(uint8_t slot)
+{
+    uint8_t hole = slot;
+    uint8_t next = (slot + 1) & MEAS_INDEX_MASK;
+
+    while (m_meas_table.index[next] != MEAS_NONE)
+    {
+        uint8_t home = index_hash(
+                    m_meas_table.beacons[m_meas_table.index[next]].address);
+
+        // entry can fill the hole if the hole is between its home and itself
+        if (((next - home) & MEAS_INDEX_MASK) >=
+            ((next - hole) & MEAS_INDEX_MASK))
+        {
+            m_meas_table.index[hole] = m_meas_table.index[next];
+            hole = next;
         }
+        next = (next + 1) & MEAS_INDEX_MASK;
     }
+    m_meas_table.index[hole] = MEAS_NONE;
+}
 
-    LOG(LVL_DEBUG, " now :%d, num_beacons :%d",
-        now, m_meas_table.num_beacons);
+static inline int16_t heap_rss(uint8_t pos)
+{
+    return m_meas_table.beacons[m_meas_table.heap[pos]].norm_rss;
+}
+
+static void heap_swap(uint8_t a, uint8_t b)
+{
+    uint8_t tmp = m_meas_table.heap[a];
+
+    m_meas_table.heap[a] = m_meas_table.heap[b];
+    m_meas_table.heap[b] = tmp;
+    m_meas_table.beacons[m_meas_table.heap[a]].heap_pos = a;
+    m_meas_table.beacons[m_meas_table.heap[b]].heap_pos = b;
 }
-#endif
 
 /**
- * @brief   Searchs through the measurement table for the entry with
- *          the smallest rssi
+ * @brief   Restores the heap order after the rss at a position changed
  */
-static void update_min(void)
+static void heap_fix(uint8_t pos)
 {
-    uint8_t i = 0;
-    m_meas_table.min_rss = 0; // forces a minimum refresh
+    uint8_t size = m_meas_table.num_beacons;
 
-    // update minimum
-    for (i = 0; i < m_meas_table.num_beacons; i++)
+    while (pos > 0 && heap_rss(pos) < heap_rss((pos - 1) / 2))
     {
-        // updates minimum location
-        if (m_meas_table.beacons[i].norm_rss < m_meas_table.min_rss)
+        heap_swap(pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+
+    while (true)
+    {
+        uint8_t min = pos;
+        uint8_t left = 2 * pos + 1;
+        uint8_t right = left + 1;
+
+        if (left < size && heap_rss(left) < heap_rss(min))
         {
-            m_meas_table.min_index = i;
-            m_meas_table.min_rss = m_meas_table.beacons[i].norm_rss;
+            min = left;
+        }
+        if (right < size && heap_rss(right) < heap_rss(min))
+        {
+            min = right;
+        }
+        if (min == pos)
+        {
+            break;
         }
+        heap_swap(pos, min);
+        pos = min;
     }
 }
 
-static void insert_beacon(const poslib_meas_wm_beacon_t * beacon)
+static void age_unlink(uint8_t idx)
 {
-    uint8_t i = 0;
-    uint8_t insert_idx = MAX_BEACONS;
-    bool match = false;
-    poslib_meas_wm_beacon_t * bcn = NULL;
+    poslib_meas_wm_beacon_t * bcn = &m_meas_table.beacons[idx];
+
+    if (bcn->older != MEAS_NONE)
+    {
+        m_meas_table.beacons[bcn->older].newer = bcn->newer;
+    }
+    else
+    {
+        m_meas_table.oldest = bcn->newer;
+    }
+
+    if (bcn->newer != MEAS_NONE)
+    {
+        m_meas_table.beacons[bcn->newer].older = bcn->older;
+    }
+    else
+    {
+        m_meas_table.newest = bcn->older;
+    }
+}
+
+static void age_append(uint8_t idx)
+{
+    poslib_meas_wm_beacon_t * bcn = &m_meas_table.beacons[idx];
+
+    bcn->older = m_meas_table.newest;
+    bcn->newer = MEAS_NONE;
+    if (m_meas_table.newest != MEAS_NONE)
+    {
+        m_meas_table.beacons[m_meas_table.newest].newer = idx;
+    }
+    else
+    {
+        m_meas_table.oldest = idx;
+    }
+    m_meas_table.newest = idx;
+}
+
+#ifdef POSLIB_CLEANBEACON_USE
+/**
+ * @brief   Moves a beacon to another table entry, updating all references
+ */
+static void move_beacon(uint8_t from, uint8_t to)
+{
+    poslib_meas_wm_beacon_t * bcn = &m_meas_table.beacons[to];
+
+    // index lookup compares addresses, do it while source is still valid
+    m_meas_table.index[index_find(m_meas_table.beacons[from].address)] = to;
+    memcpy(bcn, &m_meas_table.beacons[from], sizeof(poslib_meas_wm_beacon_t));
+    m_meas_table.heap[bcn->heap_pos] = to;
+
+    if (bcn->older != MEAS_NONE)
+    {
+        m_meas_table.beacons[bcn->older].newer = to;
+    }
+    else
+    {
+        m_meas_table.oldest = to;
+    }
 
-    // searches for itself
-    for (i = 0; i < m_meas_table.num_beacons; i++)
+    if (bcn->newer != MEAS_NONE)
     {
-        // if there is an entry present, use that index
-        if (m_meas_table.beacons[i].address == beacon->address)
+        m_meas_table.beacons[bcn->newer].older = to;
+    }
+    else
+    {
+        m_meas_table.newest = to;
+    }
+}
+
+static void remove_beacon(uint8_t idx)
+{
+    uint8_t last = m_meas_table.num_beacons - 1;
+    uint8_t pos = m_meas_table.beacons[idx].heap_pos;
+
+    index_remove(index_find(m_meas_table.beacons[idx].address));
+    age_unlink(idx);
+
+    // last heap element takes the place of the removed one
+    m_meas_table.heap[pos] = m_meas_table.heap[last];
+    m_meas_table.beacons[m_meas_table.heap[pos]].heap_pos = pos;
+    m_meas_table.num_beacons--;
+    if (pos < m_meas_table.num_beacons)
+    {
+        heap_fix(pos);
+    }
+
+    // keep the table packed
+    if (idx != last)
+    {
+        move_beacon(last, idx);
+    }
+}
+
+static void clean_beacon(uint32_t older_than)
+{
+    app_lib_time_timestamp_hp_t now = lib_time->getTimestampHp();
+
+    // oldest beacons first, stop at the first recent enough
+    while (m_meas_table.oldest != MEAS_NONE)
+    {
+        uint8_t idx = m_meas_table.oldest;
+
+        if ((lib_time->getTimeDiffUs(now,
+                m_meas_table.beacons[idx].last_update) / 1000000) < older_than)
         {
-            insert_idx = i;
-            match = true;
             break;
         }
+        remove_beacon(idx);
     }
 
+    LOG(LVL_DEBUG, " now :%d, num_beacons :%d",
+        now, m_meas_table.num_beacons);
+}
+#endif
+
+static void insert_beacon(const poslib_meas_wm_beacon_t * beacon)
+{
+    uint8_t slot = index_find(beacon->address);
+    uint8_t insert_idx = m_meas_table.index[slot];
+    poslib_meas_wm_beacon_t * bcn = NULL;
+
     // if there is no entry in the table for the given address, then simply
-    // append the beacon, otherwise replace the entry with the lowest minimum
-    if (!match)
+    // append the beacon, otherwise replace the entry with the lowest rss
+    if (insert_idx == MEAS_NONE)
     {
         if(m_meas_table.num_beacons == MAX_BEACONS) // no space
         {
-            update_min();
-
-            if(beacon->norm_rss > m_meas_table.min_rss)
+            insert_idx = m_meas_table.heap[0];
+            if(beacon->norm_rss <= m_meas_table.beacons[insert_idx].norm_rss)
             {
-                insert_idx = m_meas_table.min_index;
+                return;
             }
+
+            // weakest beacon is replaced, its samples are not relevant
+            index_remove(index_find(m_meas_table.beacons[insert_idx].address));
+            slot = index_find(beacon->address);
+            m_meas_table.beacons[insert_idx].samples = 0;
         }
         else
         {
             insert_idx = m_meas_table.num_beacons;
+            m_meas_table.heap[insert_idx] = insert_idx;
+            m_meas_table.beacons[insert_idx].heap_pos = insert_idx;
+            m_meas_table.beacons[insert_idx].samples = 0;
             m_meas_table.num_beacons++; 
+            age_append(insert_idx);
         }
+        m_meas_table.index[slot] = insert_idx;
     }
 
     // update the table
-    if (insert_idx < MAX_BEACONS)
+    bcn = &m_meas_table.beacons[insert_idx];
+    if (bcn->samples < MAX_FLT_SAMPLES)
     {
-        bcn = &m_meas_table.beacons[insert_idx];
-        if (bcn->samples < MAX_FLT_SAMPLES)
-        {
-           bcn->samples++; 
-        }
-        bcn->address = beacon->address;
-        bcn->txpower = beacon->txpower;
-        bcn->last_update = lib_time->getTimestampHp();
-        
-        if (bcn->samples > 1)
-        {
-            bcn->type = POSLIB_MEAS_BEACON_TYPE_FLT;
-            bcn->norm_rss += (beacon->norm_rss - bcn->norm_rss) / bcn->samples;
-        }
-        else
-        {
-            bcn->type = beacon->type;
-            bcn->norm_rss = beacon->norm_rss;
-        }
+       bcn->samples++; 
+    }
+    bcn->address = beacon->address;
+    bcn->txpower = beacon->txpower;
+    bcn->scan_rss = beacon->norm_rss;
+    bcn->last_update = lib_time->getTimestampHp();
+    
+    if (bcn->samples > 1)
+    {
+        bcn->type = POSLIB_MEAS_BEACON_TYPE_FLT;
+        bcn->norm_rss = PosLibFilter_update(&bcn->filter, beacon->norm_rss);
+    }
+    else if (restore_filter(bcn))
+    {
+        // first sample of this scan continues the filter of previous scans
+        bcn->samples = MAX_FLT_SAMPLES;
+        bcn->type = POSLIB_MEAS_BEACON_TYPE_FLT;
+        bcn->norm_rss = PosLibFilter_update(&bcn->filter, beacon->norm_rss);
+    }
+    else
+    {
+        bcn->type = beacon->type;
+        bcn->norm_rss = beacon->norm_rss;
+        PosLibFilter_init(&bcn->filter, beacon->norm_rss);
+    }
 
-        LOG(LVL_DEBUG, "idx:%d,address:%d,rss:%d,txpower:%d,type:%d",
-            insert_idx,
-            beacon->address,
-            beacon->norm_rss,
-            beacon->txpower,
-            beacon->type);
+    heap_fix(bcn->heap_pos);
+
+    // most recently updated beacon goes to the end of the age list
+    if (m_meas_table.newest != insert_idx)
+    {
+        age_unlink(insert_idx);
+        age_append(insert_idx);
     }
-    // else
-    // {
-    //     LOG(LVL_DEBUG, "Ignoring beacon address :%u, rss :%d",
-    //         beacon->address,
-    //         beacon->rssi);
-    // }
+
+    LOG(LVL_DEBUG, "idx:%d,address:%d,rss:%d,txpower:%d,type:%d",
+        insert_idx,
+        beacon->address,
+        beacon->norm_rss,
+        beacon->txpower,
+        beacon->type);
 }
 
 uint8_t PosLibMeas_getBeaconNum(void)
@@ -614,6 +924,120 @@ static uint8_t add_rss_record(poslib_meas_payload_buffer_t * buf, poslib_measure
     }
 }
 
+/**
+ * @brief   Writes an unsigned LEB128 value
+ * @return  Amount of bytes written
+ */
+static uint8_t put_varint(uint8_t * out, uint64_t value)
+{
+    uint8_t len = 0;
+
+    do
+    {
+        out[len] = value & 0x7F;
+        value >>= 7;
+        if (value != 0)
+        {
+            out[len] |= 0x80;
+        }
+        len++;
+    } while (value != 0);
+
+    return len;
+}
+
+/**
+ * @brief   Writes a compact rss record entry
+ * @return  Amount of bytes written, at most POSLIB_MEAS_COMPACT_ENTRY_MAX
+ */
+static uint8_t put_compact_entry(uint8_t * entry,
+                                 const poslib_meas_wm_beacon_t * bcn,
+                                 app_addr_t prev_address,
+                                 bool add_txpower,
+                                 uint8_t rss_step)
+{
+    int16_t norm_rss = bcn->norm_rss * -2;
+    uint8_t len;
+
+    norm_rss = (norm_rss <= 0) ? 0 : (norm_rss + rss_step / 2) / rss_step;
+
+    len = put_varint(entry, ((uint64_t)(bcn->address - prev_address) << 1)
+                            | add_txpower);
+    entry[len++] = (norm_rss >= 0xFF) ? 0xFF : norm_rss;
+    if (add_txpower)
+    {
+        entry[len++] = (uint8_t)bcn->txpower;
+    }
+    return len;
+}
+
+static uint8_t add_compact_rss_record(poslib_meas_payload_buffer_t * buf,
+                                      poslib_measurements_e meas_type,
+                                      uint8_t rss_step)
+{
+    uint8_t num_meas = m_meas_table.num_beacons;
+    uint8_t order[MAX_BEACONS];
+    poslib_meas_record_header_t header;
+    poslib_meas_rss_compact_t record;
+    uint8_t entry[POSLIB_MEAS_COMPACT_ENTRY_MAX];
+    uint8_t * header_cursor = buf->cursor;
+    app_addr_t prev_address = 0;
+    int8_t prev_txpower = 0;
+    bool ret = true;
+
+    if (num_meas == 0)
+    {
+        LOG(LVL_WARNING, "No measurements available");
+        return num_meas;
+    }
+
+    // beacons in increasing address order, table is small
+    for (uint8_t i = 0; i < num_meas; i++)
+    {
+        uint8_t j = i;
+        while (j > 0 && m_meas_table.beacons[order[j - 1]].address >
+                        m_meas_table.beacons[i].address)
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    // add header, length is known once all entries are added
+    header.type = meas_type;
+    header.length = 0;
+    record.rss_step = rss_step;
+    ret &= meas_copy_payload(buf, (void*) &header, sizeof(header));
+    ret &= meas_copy_payload(buf, (void*) &record, sizeof(record));
+
+    for (uint8_t i = 0; ret && i < num_meas; i++)
+    {
+        poslib_meas_wm_beacon_t * bcn = &m_meas_table.beacons[order[i]];
+        bool add_txpower = (i == 0) || (bcn->txpower != prev_txpower);
+        uint8_t len = put_compact_entry(entry, bcn, prev_address,
+                                        add_txpower, rss_step);
+
+        ret &= meas_copy_payload(buf, (void*) entry, len);
+        prev_address = bcn->address;
+        prev_txpower = bcn->txpower;
+    }
+
+    if (ret)
+    {
+        header.length = buf->cursor - header_cursor - sizeof(header);
+        memcpy(header_cursor, &header, sizeof(header));
+        LOG(LVL_DEBUG, "Compact measurements added %u (%u bytes)",
+            num_meas, header.length);
+        return num_meas;
+    }
+    else
+    {
+        LOG(LVL_ERROR, "Not enough space for all measurements");
+        buf->cursor = header_cursor; //revert cursor
+        return 0;
+    }
+}
 
 static uint16_t get_voltage(void)
 #ifdef CONF_VOLTAGE_REPORT
@@ -673,7 +1097,8 @@ static bool add_voltage_record(poslib_meas_payload_buffer_t * buf)
 }
 
 bool PosLibMeas_getPayload(uint8_t * bytes, uint8_t max_len, uint8_t sequence,
-                                poslib_measurements_e meas_type, bool add_voltage, 
+                                poslib_measurements_e meas_type, uint8_t rss_step,
+                                bool add_voltage,
                                 poslib_meas_record_node_info_t * node_info, 
                                 uint8_t * num_bytes, uint8_t * num_meas)
 {
@@ -694,7 +1119,15 @@ bool PosLibMeas_getPayload(uint8_t * bytes, uint8_t max_len, uint8_t sequence,
     // add RSS measurements
     if (ret)
     {
-        *num_meas = add_rss_record(&buf, meas_type);
+        if (meas_type == POSLIB_MEAS_RSS_SR_COMPACT ||
+            meas_type == POSLIB_MEAS_RSS_SR_ANCHOR_COMPACT)
+        {
+            *num_meas = add_compact_rss_record(&buf, meas_type, rss_step);
+        }
+        else
+        {
+            *num_meas = add_rss_record(&buf, meas_type);
+        }
         ret = (*num_meas == 0) ? false : true;
     }
     // add voltage
@@ -716,5 +1149,115 @@ bool PosLibMeas_getPayload(uint8_t * bytes, uint8_t max_len, uint8_t sequence,
 
 void PosLibMeas_clearMeas(void)
 {
-    memset(&m_meas_table, 0, sizeof(m_meas_table));
+    reset_table();
+}
+
+void PosLibMeas_resetFilters(void)
+{
+    for (uint8_t i = 0; i < m_meas_table.num_beacons; i++)
+    {
+        poslib_meas_wm_beacon_t * bcn = &m_meas_table.beacons[i];
+        PosLibFilter_init(&bcn->filter, bcn->norm_rss);
+    }
+    for (uint8_t i = 0; i < MEAS_FILTER_CACHE_SIZE; i++)
+    {
+        poslib_meas_filter_cache_t * entry = &m_filter_cache[i];
+        PosLibFilter_init(&entry->filter, entry->norm_rss);
+    }
+}
+
+void PosLibMeas_setScanReference(void)
+{
+    bool used[MAX_BEACONS] = {false};
+
+    // selection of the strongest beacons, table is small
+    for (m_reference_num = 0;
+         m_reference_num < REFERENCE_BEACONS &&
+         m_reference_num < m_meas_table.num_beacons;
+         m_reference_num++)
+    {
+        uint8_t best = MEAS_NONE;
+        for (uint8_t i = 0; i < m_meas_table.num_beacons; i++)
+        {
+            if (!used[i] && (best == MEAS_NONE ||
+                m_meas_table.beacons[i].norm_rss >
+                    m_meas_table.beacons[best].norm_rss))
+            {
+                best = i;
+            }
+        }
+        used[best] = true;
+        m_reference[m_reference_num].address = m_meas_table.beacons[best].address;
+        m_reference[m_reference_num].norm_rss = m_meas_table.beacons[best].norm_rss;
+    }
+    LOG(LVL_DEBUG, "Scan reference: %u beacons", m_reference_num);
+}
+
+bool PosLibMeas_isScanStable(uint8_t rss_threshold_db)
+{
+    uint8_t strongest = MEAS_NONE;
+    bool strongest_known = false;
+
+    if (m_reference_num == 0 || m_meas_table.num_beacons == 0)
+    {
+        return false;
+    }
+
+    // all the reference beacons are seen with a similar rss
+    for (uint8_t i = 0; i < m_reference_num; i++)
+    {
+        uint8_t idx = m_meas_table.index[index_find(m_reference[i].address)];
+        int16_t delta;
+
+        if (idx == MEAS_NONE)
+        {
+            LOG(LVL_DEBUG, "Scan changed: %u missing", m_reference[i].address);
+            return false;
+        }
+        // rss of this scan: the filter would hide a change for several scans
+        delta = m_meas_table.beacons[idx].scan_rss - m_reference[i].norm_rss;
+        if (delta > rss_threshold_db || delta < -rss_threshold_db)
+        {
+            LOG(LVL_DEBUG, "Scan changed: %u rss %d", m_reference[i].address, delta);
+            return false;
+        }
+    }
+
+    // and no other beacon became the strongest one
+    for (uint8_t i = 0; i < m_meas_table.num_beacons; i++)
+    {
+        if (strongest == MEAS_NONE ||
+            m_meas_table.beacons[i].scan_rss > m_meas_table.beacons[strongest].scan_rss)
+        {
+            strongest = i;
+        }
+    }
+    for (uint8_t i = 0; i < m_reference_num; i++)
+    {
+        if (m_reference[i].address == m_meas_table.beacons[strongest].address)
+        {
+            strongest_known = true;
+            break;
+        }
+    }
+    if (!strongest_known)
+    {
+        LOG(LVL_DEBUG, "Scan changed: %u strongest",
+            m_meas_table.beacons[strongest].address);
+    }
+    return strongest_known;
+}
+
+bool PosLibMeas_repeatScan(void)
+{
+    if (m_scan_pending || m_meas_table.num_beacons == 0)
+    {
+        return false;
+    }
+
+    LOG(LVL_DEBUG, "Scan skipped, %u beacons reported again",
+        m_meas_table.num_beacons);
+    PosLibEvent_add(POSLIB_CTRL_EVENT_SCAN_STARTED);
+    PosLibEvent_add(POSLIB_CTRL_EVENT_SCAN_END);
+    return true;
 }
\ No newline at end of file
@@ -23,12 +23,14 @@ typedef enum
     POSLIB_MEAS_RSS_SR_4BYTE_ADDR = 0x05,
     POSLIB_MEAS_NODE_INFO = 0x06,
     POSLIB_MEAS_DA = 0x07,
+    POSLIB_MEAS_RSS_SR_COMPACT = 0x08,
     /** 0x70 - 0xEF : range reserved for customer
      *  Please notify Wirepas if a custom record ID is used by
      * your customised positoning app
      * 0xF0 - 0xFF : range reserved for Wirepas */
     POSLIB_MEAS_RSS_SR_ANCHOR = 0xF0,
-    POSLIB_MEAS_RSS_SR_ANCHOR_4BYTE_ADDR = 0xF5
+    POSLIB_MEAS_RSS_SR_ANCHOR_4BYTE_ADDR = 0xF5,
+    POSLIB_MEAS_RSS_SR_ANCHOR_COMPACT = 0xF8
 } poslib_measurements_e;
 
 /** 2.4 profile - limited by internal memory */
@@ -68,6 +70,29 @@ typedef PACKED_STRUCT
     uint8_t length;
 } poslib_meas_record_header_t;
 
+/**
+    @brief Compact RSS record (POSLIB_MEAS_RSS_SR_COMPACT and
+           POSLIB_MEAS_RSS_SR_ANCHOR_COMPACT) payload.
+
+    The record starts with the rss quantisation step in 0.5 dB followed by
+    one entry per beacon, in increasing address order:
+    - address delta to the previous entry (0 for the first one), shifted left
+      by one, with the lowest bit set when tx power follows. Encoded as
+      LEB128: 7 bits per byte, least significant first, bit 7 set when more
+      bytes follow
+    - quantised rss: norm_rss [dB] = -value * step / 2 (saturated to 0xFF)
+    - tx power [dBm] as int8, only when it differs from the previous entry
+      (always present for the first one)
+*/
+typedef PACKED_STRUCT
+{
+    uint8_t rss_step;
+    uint8_t entries[];
+} poslib_meas_rss_compact_t;
+
+/** Largest compact entry: 5 bytes address delta, rss and tx power */
+#define POSLIB_MEAS_COMPACT_ENTRY_MAX 7
+
 typedef PACKED_STRUCT
 {
     poslib_meas_record_header_t header;
@@ -151,8 +176,32 @@ uint8_t PosLibMeas_getBeaconNum(void);
  */
 void PosLibMeas_stop(void);
 
+/**
+ * @brief   Builds the measurement message.
+ * @param   bytes
+ *          Out: message
+ * @param   max_len
+ *          Size of bytes
+ * @param   sequence
+ *          Message sequence
+ * @param   meas_type
+ *          Type of the rss record. The compact record is used for
+ *          POSLIB_MEAS_RSS_SR_COMPACT and POSLIB_MEAS_RSS_SR_ANCHOR_COMPACT
+ * @param   rss_step
+ *          Rss quantisation step of the compact record [0.5 dB]
+ * @param   add_voltage
+ *          True to add the voltage record
+ * @param   node_info
+ *          Node info record or NULL
+ * @param   bytes_len
+ *          Out: message length
+ * @param   num_meas
+ *          Out: number of beacons in rss record
+ * @return  True if message could be built
+ */
 bool PosLibMeas_getPayload(uint8_t * bytes, uint8_t max_len, uint8_t sequence,
-                                poslib_measurements_e meas_type, bool add_voltage, 
+                                poslib_measurements_e meas_type, uint8_t rss_step,
+                                bool add_voltage,
                                 poslib_meas_record_node_info_t * node_info,
                                 uint8_t * bytes_len, uint8_t * num_meas);
 
@@ -162,4 +211,33 @@ bool PosLibMeas_getPayload(uint8_t * bytes, uint8_t max_len, uint8_t sequence,
  * @return void
  */
 void PosLibMeas_clearMeas(void);
+
+/**
+ * @brief   Restarts the rss filter of every beacon from its last reported
+ *          rss. To be called when the filter type changes, as the state of
+ *          one filter is meaningless to another.
+ */
+void PosLibMeas_resetFilters(void);
+
+/**
+ * @brief   Keeps the strongest beacons of the last scan as reference for
+ *          \ref PosLibMeas_isScanStable.
+ */
+void PosLibMeas_setScanReference(void);
+
+/**
+ * @brief   Compares the last scan with the reference scan.
+ * @param   rss_threshold_db maximum rss change of a stable beacon [dB]
+ * @return  true if the strongest reference beacons are all seen with a similar
+ *          rss and none of the other beacons is the strongest one. The last
+ *          rss received during the scan is used, not the filtered one.
+ */
+bool PosLibMeas_isScanStable(uint8_t rss_threshold_db);
+
+/**
+ * @brief   Ends an update without scanning: the beacons of the last scan are
+ *          reported again.
+ * @return  true if scan end is generated, false if there is no beacon to report
+ */
+bool PosLibMeas_repeatScan(void);
 #endif
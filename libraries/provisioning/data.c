@@ -13,49 +13,132 @@
 #include "debug_log.h"
 
 
-/** Size of the buffer to store strings from CBOR buffer. */
-#define MAX_STRING_BUFFER_SIZE 94
+/** Maximum number of User data items recorded from one provisioning data
+ *  buffer.
+ */
+#ifndef PROV_DATA_MAX_USER_ITEMS
+#define PROV_DATA_MAX_USER_ITEMS 16
+#endif
 
 /** Invalid values for the network parameters. */
-#define INVALID_KEY 0xFF
 #define INVALID_NET_ADDR 0
 #define INVALID_NET_CHAN 0
 #define INVALID_NODE_ADDR 0
 #define INVALID_NODE_ROLE 0xFF
 
-/** \brief Structure containing the Wirepas network parameters. */
+/**
+ * \brief   Location of one User data item in the provisioning data buffer.
+ *          Byte and text strings point to the string content, other types
+ *          to the whole CBOR encoded item, which is decoded when the callback
+ *          is called.
+ */
+typedef struct
+{
+    /** Id of the item. */
+    uint8_t id;
+    /** CborType of the item. */
+    uint8_t type;
+    /** Offset of the value from the beginning of the buffer. */
+    uint8_t offset;
+    /** Length of the value. */
+    uint8_t length;
+} user_data_span_t;
+
+/**
+ * \brief   Structure containing the Wirepas network parameters. Keys are not
+ *          copied and point to the provisioning data buffer.
+ */
 static struct
 {
-    uint8_t enc_key[APP_LIB_SETTINGS_AES_KEY_NUM_BYTES];
-    bool is_enc_key_set;
-    uint8_t auth_key[APP_LIB_SETTINGS_AES_KEY_NUM_BYTES];
-    bool is_auth_key_set;
+    const uint8_t * enc_key;
+    const uint8_t * auth_key;
     app_lib_settings_net_addr_t net_addr;
     app_lib_settings_net_channel_t net_chan;
     app_addr_t node_addr;
     app_lib_settings_role_t node_role;
+    /** Buffer the parameters and User data items were decoded from. */
+    const uint8_t * buffer;
+    /** Length of the decoded buffer. */
+    uint8_t length;
+    /** True if the whole buffer was decoded and is valid. */
+    bool valid;
+    /** Number of User data items in user_data. */
+    uint8_t nb_user_data;
+    /** User data items found in the buffer. */
+    user_data_span_t user_data[PROV_DATA_MAX_USER_ITEMS];
 } m_provisioning_data;
 
+/**
+ * \brief   Locate the content of a string in the CBOR buffer.
+ * \param   value
+ *          Pointer to a CBOR Value, must be a byte or text string.
+ * \param   data
+ *          Pointer to store the address of the string content.
+ * \param   len
+ *          Pointer to store the length of the string content.
+ * \note    Only definite length strings are supported as the content of
+ *          chunked strings is not contiguous.
+ * \return  A CborError error code.
+ */
+static CborError get_string_span(CborValue * value,
+                                 const uint8_t ** data,
+                                 size_t * len)
+{
+    CborValue next = *value;
+    CborError err;
+
+    err = cbor_value_get_string_length(value, len);
+    if (err != CborNoError)
+    {
+        return err;
+    }
+
+    /* Content of a definite length string ends where the next item begins. */
+    err = cbor_value_advance(&next);
+    if (err != CborNoError)
+    {
+        return err;
+    }
+
+    *data = cbor_value_get_next_byte(&next) - *len;
+
+    return CborNoError;
+}
+
 /**
  * \brief   Extract a byte array from a CBOR Value.
  * \param   value
  *          Pointer to a CBOR Value.
- * \param   buffer
- *          Pointer to where to store the data.
- * \param   buflen
- *          [In] Size of the buffer. [Out] Size of the extracted byte string.
+ * \param   data
+ *          Pointer to store the address of the byte string content.
+ * \param   len
+ *          Expected size of the byte string.
  * \return  A CborError error code.
  */
 static CborError extract_byte_string(CborValue * value,
-                                     uint8_t *buffer,
-                                     size_t *buflen)
+                                     const uint8_t ** data,
+                                     size_t len)
 {
+    CborError err;
+    size_t str_len;
+
     if (!cbor_value_is_byte_string(value))
     {
         return CborErrorIllegalType;
     }
 
-    return cbor_value_copy_byte_string(value, buffer, buflen, NULL);
+    err = get_string_span(value, data, &str_len);
+    if (err != CborNoError)
+    {
+        return err;
+    }
+
+    if (str_len != len)
+    {
+        return CborErrorImproperValue;
+    }
+
+    return CborNoError;
 }
 
 /**
@@ -87,15 +170,10 @@ static CborError extract_unsigned_int(CborValue * value,
         return err;
     }
 
-    if (size == 8)
-    {
-
-    }
-    else if (size == 0)
-    {
-        return CborErrorDataTooLarge;
-    }
-    else if (size > 8 || val > (uint64_t)((2<<(size*8)) - 1))
+    // Any value fits in 8 bytes, a smaller size must hold it. The shift is
+    // only done for 1 to 7 bytes, a shift by 64 bits is undefined.
+    if (size == 0 || size > 8 ||
+        (size < 8 && val > (UINT64_MAX >> (64 - size * 8))))
     {
         return CborErrorDataTooLarge;
     }
@@ -114,24 +192,9 @@ static CborError extract_unsigned_int(CborValue * value,
  */
 static CborError parse_enc_key(CborValue * value)
 {
-    CborError err;
-    size_t len = APP_LIB_SETTINGS_AES_KEY_NUM_BYTES;
-    err = extract_byte_string(value,
-                                m_provisioning_data.enc_key,
-                                &len);
-    if (err != CborNoError)
-    {
-        return err;
-    }
-
-    if (len != APP_LIB_SETTINGS_AES_KEY_NUM_BYTES)
-    {
-        return CborErrorImproperValue;
-    }
-
-    m_provisioning_data.is_enc_key_set = true;
-
-    return err;
+    return extract_byte_string(value,
+                               &m_provisioning_data.enc_key,
+                               APP_LIB_SETTINGS_AES_KEY_NUM_BYTES);
 }
 
 /**
@@ -143,22 +206,9 @@ static CborError parse_enc_key(CborValue * value)
  */
 static CborError parse_auth_key(CborValue * value)
 {
-    CborError err;
-    size_t len = APP_LIB_SETTINGS_AES_KEY_NUM_BYTES;
-    err = extract_byte_string(value, m_provisioning_data.auth_key, &len);
-    if (err != CborNoError)
-    {
-        return err;
-    }
-
-    if (len != APP_LIB_SETTINGS_AES_KEY_NUM_BYTES)
-    {
-        return CborErrorImproperValue;
-    }
-
-    m_provisioning_data.is_auth_key_set = true;
-
-    return err;
+    return extract_byte_string(value,
+                               &m_provisioning_data.auth_key,
+                               APP_LIB_SETTINGS_AES_KEY_NUM_BYTES);
 }
 
 /**
@@ -258,22 +308,22 @@ static CborError parse_node_address(CborValue * value)
 static CborError parse_node_role(CborValue * value)
 {
     CborError err;
-    size_t len = sizeof(app_lib_settings_role_t);
+    const uint8_t * role;
 
-    err = extract_byte_string(value, &m_provisioning_data.node_role, &len);
+    err = extract_byte_string(value, &role, sizeof(app_lib_settings_role_t));
 
     if (err != CborNoError)
     {
         return err;
     }
 
-    if (len != sizeof(app_lib_settings_role_t) ||
-        !lib_settings->isValidNodeRole(m_provisioning_data.node_role))
+    if (!lib_settings->isValidNodeRole(*role))
     {
-        m_provisioning_data.node_role = INVALID_NODE_ROLE;
         return CborErrorImproperValue;
     }
 
+    m_provisioning_data.node_role = *role;
+
     return err;
 }
 
@@ -336,62 +386,34 @@ static CborError parse_wirepas_data(CborValue * value,
 }
 
 /**
- * \brief   Parse one CBOR Id of User data.
+ * \brief   Decode the value of a non string User data item.
  * \param   value
- *          Pointer to a CBOR Value. Points to provisioning data encoded
- *          in a Cbor(Data of one Id:Data map entry).
- * \param   id
- *          Id corresponding to the data
- * \param   cb
- *          Callback to call for each User specific Id found.
- *          It is called only if the whole provisioning data is valid.
+ *          Pointer to a CBOR Value.
+ * \param   data
+ *          Pointer to store the decoded value, 8 bytes aligned.
+ * \param   len
+ *          Pointer to store the size of the decoded value.
  * \return  A CborError error code.
  */
-static CborError parse_user_data(CborValue * value,
-                                 int id,
-                                 provisioning_user_data_cb_f cb)
+static CborError decode_user_value(CborValue * value,
+                                   void * data,
+                                   size_t * len)
 {
     CborError err;
 
-    size_t len;
-    /* Force alignement as buffer can contain int64 values. */
-    uint8_t val[MAX_STRING_BUFFER_SIZE]  __attribute__ ((aligned (8)));
-    void * data = &val;
-    CborType type = cbor_value_get_type(value);
-
-    switch (type)
+    switch (cbor_value_get_type(value))
     {
         case CborIntegerType:
         {
-            len = sizeof(int64_t);
+            *len = sizeof(int64_t);
             err = cbor_value_get_int64_checked(value,
                                                 (int64_t *)data);
             break;
         }
 
-        case CborByteStringType:
-        {
-            len = MAX_STRING_BUFFER_SIZE;
-            err = cbor_value_copy_byte_string(value,
-                                                (uint8_t *)data,
-                                                &len,
-                                                NULL);
-            break;
-        }
-
-        case CborTextStringType:
-        {
-            len = MAX_STRING_BUFFER_SIZE;
-            err = cbor_value_copy_text_string(value,
-                                                (char *)data,
-                                                &len,
-                                                NULL);
-            break;
-        }
-
         case CborSimpleType:
         {
-            len = sizeof(uint8_t);
+            *len = sizeof(uint8_t);
             err = cbor_value_get_simple_type(value,
                                                 (uint8_t *)data);
             break;
@@ -399,14 +421,14 @@ static CborError parse_user_data(CborValue * value,
 
         case CborBooleanType:
         {
-            len = sizeof(bool);
+            *len = sizeof(bool);
             err = cbor_value_get_boolean(value, (bool *)data);
             break;
         }
 
         case CborDoubleType:
         {
-            len = sizeof(double);
+            *len = sizeof(double);
             err = cbor_value_get_double(value,
                                         (double *)data);
             break;
@@ -414,21 +436,68 @@ static CborError parse_user_data(CborValue * value,
 
         case CborFloatType:
         {
-            len = sizeof(float);
+            *len = sizeof(float);
             err = cbor_value_get_float(value,
                                         (float *)data);
             break;
         }
         case CborHalfFloatType:
         {
-            len = sizeof(uint16_t);
+            *len = sizeof(uint16_t);
             err = cbor_value_get_half_float(value,
                                             (uint16_t *)data);
             break;
         }
 
         default:
-            return CborErrorUnknownType;
+            err = CborErrorUnknownType;
+    }
+
+    return err;
+}
+
+/**
+ * \brief   Parse one CBOR Id of User data and record where its value is.
+ * \param   value
+ *          Pointer to a CBOR Value. Points to provisioning data encoded
+ *          in a Cbor(Data of one Id:Data map entry).
+ * \param   id
+ *          Id corresponding to the data
+ * \return  A CborError error code.
+ */
+static CborError parse_user_data(CborValue * value, int id)
+{
+    CborError err;
+    user_data_span_t * span;
+    const uint8_t * data;
+    size_t len;
+    CborType type = cbor_value_get_type(value);
+
+    if (m_provisioning_data.nb_user_data >= PROV_DATA_MAX_USER_ITEMS)
+    {
+        return CborErrorTooManyItems;
+    }
+
+    if (type == CborByteStringType || type == CborTextStringType)
+    {
+        err = get_string_span(value, &data, &len);
+    }
+    else
+    {
+        /* Check the value now, it is decoded again from the whole item
+         * when the callback is called.
+         */
+        uint64_t val;
+        CborValue next = *value;
+
+        err = decode_user_value(value, &val, &len);
+        if (err == CborNoError)
+        {
+            err = cbor_value_advance_fixed(&next);
+        }
+
+        data = cbor_value_get_next_byte(value);
+        len = cbor_value_get_next_byte(&next) - data;
     }
 
     if (err != CborNoError)
@@ -436,16 +505,51 @@ static CborError parse_user_data(CborValue * value,
         return err;
     }
 
-    if (cb != NULL)
+    span = &m_provisioning_data.user_data[m_provisioning_data.nb_user_data++];
+    span->id = id;
+    span->type = type;
+    span->offset = data - m_provisioning_data.buffer;
+    span->length = len;
+
+    return err;
+}
+
+/**
+ * \brief   Call the User data callback for each recorded User data item.
+ * \param   cb
+ *          Callback to call for each User specific Id found.
+ */
+static void call_user_data_cb(provisioning_user_data_cb_f cb)
+{
+    for (uint8_t i = 0; i < m_provisioning_data.nb_user_data; i++)
     {
+        const user_data_span_t * span = &m_provisioning_data.user_data[i];
+        uint8_t * data = (uint8_t *)m_provisioning_data.buffer + span->offset;
+        size_t len = span->length;
+        /* Force alignement as buffer can contain int64 values. */
+        uint64_t val;
+
+        if (span->type != CborByteStringType &&
+            span->type != CborTextStringType)
+        {
+            CborParser parser;
+            CborValue value;
+
+            /* Already checked while parsing the buffer. */
+            if (cbor_parser_init(data, len, 0, &parser, &value) != CborNoError
+                || decode_user_value(&value, &val, &len) != CborNoError)
+            {
+                continue;
+            }
+            data = (uint8_t *)&val;
+        }
+
         LOG(LVL_DEBUG, "User data (id : %d, type : %d, len : %d).",
-                        id,
-                        type,
+                        span->id,
+                        span->type,
                         len);
-        cb(id, type, data, len);
+        cb(span->id, span->type, data, len);
     }
-
-    return err;
 }
 
 /**
@@ -453,23 +557,21 @@ static CborError parse_user_data(CborValue * value,
  * \param   value
  *          Pointer to a CBOR Value. Points to provisioning data encoded
  *          in a Cbor map (Id:Data).
- * \param   cb
- *          Callback to call for each User specific Id found.
- *          It is called only if the whole provisioning data is valid.
  * \return  A CborError error code.
  */
-static CborError parse_map(CborValue * value, provisioning_user_data_cb_f cb)
+static CborError parse_map(CborValue * value)
 {
     CborError err;
     int id;
 
     /* Sets provisioning data structure to invalid values. */
-    m_provisioning_data.is_auth_key_set = false;
-    m_provisioning_data.is_enc_key_set = false;
+    m_provisioning_data.enc_key = NULL;
+    m_provisioning_data.auth_key = NULL;
     m_provisioning_data.net_addr = INVALID_NET_ADDR;
     m_provisioning_data.net_chan = INVALID_NET_CHAN;
     m_provisioning_data.node_addr = INVALID_NODE_ADDR;
     m_provisioning_data.node_role = INVALID_NODE_ROLE;
+    m_provisioning_data.nb_user_data = 0;
 
 
     while (!cbor_value_at_end(value))
@@ -501,7 +603,7 @@ static CborError parse_map(CborValue * value, provisioning_user_data_cb_f cb)
         /* Match User Ids. */
         else if (id >= PROV_DATA_MIN_USER_ID && id <= PROV_DATA_MAX_USER_ID)
         {
-            err = parse_user_data(value, id, cb);
+            err = parse_user_data(value, id);
         }
         else
         {
@@ -523,8 +625,8 @@ static CborError parse_map(CborValue * value, provisioning_user_data_cb_f cb)
     /* Encryption and Authentatication keys, network address and channel
      * are mandatory in the provisioning data packet.
      */
-    if (!m_provisioning_data.is_enc_key_set ||
-        !m_provisioning_data.is_auth_key_set ||
+    if (m_provisioning_data.enc_key == NULL ||
+        m_provisioning_data.auth_key == NULL ||
         m_provisioning_data.net_addr == INVALID_NET_ADDR ||
         m_provisioning_data.net_chan == INVALID_NET_CHAN)
     {
@@ -534,6 +636,52 @@ static CborError parse_map(CborValue * value, provisioning_user_data_cb_f cb)
     return CborNoError;
 }
 
+/**
+ * \brief   Parse a provisioning data buffer and record its content.
+ * \param   conf
+ *          Configuration for the provisioning data decoder.
+ * \return  A CborError error code.
+ */
+static CborError decode_buffer(provisioning_data_conf_t * conf)
+{
+    CborParser parser;
+    CborValue value;
+    CborValue map;
+    CborError err;
+
+    m_provisioning_data.valid = false;
+    m_provisioning_data.buffer = conf->buffer;
+    m_provisioning_data.length = conf->length;
+
+    err = cbor_parser_init(conf->buffer, conf->length, 0, &parser, &value);
+    if (err != CborNoError)
+    {
+        return err;
+    }
+
+    /* Data buffer must be organised as a map. */
+    if (!cbor_value_is_map(&value))
+    {
+        return CborErrorIllegalType;
+    }
+
+    err = cbor_value_enter_container(&value, &map);
+    if (err != CborNoError)
+    {
+        return err;
+    }
+
+    err = parse_map(&map);
+    if (err != CborNoError)
+    {
+        return err;
+    }
+
+    m_provisioning_data.valid = true;
+
+    return CborNoError;
+}
+
 /**
  * \brief   Apply received network parameters.
  */
@@ -592,9 +740,7 @@ static void apply_network_parameters(void)
 
 provisioning_ret_e Provisioning_Data_decode(provisioning_data_conf_t * conf, bool dry_run)
 {
-    CborParser parser;
-    CborValue value;
-    CborError err;
+    CborError err = CborNoError;
 
     if (conf == NULL || conf->buffer == NULL || conf->length == 0)
     {
@@ -602,78 +748,54 @@ provisioning_ret_e Provisioning_Data_decode(provisioning_data_conf_t * conf, boo
         return PROV_RET_INVALID_PARAM;
     }
 
-    err = cbor_parser_init(conf->buffer, conf->length, 0, &parser, &value);
-
-    if (err == CborNoError)
+    /* Buffer is parsed once. When applying, reuse what was recorded during
+     * the dry run if it was done on the same buffer.
+     */
+    if (dry_run ||
+        !m_provisioning_data.valid ||
+        m_provisioning_data.buffer != conf->buffer ||
+        m_provisioning_data.length != conf->length)
     {
-        CborValue map;
+        err = decode_buffer(conf);
+    }
 
-        /* Begin parsing the received Cbor buffer. */
-        if (!cbor_value_is_map(&value))
-        {
-            /* Data buffer must be organised as a map. */
-            LOG(LVL_ERROR, "%s : PROV_RET_INVALID_DATA.", __func__);
-            return PROV_RET_INVALID_DATA;
-        }
+    if (err != CborNoError)
+    {
+        /* Error when parsing the buffer. */
+        LOG(LVL_ERROR, "%s : PROV_RET_INVALID_DATA (cBorError %d).",
+                    __func__,
+                    err);
+        return PROV_RET_INVALID_DATA;
+    }
 
-        err = cbor_value_enter_container(&value, &map);
-        if (err != CborNoError)
-        {
-            /* Error entering the map. */
-            LOG(LVL_ERROR, "%s : PROV_RET_INVALID_DATA.", __func__);
-            return PROV_RET_INVALID_DATA;
-        }
+    if (dry_run)
+    {
+        LOG(LVL_INFO, "Provisioning data is valid.");
+        return PROV_RET_OK;
+    }
 
-        if(dry_run)
-        {
-            /* First to verify the data is valid but don't call the User
-             * callback.
-             */
-            err = parse_map(&map, NULL);
+    /* Recorded items are consumed. Keys are still read from the buffer when
+     * the network parameters are applied at shutdown.
+     */
+    m_provisioning_data.valid = false;
 
-            if (err != CborNoError)
-            {
-                /* Error when parsing the buffer. */
-                LOG(LVL_ERROR, "%s : PROV_RET_INVALID_DATA (cBorError %d).",
-                            __func__,
-                            err);
-                return PROV_RET_INVALID_DATA;
-            }
+    /* Call user callback for customer data. */
+    if (conf->user_data_cb != NULL)
+    {
+        call_user_data_cb(conf->user_data_cb);
+    }
 
-            LOG(LVL_INFO, "Provisioning data is valid.");
-            return PROV_RET_OK;
-        }
-        else
+    if (conf->end_cb != NULL)
+    {
+        if (conf->end_cb(PROV_RES_SUCCESS))
         {
-            /* Parse the buffer. call user callback for customer data */
-            err = parse_map(&map, conf->user_data_cb);
-
-            /* This should not happen as the buffer is tested during dryrun. */
-            if (err != CborNoError)
-            {
-                /* Error when parsing the buffer. */
-                LOG(LVL_ERROR, "%s : PROV_RET_INVALID_DATA (cBorError %d).",
-                            __func__,
-                            err);
-                return PROV_RET_INVALID_DATA;
-            }
-
-            if (conf->end_cb != NULL)
-            {
-                if (conf->end_cb(PROV_RES_SUCCESS))
-                {
-                    /* Stop the stack and apply new network parameters.
-                     * This will trigger a reboot.
-                     */
-                    LOG(LVL_INFO, "Applying network parameters.");
-                    lib_system->setShutdownCb(apply_network_parameters);
-                    lib_state->stopStack(); /* Does not return. */
-                }
-            }
-            return PROV_RET_OK;
+            /* Stop the stack and apply new network parameters.
+             * This will trigger a reboot.
+             */
+            LOG(LVL_INFO, "Applying network parameters.");
+            lib_system->setShutdownCb(apply_network_parameters);
+            lib_state->stopStack(); /* Does not return. */
         }
     }
-
-    LOG(LVL_ERROR, "%s : PROV_RET_INVALID_DATA.", __func__);
-    return PROV_RET_INVALID_DATA;
-}
\ No newline at end of file
+    return PROV_RET_OK;
+}
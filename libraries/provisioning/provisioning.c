@@ -300,7 +300,6 @@ provisioning_res_e process_data_packet(void)
             aes_omac1_state_t omac1_state;
             uint32_t icb[AES_128_KEY_BLOCK_SIZE/4];
             uint32_t temp;
-            uint8_t mic[PROV_MIC_SIZE];
 
             data_conf.length -= PROV_MIC_SIZE;
 
@@ -325,26 +324,22 @@ provisioning_res_e process_data_packet(void)
             LOG(LVL_DEBUG, "State WAIT_DATA - ICB:");
             LOG_BUFFER(LVL_DEBUG, ((uint8_t*)icb), AES_128_KEY_BLOCK_SIZE);
 
-            /* Decrypt DATA + MIC. */
+            /* Decrypt Data + MIC and authenticate whole packet
+             * (Hdr + Key idx + Ctr + Data).
+             */
             aes_setupStream(&data_stream,
                             &m_conf.key[ENC_KEY_OFFSET],
                             (uint8_t*)icb);
-            aes_crypto128Ctr(&data_stream,
-                                data_conf.buffer,
-                                data_conf.buffer, // overwrite input buffer
-                                data_conf.length + PROV_MIC_SIZE);
-
-            /* Authenticate whole packet (Hdr + Key idx + Ctr + Data). */
             aes_initOmac1(&omac1_state, m_conf.key);
-            aes_omac1(&omac1_state,
-                    mic,
-                    PROV_MIC_SIZE,
-                    m_data_buffer,
-                    m_data_length - PROV_MIC_SIZE);
-
-            if (memcmp(mic,
-                &data_conf.buffer[data_conf.length],
-                PROV_MIC_SIZE))
+            if (!aes_decryptOmac1Ctr(&omac1_state,
+                                     &data_stream,
+                                     m_data_buffer,
+                                     PROV_DATA_OFFSET,
+                                     data_conf.buffer,
+                                     data_conf.buffer, // overwrite input
+                                     data_conf.length,
+                                     &data_conf.buffer[data_conf.length],
+                                     PROV_MIC_SIZE))
             {
                 LOG(LVL_ERROR, "State WAIT_DATA : MIC doesn't match.");
                 res = PROV_RES_INVALID_DATA;
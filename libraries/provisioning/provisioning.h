@@ -63,7 +63,9 @@ typedef bool (*provisioning_end_cb_f)(provisioning_res_e result);
  * \param   id
  *          Id of the received item.
  * \param   data
- *          Received data.
+ *          Received data. Byte and text strings point directly to the
+ *          received buffer and text strings are not null terminated.
+ *          Only valid during the callback.
  * \param   len
  *          Length of the data.
  */
@@ -186,6 +188,34 @@ typedef struct
     provisioning_proxy_start_cb_f start_cb;
 } provisioning_proxy_conf_t;
 
+/**
+ * \brief Statistics of the sessions opened by the provisioning proxy for
+ *        local provisioning.
+ */
+typedef struct
+{
+    /** Sessions opened on a START packet. */
+    uint32_t started;
+    /** Sessions closed on a DATA_ACK packet from the new node. */
+    uint32_t completed;
+    /** Sessions closed with no DATA_ACK after all DATA retransmissions. */
+    uint32_t failed;
+    /** NACK packets sent. */
+    uint32_t rejected;
+    /** START packets dropped as all the sessions were in use. */
+    uint32_t dropped;
+    /** DATA packets sent again. */
+    uint32_t resent;
+    /** Cumulated time from START to DATA_ACK of completed sessions, in ms. */
+    uint32_t total_time_ms;
+    /** Longest time from START to DATA_ACK, in ms. */
+    uint32_t max_time_ms;
+    /** Sessions currently open. */
+    uint8_t active;
+    /** Highest amount of sessions open at the same time. */
+    uint8_t high_water;
+} provisioning_proxy_stats_t;
+
 /**
  * \brief   Initialize the provisioning process.
  * \note    If Provisioning is used, App_scheduler and Shared_data MUST BE
@@ -225,11 +255,14 @@ provisioning_ret_e Provisioning_stop(void);
 
 /**
  * \brief   Initialize the provisioning proxy.
- * \note    If Provisioning Proxy is used, Shared_data MUST BE initialized
- *          in App_Init of the application.
+ * \note    If Provisioning Proxy is used, App_scheduler and Shared_data MUST
+ *          BE initialized in App_Init of the application.
  * \note    If local provisioing is enabled, provisioning request sent by new
  *          node will be treated locally by this library instead of being
- *          forwarded to the provisioning server.
+ *          forwarded to the provisioning server. Up to PROV_PROXY_MAX_SESSIONS
+ *          new nodes are provisioned at the same time, each in its own
+ *          session. DATA packets not acknowledged are sent again every
+ *          PROV_PROXY_RESEND_MS, up to PROV_PROXY_MAX_RESEND times.
  * \param   conf
  *          Configuration for the provisioning proxy.
  * \return  Result code, \ref PROV_RET_OK if proxy is initialized.
@@ -254,4 +287,16 @@ provisioning_ret_e Provisioning_Proxy_start(void);
  */
 provisioning_ret_e Provisioning_Proxy_stop(void);
 
+/**
+ * \brief   Get the statistics of the local provisioning sessions.
+ * \note    Throughput is completed / time, mean provisioning time is
+ *          total_time_ms / completed.
+ * \param   stats
+ *          Out: the statistics.
+ * \return  Result code, \ref PROV_RET_OK if statistics are copied.
+ *          See \ref provisioning_ret_e for other return codes.
+ */
+provisioning_ret_e Provisioning_Proxy_getStats(
+                                        provisioning_proxy_stats_t * stats);
+
 #endif //_PROVISIONING_H_
\ No newline at end of file
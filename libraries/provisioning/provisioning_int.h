@@ -181,7 +181,11 @@ typedef struct
  * \param   conf
  *          Configuration for the provisioning data decoder.
  * \param   dry_run
- *          If true, only check data validity and don't apply it.
+ *          If true, only check data validity and don't apply it. The
+ *          location of each item in the buffer is recorded so that applying
+ *          the same buffer afterwards does not parse it again.
+ * \note    Data is not copied, the buffer must not be modified between the
+ *          dry run and applying the data.
  * \return  Result code, \ref PROV_RET_OK if config is valid.
  *          See \ref provisioning_ret_e for other return codes.
  */
@@ -13,11 +13,63 @@
 #include "node_configuration.h"
 #include "api.h"
 #include "aessw.h"
+#include "app_scheduler.h"
 
 #define DEBUG_LOG_MODULE_NAME "PROXY LIB"
 #define DEBUG_LOG_MAX_LEVEL LVL_INFO
 #include "debug_log.h"
 
+/** Maximum amount of new nodes provisioned at the same time. */
+#ifndef PROV_PROXY_MAX_SESSIONS
+#define PROV_PROXY_MAX_SESSIONS 4
+#endif
+
+/** Delay before sending again a DATA packet not acknowledged, in ms. */
+#ifndef PROV_PROXY_RESEND_MS
+#define PROV_PROXY_RESEND_MS 3000
+#endif
+
+/** How many times a DATA packet is sent again before closing the session. */
+#ifndef PROV_PROXY_MAX_RESEND
+#define PROV_PROXY_MAX_RESEND 3
+#endif
+
+/** Execution time reserved for the session task, in us. */
+#define SESSION_TASK_EXEC_TIME_US 500
+
+/** \brief States of a provisioning session. */
+typedef enum
+{
+    SESSION_FREE = 0, /**< Entry is not used. */
+    SESSION_PENDING = 1, /**< START received, DATA not generated yet. */
+    SESSION_WAIT_ACK = 2 /**< DATA sent, waiting for DATA_ACK. */
+} session_state_e;
+
+/** \brief A new node being provisioned by the proxy. */
+typedef struct
+{
+    /** Received START packet, then the DATA packet to (re)send. */
+    pdu_prov_t pdu;
+    /** Size of the packet in pdu. */
+    uint8_t length;
+    /** State of the session. */
+    session_state_e state;
+    /** Address of the new node on the joining network. */
+    app_addr_t src_address;
+    /** Session Id chosen by the new node. */
+    uint8_t session_id;
+    /** Counter used in AES encryption of this session. */
+    uint16_t counter;
+    /** How many times the DATA packet was sent. */
+    uint8_t nb_sent;
+    /** The new node sent START again, resend DATA without waiting. */
+    bool resend;
+    /** Time when START was received. */
+    app_lib_time_timestamp_hp_t start_time;
+    /** Time when DATA was last sent. */
+    app_lib_time_timestamp_hp_t sent_time;
+} proxy_session_t;
+
 /** Copy of the configuration passed during initialization. */
 static provisioning_proxy_conf_t m_conf;
 /** Placeholder for the network parameters sent to the new node. */
@@ -28,27 +80,37 @@ static bool m_started;
 static bool m_init = false;
 /** Provisioning packet received filter and callback. */
 static shared_data_item_t m_ptk_received_item;
-/** The counter used in AES encryption. */
-static uint16_t m_counter;
+/** Sessions of the new nodes being provisioned. */
+static proxy_session_t m_sessions[PROV_PROXY_MAX_SESSIONS];
+/** Local provisioning statistics. */
+static provisioning_proxy_stats_t m_stats;
+/** OMAC1 state of the authentication key, subkeys derived once. */
+static aes_omac1_state_t m_omac1_state;
+/** Expanded authentication key. */
+static aes_128_key_t m_auth_key;
+/** Expanded encryption key. */
+static aes_128_key_t m_enc_key;
 
 /**
- * \brief   Sends a NACK packet to the existing node.
+ * \brief   Sends a NACK packet to the new node.
  * \param   type
  *          Reason why the NACK is sent.
- * \param   data
- *          The received packet data and metadata.
- *          (contains the sender address, START packet).
+ * \param   hdr
+ *          Header of the START packet received from the new node.
+ * \param   dest_address
+ *          Address of the new node.
  */
-void send_nack(prov_nack_type_e type, const app_lib_data_received_t * data)
+void send_nack(prov_nack_type_e type,
+               const pdu_prov_hdr_t * hdr,
+               app_addr_t dest_address)
 {
     app_lib_data_send_res_e res;
-    pdu_prov_start_t * pdu = (pdu_prov_start_t *) data;
     pdu_prov_nack_t nack_pdu;
 
     /* Generate NACK packet. */
-    nack_pdu.pdu_header.type = PROV_PACKET_TYPE_DATA;
-    nack_pdu.pdu_header.address = pdu->pdu_header.address;
-    nack_pdu.pdu_header.session_id = pdu->pdu_header.session_id;
+    nack_pdu.pdu_header.type = PROV_PACKET_TYPE_NACK;
+    nack_pdu.pdu_header.address = hdr->address;
+    nack_pdu.pdu_header.session_id = hdr->session_id;
     nack_pdu.nack_type = type;
 
     /* Send NACK packet. */
@@ -56,7 +118,7 @@ void send_nack(prov_nack_type_e type, const app_lib_data_received_t * data)
     {
         .bytes = (uint8_t *)&nack_pdu,
         .num_bytes = sizeof(pdu_prov_nack_t),
-        .dest_address = data->src_address,
+        .dest_address = dest_address,
         .delay = 0,
         .qos = APP_LIB_DATA_QOS_HIGH,
         .flags = APP_LIB_DATA_SEND_FLAG_NONE,
@@ -66,13 +128,13 @@ void send_nack(prov_nack_type_e type, const app_lib_data_received_t * data)
 
     LOG(LVL_INFO, "Send NACK packet (type:%d).", type);
 
+    m_stats.rejected++;
     res = Shared_Data_sendData(&data_to_send, NULL);
     if (res != APP_LIB_DATA_SEND_RES_SUCCESS)
     {
         LOG(LVL_WARNING, "Error sending NACK (res:%d).", res);
     }
 }
-
 /**
  * \brief   Encode the provisioning data in a CBOR buffer.
  * \param   buffer
@@ -164,22 +226,24 @@ CborError encode_cbor_map(uint8_t * buffer, uint8_t  * len)
  *          The size of the provisioning data (not the whole packet).
  * \param   iv
  *          A pointer to the IV received in the START packet.
+ * \param   counter
+ *          The counter of the session.
  */
-void encrypt_data(pdu_prov_data_t * data_pdu, uint8_t data_len, uint8_t * iv)
+void encrypt_data(pdu_prov_data_t * data_pdu,
+                  uint8_t data_len,
+                  const uint8_t * iv,
+                  uint16_t counter)
 {
     aes_data_stream_t data_stream;
-    aes_omac1_state_t omac1_state;
     uint32_t icb[AES_128_KEY_BLOCK_SIZE/4];
     uint32_t sum;
-    uint8_t mic[PROV_MIC_SIZE];
 
-    m_counter++;
     data_pdu->key_index = 1;
-    data_pdu->counter = m_counter;
+    data_pdu->counter = counter;
 
     /* Initialize counter. */
     memcpy(icb, iv, AES_128_KEY_BLOCK_SIZE);
-    sum = icb[0] + m_counter;
+    sum = icb[0] + counter;
 
     if (sum < icb[0])
     {
@@ -193,35 +257,295 @@ void encrypt_data(pdu_prov_data_t * data_pdu, uint8_t data_len, uint8_t * iv)
     }
     icb[0] = sum;
 
-    LOG(LVL_DEBUG, "Encrypt data - Ctr: %d, - IV:", m_counter);
+    LOG(LVL_DEBUG, "Encrypt data - Ctr: %d, - IV:", counter);
     LOG_BUFFER(LVL_DEBUG, iv, AES_128_KEY_BLOCK_SIZE);
     LOG(LVL_DEBUG, "Encrypt data - ICB:");
     LOG_BUFFER(LVL_DEBUG, ((uint8_t*)icb), AES_128_KEY_BLOCK_SIZE);
 
-    /* Authenticate whole packet (Hdr + Key idx + Ctr + Data). */
-    aes_initOmac1(&omac1_state, m_conf.key);
-    aes_omac1(&omac1_state,
-              mic,
-              PROV_MIC_SIZE,
-              (uint8_t *)data_pdu,
-              data_len + PROV_DATA_OFFSET);
-
-    /* Copy MIC after the data. */
-    memcpy(&data_pdu->data[data_len], mic, PROV_MIC_SIZE);
-
-    /* Encrypt Data + MIC. */
-    aes_setupStream(&data_stream,
-                    &m_conf.key[ENC_KEY_OFFSET],
-                    (uint8_t*)icb);
-    aes_crypto128Ctr(&data_stream,
-                     data_pdu->data,
-                     data_pdu->data, // overwrite input buffer
-                     data_len + PROV_MIC_SIZE);
+    /* Authenticate whole packet (Hdr + Key idx + Ctr + Data) and encrypt
+     * Data + MIC, MIC being written after the data.
+     */
+    aes_setupStreamKey(&data_stream, &m_enc_key, (uint8_t*)icb);
+    aes_encryptOmac1Ctr(&m_omac1_state,
+                        &data_stream,
+                        (uint8_t *)data_pdu,
+                        PROV_DATA_OFFSET,
+                        data_pdu->data,
+                        data_pdu->data, // overwrite input buffer
+                        data_len,
+                        &data_pdu->data[data_len],
+                        PROV_MIC_SIZE);
+}
+
+/**
+ * \brief   Time elapsed since a timestamp, in ms.
+ */
+static uint32_t elapsed_ms(app_lib_time_timestamp_hp_t since)
+{
+    return lib_time->getTimeDiffUs(lib_time->getTimestampHp(), since) / 1000;
+}
+
+/**
+ * \brief   Find the session of a new node.
+ * \param   src_address
+ *          Address of the new node.
+ * \return  The session or NULL if the node has none.
+ */
+static proxy_session_t * find_session(app_addr_t src_address)
+{
+    for (uint8_t i = 0; i < PROV_PROXY_MAX_SESSIONS; i++)
+    {
+        if (m_sessions[i].state != SESSION_FREE &&
+            m_sessions[i].src_address == src_address)
+        {
+            return &m_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief   Take a free session.
+ * \return  The session or NULL if all sessions are in use.
+ */
+static proxy_session_t * alloc_session(void)
+{
+    for (uint8_t i = 0; i < PROV_PROXY_MAX_SESSIONS; i++)
+    {
+        if (m_sessions[i].state == SESSION_FREE)
+        {
+            if (++m_stats.active > m_stats.high_water)
+            {
+                m_stats.high_water = m_stats.active;
+            }
+            return &m_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief   Release a session.
+ */
+static void free_session(proxy_session_t * session)
+{
+    session->state = SESSION_FREE;
+    m_stats.active--;
+}
+
+/**
+ * \brief   Close all the sessions.
+ */
+static void reset_sessions(void)
+{
+    memset(m_sessions, 0, sizeof(m_sessions));
+    m_stats.active = 0;
+}
+
+/**
+ * \brief   Sends the DATA packet of a session.
+ * \param   session
+ *          The session in \ref SESSION_WAIT_ACK state.
+ */
+static void send_data(proxy_session_t * session)
+{
+    app_lib_data_send_res_e res;
+
+    app_lib_data_to_send_t data_to_send =
+    {
+        .bytes = (uint8_t *)&session->pdu,
+        .num_bytes = session->length,
+        .dest_address = session->src_address,
+        .delay = 0,
+        .qos = APP_LIB_DATA_QOS_HIGH,
+        .flags = APP_LIB_DATA_SEND_FLAG_NONE,
+        .src_endpoint = PROV_DOWNLINK_EP,
+        .dest_endpoint = PROV_UPLINK_EP
+    };
+
+    LOG(LVL_INFO, "Send DATA packet to %08X (%d).",
+                  session->src_address,
+                  session->nb_sent);
+    LOG_BUFFER(LVL_DEBUG, (uint8_t *)&session->pdu, session->length);
+
+    if (session->nb_sent > 0)
+    {
+        m_stats.resent++;
+    }
+    session->nb_sent++;
+    session->resend = false;
+    session->sent_time = lib_time->getTimestampHp();
+
+    res = Shared_Data_sendData(&data_to_send, NULL);
+    if (res != APP_LIB_DATA_SEND_RES_SUCCESS)
+    {
+        LOG(LVL_WARNING, "Error sending DATA (res:%d).", res);
+    }
 }
 
 /**
- * \brief   Provisioning packet received callback. Handles START packets from
- *          new nodes.
+ * \brief   Generates and sends the DATA packet answering the START packet of
+ *          a session.
+ * \param   session
+ *          The session in \ref SESSION_PENDING state.
+ */
+static void process_start(proxy_session_t * session)
+{
+    uint8_t data_len = PROV_PDU_SIZE - PROV_DATA_OFFSET - PROV_MIC_SIZE;
+    pdu_prov_start_t start;
+    pdu_prov_data_t * data_pdu = &session->pdu.data;
+    uint8_t uid_len = session->length - sizeof(pdu_prov_hdr_t)
+                                      - 1
+                                      - AES_128_KEY_BLOCK_SIZE;
+
+    /* START packet is overwritten by the DATA packet. */
+    memcpy(&start, &session->pdu.start, session->length);
+
+    /* Call start callback. */
+    if (m_conf.start_cb != NULL)
+    {
+        if (!m_conf.start_cb(start.uid, uid_len, start.method, &m_net_param))
+        {
+            send_nack(PROV_NACK_TYPE_NOT_AUTHORIZED,
+                      &start.pdu_header,
+                      session->src_address);
+            LOG(LVL_INFO, "Node rejected by app.");
+            free_session(session);
+            return;
+        }
+    }
+
+    /* Generate DATA packet. */
+    data_pdu->pdu_header.type = PROV_PACKET_TYPE_DATA;
+    data_pdu->pdu_header.address = start.pdu_header.address;
+    data_pdu->pdu_header.session_id = start.pdu_header.session_id;
+    data_pdu->key_index = 0;
+    data_pdu->counter = 0x0000;
+
+    if (encode_cbor_map(data_pdu->data, &data_len) != CborNoError)
+    {
+        LOG(LVL_ERROR, "Error encoding CBOR.");
+        free_session(session);
+        return;
+    }
+
+    /* Encrypt if SECURED method. */
+    if (start.method == PROV_METHOD_SECURED)
+    {
+        encrypt_data(data_pdu, data_len, start.iv, ++session->counter);
+        data_len += PROV_MIC_SIZE;
+    }
+
+    session->length = PROV_DATA_OFFSET + data_len;
+    session->state = SESSION_WAIT_ACK;
+    send_data(session);
+}
+
+/**
+ * \brief   Task handling the sessions: generates the DATA packets of new
+ *          sessions, one per execution, and sends again the DATA packets
+ *          not acknowledged in time.
+ * \return  Time in ms to schedule the task again.
+ */
+static uint32_t sessions_task(void)
+{
+    uint32_t next_ms = APP_SCHEDULER_STOP_TASK;
+    bool start_processed = false;
+
+    for (uint8_t i = 0; i < PROV_PROXY_MAX_SESSIONS; i++)
+    {
+        proxy_session_t * session = &m_sessions[i];
+        uint32_t elapsed;
+
+        if (session->state == SESSION_PENDING)
+        {
+            if (start_processed)
+            {
+                /* Leave the CPU, next START is processed asap. */
+                next_ms = APP_SCHEDULER_SCHEDULE_ASAP;
+                continue;
+            }
+            process_start(session);
+            start_processed = true;
+        }
+        else if (session->state == SESSION_WAIT_ACK &&
+                 (session->resend ||
+                  elapsed_ms(session->sent_time) >= PROV_PROXY_RESEND_MS))
+        {
+            if (session->nb_sent > PROV_PROXY_MAX_RESEND)
+            {
+                LOG(LVL_WARNING, "No ACK from %08X, session closed.",
+                                 session->src_address);
+                m_stats.failed++;
+                free_session(session);
+                continue;
+            }
+            send_data(session);
+        }
+
+        if (session->state == SESSION_WAIT_ACK)
+        {
+            elapsed = elapsed_ms(session->sent_time);
+            elapsed = (elapsed < PROV_PROXY_RESEND_MS) ?
+                                    PROV_PROXY_RESEND_MS - elapsed : 0;
+            if (elapsed < next_ms)
+            {
+                next_ms = elapsed;
+            }
+        }
+    }
+
+    return next_ms;
+}
+
+/**
+ * \brief   Schedules the session task as soon as possible.
+ */
+static void schedule_sessions_task(void)
+{
+    if (App_Scheduler_addTask_execTime(sessions_task,
+                                       APP_SCHEDULER_SCHEDULE_ASAP,
+                                       SESSION_TASK_EXEC_TIME_US)
+                                                    != APP_SCHEDULER_RES_OK)
+    {
+        LOG(LVL_ERROR, "Error adding session task.");
+    }
+}
+
+/**
+ * \brief   Handles a DATA_ACK packet: the session of the node is completed.
+ * \param   data
+ *          The packet data and metadata.
+ */
+static void process_ack(const app_lib_data_received_t * data)
+{
+    pdu_prov_hdr_t * hdr = (pdu_prov_hdr_t *) data->bytes;
+    proxy_session_t * session = find_session(data->src_address);
+    uint32_t time_ms;
+
+    LOG(LVL_INFO, "ACK received from %08X.", data->src_address);
+
+    if (session == NULL ||
+        session->state != SESSION_WAIT_ACK ||
+        session->session_id != hdr->session_id)
+    {
+        return;
+    }
+
+    time_ms = elapsed_ms(session->start_time);
+    m_stats.completed++;
+    m_stats.total_time_ms += time_ms;
+    if (time_ms > m_stats.max_time_ms)
+    {
+        m_stats.max_time_ms = time_ms;
+    }
+    free_session(session);
+}
+
+/**
+ * \brief   Provisioning packet received callback. Opens a session for START
+ *          packets from new nodes, processed later in the session task, and
+ *          closes it when the node acknowledges the DATA packet.
  * \param   item
  *          Packet filter that generated this callback.
  * \param   data
@@ -233,19 +557,23 @@ static app_lib_data_receive_res_e pkt_received_cb(
                                         const app_lib_data_received_t * data)
 {
     int8_t uid_len;
-    uint8_t data_len = PROV_PDU_SIZE - PROV_DATA_OFFSET - PROV_MIC_SIZE;
-    app_lib_data_send_res_e res;
-    uint8_t data_buffer[PROV_PDU_SIZE];
-    pdu_prov_data_t * data_pdu = (pdu_prov_data_t *) &data_buffer;
     pdu_prov_start_t * pdu = (pdu_prov_start_t *) data->bytes;
+    proxy_session_t * session;
 
     LOG(LVL_DEBUG, "Packet received.");
     LOG_BUFFER(LVL_DEBUG, data->bytes, data->num_bytes);
 
+    if (data->num_bytes < sizeof(pdu_prov_hdr_t) ||
+        data->num_bytes > PROV_PDU_SIZE)
+    {
+        LOG(LVL_ERROR, "Invalid packet length.");
+        return APP_LIB_DATA_RECEIVE_RES_HANDLED;
+    }
+
     /* Check if it is a ACK packet. */
-    if (pdu->pdu_header.type != PROV_PACKET_TYPE_START)
+    if (pdu->pdu_header.type == PROV_PACKET_TYPE_DATA_ACK)
     {
-        LOG(LVL_INFO, "ACK received from %08X.", data->src_address);
+        process_ack(data);
         return APP_LIB_DATA_RECEIVE_RES_HANDLED;
     }
 
@@ -278,7 +606,9 @@ static app_lib_data_receive_res_e pkt_received_cb(
         {
             if (!m_conf.is_local_unsec_allowed)
             {
-                send_nack(PROV_NACK_TYPE_METHOD_NOT_SUPPORTED, data);
+                send_nack(PROV_NACK_TYPE_METHOD_NOT_SUPPORTED,
+                          &pdu->pdu_header,
+                          data->src_address);
                 LOG(LVL_ERROR, "Unsecured method is not supported.");
                 return APP_LIB_DATA_RECEIVE_RES_HANDLED;
             }
@@ -288,7 +618,9 @@ static app_lib_data_receive_res_e pkt_received_cb(
         {
             if (!m_conf.is_local_sec_allowed)
             {
-                send_nack(PROV_NACK_TYPE_METHOD_NOT_SUPPORTED, data);
+                send_nack(PROV_NACK_TYPE_METHOD_NOT_SUPPORTED,
+                          &pdu->pdu_header,
+                          data->src_address);
                 LOG(LVL_ERROR, "Secured method is not supported.");
                 return APP_LIB_DATA_RECEIVE_RES_HANDLED;
             }
@@ -302,58 +634,44 @@ static app_lib_data_receive_res_e pkt_received_cb(
         }
     }
 
-    /* Call start callback. */
-    if (m_conf.start_cb != NULL)
+    session = find_session(data->src_address);
+    if (session != NULL &&
+        session->session_id == pdu->pdu_header.session_id)
     {
-        if (!m_conf.start_cb(pdu->uid, uid_len, pdu->method, &m_net_param))
+        /* START sent again: DATA was lost, no need to generate it again. */
+        if (session->state == SESSION_WAIT_ACK)
         {
-            send_nack(PROV_NACK_TYPE_NOT_AUTHORIZED, data);
-            LOG(LVL_INFO, "Node rejected by app.");
-            return APP_LIB_DATA_RECEIVE_RES_HANDLED;
+            session->resend = true;
+            schedule_sessions_task();
         }
-    }
-
-    /* Generate DATA packet. */
-    data_pdu->pdu_header.type = PROV_PACKET_TYPE_DATA;
-    data_pdu->pdu_header.address = pdu->pdu_header.address;
-    data_pdu->pdu_header.session_id = pdu->pdu_header.session_id;
-    data_pdu->key_index = 0;
-    data_pdu->counter = 0x0000;
-
-    if (encode_cbor_map(data_pdu->data, &data_len) != CborNoError)
-    {
-        LOG(LVL_ERROR, "Error encoding CBOR.");
         return APP_LIB_DATA_RECEIVE_RES_HANDLED;
     }
 
-    /* Encrypt if SECURED method. */
-    if (pdu->method == PROV_METHOD_SECURED)
+    if (session == NULL)
     {
-        encrypt_data(data_pdu, data_len, pdu->iv);
-        data_len += PROV_MIC_SIZE;
+        session = alloc_session();
+        if (session == NULL)
+        {
+            /* New node will send START again after its timeout. */
+            LOG(LVL_WARNING, "No free session, START dropped.");
+            m_stats.dropped++;
+            return APP_LIB_DATA_RECEIVE_RES_HANDLED;
+        }
+        session->counter = Random_get16();
     }
 
-    /* Send DATA packet. */
-    app_lib_data_to_send_t data_to_send =
-    {
-        .bytes = data_buffer,
-        .num_bytes = PROV_DATA_OFFSET + data_len,
-        .dest_address = data->src_address,
-        .delay = 0,
-        .qos = APP_LIB_DATA_QOS_HIGH,
-        .flags = APP_LIB_DATA_SEND_FLAG_NONE,
-        .src_endpoint = PROV_DOWNLINK_EP,
-        .dest_endpoint = PROV_UPLINK_EP
-    };
-
-    LOG(LVL_INFO, "Send DATA packet.");
-    LOG_BUFFER(LVL_DEBUG, data_buffer, PROV_DATA_OFFSET + data_len);
+    /* New session, or node restarted its provisioning. */
+    memcpy(&session->pdu, data->bytes, data->num_bytes);
+    session->length = data->num_bytes;
+    session->state = SESSION_PENDING;
+    session->src_address = data->src_address;
+    session->session_id = pdu->pdu_header.session_id;
+    session->nb_sent = 0;
+    session->resend = false;
+    session->start_time = lib_time->getTimestampHp();
+    m_stats.started++;
 
-    res = Shared_Data_sendData(&data_to_send, NULL);
-    if (res != APP_LIB_DATA_SEND_RES_SUCCESS)
-    {
-        LOG(LVL_WARNING, "Error sending DATA (res:%d).", res);
-    }
+    schedule_sessions_task();
 
     return APP_LIB_DATA_RECEIVE_RES_HANDLED;
 }
@@ -418,9 +736,20 @@ provisioning_ret_e Provisioning_Proxy_init(provisioning_proxy_conf_t * conf)
         Shared_Data_addDataReceivedCb(&m_ptk_received_item);
         Random_init(getUniqueId() ^
                     lib_time->getTimestampHp());
-        m_counter = Random_get16();
     }
 
+    if (conf->is_local_sec_allowed)
+    {
+        /* Keys are expanded once for all the sessions. */
+        aes_initKey(&m_auth_key, m_conf.key);
+        aes_initKey(&m_enc_key, &m_conf.key[ENC_KEY_OFFSET]);
+        aes_initOmac1Key(&m_omac1_state, &m_auth_key);
+    }
+
+    App_Scheduler_cancelTask(sessions_task);
+    reset_sessions();
+    memset(&m_stats, 0, sizeof(m_stats));
+
     m_started = false;
     m_init = true;
 
@@ -479,6 +808,8 @@ provisioning_ret_e Provisioning_Proxy_stop(void)
     {
         lib_joining->enableProxy(true);
         Shared_Data_removeDataReceivedCb(&m_ptk_received_item);
+        App_Scheduler_cancelTask(sessions_task);
+        reset_sessions();
     }
 
     if (lib_joining->stopJoiningBeaconTx() != APP_RES_OK)
@@ -491,3 +822,23 @@ provisioning_ret_e Provisioning_Proxy_stop(void)
 
     return PROV_RET_OK;
 }
+
+provisioning_ret_e Provisioning_Proxy_getStats(
+                                        provisioning_proxy_stats_t * stats)
+{
+    if (!m_init)
+    {
+        LOG(LVL_ERROR, "%s : PROV_RET_INVALID_STATE.", __func__);
+        return PROV_RET_INVALID_STATE;
+    }
+
+    if (stats == NULL)
+    {
+        LOG(LVL_ERROR, "%s : PROV_RET_INVALID_PARAM.", __func__);
+        return PROV_RET_INVALID_PARAM;
+    }
+
+    memcpy(stats, &m_stats, sizeof(m_stats));
+
+    return PROV_RET_OK;
+}
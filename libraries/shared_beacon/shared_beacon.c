@@ -197,3 +197,49 @@ shared_beacon_res_e Shared_Beacon_stopBeacon(uint8_t shared_beacon_index)
 
     return SHARED_BEACON_RES_OK;
 }
+
+shared_beacon_res_e Shared_Beacon_updateContents(uint8_t shared_beacon_index,
+                                                 const uint8_t * content,
+                                                 uint8_t length)
+{
+    app_res_e res;
+
+    if (!m_init_done)
+    {
+        LOG(LVL_ERROR, "Shared_Beacon_updateContents - init not done");
+        return SHARED_BEACON_INIT_NOT_DONE;
+    }
+
+    /** Empty content would stop the beacon, Shared_Beacon_stopBeacon must
+     *  be used for that
+     */
+    if (shared_beacon_index > APP_LIB_BEACON_TX_MAX_INDEX ||
+        content == NULL || length == 0)
+    {
+        LOG(LVL_ERROR, "Shared_Beacon_updateContents error wrong parameter");
+        return SHARED_BEACON_INVALID_PARAM;
+    }
+
+    Sys_enterCriticalSection();
+
+    if (!m_beacon_index[shared_beacon_index].in_use)
+    {
+        Sys_exitCriticalSection();
+        LOG(LVL_ERROR, "Shared_Beacon_updateContents error index not in use");
+        return SHARED_BEACON_INDEX_NOT_AVAILABLE;
+    }
+
+    res = lib_beacon_tx->setBeaconContents(shared_beacon_index,
+                                           content,
+                                           length);
+
+    Sys_exitCriticalSection();
+
+    if (res != APP_RES_OK)
+    {
+        LOG(LVL_ERROR, "Shared_Beacon_updateContents - error: %d\n", res);
+        return SHARED_BEACON_INVALID_PARAM;
+    }
+
+    return SHARED_BEACON_RES_OK;
+}
@@ -73,4 +73,20 @@ shared_beacon_res_e Shared_Beacon_startBeacon(uint16_t interval_ms,
  */
 shared_beacon_res_e Shared_Beacon_stopBeacon(uint8_t shared_beacon_index);
 
+/**
+ * @brief   Replaces the content of a started beacon. Interval, power and
+ *          channels are kept and the beacon is not stopped in between.
+ * @param   shared_beacon_index
+ *          The index received in Shared_Beacon_startBeacon
+ * @param   content
+ *          data to be sent out
+ * @param   length
+ *          length of content to be sent out
+ * @return  \ref shared_beacon_res_e. On error the beacon is left as it is,
+ *          still started and still owning the index.
+ */
+shared_beacon_res_e Shared_Beacon_updateContents(uint8_t shared_beacon_index,
+                                                 const uint8_t * content,
+                                                 uint8_t length);
+
 #endif //_SHARED_BEACON_H_
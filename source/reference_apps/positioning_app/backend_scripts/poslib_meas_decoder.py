@@ -0,0 +1,107 @@
+# Copyright 2021 Wirepas Ltd. All Rights Reserved.
+#
+# See file LICENSE.txt for full license details.
+#
+"""Decoder of the PosLib measurement message (endpoints 238/238)
+
+Usage: python poslib_meas_decoder.py <payload as hex string>
+"""
+import argparse
+from struct import unpack_from
+
+MEAS_RSS_SR_4BYTE_ADDR = 0x05
+MEAS_VOLTAGE = 0x04
+MEAS_NODE_INFO = 0x06
+MEAS_DA = 0x07
+MEAS_RSS_SR_COMPACT = 0x08
+MEAS_RSS_SR_ANCHOR_4BYTE_ADDR = 0xF5
+MEAS_RSS_SR_ANCHOR_COMPACT = 0xF8
+
+
+def decode_varint(data, offset):
+    """Decode an unsigned LEB128 value, return (value, next offset)"""
+    value = 0
+    shift = 0
+    while True:
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, offset
+
+
+def decode_rss(value):
+    """Decode a 4 byte address rss record"""
+    beacons = []
+    for offset in range(0, len(value) - 4, 5):
+        address, rss = unpack_from('<IB', value, offset)
+        beacons.append({'address': address, 'norm_rss': -rss / 2})
+    return beacons
+
+
+def decode_compact_rss(value):
+    """Decode a compact rss record"""
+    beacons = []
+    step = value[0]
+    offset = 1
+    address = 0
+    txpower = None
+    while offset < len(value):
+        delta, offset = decode_varint(value, offset)
+        address += delta >> 1
+        rss = value[offset]
+        offset += 1
+        if delta & 1:
+            txpower = unpack_from('<b', value, offset)[0]
+            offset += 1
+        beacons.append({'address': address,
+                        'norm_rss': -rss * step / 2,
+                        'txpower': txpower})
+    return beacons
+
+
+def decode_message(payload):
+    """Decode a measurement message into a dictionary"""
+    message = {'sequence': unpack_from('<H', payload, 0)[0]}
+    offset = 2
+    while offset + 2 <= len(payload):
+        rtype, length = payload[offset], payload[offset + 1]
+        value = payload[offset + 2:offset + 2 + length]
+        offset += 2 + length
+
+        if rtype in (MEAS_RSS_SR_4BYTE_ADDR, MEAS_RSS_SR_ANCHOR_4BYTE_ADDR):
+            message['anchor'] = rtype == MEAS_RSS_SR_ANCHOR_4BYTE_ADDR
+            message['beacons'] = decode_rss(value)
+        elif rtype in (MEAS_RSS_SR_COMPACT, MEAS_RSS_SR_ANCHOR_COMPACT):
+            message['anchor'] = rtype == MEAS_RSS_SR_ANCHOR_COMPACT
+            message['beacons'] = decode_compact_rss(value)
+        elif rtype == MEAS_VOLTAGE:
+            message['voltage_mv'] = unpack_from('<H', value)[0]
+        elif rtype == MEAS_NODE_INFO:
+            update_s, features, mode, node_class = unpack_from('<IIBB', value)
+            message['node_info'] = {'update_s': update_s,
+                                    'features': features,
+                                    'mode': mode,
+                                    'class': node_class}
+        elif rtype == MEAS_DA:
+            message['da_router'] = unpack_from('<I', value)[0]
+        else:
+            message.setdefault('unknown', []).append((rtype, value.hex()))
+    return message
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('payload',
+                        help="Measurement message as hex string")
+
+    args = parser.parse_args()
+
+    message = decode_message(bytes.fromhex(args.payload))
+    for key, value in message.items():
+        if key == 'beacons':
+            for beacon in value:
+                print("beacon {}".format(beacon))
+        else:
+            print("{}: {}".format(key, value))
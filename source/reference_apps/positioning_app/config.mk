@@ -71,11 +71,40 @@ default_motion_duration_ms = 0
 default_mbcn_enabled = 0
 # for tx interval only 1000, 500, 250 msec supported
 default_mbcn_tx_interval_ms = 1000
+# random variation of each tx interval in +/- percent [0 ... 50]
+default_mbcn_tx_jitter_pct = 10
 
 #DA settings
 default_da_routing_enabled = 0
 default_da_follow_network = 1
 
+#RSS filter settings
+# From poslib_rss_filter_type_e in poslib.h. Mean: 0, EWMA: 1, median: 2, Kalman: 3
+default_rss_filter_type = 0
+# EWMA weight of a new sample in 1/256
+default_rss_filter_ewma_alpha_static = 64
+default_rss_filter_ewma_alpha_dynamic = 128
+# Kalman process noise per sample and measurement noise [dB^2]
+default_rss_filter_kalman_q_static = 1
+default_rss_filter_kalman_q_dynamic = 8
+default_rss_filter_kalman_r = 16
+
+#Measurement report settings
+# Use the compact rss record: yes (1), no (0)
+default_meas_compact = 0
+# RSS quantisation step of the compact record in 0.5 dB [1 ... 20]
+default_meas_rss_step = 2
+
+#Adaptive scan settings (tags with motion sensor)
+# Shorten or skip scans while static and beacons are unchanged: yes (1), no (0)
+default_adaptive_scan_enabled = 0
+# Duration of the short scans [ms]
+default_adaptive_scan_short_scan_ms = 300
+# Maximum scans skipped in a row
+default_adaptive_scan_max_skipped = 3
+# Maximum rss change of an unchanged beacon [dB]
+default_adaptive_scan_rss_threshold_db = 6
+
 # App version
 app_major=$(sdk_major)
 app_minor=$(sdk_minor)
@@ -66,10 +66,26 @@ void get_default_settings(poslib_settings_t * settings)
     // Mini-beacon 
     settings->mbcn.enabled = POSLIB_MBCN_ENABLED;
     settings->mbcn.tx_interval_ms = POSLIB_MBCN_TX_INTERVAL_MS;
+    settings->mbcn.tx_jitter_pct = POSLIB_MBCN_TX_JITTER_PCT;
     memset(settings->mbcn.records, 0 , sizeof(settings->mbcn.records));
     // Default custom records can be initialized here
     settings->da.routing_enabled = POSLIB_DA_ROUTING_ENABLED;
     settings->da.follow_network = POSLIB_DA_FOLLOW_NETWORK;
+    // RSS filter
+    settings->rss_filter.type = POSLIB_RSS_FILTER_TYPE;
+    settings->rss_filter.ewma_alpha_static = POSLIB_RSS_FILTER_EWMA_ALPHA_STATIC;
+    settings->rss_filter.ewma_alpha_dynamic = POSLIB_RSS_FILTER_EWMA_ALPHA_DYNAMIC;
+    settings->rss_filter.kalman_q_static = POSLIB_RSS_FILTER_KALMAN_Q_STATIC;
+    settings->rss_filter.kalman_q_dynamic = POSLIB_RSS_FILTER_KALMAN_Q_DYNAMIC;
+    settings->rss_filter.kalman_r = POSLIB_RSS_FILTER_KALMAN_R;
+    // Measurement report
+    settings->report.compact = POSLIB_MEAS_COMPACT;
+    settings->report.rss_step = POSLIB_MEAS_RSS_STEP;
+    // Adaptive scan
+    settings->adaptive_scan.enabled = POSLIB_ADAPTIVE_SCAN_ENABLED;
+    settings->adaptive_scan.short_scan_ms = POSLIB_ADAPTIVE_SCAN_SHORT_SCAN_MS;
+    settings->adaptive_scan.max_skipped = POSLIB_ADAPTIVE_SCAN_MAX_SKIPPED;
+    settings->adaptive_scan.rss_threshold_db = POSLIB_ADAPTIVE_SCAN_RSS_THRESHOLD_DB;
 }
 
 static void stack_state_cb(stack_state_event_e event)
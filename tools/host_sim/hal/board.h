@@ -0,0 +1,21 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/**
+ * \file    board.h
+ * \brief   Board definition of the host simulator
+ *
+ *          The serial port is a pseudo terminal, see hal/usart.c. The UART IRQ
+ *          pin is only logged.
+ */
+#ifndef HOST_SIM_BOARD_H_
+#define HOST_SIM_BOARD_H_
+
+#define BOARD_UART_IRQ_PIN              0
+#define BOARD_USART_TX_PIN              1
+#define BOARD_USART_RX_PIN              2
+
+#endif /* HOST_SIM_BOARD_H_ */
@@ -0,0 +1,88 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/**
+ * \file    hal_sim.h
+ * \brief   Host drivers: serial port on a pseudo terminal and UART IRQ pin
+ *
+ *          The serial port is the master side of a pseudo terminal. Hosts
+ *          open the slave side (or the link to it) like a real serial port.
+ *          Bytes are paced at the configured baudrate (10 bits per byte), and
+ *          use the DMA driver buffering of nRF52: two 256 bytes transmission
+ *          buffers, reception delivered after 5 characters of silence.
+ *
+ *          While the receiver is off (UART auto-power), each received byte
+ *          is lost and only toggles the wake-up pin (falling then rising
+ *          edge). The next byte comes one character later, when the
+ *          application may have turned the receiver on.
+ */
+#ifndef HOST_SIM_HAL_SIM_H_
+#define HOST_SIM_HAL_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Serial port counters */
+typedef struct
+{
+    /** Bytes sent to the host */
+    uint32_t    tx_bytes;
+    /** Bytes received from the host and given to the application */
+    uint32_t    rx_bytes;
+    /** Bytes received while the receiver was off */
+    uint32_t    rx_lost;
+    /** Calls to Usart_sendBuffer() refused for lack of buffer */
+    uint32_t    tx_refused;
+    /** Bytes the host did not read in time (pseudo terminal full) */
+    uint32_t    tx_lost;
+    /** Wake-up pin edges given to the application */
+    uint32_t    wakeup_edges;
+    /** Time the UART was enabled, in microseconds */
+    uint64_t    enabled_us;
+    /** Times the UART IRQ pin was asserted */
+    uint32_t    irq_asserted;
+} hal_sim_usart_stats_t;
+
+/**
+ * \brief   Create the pseudo terminal of the serial port
+ * \param   link
+ *          Symbolic link created to the slave side, NULL for none
+ * \param   paced
+ *          False to transfer bytes as fast as possible, ignoring the baudrate
+ * \return  True if successful
+ */
+bool Hal_sim_usartOpen(const char * link, bool paced);
+
+/**
+ * \brief   Remove the pseudo terminal and its link
+ */
+void Hal_sim_usartClose(void);
+
+/**
+ * \brief   Get serial port counters
+ * \param   stats
+ *          Filled with the counters
+ */
+void Hal_sim_usartGetStats(hal_sim_usart_stats_t * stats);
+
+/**
+ * \brief   Count an assertion of the UART IRQ pin, see hal/io.c
+ */
+void Hal_sim_usartIrqAsserted(void);
+
+/**
+ * \brief   Count a wake-up pin edge given to the application, see hal/io.c
+ */
+void Hal_sim_usartWakeupEdge(void);
+
+/**
+ * \brief   Wake-up pin edge, see hal/io.c
+ * \param   falling
+ *          True for a falling edge
+ */
+void Hal_sim_wakeupEdge(bool falling);
+
+#endif /* HOST_SIM_HAL_SIM_H_ */
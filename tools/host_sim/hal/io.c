@@ -0,0 +1,76 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/*
+ * UART IRQ and wake-up pins of the dual-MCU drivers, see io.h
+ *
+ * The IRQ pin is only counted. The wake-up pin toggles with the bytes the
+ * host sends while the receiver is off, see hal/usart.c.
+ */
+
+#include "hal_api.h"
+#include "io.h"
+#include "hal_sim.h"
+
+/** Active low IRQ pin */
+static bool             m_irq_asserted;
+
+static wakeup_cb_f      m_wakeup_cb;
+static uint8_t          m_wakeup_edges;
+
+void Io_init(void)
+{
+    m_irq_asserted = false;
+}
+
+void Io_enableUartIrq(void)
+{
+}
+
+void Io_setUartIrq(void)
+{
+    if (!m_irq_asserted)
+    {
+        Hal_sim_usartIrqAsserted();
+    }
+    m_irq_asserted = true;
+}
+
+void Io_clearUartIrq(void)
+{
+    m_irq_asserted = false;
+}
+
+void Wakeup_pinInit(wakeup_cb_f cb)
+{
+    m_wakeup_cb = cb;
+    m_wakeup_edges = 0;
+}
+
+void Wakeup_off(void)
+{
+    m_wakeup_edges = 0;
+}
+
+void Wakeup_clearIrq(void)
+{
+}
+
+void Wakeup_setEdgeIRQ(exti_irq_config_e edge, bool enable)
+{
+    // Like the drivers, a single edge configuration at a time
+    m_wakeup_edges = enable ? (uint8_t)edge : 0;
+}
+
+void Hal_sim_wakeupEdge(bool falling)
+{
+    uint8_t edge = falling ? EXTI_IRQ_FALLING_EDGE : EXTI_IRQ_RISING_EDGE;
+    if ((m_wakeup_edges & edge) && (m_wakeup_cb != NULL))
+    {
+        Hal_sim_usartWakeupEdge();
+        m_wakeup_cb();
+    }
+}
@@ -0,0 +1,30 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/**
+ * \file    mcu.h
+ * \brief   Host replacement of the MCU header, for the host simulator
+ *
+ *          Only the CMSIS helpers used by the libraries are provided. There
+ *          are no interrupts on the host, so they are empty.
+ */
+#ifndef HOST_SIM_MCU_H_
+#define HOST_SIM_MCU_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef __STATIC_INLINE
+#define __STATIC_INLINE     static inline
+#endif
+
+#define __NOP()
+#define __DSB()
+#define __ISB()
+#define __disable_irq()
+#define __enable_irq()
+
+#endif /* HOST_SIM_MCU_H_ */
@@ -0,0 +1,390 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/*
+ * Serial port on a pseudo terminal, see hal_sim.h
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/stat.h>
+
+#include "hal_api.h"
+#include "hal_sim.h"
+#include "sim.h"
+
+/** Size of each transmission buffer, like the DMA driver */
+#define BUFFER_SIZE                     256u
+
+/** Size of the reception buffer, like the DMA driver */
+#define RX_BUFFER_SIZE                  255u
+
+/** Silence, in characters, before received bytes are given to the app */
+#define TIMEOUT_CHAR_N                  5
+
+/** Bits per character: start, 8 data bits and stop */
+#define BITS_PER_CHAR                   10
+
+static int                      m_master = -1;
+/** Slave side kept open, so the master does not hang up between hosts */
+static int                      m_slave = -1;
+static char                     m_link[256];
+static bool                     m_paced;
+
+static uint32_t                 m_baudrate;
+static serial_rx_callback_f     m_rx_callback;
+static bool                     m_rx_enabled;
+static uint32_t                 m_enabled;
+static uint64_t                 m_enabled_since;
+
+/** Transmission buffers: one being filled, one being sent */
+static uint8_t                  m_tx_buffers[2][BUFFER_SIZE];
+static uint8_t                  m_tx_active;
+static uint32_t                 m_tx_index;
+static uint32_t                 m_tx_ongoing_len;
+static bool                     m_tx_ongoing;
+
+/** Bytes read from the host, being transferred */
+static uint8_t                  m_rx_buffer[RX_BUFFER_SIZE];
+static uint32_t                 m_rx_len;
+/** First byte not given to the application yet */
+static uint32_t                 m_rx_pos;
+
+static hal_sim_usart_stats_t    m_stats;
+
+/** Time to transfer num_bytes at the current baudrate */
+static uint64_t transfer_time_us(uint32_t num_bytes)
+{
+    if (!m_paced || (m_baudrate == 0))
+    {
+        return 0;
+    }
+    return (uint64_t)num_bytes * BITS_PER_CHAR * 1000000u / m_baudrate;
+}
+
+static void start_tx(void);
+
+static void tx_end(void * arg)
+{
+    (void)arg;
+    const uint8_t * bytes = m_tx_buffers[m_tx_active ^ 1];
+    ssize_t written = write(m_master, bytes, m_tx_ongoing_len);
+    if (written < 0)
+    {
+        written = 0;
+    }
+    m_stats.tx_bytes += (uint32_t)written;
+    m_stats.tx_lost += m_tx_ongoing_len - (uint32_t)written;
+
+    m_tx_ongoing = false;
+    Usart_setEnabled(false);
+    // Chain the buffer filled meanwhile
+    start_tx();
+}
+
+static void start_tx(void)
+{
+    if (m_tx_ongoing || (m_tx_index == 0))
+    {
+        return;
+    }
+    m_tx_ongoing = true;
+    // The driver enables the UART (and keeps deep sleep off) for the transfer
+    Usart_setEnabled(true);
+    m_tx_ongoing_len = m_tx_index;
+    m_tx_active ^= 1;
+    m_tx_index = 0;
+    Sim_addEvent(transfer_time_us(m_tx_ongoing_len), tx_end, NULL);
+}
+
+static bool receiving(void)
+{
+    return m_rx_enabled && (m_rx_callback != NULL);
+}
+
+/** Receiver off: the byte only toggles the wake-up pin */
+static void lose_byte(void)
+{
+    m_stats.rx_lost++;
+    Hal_sim_wakeupEdge(true);
+    Hal_sim_wakeupEdge(false);
+}
+
+static void rx_done(void)
+{
+    m_rx_len = 0;
+    m_rx_pos = 0;
+    // Ready for more bytes
+    Sim_pollReadable(true);
+}
+
+/** Bytes read from the host have been transferred */
+static void rx_end(void * arg)
+{
+    (void)arg;
+    uint32_t first = m_rx_pos;
+    for (uint32_t i = m_rx_pos; i < m_rx_len; i++)
+    {
+        if (receiving())
+        {
+            continue;
+        }
+        // Receiver turned off by a frame: give the bytes received so far
+        if ((i > first) && (m_rx_callback != NULL))
+        {
+            m_rx_callback(&m_rx_buffer[first], i - first);
+            m_stats.rx_bytes += i - first;
+        }
+        lose_byte();
+        first = i + 1;
+    }
+    if ((m_rx_len > first) && (m_rx_callback != NULL))
+    {
+        m_rx_callback(&m_rx_buffer[first], m_rx_len - first);
+        m_stats.rx_bytes += m_rx_len - first;
+    }
+    rx_done();
+}
+
+/** A byte reaches the receiver: bytes are lost one by one while it is off,
+ *  then the rest of them is transferred */
+static void rx_byte(void * arg)
+{
+    (void)arg;
+    while ((m_rx_pos < m_rx_len) && !receiving())
+    {
+        lose_byte();
+        m_rx_pos++;
+        if (m_paced && (m_rx_pos < m_rx_len))
+        {
+            // Next byte one character later, the UART may be on by then
+            Sim_addEvent(transfer_time_us(1), rx_byte, NULL);
+            return;
+        }
+    }
+    if (m_rx_pos == m_rx_len)
+    {
+        rx_done();
+        return;
+    }
+    uint64_t delay = transfer_time_us(m_rx_len - m_rx_pos - 1);
+    if (m_paced)
+    {
+        delay += transfer_time_us(TIMEOUT_CHAR_N);
+    }
+    Sim_addEvent(delay, rx_end, NULL);
+}
+
+static void master_readable(int fd)
+{
+    ssize_t len = read(fd, m_rx_buffer, sizeof(m_rx_buffer));
+    if (len <= 0)
+    {
+        return;
+    }
+    m_rx_len = (uint32_t)len;
+    m_rx_pos = 0;
+    // Next bytes stay in the pseudo terminal until these are transferred
+    Sim_pollReadable(false);
+    Sim_addEvent(transfer_time_us(1), rx_byte, NULL);
+}
+
+bool Hal_sim_usartOpen(const char * link, bool paced)
+{
+    struct termios tio;
+
+    m_paced = paced;
+    m_master = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((m_master < 0) || (grantpt(m_master) != 0) ||
+        (unlockpt(m_master) != 0))
+    {
+        perror("posix_openpt");
+        return false;
+    }
+    const char * name = ptsname(m_master);
+    m_slave = open(name, O_RDWR | O_NOCTTY);
+    if (m_slave < 0)
+    {
+        perror(name);
+        return false;
+    }
+    // Raw bytes, whatever the host configures
+    tcgetattr(m_slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(m_slave, TCSANOW, &tio);
+    tcgetattr(m_master, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(m_master, TCSANOW, &tio);
+    fcntl(m_master, F_SETFL, fcntl(m_master, F_GETFL) | O_NONBLOCK);
+
+    printf("Serial port: %s\n", name);
+    if (link != NULL)
+    {
+        struct stat st;
+        if ((lstat(link, &st) == 0) && S_ISLNK(st.st_mode))
+        {
+            unlink(link);
+        }
+        if (symlink(name, link) != 0)
+        {
+            perror(link);
+            return false;
+        }
+        snprintf(m_link, sizeof(m_link), "%s", link);
+        printf("Serial port link: %s\n", link);
+    }
+    fflush(stdout);
+
+    Sim_setReadable(m_master, master_readable);
+    return true;
+}
+
+void Hal_sim_usartClose(void)
+{
+    if (m_link[0] != '\0')
+    {
+        unlink(m_link);
+        m_link[0] = '\0';
+    }
+    Sim_setReadable(-1, NULL);
+    if (m_slave >= 0)
+    {
+        close(m_slave);
+        m_slave = -1;
+    }
+    if (m_master >= 0)
+    {
+        close(m_master);
+        m_master = -1;
+    }
+}
+
+void Hal_sim_usartGetStats(hal_sim_usart_stats_t * stats)
+{
+    *stats = m_stats;
+    if (m_enabled > 0)
+    {
+        stats->enabled_us += Sim_now() - m_enabled_since;
+    }
+}
+
+void Hal_sim_usartIrqAsserted(void)
+{
+    m_stats.irq_asserted++;
+}
+
+void Hal_sim_usartWakeupEdge(void)
+{
+    m_stats.wakeup_edges++;
+}
+
+bool Usart_init(uint32_t baudrate, uart_flow_control_e flow_control)
+{
+    (void)flow_control;
+    m_baudrate = baudrate;
+    m_enabled = 0;
+    m_rx_enabled = false;
+    m_rx_callback = NULL;
+    switch (baudrate)
+    {
+        case 9600:
+        case 19200:
+        case 38400:
+        case 57600:
+        case 115200:
+        case 125000:
+        case 230400:
+        case 250000:
+        case 460800:
+        case 921600:
+        case 1000000:
+            return true;
+        default:
+            // Keeps working, like the real driver at its default speed
+            m_baudrate = 115200;
+            return false;
+    }
+}
+
+void Usart_setEnabled(bool enabled)
+{
+    if (enabled)
+    {
+        if (m_enabled == 0)
+        {
+            DS_Disable(DS_SOURCE_USART);
+            m_enabled_since = Sim_now();
+        }
+        m_enabled++;
+    }
+    else
+    {
+        if (m_enabled > 0)
+        {
+            m_enabled--;
+            if (m_enabled == 0)
+            {
+                m_stats.enabled_us += Sim_now() - m_enabled_since;
+                DS_Enable(DS_SOURCE_USART);
+            }
+        }
+    }
+}
+
+void Usart_receiverOn(void)
+{
+    m_rx_enabled = true;
+}
+
+void Usart_receiverOff(void)
+{
+    m_rx_enabled = false;
+}
+
+bool Usart_setFlowControl(uart_flow_control_e flow)
+{
+    // No flow control on a pseudo terminal, the pacing is enough
+    return (m_enabled == 0) && (flow == UART_FLOW_CONTROL_NONE);
+}
+
+uint32_t Usart_sendBuffer(const void * buffer, uint32_t length)
+{
+    if (BUFFER_SIZE - m_tx_index < length)
+    {
+        m_stats.tx_refused++;
+        return 0;
+    }
+    memcpy(&m_tx_buffers[m_tx_active][m_tx_index], buffer, length);
+    m_tx_index += length;
+    start_tx();
+    return length;
+}
+
+void Usart_enableReceiver(serial_rx_callback_f callback)
+{
+    m_rx_callback = callback;
+}
+
+uint32_t Usart_getMTUSize(void)
+{
+    return BUFFER_SIZE;
+}
+
+void Usart_flush(void)
+{
+    // The real driver busy waits: end the transfers now
+    while (m_tx_ongoing)
+    {
+        Sim_cancelEvent(tx_end);
+        tx_end(NULL);
+    }
+}
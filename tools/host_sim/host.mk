@@ -0,0 +1,57 @@
+# Common part of the host builds, included by the tool makefiles once they
+# have selected their libraries (like an application makefile does)
+
+SDK_PATH := ../../
+API_PATH := $(SDK_PATH)api/
+UTIL_PATH := $(SDK_PATH)util/
+HAL_API_PATH := $(SDK_PATH)mcu/hal_api/
+WP_LIB_PATH := $(SDK_PATH)libraries/
+
+
+BUILDPREFIX ?= build/$(TOOL)/
+
+# No MCU: drivers are in hal/
+MCU := host
+
+CC ?= gcc
+CFLAGS += -std=gnu99 -Wall -Wextra -g -O2
+CFLAGS += -Wno-unused-parameter -Wno-sign-compare -Wno-missing-field-initializers
+# Enums sized like with arm-none-eabi: some are fields of packed frames
+CFLAGS += -fshort-enums
+LDFLAGS +=
+
+# Libraries selected by the tool
+-include $(WP_LIB_PATH)config.mk
+-include $(UTIL_PATH)makefile
+-include $(WP_LIB_PATH)makefile
+INCLUDES += -I$(WP_LIB_PATH)
+
+# Simulated stack and host drivers
+SRCS += sim/sim.c \
+        sim/sim_data.c \
+        sim/sim_otap.c \
+        sim/sim_state.c \
+        sim/sim_system.c \
+        sim/sim_misc.c \
+        $(SDK_PATH)mcu/nrf/common/hal/ds.c
+INCLUDES += -Ihal -Isim
+INCLUDES += -I$(API_PATH) -I$(UTIL_PATH) -I$(HAL_API_PATH)
+
+# Sources a tool compiles itself, for example to include them
+SRCS := $(filter-out $(EXCLUDED_SRCS),$(SRCS))
+
+OBJS = $(addprefix $(BUILDPREFIX), $(patsubst $(SDK_PATH)%,sdk/%,$(SRCS:.c=.o)))
+DEPS = $(OBJS:.o=.d)
+
+$(BUILDPREFIX)sdk/%.o: $(SDK_PATH)%.c
+	@mkdir -p $(@D)
+	$(CC) $(INCLUDES) $(CFLAGS) -MMD -MP -c $< -o $@
+
+$(BUILDPREFIX)%.o: %.c
+	@mkdir -p $(@D)
+	$(CC) $(INCLUDES) $(CFLAGS) -MMD -MP -c $< -o $@
+
+$(TOOL): $(OBJS)
+	$(CC) $(CFLAGS) -o $@ $^ $(LDFLAGS)
+
+-include $(DEPS)
@@ -0,0 +1,707 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/*
+ * Measurement table of the positioning library on the host
+ *
+ * Replays the anchors of a poslib_sim trace (see poslib_sim.c) as scans of
+ * beacons given straight to the measurement table of poslib_measurement.c,
+ * and to the linear table it replaced, and reports the CPU time of both per
+ * update. Before each beacon, the beacons not heard for -a seconds are
+ * removed (clean_beacon, like during an opportunistic scan).
+ *
+ * A first, untimed pass checks the table after each beacon (address index,
+ * rss heap and age list) and counts the paths taken.
+ */
+
+// Static functions of the table, with its optional clean-up
+#define POSLIB_CLEANBEACON_USE
+#include "poslib/poslib_measurement.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "sim.h"
+
+/** Maximum number of anchors heard at the same time */
+#define MAX_ANCHORS             32
+
+/** Maximum beacons received from each anchor during a scan */
+#define MAX_BEACONS_PER_SCAN    8
+
+typedef struct
+{
+    app_addr_t  address;
+    int8_t      rss;
+    int8_t      txpower;
+} anchor_t;
+
+typedef struct
+{
+    /** Arrival time from the scan start, in microseconds */
+    uint32_t                time_us;
+    poslib_meas_wm_beacon_t beacon;
+} scan_beacon_t;
+
+/** Linear table of the SDK before the address index and rss heap */
+typedef struct
+{
+    poslib_meas_wm_beacon_t beacons[MAX_BEACONS];
+    uint8_t num_beacons;
+    uint8_t min_index;
+    int16_t min_rss;
+} linear_table_t;
+
+/** Paths taken in the table, counted during the checked pass */
+typedef struct
+{
+    uint32_t    beacons;
+    uint32_t    updated;
+    uint32_t    appended;
+    uint32_t    replaced;
+    uint32_t    rejected;
+    uint32_t    removed;
+    uint32_t    index_shifts;
+    uint32_t    sift_downs;
+} table_counters_t;
+
+static FILE *               m_trace;
+static const char *         m_trace_name;
+static uint32_t             m_line;
+static char                 m_command[256];
+static uint64_t             m_command_time;
+static bool                 m_trace_end;
+
+static anchor_t             m_anchors[MAX_ANCHORS];
+static uint32_t             m_num_anchors;
+static uint32_t             m_max_anchors;
+
+static scan_beacon_t        m_beacons[MAX_ANCHORS * MAX_BEACONS_PER_SCAN];
+static uint32_t             m_num_beacons;
+static uint32_t             m_beacons_per_scan = 4;
+static uint32_t             m_scan_ms = 5000;
+static uint32_t             m_period_s = 10;
+static uint32_t             m_age_s = 2;
+static uint32_t             m_repeats = 20;
+static double               m_noise_db = 2.0;
+static uint32_t             m_random = 1;
+
+static linear_table_t       m_linear;
+static table_counters_t     m_counters;
+
+static void trace_error(const char * msg)
+{
+    fprintf(stderr, "%s:%u: %s\n", m_trace_name, m_line, msg);
+    exit(EXIT_FAILURE);
+}
+
+/** Random numbers of the harness, independent of the SDK code */
+static uint32_t random_u32(void)
+{
+    // xorshift32
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+}
+
+static double random_uniform(void)
+{
+    return (random_u32() + 0.5) / 4294967296.0;
+}
+
+static double random_normal(void)
+{
+    // Box-Muller
+    return sqrt(-2.0 * log(random_uniform())) *
+           cos(2.0 * M_PI * random_uniform());
+}
+
+static uint64_t thread_cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/*
+ * Trace, only its anchor commands are used
+ */
+
+/** Read the next command of the trace, false at the end of the trace */
+static bool read_command(void)
+{
+    char line[256];
+
+    while (fgets(line, sizeof(line), m_trace) != NULL)
+    {
+        m_line++;
+        char * comment = strchr(line, '#');
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+        char * end;
+        double time_s = strtod(line, &end);
+        while ((*end == ' ') || (*end == '\t'))
+        {
+            end++;
+        }
+        end[strcspn(end, "\r\n")] = '\0';
+        if (*end == '\0')
+        {
+            // Empty line
+            continue;
+        }
+        if ((end == line) || (time_s * 1e6 < m_command_time))
+        {
+            trace_error("time missing or going backwards");
+        }
+        m_command_time = (uint64_t)(time_s * 1e6);
+        snprintf(m_command, sizeof(m_command), "%s", end);
+        return true;
+    }
+    return false;
+}
+
+static void command_anchor(char * args)
+{
+    char * address_arg = strtok(args, " \t");
+    char * rss_arg = strtok(NULL, " \t");
+    char * txpower_arg = strtok(NULL, " \t");
+    uint32_t i;
+
+    if ((address_arg == NULL) || (rss_arg == NULL))
+    {
+        trace_error("anchor <address> <rss>|off [<tx power>]");
+    }
+    app_addr_t address = strtoul(address_arg, NULL, 0);
+    for (i = 0; i < m_num_anchors; i++)
+    {
+        if (m_anchors[i].address == address)
+        {
+            break;
+        }
+    }
+
+    if (strcmp(rss_arg, "off") == 0)
+    {
+        if (i < m_num_anchors)
+        {
+            m_anchors[i] = m_anchors[--m_num_anchors];
+        }
+        return;
+    }
+    if (i == m_num_anchors)
+    {
+        if (m_num_anchors == MAX_ANCHORS)
+        {
+            trace_error("too many anchors heard");
+        }
+        m_num_anchors++;
+        if (m_num_anchors > m_max_anchors)
+        {
+            m_max_anchors = m_num_anchors;
+        }
+    }
+    m_anchors[i].address = address;
+    m_anchors[i].rss = strtol(rss_arg, NULL, 0);
+    m_anchors[i].txpower = (txpower_arg != NULL) ?
+                            strtol(txpower_arg, NULL, 0) : 8;
+}
+
+/** Run the commands of the trace up to the given time */
+static void run_commands(uint64_t now_us)
+{
+    while (!m_trace_end && (m_command_time <= now_us))
+    {
+        char * args = m_command + strcspn(m_command, " \t");
+        if (*args != '\0')
+        {
+            *args++ = '\0';
+        }
+
+        if (strcmp(m_command, "anchor") == 0)
+        {
+            command_anchor(args);
+        }
+        else if (strcmp(m_command, "end") == 0)
+        {
+            m_trace_end = true;
+            return;
+        }
+        else if ((strcmp(m_command, "motion") != 0) &&
+                 (strcmp(m_command, "set") != 0))
+        {
+            trace_error("unknown command");
+        }
+        m_trace_end = !read_command();
+    }
+}
+
+/*
+ * Beacons of a scan
+ */
+
+static int compare_beacons(const void * a, const void * b)
+{
+    uint32_t time_a = ((const scan_beacon_t *)a)->time_us;
+    uint32_t time_b = ((const scan_beacon_t *)b)->time_us;
+    return (time_a > time_b) - (time_a < time_b);
+}
+
+/** Each anchor heard sends its beacons at random times during the scan */
+static void plan_scan(void)
+{
+    m_num_beacons = 0;
+    for (uint32_t i = 0; i < m_num_anchors; i++)
+    {
+        for (uint32_t n = 0; n < m_beacons_per_scan; n++)
+        {
+            double rss = m_anchors[i].rss + m_noise_db * random_normal();
+            rss = (rss < -127) ? -127 : ((rss > 0) ? 0 : rss);
+            m_beacons[m_num_beacons++] = (scan_beacon_t) {
+                .time_us = (uint32_t)(random_uniform() * m_scan_ms * 1000u),
+                .beacon = {
+                    .address = m_anchors[i].address,
+                    .norm_rss = (int16_t)lround(rss) - m_anchors[i].txpower,
+                    .txpower = m_anchors[i].txpower,
+                    .type = POSLIB_MEAS_BEACON_TYPE_NB,
+                    .samples = 1,
+                },
+            };
+        }
+    }
+    qsort(m_beacons, m_num_beacons, sizeof(m_beacons[0]), compare_beacons);
+}
+
+/*
+ * Linear table, as in the SDK before the address index
+ */
+
+static void linear_update_min(void)
+{
+    m_linear.min_rss = 0; // forces a minimum refresh
+
+    for (uint8_t i = 0; i < m_linear.num_beacons; i++)
+    {
+        if (m_linear.beacons[i].norm_rss < m_linear.min_rss)
+        {
+            m_linear.min_index = i;
+            m_linear.min_rss = m_linear.beacons[i].norm_rss;
+        }
+    }
+}
+
+static void linear_clean(uint32_t older_than)
+{
+    app_lib_time_timestamp_hp_t now = lib_time->getTimestampHp();
+    uint8_t head = 0;
+
+    // keeps recent beacons, moving them up the table
+    for (uint8_t i = 0; i < m_linear.num_beacons; i++)
+    {
+        if ((lib_time->getTimeDiffUs(now, m_linear.beacons[i].last_update) /
+                1000000) >= older_than)
+        {
+            continue;
+        }
+        if (i != head)
+        {
+            memcpy(&m_linear.beacons[head],
+                   &m_linear.beacons[i],
+                   sizeof(poslib_meas_wm_beacon_t));
+        }
+        head++;
+    }
+    m_linear.num_beacons = head;
+}
+
+static void linear_insert(const poslib_meas_wm_beacon_t * beacon)
+{
+    uint8_t insert_idx = MAX_BEACONS;
+    poslib_meas_wm_beacon_t * bcn;
+
+    for (uint8_t i = 0; i < m_linear.num_beacons; i++)
+    {
+        if (m_linear.beacons[i].address == beacon->address)
+        {
+            insert_idx = i;
+            break;
+        }
+    }
+
+    if (insert_idx == MAX_BEACONS)
+    {
+        if (m_linear.num_beacons == MAX_BEACONS) // no space
+        {
+            linear_update_min();
+            if (beacon->norm_rss <= m_linear.min_rss)
+            {
+                return;
+            }
+            insert_idx = m_linear.min_index;
+        }
+        else
+        {
+            insert_idx = m_linear.num_beacons++;
+        }
+        m_linear.beacons[insert_idx].samples = 0;
+    }
+
+    // same filtering as the indexed table, only the lookups differ
+    bcn = &m_linear.beacons[insert_idx];
+    if (bcn->samples < MAX_FLT_SAMPLES)
+    {
+        bcn->samples++;
+    }
+    bcn->address = beacon->address;
+    bcn->txpower = beacon->txpower;
+    bcn->last_update = lib_time->getTimestampHp();
+    if (bcn->samples > 1)
+    {
+        bcn->type = POSLIB_MEAS_BEACON_TYPE_FLT;
+        bcn->norm_rss = PosLibFilter_update(&bcn->filter, beacon->norm_rss);
+    }
+    else
+    {
+        bcn->type = beacon->type;
+        bcn->norm_rss = beacon->norm_rss;
+        PosLibFilter_init(&bcn->filter, beacon->norm_rss);
+    }
+}
+
+/*
+ * Indexed table checks
+ */
+
+static void check_failed(const char * msg, uint32_t beacon)
+{
+    fprintf(stderr, "table check failed at beacon %u: %s\n", beacon, msg);
+    exit(EXIT_FAILURE);
+}
+
+/** Address index, rss heap and age list against the packed table */
+static void check_table(uint32_t beacon)
+{
+    uint8_t num = m_meas_table.num_beacons;
+    uint32_t indexed = 0;
+    uint32_t aged = 0;
+
+    if (num > MAX_BEACONS)
+    {
+        check_failed("too many beacons", beacon);
+    }
+    for (uint32_t slot = 0; slot < MEAS_INDEX_SIZE; slot++)
+    {
+        indexed += (m_meas_table.index[slot] != MEAS_NONE);
+    }
+    if (indexed != num)
+    {
+        check_failed("index size", beacon);
+    }
+
+    for (uint8_t i = 0; i < num; i++)
+    {
+        const poslib_meas_wm_beacon_t * bcn = &m_meas_table.beacons[i];
+        if (m_meas_table.index[index_find(bcn->address)] != i)
+        {
+            check_failed("address not found in the index", beacon);
+        }
+        if ((bcn->heap_pos >= num) || (m_meas_table.heap[bcn->heap_pos] != i))
+        {
+            check_failed("heap position", beacon);
+        }
+        if ((i > 0) && (heap_rss(i) < heap_rss((i - 1) / 2)))
+        {
+            check_failed("heap order", beacon);
+        }
+    }
+
+    uint8_t previous = MEAS_NONE;
+    for (uint8_t idx = m_meas_table.oldest; idx != MEAS_NONE;
+         idx = m_meas_table.beacons[idx].newer)
+    {
+        const poslib_meas_wm_beacon_t * bcn = &m_meas_table.beacons[idx];
+        if ((idx >= num) || (bcn->older != previous) || (++aged > num))
+        {
+            check_failed("age list links", beacon);
+        }
+        if ((previous != MEAS_NONE) &&
+            lib_time->isHpTimestampBefore(bcn->last_update,
+                    m_meas_table.beacons[previous].last_update))
+        {
+            check_failed("age list order", beacon);
+        }
+        previous = idx;
+    }
+    if ((aged != num) || (m_meas_table.newest != previous))
+    {
+        check_failed("age list size", beacon);
+    }
+}
+
+/** Insert a beacon in the indexed table, counting the paths it takes */
+static void checked_insert(const poslib_meas_wm_beacon_t * beacon)
+{
+    uint8_t num = m_meas_table.num_beacons;
+
+    clean_beacon(m_age_s);
+    m_counters.removed += num - m_meas_table.num_beacons;
+    check_table(m_counters.beacons);
+
+    uint8_t slot = index_find(beacon->address);
+    uint8_t idx = m_meas_table.index[slot];
+    uint8_t heap_pos = 0;
+
+    if (idx != MEAS_NONE)
+    {
+        m_counters.updated++;
+        heap_pos = m_meas_table.beacons[idx].heap_pos;
+    }
+    else if (m_meas_table.num_beacons < MAX_BEACONS)
+    {
+        m_counters.appended++;
+    }
+    else if (beacon->norm_rss <=
+             m_meas_table.beacons[m_meas_table.heap[0]].norm_rss)
+    {
+        m_counters.rejected++;
+    }
+    else
+    {
+        // weakest beacon is replaced, its index entry removed
+        idx = m_meas_table.heap[0];
+        slot = index_find(m_meas_table.beacons[idx].address);
+        m_counters.replaced++;
+        m_counters.index_shifts +=
+            (m_meas_table.index[(slot + 1) & MEAS_INDEX_MASK] != MEAS_NONE);
+    }
+
+    insert_beacon(beacon);
+
+    if ((idx != MEAS_NONE) && (m_meas_table.beacons[idx].heap_pos > heap_pos))
+    {
+        m_counters.sift_downs++;
+    }
+    check_table(m_counters.beacons++);
+}
+
+/*
+ * Updates
+ */
+
+typedef void (*insert_f)(const poslib_meas_wm_beacon_t * beacon);
+
+static void linear_clean_insert(const poslib_meas_wm_beacon_t * beacon)
+{
+    linear_clean(m_age_s);
+    linear_insert(beacon);
+}
+
+static void indexed_clean_insert(const poslib_meas_wm_beacon_t * beacon)
+{
+    clean_beacon(m_age_s);
+    insert_beacon(beacon);
+}
+
+/**
+ * \brief   Give the beacons of the scan to a table, from an empty table
+ *
+ *          Each run of the scan starts at the current simulated time, as
+ *          only the times between beacons matter. The CPU time includes
+ *          moving the simulated time, a few ns per beacon.
+ * \return  CPU time, in nanoseconds
+ */
+static uint64_t run_scan(insert_f insert)
+{
+    uint64_t scan_start_us = Sim_now();
+    uint64_t start_ns = thread_cpu_ns();
+
+    reset_table();
+    m_linear.num_beacons = 0;
+    for (uint32_t i = 0; i < m_num_beacons; i++)
+    {
+        Sim_advance(scan_start_us + m_beacons[i].time_us - Sim_now());
+        insert(&m_beacons[i].beacon);
+    }
+    uint64_t cpu_ns = thread_cpu_ns() - start_ns;
+
+    Sim_advance(scan_start_us + m_scan_ms * 1000u - Sim_now());
+    return cpu_ns;
+}
+
+void App_init(const app_global_functions_t * functions)
+{
+    (void)functions;
+}
+
+const void * Sim_openExtraLibrary(uint32_t name, uint32_t version)
+{
+    switch (name)
+    {
+        case APP_LIB_BEACON_TX_NAME:
+            return Sim_beacon_tx_open(version);
+        case APP_LIB_ADVERTISER_NAME:
+            return Sim_advertiser_open(version);
+        default:
+            return NULL;
+    }
+}
+
+static void usage(const char * name)
+{
+    fprintf(stderr,
+        "Usage: %s [options] <trace>\n"
+        "  -k <n>        beacons from each anchor per scan (default 4)\n"
+        "  -S <ms>       scan duration (default 5000)\n"
+        "  -p <s>        update period (default 10)\n"
+        "  -a <s>        remove beacons not heard for <s> s, 0 never "
+        "(default 2)\n"
+        "  -R <n>        timed repeats of each scan (default 20)\n"
+        "  -n <dB>       rss noise standard deviation (default 2)\n"
+        "  -s <seed>     seed of the rss noise and beacon times\n",
+        name);
+}
+
+int main(int argc, char * argv[])
+{
+    sim_config_t config = SIM_CONFIG_DEFAULT;
+    uint64_t linear_ns = 0;
+    uint64_t indexed_ns = 0;
+    uint32_t updates = 0;
+    uint32_t beacons = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:S:p:a:R:n:s:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'k':
+                m_beacons_per_scan = strtoul(optarg, NULL, 0);
+                if (m_beacons_per_scan > MAX_BEACONS_PER_SCAN)
+                {
+                    m_beacons_per_scan = MAX_BEACONS_PER_SCAN;
+                }
+                break;
+            case 'S':
+                m_scan_ms = strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                m_period_s = strtoul(optarg, NULL, 0);
+                break;
+            case 'a':
+                m_age_s = strtoul(optarg, NULL, 0);
+                break;
+            case 'R':
+                m_repeats = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                m_noise_db = strtod(optarg, NULL);
+                break;
+            case 's':
+                m_random = strtoul(optarg, NULL, 0);
+                if (m_random == 0)
+                {
+                    // Not a valid xorshift state
+                    m_random = 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((optind != argc - 1) || (m_period_s == 0) || (m_repeats == 0) ||
+        ((uint64_t)m_scan_ms > m_period_s * 1000ull))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (m_age_s == 0)
+    {
+        // clean_beacon() would empty the table
+        m_age_s = UINT32_MAX;
+    }
+
+    m_trace_name = argv[optind];
+    m_trace = fopen(m_trace_name, "r");
+    if (m_trace == NULL)
+    {
+        perror(m_trace_name);
+        return EXIT_FAILURE;
+    }
+
+    // Opens the libraries for the table (lib_time), time then only moves
+    // with Sim_advance(). The trace time is kept apart.
+    Sim_init(true, &config);
+    Sim_start();
+    m_trace_end = !read_command();
+
+    for (uint64_t start_us = 0; !m_trace_end;
+         start_us += m_period_s * 1000000ull)
+    {
+        run_commands(start_us);
+        if (m_trace_end)
+        {
+            break;
+        }
+        plan_scan();
+
+        // Checked pass first, then timed passes
+        run_scan(checked_insert);
+        for (uint32_t repeat = 0; repeat < m_repeats; repeat++)
+        {
+            linear_ns += run_scan(linear_clean_insert);
+            indexed_ns += run_scan(indexed_clean_insert);
+        }
+        updates++;
+        beacons += m_num_beacons;
+    }
+
+    double runs = (double)updates * m_repeats;
+    printf("--- poslib_meas_bench report ---\n");
+    printf("trace:           %s, %.1f s, %u anchors at most, "
+           "table of %u beacons\n",
+           m_trace_name, m_command_time / 1e6, m_max_anchors, MAX_BEACONS);
+    printf("updates:         %u, every %u s, scan %u ms, %u beacons per "
+           "anchor, %.1f beacons per update\n",
+           updates, m_period_s, m_scan_ms, m_beacons_per_scan,
+           updates > 0 ? (double)beacons / updates : 0.0);
+    if (m_age_s == UINT32_MAX)
+    {
+        printf("clean-up:        off\n");
+    }
+    else
+    {
+        printf("clean-up:        beacons not heard for %u s\n", m_age_s);
+    }
+    printf("table paths:     %u updated, %u appended, %u replaced, "
+           "%u rejected, %u removed\n",
+           m_counters.updated, m_counters.appended, m_counters.replaced,
+           m_counters.rejected, m_counters.removed);
+    printf("index and heap:  %u replacements shifting the index back, "
+           "%u heap sift-downs\n",
+           m_counters.index_shifts, m_counters.sift_downs);
+    printf("table checks:    %u beacons, index, heap and age list ok\n",
+           m_counters.beacons);
+    if (runs > 0)
+    {
+        printf("cpu per update:  before (linear) %.2f us, "
+               "after (index + heap) %.2f us, %.2fx\n",
+               linear_ns / runs / 1e3, indexed_ns / runs / 1e3,
+               indexed_ns > 0 ? (double)linear_ns / indexed_ns : 0.0);
+        printf("cpu per beacon:  before (linear) %.1f ns, "
+               "after (index + heap) %.1f ns\n",
+               linear_ns / (runs * beacons / updates),
+               indexed_ns / (runs * beacons / updates));
+    }
+    fclose(m_trace);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,18 @@
+# Measurement table of the positioning library on the host, see Readme.md
+
+TOOL := poslib_meas_bench
+
+# Same libraries as poslib_sim
+POSITIONING=yes
+APP_SCHEDULER=yes
+APP_SCHEDULER_TASKS=1
+
+LDFLAGS += -lm
+
+# Included by the benchmark for its static functions
+EXCLUDED_SRCS += %/poslib_measurement.c
+
+SRCS += poslib_meas_bench.c \
+        sim/sim_beacon.c
+
+include host.mk
@@ -0,0 +1,1587 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/*
+ * Positioning library (libraries/positioning) on the host, in virtual time
+ *
+ * Replays a trace of the radio environment of a tag (anchors heard and their
+ * rss, motion, settings changes) against the simulated stack libraries of
+ * sim/, much faster than real time, and reports the cost of the updates: CPU
+ * time, payload bytes, radio-on time and state machine timings.
+ *
+ * Trace format, one command per line, '#' starts a comment, times are in
+ * seconds from the start and never decrease:
+ *
+ *   <t> anchor <address> <rss dBm> [<tx power dBm>]   anchor heard from t
+ *   <t> anchor <address> off                           no longer heard
+ *   <t> motion static|dynamic                          PosLib_motion()
+ *   <t> set <setting> <value>                          PosLib_setConfig()
+ *   <t> expect full                                    beacons changed at t
+ *   <t> end                                            end of the trace
+ *
+ * With the adaptive scan, a motion or settings change must be followed by a
+ * full scan at the next update. After an "expect full", scans may still be
+ * skipped, but the first short scan must see the change and be followed by a
+ * full scan.
+ *
+ * With -N, the trace is replayed by that many anchors powered on at the same
+ * time, one process each, and the overlaps of their mini-beacons are counted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "sim.h"
+#include "poslib.h"
+#include "poslib/poslib_measurement.h"
+
+/** Maximum number of anchors heard at the same time */
+#define MAX_ANCHORS             32
+
+/** Maximum beacons received from each anchor during a scan */
+#define MAX_BEACONS_PER_SCAN    4
+
+/** Updates kept for the percentiles */
+#define MAX_UPDATES             8192
+
+/** Mini-beacon intervals kept for their distribution */
+#define MAX_MBCN_INTERVALS      32768
+
+/** Bins of the mini-beacon interval histogram, over the jitter range */
+#define MBCN_BINS               10
+
+/** Chi-square exceeded with a probability of 0.001, for MBCN_BINS - 1
+ *  degrees of freedom */
+#define MBCN_CHI2_LIMIT         27.88
+
+/** Fewest intervals for the chi-square test, 5 per bin */
+#define MBCN_MIN_INTERVALS      (5 * MBCN_BINS)
+
+/** Duration of the stack default scan, in milliseconds */
+#define SCAN_DURATION_MS        1000
+
+/** Maximum number of anchors of the collision runs */
+#define MAX_COLLISION_ANCHORS   64
+
+/** Radio headers and acknowledgement of a data packet, in bytes */
+#define DATA_OVERHEAD_BYTES     20
+
+/** Data rate of the radio, in bits per microsecond */
+#define RADIO_BITS_PER_US       1
+
+typedef struct
+{
+    app_addr_t  address;
+    int8_t      rss;
+    int8_t      txpower;
+} anchor_t;
+
+typedef struct
+{
+    /** Arrival time from the scan start, in microseconds */
+    uint32_t                    time_us;
+    app_lib_state_beacon_rx_t   beacon;
+} scan_beacon_t;
+
+/** Error of rss values against the rss of the trace, in dB */
+typedef struct
+{
+    uint32_t    count;
+    double      sum;
+    double      sum_squares;
+    double      max;
+} rss_error_t;
+
+typedef struct
+{
+    /** Time from the previous update start */
+    uint32_t    interval_ms;
+    uint32_t    scan_ms;
+    uint32_t    send_ms;
+    uint32_t    update_ms;
+} update_t;
+
+/** Pending check of the adaptive scan, by increasing strength */
+typedef enum
+{
+    CHECK_NONE,
+    /** Beacons changed: a full scan, or a short scan and then a full scan,
+     *  after at most max_skipped skipped scans */
+    CHECK_CHANGE,
+    /** Change seen by a short scan: the next update is a full scan */
+    CHECK_CHANGE_SEEN,
+    /** Motion or settings changed: the next update is a full scan */
+    CHECK_NEXT_FULL,
+} adaptive_check_e;
+
+/** Mini-beacon of a collision run */
+typedef struct
+{
+    uint64_t    start_us;
+    uint32_t    airtime_us;
+    uint32_t    anchor;
+} mbcn_tx_t;
+
+static FILE *               m_trace;
+static const char *         m_trace_name;
+static uint32_t             m_line;
+/** Next command of the trace, already read */
+static char                 m_command[256];
+static uint64_t             m_command_time;
+static bool                 m_verbose;
+
+static anchor_t             m_anchors[MAX_ANCHORS];
+static uint32_t             m_num_anchors;
+/** Anchors heard during the last scan, the rss reported comes from them */
+static anchor_t             m_scan_anchors[MAX_ANCHORS];
+static uint32_t             m_num_scan_anchors;
+
+/** Beacons of the ongoing scan, in arrival order */
+static scan_beacon_t        m_beacons[MAX_ANCHORS * MAX_BEACONS_PER_SCAN];
+static uint32_t             m_num_beacons;
+static uint32_t             m_next_beacon;
+static uint32_t             m_beacons_per_scan = 2;
+static double               m_noise_db = 2.0;
+static uint32_t             m_random = 1;
+
+static poslib_settings_t    m_settings;
+
+static update_t             m_updates[MAX_UPDATES];
+static uint32_t             m_num_updates;
+static uint64_t             m_update_start;
+static uint64_t             m_previous_start;
+static bool                 m_update_started;
+static uint32_t             m_updates_without_scan;
+
+/** Motion state of the trace */
+static bool                 m_dynamic;
+/** Rss errors of the reports and of the beacons received, by filter type and
+ *  motion state */
+static rss_error_t          m_report_errors[POSLIB_RSS_FILTER_KALMAN + 1][2];
+static rss_error_t          m_beacon_errors[POSLIB_RSS_FILTER_KALMAN + 1][2];
+static uint32_t             m_reports;
+/** Reported rss of anchors not heard during the last scan */
+static uint32_t             m_stale_rss;
+
+/** Adaptive scan check pending, started at m_check_time by the trace line
+ *  m_check_line */
+static adaptive_check_e     m_check;
+static uint64_t             m_check_time;
+static uint32_t             m_check_line;
+static uint32_t             m_check_skipped;
+static uint32_t             m_checks;
+static uint32_t             m_failed_checks;
+/** Scan counts at the end of the previous update */
+static poslib_scan_stats_t  m_scan_stats;
+
+/** Mini-beacon settings given to PosLib_startPeriodic(), the library only
+ *  applies them when it starts */
+static poslib_mbcn_config_t m_mbcn;
+static uint32_t             m_mbcn_sent;
+static uint64_t             m_mbcn_last;
+static uint32_t             m_mbcn_intervals[MAX_MBCN_INTERVALS];
+static uint32_t             m_num_mbcn_intervals;
+/** Mini-beacons of this anchor for a collision run, NULL otherwise */
+static FILE *               m_mbcn_log;
+
+/** Settings the trace can change */
+typedef enum
+{
+    SETTING_MODE,
+    SETTING_PERIOD,
+    SETTING_DYNAMIC_PERIOD,
+    SETTING_OFFLINE_PERIOD,
+    SETTING_FILTER,
+    SETTING_ADAPTIVE,
+    SETTING_COMPACT,
+    SETTING_BLE,
+    SETTING_BLE_INTERVAL,
+    SETTING_MBCN,
+    SETTING_MBCN_INTERVAL,
+    SETTING_MBCN_JITTER,
+} setting_e;
+
+static const char * const m_setting_names[] =
+{
+    [SETTING_MODE] = "mode",
+    [SETTING_PERIOD] = "period",
+    [SETTING_DYNAMIC_PERIOD] = "dynamic_period",
+    [SETTING_OFFLINE_PERIOD] = "offline_period",
+    [SETTING_FILTER] = "filter",
+    [SETTING_ADAPTIVE] = "adaptive",
+    [SETTING_COMPACT] = "compact",
+    [SETTING_BLE] = "ble",
+    [SETTING_BLE_INTERVAL] = "ble_interval",
+    [SETTING_MBCN] = "mbcn",
+    [SETTING_MBCN_INTERVAL] = "mbcn_interval",
+    [SETTING_MBCN_JITTER] = "mbcn_jitter",
+};
+
+static const char * const m_filter_names[] =
+{
+    [POSLIB_RSS_FILTER_MEAN] = "mean",
+    [POSLIB_RSS_FILTER_EWMA] = "ewma",
+    [POSLIB_RSS_FILTER_MEDIAN] = "median",
+    [POSLIB_RSS_FILTER_KALMAN] = "kalman",
+};
+
+/** Same defaults as source/reference_apps/positioning_app, motion enabled */
+static void default_settings(poslib_settings_t * settings)
+{
+    memset(settings, 0, sizeof(*settings));
+    settings->node_mode = POSLIB_MODE_AUTOSCAN_TAG;
+    settings->node_class = POSLIB_CLASS_A;
+    settings->update_period_static_s = 60;
+    settings->update_period_dynamic_s = 30;
+    settings->update_period_offline_s = 0;
+    settings->ble.type = POSLIB_EDDYSTONE;
+    settings->ble.mode = POSLIB_BLE_OFF;
+    settings->ble.ibeacon.tx_interval_ms = 1000;
+    settings->ble.ibeacon.tx_power = 8;
+    settings->ble.ibeacon.channels = APP_LIB_BEACON_TX_CHANNELS_ALL;
+    settings->ble.eddystone.tx_interval_ms = 1000;
+    settings->ble.eddystone.tx_power = 8;
+    settings->ble.eddystone.channels = APP_LIB_BEACON_TX_CHANNELS_ALL;
+    settings->motion.enabled = true;
+    settings->mbcn.enabled = false;
+    settings->mbcn.tx_interval_ms = 1000;
+    settings->mbcn.tx_jitter_pct = 10;
+    settings->da.follow_network = true;
+    settings->rss_filter.type = POSLIB_RSS_FILTER_MEAN;
+    settings->rss_filter.ewma_alpha_static = 64;
+    settings->rss_filter.ewma_alpha_dynamic = 128;
+    settings->rss_filter.kalman_q_static = 1;
+    settings->rss_filter.kalman_q_dynamic = 8;
+    settings->rss_filter.kalman_r = 16;
+    settings->report.rss_step = 2;
+    settings->adaptive_scan.short_scan_ms = 300;
+    settings->adaptive_scan.max_skipped = 3;
+    settings->adaptive_scan.rss_threshold_db = 6;
+}
+
+static void trace_error(const char * msg)
+{
+    fprintf(stderr, "%s:%u: %s\n", m_trace_name, m_line, msg);
+    exit(EXIT_FAILURE);
+}
+
+/** Random numbers of the harness, independent of the SDK code */
+static uint32_t random_u32(void)
+{
+    // xorshift32
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+}
+
+static double random_uniform(void)
+{
+    return (random_u32() + 0.5) / 4294967296.0;
+}
+
+static double random_normal(void)
+{
+    // Box-Muller
+    return sqrt(-2.0 * log(random_uniform())) *
+           cos(2.0 * M_PI * random_uniform());
+}
+
+/** Anchor heard during the last scan, NULL if none */
+static const anchor_t * find_scan_anchor(app_addr_t address)
+{
+    for (uint32_t i = 0; i < m_num_scan_anchors; i++)
+    {
+        if (m_scan_anchors[i].address == address)
+        {
+            return &m_scan_anchors[i];
+        }
+    }
+    return NULL;
+}
+
+/** Add the error of a normalized rss (rss - tx power) of an anchor */
+static void add_rss_error(rss_error_t * errors,
+                          const anchor_t * anchor,
+                          double norm_rss)
+{
+    double error = norm_rss - (anchor->rss - anchor->txpower);
+    errors->count++;
+    errors->sum += error;
+    errors->sum_squares += error * error;
+    if (fabs(error) > errors->max)
+    {
+        errors->max = fabs(error);
+    }
+}
+
+/*
+ * Adaptive scan checks
+ */
+
+/** Scans are only shortened or skipped by autoscan and DA tags */
+static bool is_adaptive_scan_mode(void)
+{
+    return m_settings.adaptive_scan.enabled &&
+           ((m_settings.node_mode == POSLIB_MODE_AUTOSCAN_TAG) ||
+            (m_settings.node_mode == POSLIB_MODE_DA_TAG));
+}
+
+/** A stronger check replaces the pending one, from now */
+static void start_check(adaptive_check_e check)
+{
+    if (!is_adaptive_scan_mode() || (check <= m_check))
+    {
+        return;
+    }
+    m_check = check;
+    m_check_time = Sim_now();
+    m_check_line = m_line;
+    m_check_skipped = 0;
+}
+
+/**
+ * \brief   Check the scan of an update against the pending check
+ * \param   start
+ *          Start of the update, those started before the check are ignored
+ */
+static void check_update(uint64_t start)
+{
+    poslib_scan_stats_t stats;
+    const char * type;
+
+    PosLib_getScanStats(&stats);
+    bool full = stats.full_scans != m_scan_stats.full_scans;
+    bool short_scan = stats.short_scans != m_scan_stats.short_scans;
+    m_scan_stats = stats;
+    type = short_scan ? "short" : (full ? "full" : "skipped");
+    if (m_verbose)
+    {
+        printf("%10.3f s: %s scan\n", start / 1e6, type);
+    }
+
+    if ((m_check == CHECK_NONE) || (start < m_check_time))
+    {
+        return;
+    }
+    if (!is_adaptive_scan_mode())
+    {
+        // Turned off by the trace, all scans are full ones
+        m_check = CHECK_NONE;
+        return;
+    }
+    if ((m_check == CHECK_CHANGE) && !full)
+    {
+        if (short_scan)
+        {
+            m_check = CHECK_CHANGE_SEEN;
+            return;
+        }
+        if (++m_check_skipped <= m_settings.adaptive_scan.max_skipped)
+        {
+            return;
+        }
+    }
+
+    m_checks++;
+    if (short_scan || !full)
+    {
+        m_failed_checks++;
+        fprintf(stderr, "%s:%u: %s scan at %.3f s, not a full one\n",
+                m_trace_name, m_check_line, type, start / 1e6);
+    }
+    m_check = CHECK_NONE;
+}
+
+/*
+ * Beacons received during the scans
+ */
+
+static void deliver_beacon(void * arg)
+{
+    (void)arg;
+    const scan_beacon_t * beacon = &m_beacons[m_next_beacon++];
+    const anchor_t * anchor = find_scan_anchor(beacon->beacon.address);
+    if (anchor != NULL)
+    {
+        add_rss_error(&m_beacon_errors[m_settings.rss_filter.type][m_dynamic],
+                      anchor,
+                      beacon->beacon.rssi - beacon->beacon.txpower);
+    }
+    Sim_state_receiveBeacon(&beacon->beacon);
+    if (m_next_beacon < m_num_beacons)
+    {
+        Sim_addEvent(m_beacons[m_next_beacon].time_us - beacon->time_us,
+                     deliver_beacon,
+                     NULL);
+    }
+}
+
+static int compare_beacons(const void * a, const void * b)
+{
+    uint32_t time_a = ((const scan_beacon_t *)a)->time_us;
+    uint32_t time_b = ((const scan_beacon_t *)b)->time_us;
+    return (time_a > time_b) - (time_a < time_b);
+}
+
+/** Each anchor heard sends its beacons at random times during the scan */
+static void on_scan_start(uint32_t duration_us)
+{
+    Sim_cancelEvent(deliver_beacon);
+    memcpy(m_scan_anchors, m_anchors, sizeof(m_anchors));
+    m_num_scan_anchors = m_num_anchors;
+    m_num_beacons = 0;
+    m_next_beacon = 0;
+    for (uint32_t i = 0; i < m_num_anchors; i++)
+    {
+        for (uint32_t n = 0; n < m_beacons_per_scan; n++)
+        {
+            double rss = m_anchors[i].rss + m_noise_db * random_normal();
+            rss = (rss < -127) ? -127 : ((rss > 0) ? 0 : rss);
+            m_beacons[m_num_beacons++] = (scan_beacon_t) {
+                .time_us = (uint32_t)(random_uniform() * duration_us),
+                .beacon = {
+                    .address = m_anchors[i].address,
+                    .rssi = (int8_t)lround(rss),
+                    .txpower = m_anchors[i].txpower,
+                    .is_sink = false,
+                    .is_ll = true,
+                    .cost = 1,
+                    .type = APP_LIB_STATE_BEACON_TYPE_NB,
+                    .is_da_support = false,
+                },
+            };
+        }
+    }
+    if (m_num_beacons > 0)
+    {
+        qsort(m_beacons, m_num_beacons, sizeof(m_beacons[0]), compare_beacons);
+        Sim_addEvent(m_beacons[0].time_us, deliver_beacon, NULL);
+    }
+}
+
+/** Anchors heard are also the neighbors of the tag */
+static void update_nbors(void)
+{
+    app_lib_state_nbor_info_t nbors[MAX_ANCHORS];
+
+    memset(nbors, 0, sizeof(nbors));
+    for (uint32_t i = 0; i < m_num_anchors; i++)
+    {
+        nbors[i].address = m_anchors[i].address;
+        nbors[i].link_reliability = 255;
+        nbors[i].norm_rssi = m_anchors[i].rss - m_anchors[i].txpower;
+        nbors[i].cost = 1;
+        nbors[i].channel = 1;
+        nbors[i].type = APP_LIB_STATE_NEIGHBOR_IS_CLUSTER;
+        nbors[i].tx_power = m_anchors[i].txpower;
+        nbors[i].rx_power = m_anchors[i].rss;
+        nbors[i].diradv_support = APP_LIB_STATE_DIRADV_NOT_SUPPORTED;
+    }
+    Sim_state_setNbors(nbors, m_num_anchors);
+}
+
+/*
+ * Trace commands
+ */
+
+static void command_anchor(char * args)
+{
+    char * address_str = strtok(args, " \t");
+    char * rss_str = strtok(NULL, " \t");
+    char * txpower_str = strtok(NULL, " \t");
+    uint32_t i;
+
+    if ((address_str == NULL) || (rss_str == NULL))
+    {
+        trace_error("anchor <address> <rss>|off [<tx power>]");
+    }
+    app_addr_t address = strtoul(address_str, NULL, 0);
+    for (i = 0; i < m_num_anchors; i++)
+    {
+        if (m_anchors[i].address == address)
+        {
+            break;
+        }
+    }
+
+    if (strcmp(rss_str, "off") == 0)
+    {
+        if (i < m_num_anchors)
+        {
+            m_anchors[i] = m_anchors[--m_num_anchors];
+        }
+    }
+    else
+    {
+        if (i == m_num_anchors)
+        {
+            if (m_num_anchors == MAX_ANCHORS)
+            {
+                trace_error("too many anchors");
+            }
+            m_num_anchors++;
+            m_anchors[i].address = address;
+            m_anchors[i].txpower = 8;
+        }
+        m_anchors[i].rss = (int8_t)strtol(rss_str, NULL, 0);
+        if (txpower_str != NULL)
+        {
+            m_anchors[i].txpower = (int8_t)strtol(txpower_str, NULL, 0);
+        }
+    }
+    update_nbors();
+}
+
+static void command_motion(char * args)
+{
+    char * mode = strtok(args, " \t");
+    bool dynamic = m_dynamic;
+    if ((mode != NULL) && (strcmp(mode, "static") == 0))
+    {
+        PosLib_motion(POSLIB_MOTION_STATIC);
+        m_dynamic = false;
+    }
+    else if ((mode != NULL) && (strcmp(mode, "dynamic") == 0))
+    {
+        PosLib_motion(POSLIB_MOTION_DYNAMIC);
+        m_dynamic = true;
+    }
+    else
+    {
+        trace_error("motion static|dynamic");
+    }
+    if ((m_dynamic != dynamic) && m_settings.motion.enabled)
+    {
+        start_check(CHECK_NEXT_FULL);
+    }
+}
+
+static void command_expect(char * args)
+{
+    char * what = strtok(args, " \t");
+    if ((what == NULL) || (strcmp(what, "full") != 0))
+    {
+        trace_error("expect full");
+    }
+    start_check(CHECK_CHANGE);
+}
+
+static bool parse_filter(const char * name, poslib_rss_filter_type_e * type)
+{
+    for (uint32_t i = 0; i < sizeof(m_filter_names) / sizeof(m_filter_names[0]);
+         i++)
+    {
+        if (strcmp(name, m_filter_names[i]) == 0)
+        {
+            *type = (poslib_rss_filter_type_e)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool set_setting(poslib_settings_t * settings,
+                        const char * name,
+                        const char * value_str)
+{
+    uint32_t value = strtoul(value_str, NULL, 0);
+    uint32_t setting;
+
+    for (setting = 0;
+         setting < sizeof(m_setting_names) / sizeof(m_setting_names[0]);
+         setting++)
+    {
+        if (strcmp(name, m_setting_names[setting]) == 0)
+        {
+            break;
+        }
+    }
+
+    switch (setting)
+    {
+        case SETTING_MODE:
+            settings->node_mode = (poslib_mode_e)value;
+            break;
+        case SETTING_PERIOD:
+            settings->update_period_static_s = value;
+            break;
+        case SETTING_DYNAMIC_PERIOD:
+            settings->update_period_dynamic_s = value;
+            break;
+        case SETTING_OFFLINE_PERIOD:
+            settings->update_period_offline_s = value;
+            break;
+        case SETTING_FILTER:
+            return parse_filter(value_str, &settings->rss_filter.type);
+        case SETTING_ADAPTIVE:
+            settings->adaptive_scan.enabled = (value != 0);
+            break;
+        case SETTING_COMPACT:
+            settings->report.compact = (value != 0);
+            break;
+        case SETTING_BLE:
+            settings->ble.mode = (poslib_ble_mode_e)value;
+            break;
+        case SETTING_BLE_INTERVAL:
+            settings->ble.eddystone.tx_interval_ms = (uint16_t)value;
+            settings->ble.ibeacon.tx_interval_ms = (uint16_t)value;
+            break;
+        case SETTING_MBCN:
+            settings->mbcn.enabled = (value != 0);
+            break;
+        case SETTING_MBCN_INTERVAL:
+            settings->mbcn.tx_interval_ms = (uint16_t)value;
+            break;
+        case SETTING_MBCN_JITTER:
+            settings->mbcn.tx_jitter_pct = (uint8_t)value;
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+static void command_set(char * args)
+{
+    char * name = strtok(args, " \t");
+    char * value = strtok(NULL, " \t");
+    poslib_settings_t settings;
+
+    PosLib_getConfig(&settings);
+    if ((name == NULL) || (value == NULL) ||
+        !set_setting(&settings, name, value))
+    {
+        trace_error("set <setting> <value>, unknown setting or value");
+    }
+    if (PosLib_setConfig(&settings) != POS_RET_OK)
+    {
+        trace_error("settings refused by PosLib_setConfig()");
+    }
+    bool changed = memcmp(&settings, &m_settings, sizeof(settings)) != 0;
+    m_settings = settings;
+    if (changed)
+    {
+        start_check(CHECK_NEXT_FULL);
+    }
+}
+
+/** Read the next command of the trace, false at the end of the trace */
+static bool read_command(void)
+{
+    char line[256];
+
+    while (fgets(line, sizeof(line), m_trace) != NULL)
+    {
+        m_line++;
+        char * comment = strchr(line, '#');
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+        char * end;
+        double time_s = strtod(line, &end);
+        while ((*end == ' ') || (*end == '\t'))
+        {
+            end++;
+        }
+        end[strcspn(end, "\r\n")] = '\0';
+        if (*end == '\0')
+        {
+            // Empty line
+            continue;
+        }
+        if ((end == line) || (time_s * 1e6 < m_command_time))
+        {
+            trace_error("time missing or going backwards");
+        }
+        m_command_time = (uint64_t)(time_s * 1e6);
+        snprintf(m_command, sizeof(m_command), "%s", end);
+        return true;
+    }
+    return false;
+}
+
+/** Run the commands due now, then wait for the next one */
+static void run_commands(void * arg)
+{
+    (void)arg;
+    do
+    {
+        char * args = m_command + strcspn(m_command, " \t");
+        if (*args != '\0')
+        {
+            *args++ = '\0';
+        }
+
+        if (strcmp(m_command, "anchor") == 0)
+        {
+            command_anchor(args);
+        }
+        else if (strcmp(m_command, "motion") == 0)
+        {
+            command_motion(args);
+        }
+        else if (strcmp(m_command, "set") == 0)
+        {
+            command_set(args);
+        }
+        else if (strcmp(m_command, "expect") == 0)
+        {
+            command_expect(args);
+        }
+        else if (strcmp(m_command, "end") == 0)
+        {
+            Sim_stop();
+            return;
+        }
+        else
+        {
+            trace_error("unknown command");
+        }
+
+        if (!read_command())
+        {
+            Sim_stop();
+            return;
+        }
+    } while (m_command_time <= Sim_now());
+
+    Sim_addEvent(m_command_time - Sim_now(), run_commands, NULL);
+}
+
+/*
+ * Application
+ */
+
+static void on_poslib_event(POSLIB_FLAG_EVENT_info_t * msg)
+{
+    if (msg->event_id & POSLIB_FLAG_EVENT_UPDATE_START)
+    {
+        m_update_start = Sim_now();
+        m_update_started = true;
+    }
+
+    if (msg->event_id & POSLIB_FLAG_EVENT_UPDATE_END)
+    {
+        poslib_update_stats_t stats;
+        PosLib_getUpdateStats(&stats);
+
+        if (!m_update_started)
+        {
+            // Skipped scan: the beacons of the last scan are sent again
+            m_updates_without_scan++;
+            check_update(Sim_now());
+            return;
+        }
+        m_update_started = false;
+        check_update(m_update_start);
+        if (m_num_updates < MAX_UPDATES)
+        {
+            m_updates[m_num_updates++] = (update_t) {
+                .interval_ms = (uint32_t)((m_update_start - m_previous_start)
+                                          / 1000),
+                .scan_ms = stats.scan_ms,
+                .send_ms = stats.send_ms,
+                .update_ms = (uint32_t)((Sim_now() - m_update_start) / 1000),
+            };
+        }
+        if (m_verbose)
+        {
+            printf("%10.3f s: update %u, scan %u ms, sent after %u ms, "
+                   "%u ms, %u bytes in total\n",
+                   m_update_start / 1e6, stats.updates, stats.scan_ms,
+                   stats.send_ms, stats.update_ms, stats.payload_bytes);
+        }
+        m_previous_start = m_update_start;
+    }
+}
+
+/** Compare a reported rss, in 0.5 dB below 0 dB, to the trace */
+static void check_rss(app_addr_t address, uint32_t half_db)
+{
+    const anchor_t * anchor = find_scan_anchor(address);
+    if (anchor == NULL)
+    {
+        m_stale_rss++;
+        return;
+    }
+    add_rss_error(&m_report_errors[m_settings.rss_filter.type][m_dynamic],
+                  anchor,
+                  -(double)half_db / 2);
+}
+
+static void check_compact_rss(const uint8_t * bytes, uint32_t num_bytes)
+{
+    const poslib_meas_rss_compact_t * record =
+        (const poslib_meas_rss_compact_t *)bytes;
+    uint32_t pos = sizeof(poslib_meas_rss_compact_t);
+    app_addr_t address = 0;
+
+    while (pos < num_bytes)
+    {
+        // LEB128 address delta, shifted left by one, bit 0 for tx power
+        uint64_t delta = 0;
+        uint32_t shift = 0;
+        while ((pos < num_bytes) && (bytes[pos] & 0x80))
+        {
+            delta |= (uint64_t)(bytes[pos++] & 0x7F) << shift;
+            shift += 7;
+        }
+        if (pos + 1 >= num_bytes)
+        {
+            return;
+        }
+        delta |= (uint64_t)bytes[pos++] << shift;
+        address += (app_addr_t)(delta >> 1);
+        check_rss(address, bytes[pos++] * record->rss_step);
+        if (delta & 1)
+        {
+            pos++;
+        }
+    }
+}
+
+/** Decode the rss records of a measurement report */
+static void check_report(const app_lib_data_to_send_t * data)
+{
+    uint32_t pos = sizeof(poslib_meas_message_header_t);
+
+    m_reports++;
+    while (pos + sizeof(poslib_meas_record_header_t) <= data->num_bytes)
+    {
+        const poslib_meas_record_header_t * header =
+            (const poslib_meas_record_header_t *)&data->bytes[pos];
+        const uint8_t * bytes = &data->bytes[pos + sizeof(*header)];
+        pos += sizeof(*header) + header->length;
+        if (pos > data->num_bytes)
+        {
+            return;
+        }
+        switch (header->type)
+        {
+            case POSLIB_MEAS_RSS_SR:
+            case POSLIB_MEAS_RSS_SR_4BYTE_ADDR:
+            case POSLIB_MEAS_RSS_SR_ANCHOR:
+            case POSLIB_MEAS_RSS_SR_ANCHOR_4BYTE_ADDR:
+                for (uint32_t i = 0;
+                     i + sizeof(poslib_meas_rss_data_t) <= header->length;
+                     i += sizeof(poslib_meas_rss_data_t))
+                {
+                    const poslib_meas_rss_data_t * rss =
+                        (const poslib_meas_rss_data_t *)&bytes[i];
+                    check_rss(rss->address, rss->norm_rss);
+                }
+                break;
+            case POSLIB_MEAS_RSS_SR_COMPACT:
+            case POSLIB_MEAS_RSS_SR_ANCHOR_COMPACT:
+                check_compact_rss(bytes, header->length);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void on_data_tx(const app_lib_data_to_send_t * data)
+{
+    if (data->src_endpoint != POS_SOURCE_ENDPOINT)
+    {
+        return;
+    }
+    // Mini-beacons use the same endpoints, but are broadcast
+    if (data->dest_address != APP_ADDR_BROADCAST)
+    {
+        check_report(data);
+        return;
+    }
+    if ((m_mbcn_sent++ > 0) && (m_num_mbcn_intervals < MAX_MBCN_INTERVALS))
+    {
+        m_mbcn_intervals[m_num_mbcn_intervals++] =
+            (uint32_t)((Sim_now() - m_mbcn_last) / 1000);
+    }
+    m_mbcn_last = Sim_now();
+
+    if (m_mbcn_log != NULL)
+    {
+        mbcn_tx_t tx =
+        {
+            .start_us = Sim_now(),
+            .airtime_us = (data->num_bytes + DATA_OVERHEAD_BYTES) * 8u /
+                          RADIO_BITS_PER_US,
+        };
+        fwrite(&tx, sizeof(tx), 1, m_mbcn_log);
+    }
+}
+
+void App_init(const app_global_functions_t * functions)
+{
+    uint8_t id;
+    (void)functions;
+
+    if (PosLib_setConfig(&m_settings) != POS_RET_OK)
+    {
+        Sim_abort("settings refused by PosLib_setConfig()");
+    }
+    if (PosLib_eventRegister(POSLIB_FLAG_EVENT_UPDATE_START |
+                                POSLIB_FLAG_EVENT_UPDATE_END,
+                             on_poslib_event,
+                             &id) != POS_RET_OK)
+    {
+        Sim_abort("cannot register to the PosLib events");
+    }
+    m_mbcn = m_settings.mbcn;
+    if (PosLib_startPeriodic() != POS_RET_OK)
+    {
+        Sim_abort("cannot start PosLib");
+    }
+}
+
+const void * Sim_openExtraLibrary(uint32_t name, uint32_t version)
+{
+    switch (name)
+    {
+        case APP_LIB_BEACON_TX_NAME:
+            return Sim_beacon_tx_open(version);
+        case APP_LIB_ADVERTISER_NAME:
+            return Sim_advertiser_open(version);
+        default:
+            return NULL;
+    }
+}
+
+/*
+ * Report
+ */
+
+static int compare_u32(const void * a, const void * b)
+{
+    uint32_t value_a = *(const uint32_t *)a;
+    uint32_t value_b = *(const uint32_t *)b;
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+/** Print the percentiles of a field of the updates */
+static void print_percentiles(const char * name,
+                              size_t offset,
+                              uint32_t first,
+                              double scale,
+                              const char * unit)
+{
+    static uint32_t values[MAX_UPDATES];
+    uint32_t count = 0;
+
+    for (uint32_t i = first; i < m_num_updates; i++)
+    {
+        values[count++] = *(const uint32_t *)
+                            ((const uint8_t *)&m_updates[i] + offset);
+    }
+    if (count == 0)
+    {
+        printf("%-17s-\n", name);
+        return;
+    }
+    qsort(values, count, sizeof(values[0]), compare_u32);
+    printf("%-17smin %.1f %s, p50 %.1f %s, p90 %.1f %s, max %.1f %s\n",
+           name,
+           values[0] * scale, unit,
+           values[count / 2] * scale, unit,
+           values[count * 9 / 10] * scale, unit,
+           values[count - 1] * scale, unit);
+}
+
+static void report(void)
+{
+    sim_time_stats_t time;
+    sim_data_stats_t data;
+    sim_state_stats_t state;
+    sim_beacon_stats_t beacon;
+    poslib_update_stats_t update;
+    poslib_scan_stats_t scan;
+
+    Sim_getTimeStats(&time);
+    Sim_getDataStats(&data);
+    Sim_getStateStats(&state);
+    Sim_getBeaconStats(&beacon);
+    PosLib_getUpdateStats(&update);
+    PosLib_getScanStats(&scan);
+
+    uint64_t data_us = ((uint64_t)data.tx_bytes +
+                        (uint64_t)data.tx_packets * DATA_OVERHEAD_BYTES) *
+                       8u / RADIO_BITS_PER_US;
+    uint64_t radio_us = state.scan_us + data_us + beacon.airtime_us;
+    double elapsed_s = time.elapsed_us / 1e6;
+
+    printf("--- poslib_sim report ---\n");
+    printf("trace:           %s, %.1f s\n", m_trace_name, elapsed_s);
+    printf("settings:        mode %u, period %u/%u s, filter %s, "
+           "adaptive scan %s, compact %s\n",
+           m_settings.node_mode,
+           m_settings.update_period_static_s,
+           m_settings.update_period_dynamic_s,
+           m_filter_names[m_settings.rss_filter.type],
+           m_settings.adaptive_scan.enabled ? "on" : "off",
+           m_settings.report.compact ? "on" : "off");
+    printf("cpu:             %.3f ms, %u events, longest %u us, "
+           "%.1f us per update\n",
+           time.cpu_us / 1e3, time.events, time.max_event_us,
+           update.updates > 0 ? (double)time.cpu_us / update.updates : 0.0);
+    printf("updates:         %u, %u without scan\n",
+           update.updates, m_updates_without_scan);
+    print_percentiles("update interval:", offsetof(update_t, interval_ms), 1,
+                      1e-3, "s");
+    print_percentiles("scan:", offsetof(update_t, scan_ms), 0, 1, "ms");
+    print_percentiles("sent after:", offsetof(update_t, send_ms), 0, 1, "ms");
+    print_percentiles("update:", offsetof(update_t, update_ms), 0, 1, "ms");
+    printf("scans:           %u full, %u short, %u skipped, %u ms saved\n",
+           scan.full_scans, scan.short_scans, scan.skipped_scans,
+           scan.saved_ms);
+    if (m_checks > 0)
+    {
+        printf("adaptive checks: %u changes, %u not followed by a full scan\n",
+               m_checks, m_failed_checks);
+    }
+    printf("payload:         %u bytes of measurements, %.1f per update\n",
+           update.payload_bytes,
+           update.updates > 0 ? (double)update.payload_bytes /
+                                    update.updates : 0.0);
+    printf("data tx:         %u packets, %u bytes, %u refused\n",
+           data.tx_packets, data.tx_bytes, data.tx_refused);
+    printf("radio on:        %.1f ms (%.4f %%): scans %.1f ms (%u scans, "
+           "%u beacons), data %.1f ms, ble %.1f ms (%u beacons)\n",
+           radio_us / 1e3,
+           elapsed_s > 0 ? 100.0 * radio_us / time.elapsed_us : 0.0,
+           state.scan_us / 1e3, state.scans, state.beacons,
+           data_us / 1e3, beacon.airtime_us / 1e3, beacon.beacons);
+}
+
+/** Report the rss errors, for each filter type and motion state used */
+static void report_rss(void)
+{
+    const char * label = "rss error:";
+
+    printf("rss reports:     %u reports, %u rss of anchors not in the last scan\n",
+           m_reports, m_stale_rss);
+    for (uint32_t type = 0; type <= POSLIB_RSS_FILTER_KALMAN; type++)
+    {
+        for (uint32_t dynamic = 0; dynamic < 2; dynamic++)
+        {
+            const rss_error_t * report = &m_report_errors[type][dynamic];
+            const rss_error_t * beacon = &m_beacon_errors[type][dynamic];
+            if (report->count == 0)
+            {
+                continue;
+            }
+            printf("%-17s%-6s %-7s %5u rss, bias %+.2f dB, rms %.2f dB, "
+                   "max %.1f dB (beacons: rms %.2f dB)\n",
+                   label,
+                   m_filter_names[type],
+                   dynamic ? "dynamic" : "static",
+                   report->count,
+                   report->sum / report->count,
+                   sqrt(report->sum_squares / report->count),
+                   report->max,
+                   beacon->count > 0 ?
+                        sqrt(beacon->sum_squares / beacon->count) : 0.0);
+            label = "";
+        }
+    }
+}
+
+/**
+ * \brief   Report the mini-beacon intervals
+ * \return  False if they are out of the jitter range, or not uniform in it
+ *          (chi-square test, MBCN_CHI2_LIMIT)
+ */
+static bool report_mbcn(void)
+{
+    uint32_t count = m_num_mbcn_intervals;
+    uint32_t tx_interval = m_mbcn.tx_interval_ms;
+    uint32_t jitter = tx_interval * m_mbcn.tx_jitter_pct / 100;
+    uint32_t values = 2 * jitter + 1;
+    uint32_t lowest = tx_interval - jitter;
+    uint32_t bins[MBCN_BINS] = { 0 };
+    uint32_t out_of_range = 0;
+    double sum = 0.0;
+    double sum_squares = 0.0;
+
+    if (!m_mbcn.enabled)
+    {
+        return true;
+    }
+    if (count == 0)
+    {
+        printf("mini-beacons:    %u sent\n", m_mbcn_sent);
+        return true;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t interval = m_mbcn_intervals[i];
+        double offset = (double)interval - tx_interval;
+        sum += offset;
+        sum_squares += offset * offset;
+        if ((interval < lowest) || (interval >= lowest + values))
+        {
+            out_of_range++;
+            continue;
+        }
+        bins[(uint64_t)(interval - lowest) * MBCN_BINS / values]++;
+    }
+
+    double mean = sum / count;
+    double std = sqrt(sum_squares / count - mean * mean);
+    // Discrete uniform distribution over the jitter range
+    double expected_std = sqrt(((double)values * values - 1) / 12);
+    printf("mini-beacons:    %u sent, every %u ms +- %u %%, "
+           "%u intervals out of range\n",
+           m_mbcn_sent, tx_interval, m_mbcn.tx_jitter_pct, out_of_range);
+    printf("mbcn jitter:     mean %+.1f ms, std %.1f ms "
+           "(uniform: mean +0.0 ms, std %.1f ms)\n",
+           mean, std, expected_std);
+
+    if ((jitter == 0) || (count - out_of_range < MBCN_MIN_INTERVALS))
+    {
+        return out_of_range == 0;
+    }
+
+    uint32_t in_range = count - out_of_range;
+    double chi2 = 0.0;
+    printf("mbcn histogram: ");
+    for (uint32_t bin = 0; bin < MBCN_BINS; bin++)
+    {
+        // Bins are one value wider than others when values % MBCN_BINS != 0
+        uint32_t first = (bin * values + MBCN_BINS - 1) / MBCN_BINS;
+        uint32_t end = ((bin + 1) * values + MBCN_BINS - 1) / MBCN_BINS;
+        double expected = (double)in_range * (end - first) / values;
+        double diff = bins[bin] - expected;
+        chi2 += diff * diff / expected;
+        printf(" %u", bins[bin]);
+    }
+    bool uniform = chi2 <= MBCN_CHI2_LIMIT;
+    printf(", chi-square %.1f (limit %.1f): %s\n",
+           chi2, MBCN_CHI2_LIMIT, uniform ? "uniform" : "NOT uniform");
+    return uniform && (out_of_range == 0);
+}
+
+/** Replay the trace from the start of the simulation */
+static void run_trace(const sim_config_t * config, uint64_t duration_us)
+{
+    Sim_init(true, config);
+    Sim_state_setScanListener(on_scan_start);
+    Sim_data_setTxListener(on_data_tx);
+    Sim_start();
+    if (read_command())
+    {
+        Sim_addEvent(m_command_time, run_commands, NULL);
+    }
+    Sim_run(duration_us);
+}
+
+/**
+ * \brief   Replay the trace as each anchor in turn, in a child process
+ * \param   txs
+ *          Mini-beacons of all anchors, allocated, anchor is their index
+ * \return  Number of mini-beacons
+ */
+static uint32_t run_anchors(const sim_config_t * config,
+                            const app_addr_t * addresses,
+                            uint32_t count,
+                            uint64_t duration_us,
+                            mbcn_tx_t ** txs)
+{
+    FILE * log = tmpfile();
+    uint32_t num_txs = 0;
+    uint32_t max_txs = 0;
+
+    if (log == NULL)
+    {
+        perror("tmpfile");
+        exit(EXIT_FAILURE);
+    }
+    *txs = NULL;
+    fflush(stdout);
+
+    for (uint32_t anchor = 0; anchor < count; anchor++)
+    {
+        long start = ftell(log);
+        int status;
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0)
+        {
+            // Child: a fresh node, reading the trace from its start
+            sim_config_t anchor_config = *config;
+            anchor_config.node_address = addresses[anchor];
+            m_trace = fopen(m_trace_name, "r");
+            if (m_trace == NULL)
+            {
+                perror(m_trace_name);
+                _exit(EXIT_FAILURE);
+            }
+            m_mbcn_log = log;
+            run_trace(&anchor_config, duration_us);
+            fflush(log);
+            _exit(EXIT_SUCCESS);
+        }
+        if ((waitpid(pid, &status, 0) != pid) ||
+            !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS))
+        {
+            fprintf(stderr, "anchor 0x%x failed\n", addresses[anchor]);
+            exit(EXIT_FAILURE);
+        }
+
+        // The child wrote at the end of the file, which the parent shares
+        fseek(log, start, SEEK_SET);
+        mbcn_tx_t tx;
+        while (fread(&tx, sizeof(tx), 1, log) == 1)
+        {
+            if (num_txs == max_txs)
+            {
+                max_txs = (max_txs == 0) ? 1024 : 2 * max_txs;
+                *txs = realloc(*txs, max_txs * sizeof(**txs));
+                if (*txs == NULL)
+                {
+                    perror("realloc");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            tx.anchor = anchor;
+            (*txs)[num_txs++] = tx;
+        }
+    }
+    fclose(log);
+    return num_txs;
+}
+
+static int compare_txs(const void * a, const void * b)
+{
+    uint64_t start_a = ((const mbcn_tx_t *)a)->start_us;
+    uint64_t start_b = ((const mbcn_tx_t *)b)->start_us;
+    return (start_a > start_b) - (start_a < start_b);
+}
+
+/**
+ * \brief   Mini-beacons of the first anchors overlapping one of another
+ *          anchor, txs sorted by start time
+ * \return  Collided mini-beacons, in percent of those sent
+ */
+static double count_collisions(const mbcn_tx_t * txs,
+                               uint32_t num_txs,
+                               uint32_t anchors)
+{
+    bool * collided = calloc(num_txs, sizeof(bool));
+    uint32_t max_airtime = 0;
+    uint32_t sent = 0;
+    uint32_t collisions = 0;
+
+    if (collided == NULL)
+    {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < num_txs; i++)
+    {
+        if (txs[i].airtime_us > max_airtime)
+        {
+            max_airtime = txs[i].airtime_us;
+        }
+    }
+
+    for (uint32_t i = 0; i < num_txs; i++)
+    {
+        if (txs[i].anchor >= anchors)
+        {
+            continue;
+        }
+        sent++;
+        // Earlier mini-beacons still on air when this one starts
+        for (uint32_t j = i; j-- > 0;)
+        {
+            if (txs[i].start_us - txs[j].start_us >= max_airtime)
+            {
+                break;
+            }
+            if ((txs[j].anchor >= anchors) ||
+                (txs[j].anchor == txs[i].anchor) ||
+                (txs[j].start_us + txs[j].airtime_us <= txs[i].start_us))
+            {
+                continue;
+            }
+            collided[i] = true;
+            collided[j] = true;
+        }
+    }
+    for (uint32_t i = 0; i < num_txs; i++)
+    {
+        if (collided[i])
+        {
+            collisions++;
+        }
+    }
+    free(collided);
+    return (sent > 0) ? 100.0 * collisions / sent : 0.0;
+}
+
+/**
+ * \brief   Mini-beacon collisions of anchors powered on together, for
+ *          2, 4, ... up to the given number of anchors
+ *
+ * Compared spreadings:
+ * - same phase: every anchor sending at every tx interval from power on,
+ *   a model of mini-beacons without phase nor jitter
+ * - address phase: the library with no jitter (first mini-beacon from the
+ *   node address only)
+ * - phase + jitter: the library with the jitter of the options
+ * - random: sending at independent random times, on the milliseconds of
+ *   the application scheduler like the library
+ */
+static void run_collisions(sim_config_t * config,
+                           uint32_t anchors,
+                           uint64_t duration_us)
+{
+    app_addr_t addresses[MAX_COLLISION_ANCHORS];
+    mbcn_tx_t * phase_txs;
+    mbcn_tx_t * jitter_txs;
+    uint8_t jitter_pct = m_settings.mbcn.tx_jitter_pct;
+    uint32_t interval_ms = m_settings.mbcn.tx_interval_ms;
+
+    // Addresses of a deployment rather than consecutive ones
+    for (uint32_t i = 0; i < anchors; i++)
+    {
+        bool unique;
+        do
+        {
+            addresses[i] = (random_u32() & 0xffffff) | 1;
+            unique = true;
+            for (uint32_t j = 0; j < i; j++)
+            {
+                unique = unique && (addresses[j] != addresses[i]);
+            }
+        } while (!unique);
+    }
+
+    m_settings.mbcn.tx_jitter_pct = 0;
+    uint32_t num_phase = run_anchors(config, addresses, anchors, duration_us,
+                                     &phase_txs);
+    m_settings.mbcn.tx_jitter_pct = jitter_pct;
+    uint32_t num_jitter = run_anchors(config, addresses, anchors,
+                                      duration_us, &jitter_txs);
+    if ((num_phase == 0) || (num_jitter == 0))
+    {
+        fprintf(stderr, "no mini-beacons sent\n");
+        exit(EXIT_FAILURE);
+    }
+    qsort(phase_txs, num_phase, sizeof(mbcn_tx_t), compare_txs);
+    qsort(jitter_txs, num_jitter, sizeof(mbcn_tx_t), compare_txs);
+
+    // Same phase: the sent mini-beacons of each anchor, from time 0
+    uint32_t airtime_us = jitter_txs[0].airtime_us;
+    uint32_t num_same = num_jitter;
+    mbcn_tx_t * same_txs = malloc(num_same * sizeof(mbcn_tx_t));
+    if (same_txs == NULL)
+    {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    uint32_t per_anchor = num_same / anchors;
+    for (uint32_t i = 0; i < num_same; i++)
+    {
+        same_txs[i].start_us = (uint64_t)(i / anchors) * interval_ms * 1000u;
+        same_txs[i].airtime_us = airtime_us;
+        same_txs[i].anchor = (i / anchors < per_anchor) ? i % anchors :
+                                                          anchors;
+    }
+
+    printf("--- poslib_sim collisions ---\n");
+    printf("trace:           %s, %.1f s, anchors powered on together\n",
+           m_trace_name, jitter_txs[num_jitter - 1].start_us / 1e6);
+    printf("mini-beacons:    every %u ms +- %u %%, %u us on air, "
+           "%u sent (%u without jitter)\n",
+           interval_ms, jitter_pct, airtime_us, num_jitter, num_phase);
+    printf("collided mini-beacons, in %% of those sent:\n");
+    printf("anchors  same phase  address phase  phase + jitter  random\n");
+    // Start offsets in milliseconds at which two mini-beacons overlap
+    uint32_t overlap_ms = 2 * ((airtime_us + 999) / 1000) - 1;
+    for (uint32_t count = 2; count <= anchors; count *= 2)
+    {
+        double random = 1.0 - pow(1.0 - (double)overlap_ms / interval_ms,
+                                  count - 1);
+        printf("%7u  %9.2f %%  %12.2f %%  %13.2f %%  %5.2f %%\n",
+               count,
+               count_collisions(same_txs, num_same, count),
+               count_collisions(phase_txs, num_phase, count),
+               count_collisions(jitter_txs, num_jitter, count),
+               100.0 * random);
+        if ((count < anchors) && (2 * count > anchors))
+        {
+            // Last row for the number of anchors of the option
+            count = anchors / 2;
+        }
+    }
+
+    free(same_txs);
+    free(phase_txs);
+    free(jitter_txs);
+}
+
+static void usage(const char * name)
+{
+    fprintf(stderr,
+        "Usage: %s [options] <trace>\n"
+        "  -r <role>     node role, as in app_lib_settings_role_e (default 2)\n"
+        "  -m <mode>     PosLib mode, as in poslib_mode_e (default 2)\n"
+        "  -p <s>        static update period (default 60)\n"
+        "  -P <s>        dynamic update period (default 30)\n"
+        "  -f <filter>   rss filter: mean, ewma, median or kalman\n"
+        "  -a            adaptive scan\n"
+        "  -c            compact measurement report\n"
+        "  -M <ms>       mini-beacons at this interval\n"
+        "  -j <%%>        mini-beacon jitter (default 10)\n"
+        "  -S <ms>       duration of the default scan (default 1000)\n"
+        "  -k <n>        beacons from each anchor per scan (default 2)\n"
+        "  -n <dB>       rss noise standard deviation (default 2)\n"
+        "  -s <seed>     seed of the rss noise and beacon times\n"
+        "  -d <s>        run for <s> seconds, default to the end of the trace\n"
+        "  -N <n>        mini-beacon collisions of 2 to <n> anchors (max %u)\n"
+        "  -v            print each update\n",
+        name, MAX_COLLISION_ANCHORS);
+}
+
+int main(int argc, char * argv[])
+{
+    sim_config_t config = SIM_CONFIG_DEFAULT;
+    uint64_t duration_us = UINT64_MAX;
+    uint32_t collision_anchors = 0;
+    int opt;
+
+    config.node_address = 0x1000;
+    config.role = APP_LIB_SETTINGS_ROLE_SUBNODE_LE;
+    config.started = true;
+    config.scan_duration_us = SCAN_DURATION_MS * 1000u;
+    default_settings(&m_settings);
+
+    while ((opt = getopt(argc, argv, "r:m:p:P:f:acM:j:S:k:n:s:d:N:vh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':
+                config.role = strtoul(optarg, NULL, 0);
+                break;
+            case 'm':
+                m_settings.node_mode = strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                m_settings.update_period_static_s = strtoul(optarg, NULL, 0);
+                break;
+            case 'P':
+                m_settings.update_period_dynamic_s = strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                if (!parse_filter(optarg, &m_settings.rss_filter.type))
+                {
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'a':
+                m_settings.adaptive_scan.enabled = true;
+                break;
+            case 'c':
+                m_settings.report.compact = true;
+                break;
+            case 'M':
+                m_settings.mbcn.enabled = true;
+                m_settings.mbcn.tx_interval_ms = strtoul(optarg, NULL, 0);
+                break;
+            case 'j':
+                m_settings.mbcn.tx_jitter_pct = strtoul(optarg, NULL, 0);
+                break;
+            case 'S':
+                config.scan_duration_us = strtoul(optarg, NULL, 0) * 1000u;
+                break;
+            case 'k':
+                m_beacons_per_scan = strtoul(optarg, NULL, 0);
+                if (m_beacons_per_scan > MAX_BEACONS_PER_SCAN)
+                {
+                    m_beacons_per_scan = MAX_BEACONS_PER_SCAN;
+                }
+                break;
+            case 'n':
+                m_noise_db = strtod(optarg, NULL);
+                break;
+            case 's':
+                m_random = strtoul(optarg, NULL, 0);
+                if (m_random == 0)
+                {
+                    // Not a valid xorshift state
+                    m_random = 1;
+                }
+                break;
+            case 'd':
+                duration_us = strtoull(optarg, NULL, 0) * 1000000u;
+                break;
+            case 'N':
+                collision_anchors = strtoul(optarg, NULL, 0);
+                if ((collision_anchors < 2) ||
+                    (collision_anchors > MAX_COLLISION_ANCHORS))
+                {
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'v':
+                m_verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    m_trace_name = argv[optind];
+    if (collision_anchors > 0)
+    {
+        if (!m_settings.mbcn.enabled)
+        {
+            fprintf(stderr, "-N needs mini-beacons (-M)\n");
+            return EXIT_FAILURE;
+        }
+        run_collisions(&config, collision_anchors, duration_us);
+        return EXIT_SUCCESS;
+    }
+
+    m_trace = fopen(m_trace_name, "r");
+    if (m_trace == NULL)
+    {
+        perror(m_trace_name);
+        return EXIT_FAILURE;
+    }
+
+    run_trace(&config, duration_us);
+
+    // Settings at the end of the trace
+    PosLib_getConfig(&m_settings);
+    report();
+    report_rss();
+    bool mbcn_ok = report_mbcn();
+    fclose(m_trace);
+    return (mbcn_ok && (m_failed_checks == 0)) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
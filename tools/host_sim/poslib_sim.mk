@@ -0,0 +1,15 @@
+# Positioning library on the host, in virtual time, see Readme.md
+
+TOOL := poslib_sim
+
+# Same libraries as source/reference_apps/positioning_app
+POSITIONING=yes
+APP_SCHEDULER=yes
+APP_SCHEDULER_TASKS=1
+
+LDFLAGS += -lm
+
+SRCS += poslib_sim.c \
+        sim/sim_beacon.c
+
+include host.mk
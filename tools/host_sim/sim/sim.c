@@ -0,0 +1,364 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+
+#include "sim.h"
+#include "libraries_init.h"
+
+/** Maximum amount of pending events */
+#define SIM_MAX_EVENTS          64
+
+/** Simulated stack firmware version */
+#define SIM_FIRMWARE_MAJOR      5
+#define SIM_FIRMWARE_MINOR      4
+
+typedef struct
+{
+    /** Due time, in microseconds since start */
+    uint64_t    due;
+    /** Insertion order, events due at the same time run in that order */
+    uint64_t    seq;
+    sim_event_f cb;
+    void *      arg;
+} sim_event_t;
+
+/** Application entry point */
+void App_init(const app_global_functions_t * functions);
+
+/** Opens the library pointers, in util/api.c */
+bool API_Open(const app_global_functions_t * functions);
+
+/** Pending events, unsorted (there are only a few of them) */
+static sim_event_t              m_events[SIM_MAX_EVENTS];
+static uint32_t                 m_num_events;
+static uint64_t                 m_seq;
+
+/** Virtual or real time */
+static bool                     m_virtual_time;
+/** Virtual time, in microseconds */
+static uint64_t                 m_virtual_now;
+/** Real time of the start, in microseconds of CLOCK_MONOTONIC */
+static uint64_t                 m_real_start;
+
+/** Attached file descriptor */
+static int                      m_fd = -1;
+static sim_readable_f           m_readable_cb;
+static bool                     m_poll_fd;
+
+static volatile sig_atomic_t    m_stop;
+
+static sim_time_stats_t         m_time_stats;
+static bool                     m_dispatching;
+
+static uint64_t clock_us(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static uint32_t get_api_version(void)
+{
+    return APP_API_VERSION;
+}
+
+static app_firmware_version_t get_stack_firmware_version(void)
+{
+    app_firmware_version_t version = {
+        .major = SIM_FIRMWARE_MAJOR,
+        .minor = SIM_FIRMWARE_MINOR,
+    };
+    return version;
+}
+
+static const void * open_library(uint32_t name, uint32_t version)
+{
+    switch (name)
+    {
+        case APP_LIB_DATA_NAME:
+            return Sim_data_open(version);
+        case APP_LIB_OTAP_NAME:
+            return Sim_otap_open(version);
+        case APP_LIB_SETTINGS_NAME:
+            return Sim_settings_open(version);
+        case APP_LIB_STATE_NAME:
+            return Sim_state_open(version);
+        case APP_LIB_LONGSLEEP_NAME:
+            return Sim_sleep_open(version);
+        case APP_LIB_STORAGE_NAME:
+            return Sim_storage_open(version);
+        case APP_LIB_SYSTEM_NAME:
+            return Sim_system_open(version);
+        case APP_LIB_TIME_NAME:
+            return Sim_time_open(version);
+        case APP_LIB_HARDWARE_NAME:
+            return Sim_hw_open(version);
+        case APP_LIB_RADIO_CFG_NAME:
+            return Sim_radio_cfg_open(version);
+        case APP_LIB_MEMORY_AREA_NAME:
+            return Sim_memory_area_open(version);
+        default:
+            return Sim_openExtraLibrary(name, version);
+    }
+}
+
+static const app_global_functions_t m_global_functions =
+{
+    .getApiVersion = get_api_version,
+    .getStackFirmwareVersion = get_stack_firmware_version,
+    .openLibrary = open_library,
+};
+
+__attribute__((weak))
+const void * Sim_openExtraLibrary(uint32_t name, uint32_t version)
+{
+    (void)name;
+    (void)version;
+    return NULL;
+}
+
+void Sim_abort(const char * msg)
+{
+    fprintf(stderr, "sim: %s\n", msg);
+    abort();
+}
+
+void Sim_fillUnimplemented(void * lib, size_t size, void (*trap)(void))
+{
+    // All the members of the library structures are function pointers
+    void (**func)(void) = lib;
+    for (size_t i = 0; i < size / sizeof(*func); i++)
+    {
+        func[i] = trap;
+    }
+}
+
+void Sim_init(bool virtual_time, const sim_config_t * config)
+{
+    m_virtual_time = virtual_time;
+    m_virtual_now = 0;
+    m_real_start = clock_us(CLOCK_MONOTONIC);
+    m_num_events = 0;
+    memset(&m_time_stats, 0, sizeof(m_time_stats));
+
+    Sim_state_init(config);
+    Sim_data_init(config);
+}
+
+static void boot(void * arg)
+{
+    (void)arg;
+    // Same sequence as _start() in mcu/common/start.c
+    if (!API_Open(&m_global_functions))
+    {
+        Sim_abort("cannot open the libraries");
+    }
+    Libraries_init();
+    App_init(&m_global_functions);
+}
+
+void Sim_start(void)
+{
+    Sim_dispatch(boot, NULL);
+}
+
+uint64_t Sim_now(void)
+{
+    if (m_virtual_time)
+    {
+        return m_virtual_now;
+    }
+    return clock_us(CLOCK_MONOTONIC) - m_real_start;
+}
+
+void Sim_advance(uint64_t delay_us)
+{
+    if (!m_virtual_time)
+    {
+        Sim_abort("Sim_advance() needs virtual time");
+    }
+    m_virtual_now += delay_us;
+}
+
+bool Sim_addEvent(uint64_t delay_us, sim_event_f cb, void * arg)
+{
+    if (m_num_events == SIM_MAX_EVENTS)
+    {
+        return false;
+    }
+    m_events[m_num_events].due = Sim_now() + delay_us;
+    m_events[m_num_events].seq = m_seq++;
+    m_events[m_num_events].cb = cb;
+    m_events[m_num_events].arg = arg;
+    m_num_events++;
+    return true;
+}
+
+void Sim_cancelEvent(sim_event_f cb)
+{
+    uint32_t i = 0;
+    while (i < m_num_events)
+    {
+        if (m_events[i].cb == cb)
+        {
+            m_events[i] = m_events[--m_num_events];
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void Sim_setReadable(int fd, sim_readable_f cb)
+{
+    m_fd = fd;
+    m_readable_cb = cb;
+    m_poll_fd = (fd >= 0);
+}
+
+void Sim_pollReadable(bool enabled)
+{
+    m_poll_fd = enabled && (m_fd >= 0);
+}
+
+void Sim_dispatch(sim_event_f cb, void * arg)
+{
+    if (m_dispatching)
+    {
+        // Already accounted by the outer dispatch
+        cb(arg);
+        return;
+    }
+    m_dispatching = true;
+    uint64_t start = clock_us(CLOCK_THREAD_CPUTIME_ID);
+    cb(arg);
+    m_dispatching = false;
+    uint64_t cpu = clock_us(CLOCK_THREAD_CPUTIME_ID) - start;
+    m_time_stats.cpu_us += cpu;
+    m_time_stats.events++;
+    if (cpu > m_time_stats.max_event_us)
+    {
+        m_time_stats.max_event_us = (uint32_t)cpu;
+    }
+}
+
+/** Index of the next event, -1 if none */
+static int next_event(void)
+{
+    int next = -1;
+    for (uint32_t i = 0; i < m_num_events; i++)
+    {
+        if ((next < 0) ||
+            (m_events[i].due < m_events[next].due) ||
+            ((m_events[i].due == m_events[next].due) &&
+             (m_events[i].seq < m_events[next].seq)))
+        {
+            next = (int)i;
+        }
+    }
+    return next;
+}
+
+/** Remove an event and call it */
+static void run_event(int index)
+{
+    sim_event_t event = m_events[index];
+    m_events[index] = m_events[--m_num_events];
+    Sim_dispatch(event.cb, event.arg);
+}
+
+/** Wait until the attached fd is readable or the timeout elapses */
+static void wait_readable(uint64_t timeout_us)
+{
+    struct pollfd pfd = { .fd = m_fd, .events = POLLIN };
+    struct timespec ts = {
+        .tv_sec = (time_t)(timeout_us / 1000000u),
+        .tv_nsec = (long)(timeout_us % 1000000u) * 1000,
+    };
+    int res = ppoll(&pfd, m_poll_fd ? 1 : 0, &ts, NULL);
+    if ((res > 0) && (pfd.revents & (POLLIN | POLLHUP)))
+    {
+        m_readable_cb(m_fd);
+    }
+}
+
+void Sim_run(uint64_t duration_us)
+{
+    uint64_t end = UINT64_MAX;
+    if (duration_us != UINT64_MAX)
+    {
+        end = Sim_now() + duration_us;
+    }
+
+    m_stop = 0;
+    while (!m_stop)
+    {
+        int next = next_event();
+        if (m_virtual_time)
+        {
+            if ((next < 0) || (m_events[next].due > end))
+            {
+                if (end != UINT64_MAX)
+                {
+                    m_virtual_now = end;
+                }
+                break;
+            }
+            if (m_events[next].due > m_virtual_now)
+            {
+                m_virtual_now = m_events[next].due;
+            }
+            run_event(next);
+            continue;
+        }
+
+        uint64_t now = Sim_now();
+        if (now >= end)
+        {
+            break;
+        }
+        uint64_t timeout = end - now;
+        if (next >= 0)
+        {
+            timeout = (m_events[next].due <= now) ?
+                            0 : m_events[next].due - now;
+        }
+        if (timeout > 1000000u)
+        {
+            // Wake-up regularly to check m_stop
+            timeout = 1000000u;
+        }
+        // Serial port is served between events, even if some are late
+        wait_readable(timeout);
+        // Events may have been added or removed meanwhile
+        next = next_event();
+        if ((next >= 0) && (m_events[next].due <= Sim_now()))
+        {
+            run_event(next);
+        }
+    }
+    m_time_stats.elapsed_us = Sim_now();
+}
+
+void Sim_stop(void)
+{
+    m_stop = 1;
+}
+
+void Sim_getTimeStats(sim_time_stats_t * stats)
+{
+    *stats = m_time_stats;
+    stats->elapsed_us = Sim_now();
+    stats->ds_disabled_us = Sim_system_getDsDisabledTime();
+}
@@ -0,0 +1,399 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/**
+ * \file    sim.h
+ * \brief   Host simulation of the stack services used by the libraries
+ *
+ *          The simulator opens the real SDK code (util/api.c, libraries/ and
+ *          the application) against simulated lib_* services and runs it from
+ *          a single threaded event loop:
+ *
+ *          - in real time, when a serial port (pseudo terminal) is attached,
+ *          - or in virtual time, where the clock jumps from one event to the
+ *            next, to replay traces much faster than real time.
+ *
+ *          Stack callbacks (periodic work, data sent, received packets,
+ *          beacons, scans...) are events of the loop. The CPU time spent in
+ *          them is measured, as the time the application keeps the MCU busy.
+ */
+#ifndef HOST_SIM_SIM_H_
+#define HOST_SIM_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "api.h"
+
+/** Event callback */
+typedef void (*sim_event_f)(void * arg);
+
+/** Called when the attached file descriptor is readable (real time only) */
+typedef void (*sim_readable_f)(int fd);
+
+/** Simulated node configuration, set before \ref Sim_start */
+typedef struct
+{
+    /** Node address, 0 to leave it unset */
+    app_addr_t                      node_address;
+    /** Network address, 0 to leave it unset */
+    app_lib_settings_net_addr_t     network_address;
+    /** Network channel, 0 to leave it unset */
+    app_lib_settings_net_channel_t  network_channel;
+    /** Node role, \ref app_lib_settings_role_e */
+    app_lib_settings_role_t         role;
+    /** True if the stack is started at boot */
+    bool                            started;
+    /** Time for the stack to send a packet, in microseconds */
+    uint32_t                        tx_delay_us;
+    /** Number of stack data buffers */
+    uint8_t                         num_buffers;
+    /** Default neighbor scan duration, in microseconds */
+    uint32_t                        scan_duration_us;
+} sim_config_t;
+
+/** Default configuration: sink with all settings set, stack stopped */
+#define SIM_CONFIG_DEFAULT                              \
+    {                                                   \
+        .node_address = 0x1,                            \
+        .network_address = 0xABCDEF,                    \
+        .network_channel = 5,                           \
+        .role = APP_LIB_SETTINGS_ROLE_SINK_LE,          \
+        .started = false,                               \
+        .tx_delay_us = 20000,                           \
+        .num_buffers = 16,                              \
+        .scan_duration_us = 50000,                      \
+    }
+
+/** Time accounting of the simulation */
+typedef struct
+{
+    /** Simulated time since start, in microseconds */
+    uint64_t    elapsed_us;
+    /** Host CPU time spent in the SDK code, in microseconds */
+    uint64_t    cpu_us;
+    /** Number of events dispatched to the SDK code */
+    uint32_t    events;
+    /** Longest single event, in microseconds of CPU time */
+    uint32_t    max_event_us;
+    /** Time deep sleep was disabled by the application, in microseconds */
+    uint64_t    ds_disabled_us;
+} sim_time_stats_t;
+
+/** Neighbor scans of the state library */
+typedef struct
+{
+    /** Neighbor scans started */
+    uint32_t    scans;
+    /** Time spent scanning, the radio is on, in microseconds */
+    uint64_t    scan_us;
+    /** Network beacons given to the application */
+    uint32_t    beacons;
+} sim_state_stats_t;
+
+/** Beacon transmissions of the beacon tx library */
+typedef struct
+{
+    /** Beacons sent, one per enabled channel */
+    uint32_t    beacons;
+    /** Radio-on time of the beacons, in microseconds */
+    uint64_t    airtime_us;
+} sim_beacon_stats_t;
+
+/** Called when a neighbor scan starts, to plan the beacons it receives */
+typedef void (*sim_scan_start_f)(uint32_t duration_us);
+
+/** Called for each packet accepted by sendData() */
+typedef void (*sim_data_tx_f)(const app_lib_data_to_send_t * data);
+
+/** Data services counters */
+typedef struct
+{
+    /** Packets accepted by sendData() */
+    uint32_t    tx_packets;
+    /** Payload bytes accepted by sendData() */
+    uint32_t    tx_bytes;
+    /** Packets refused by sendData() */
+    uint32_t    tx_refused;
+    /** Packets generated for the application */
+    uint32_t    rx_packets;
+    /** Packets handled by the application */
+    uint32_t    rx_handled;
+    /** Packets lost because the application did not take them in time */
+    uint32_t    rx_dropped;
+    /** Highest number of data buffers in use */
+    uint8_t     buffers_high_water;
+} sim_data_stats_t;
+
+/**
+ * \brief   Initialize the simulator
+ * \param   virtual_time
+ *          True to run in virtual time
+ * \param   config
+ *          Node configuration
+ */
+void Sim_init(bool virtual_time, const sim_config_t * config);
+
+/**
+ * \brief   Boot the SDK code, like the stack does for the application
+ *
+ *          Opens the libraries (API_Open), initializes the SDK libraries
+ *          (Libraries_init) and calls App_init().
+ */
+void Sim_start(void);
+
+/**
+ * \brief   Run the event loop
+ * \param   duration_us
+ *          How long to run, in microseconds of simulated time. UINT64_MAX to
+ *          run until \ref Sim_stop is called
+ */
+void Sim_run(uint64_t duration_us);
+
+/**
+ * \brief   Make \ref Sim_run return, can be called from a signal handler
+ */
+void Sim_stop(void);
+
+/**
+ * \brief   Simulated time since start
+ * \return  Time in microseconds
+ */
+uint64_t Sim_now(void);
+
+/**
+ * \brief   Move the simulated time forward, outside of the event loop
+ *
+ *          For tools calling the SDK code directly (virtual time only):
+ *          events due in between are not dispatched.
+ * \param   delay_us
+ *          Time to add, in microseconds
+ */
+void Sim_advance(uint64_t delay_us);
+
+/**
+ * \brief   Add an event
+ * \param   delay_us
+ *          Delay from now, in microseconds
+ * \param   cb
+ *          Callback to call
+ * \param   arg
+ *          Argument given to the callback
+ * \return  True if added, false if the event table is full
+ */
+bool Sim_addEvent(uint64_t delay_us, sim_event_f cb, void * arg);
+
+/**
+ * \brief   Remove all the pending events with the given callback
+ * \param   cb
+ *          Callback of the events to remove
+ */
+void Sim_cancelEvent(sim_event_f cb);
+
+/**
+ * \brief   Attach a file descriptor to the loop (real time only)
+ * \param   fd
+ *          File descriptor to poll, -1 to detach
+ * \param   cb
+ *          Called when fd is readable
+ */
+void Sim_setReadable(int fd, sim_readable_f cb);
+
+/**
+ * \brief   Enable or disable polling of the attached file descriptor
+ * \param   enabled
+ *          True to poll it
+ */
+void Sim_pollReadable(bool enabled);
+
+/**
+ * \brief   Run SDK code as an event: its CPU time is accounted
+ * \param   cb
+ *          Code to run
+ * \param   arg
+ *          Argument given to cb
+ */
+void Sim_dispatch(sim_event_f cb, void * arg);
+
+/**
+ * \brief   Get time accounting
+ * \param   stats
+ *          Filled with the statistics
+ */
+void Sim_getTimeStats(sim_time_stats_t * stats);
+
+/**
+ * \brief   Get data services counters
+ * \param   stats
+ *          Filled with the counters
+ */
+void Sim_getDataStats(sim_data_stats_t * stats);
+
+/**
+ * \brief   Set the listener of the packets sent by the SDK code
+ * \param   cb
+ *          Called when a packet is queued, NULL to stop
+ */
+void Sim_data_setTxListener(sim_data_tx_f cb);
+
+/**
+ * \brief   Generate received packets for the application
+ * \param   interval_us
+ *          Interval between packets, 0 to stop
+ * \param   num_bytes
+ *          Payload size
+ * \param   src_address
+ *          Address of the sender
+ * \param   endpoint
+ *          Source and destination endpoint
+ */
+void Sim_data_generateRx(uint32_t interval_us,
+                         uint8_t num_bytes,
+                         app_addr_t src_address,
+                         uint8_t endpoint);
+
+/**
+ * \brief   Give a packet to the application, as if received by the stack
+ * \param   data
+ *          Received packet
+ * \return  True if the application took it (or it was queued in the
+ *          stack until the application allows reception)
+ */
+bool Sim_data_receive(const app_lib_data_received_t * data);
+
+/**
+ * \brief   Neighbors returned by lib_state->getNbors()
+ * \param   nbors
+ *          Neighbors, copied
+ * \param   count
+ *          Number of neighbors
+ */
+void Sim_state_setNbors(const app_lib_state_nbor_info_t * nbors,
+                        uint32_t count);
+
+/**
+ * \brief   Notify the application of a received network beacon
+ * \param   beacon
+ *          Beacon received
+ */
+void Sim_state_receiveBeacon(const app_lib_state_beacon_rx_t * beacon);
+
+/**
+ * \brief   Notify the application of the end of a neighbor scan
+ * \param   app_originated
+ *          True if the scan was requested by the application
+ */
+void Sim_state_scanDone(bool app_originated);
+
+/**
+ * \brief   Be notified of the neighbor scans
+ * \param   cb
+ *          Called when a scan starts, NULL to stop
+ */
+void Sim_state_setScanListener(sim_scan_start_f cb);
+
+/**
+ * \brief   Get neighbor scans counters
+ * \param   stats
+ *          Filled with the counters
+ */
+void Sim_getStateStats(sim_state_stats_t * stats);
+
+/**
+ * \brief   Get beacon transmissions counters
+ * \param   stats
+ *          Filled with the counters
+ */
+void Sim_getBeaconStats(sim_beacon_stats_t * stats);
+
+/** Implemented by each simulated library */
+void Sim_data_init(const sim_config_t * config);
+void Sim_state_init(const sim_config_t * config);
+const void * Sim_data_open(uint32_t version);
+const void * Sim_otap_open(uint32_t version);
+const void * Sim_settings_open(uint32_t version);
+const void * Sim_state_open(uint32_t version);
+const void * Sim_sleep_open(uint32_t version);
+const void * Sim_storage_open(uint32_t version);
+const void * Sim_system_open(uint32_t version);
+const void * Sim_time_open(uint32_t version);
+const void * Sim_hw_open(uint32_t version);
+const void * Sim_radio_cfg_open(uint32_t version);
+const void * Sim_memory_area_open(uint32_t version);
+const void * Sim_beacon_tx_open(uint32_t version);
+const void * Sim_advertiser_open(uint32_t version);
+
+/**
+ * \brief   Library of the application (tools linking extra libraries)
+ *
+ *          Weak, return NULL by default. Tools simulating more libraries
+ *          (beacon tx, advertiser...) implement it.
+ * \param   name
+ *          Name of the library
+ * \param   version
+ *          Version of the library
+ * \return  Library functions, or NULL
+ */
+const void * Sim_openExtraLibrary(uint32_t name, uint32_t version);
+
+/**
+ * \brief   Fill a library with functions that abort the simulation
+ *
+ *          Used before setting the simulated services, so that calls to any
+ *          other service stop the simulation with an explicit message.
+ * \param   lib
+ *          Library functions
+ * \param   size
+ *          Size of the library structure
+ * \param   trap
+ *          Function called instead of the services not simulated
+ */
+void Sim_fillUnimplemented(void * lib, size_t size, void (*trap)(void));
+
+/** Helper to define the trap function of a library */
+#define SIM_UNIMPLEMENTED(name)                                             \
+    static void name##_unimplemented(void)                                  \
+    {                                                                       \
+        Sim_abort(#name ": service not simulated");                         \
+    }
+
+/**
+ * \brief   Stop the simulation on an unrecoverable error
+ * \param   msg
+ *          Message to print
+ */
+void Sim_abort(const char * msg) __attribute__((noreturn));
+
+/**
+ * \brief   Call the shutdown callback of the application, when the stack stops
+ */
+void Sim_system_shutdown(void);
+
+/**
+ * \brief   Time deep sleep was disabled with lib_system->disableDeepSleep()
+ * \return  Time in microseconds
+ */
+uint64_t Sim_system_getDsDisabledTime(void);
+
+/**
+ * \brief   Is the simulated stack started
+ * \return  True if started
+ */
+bool Sim_state_isStarted(void);
+
+/**
+ * \brief   Node address currently set
+ * \return  Node address, 0 if not set
+ */
+app_addr_t Sim_state_getNodeAddress(void);
+
+/**
+ * \brief   Node role currently set
+ * \return  Node role
+ */
+app_lib_settings_role_t Sim_state_getRole(void);
+
+#endif /* HOST_SIM_SIM_H_ */
@@ -0,0 +1,270 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/*
+ * Simulated beacon tx and advertiser libraries
+ *
+ * Beacons are not sent anywhere: while they are enabled, their transmissions
+ * are counted from the interval, with the airtime of a BLE 1M advertisement
+ * on each enabled channel. Payloads are sent in turn, like the stack does.
+ */
+
+#include <string.h>
+
+#include "sim.h"
+
+/** BLE 1M: preamble, access address, header and CRC, in bytes */
+#define SIM_BEACON_OVERHEAD_BYTES   10
+
+/** Radio ramp-up before each advertisement, in microseconds */
+#define SIM_BEACON_RAMP_UP_US       140
+
+/** Number of beacon payloads */
+#define SIM_BEACON_NUM              (APP_LIB_BEACON_TX_MAX_INDEX + 1)
+
+SIM_UNIMPLEMENTED(lib_beacon_tx)
+SIM_UNIMPLEMENTED(lib_advertiser)
+
+static app_lib_beacon_tx_t          m_beacon_tx;
+static app_lib_advertiser_t         m_advertiser;
+
+static bool                         m_enabled;
+static uint32_t                     m_interval_ms;
+static uint8_t                      m_num_bytes[SIM_BEACON_NUM];
+static app_lib_beacon_tx_channels_mask_e m_channels[SIM_BEACON_NUM];
+/** Time up to which transmissions are accounted */
+static uint64_t                     m_accounted;
+
+static sim_beacon_stats_t           m_stats;
+
+static app_llhead_acklistener_f     m_ack_cb;
+
+static uint32_t num_channels(app_lib_beacon_tx_channels_mask_e mask)
+{
+    switch (mask)
+    {
+        case APP_LIB_BEACON_TX_CHANNELS_37:
+        case APP_LIB_BEACON_TX_CHANNELS_38:
+        case APP_LIB_BEACON_TX_CHANNELS_39:
+            return 1;
+        case APP_LIB_BEACON_TX_CHANNELS_37_38:
+        case APP_LIB_BEACON_TX_CHANNELS_37_39:
+        case APP_LIB_BEACON_TX_CHANNELS_38_39:
+            return 2;
+        default:
+            return 3;
+    }
+}
+
+/** Account the transmissions since the last change of the beacons */
+static void account(void)
+{
+    uint64_t now = Sim_now();
+    uint32_t payloads = 0;
+    uint32_t beacons = 0;
+    uint64_t airtime_us = 0;
+
+    for (uint32_t i = 0; i < SIM_BEACON_NUM; i++)
+    {
+        if (m_num_bytes[i] == 0)
+        {
+            continue;
+        }
+        uint32_t channels = num_channels(m_channels[i]);
+        payloads++;
+        beacons += channels;
+        airtime_us += (uint64_t)channels *
+            (SIM_BEACON_RAMP_UP_US +
+             (m_num_bytes[i] + SIM_BEACON_OVERHEAD_BYTES) * 8u);
+    }
+
+    if (!m_enabled || (payloads == 0))
+    {
+        m_accounted = now;
+        return;
+    }
+
+    // Whole intervals only, the rest is accounted with the next change
+    uint64_t interval_us = (uint64_t)m_interval_ms * 1000u;
+    uint64_t sent = (now - m_accounted) / interval_us;
+    m_stats.beacons += (uint32_t)(sent * beacons / payloads);
+    m_stats.airtime_us += sent * airtime_us / payloads;
+    m_accounted += sent * interval_us;
+}
+
+static app_res_e clear_beacons(void)
+{
+    account();
+    m_enabled = false;
+    m_interval_ms = APP_LIB_BEACON_TX_DEFAULT_INTERVAL;
+    for (uint32_t i = 0; i < SIM_BEACON_NUM; i++)
+    {
+        m_num_bytes[i] = 0;
+        m_channels[i] = APP_LIB_BEACON_TX_CHANNELS_ALL;
+    }
+    return APP_RES_OK;
+}
+
+static app_res_e enable_beacons(bool enabled)
+{
+    if (!Sim_state_isStarted())
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    account();
+    m_enabled = enabled;
+    return APP_RES_OK;
+}
+
+static app_res_e set_beacon_interval(uint32_t interval)
+{
+    if (!Sim_state_isStarted())
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    if ((interval < APP_LIB_BEACON_TX_MIN_INTERVAL) ||
+        (interval > APP_LIB_BEACON_TX_MAX_INTERVAL))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    account();
+    m_interval_ms = interval;
+    return APP_RES_OK;
+}
+
+static app_res_e set_beacon_power(uint8_t index, int8_t * power_p)
+{
+    if (!Sim_state_isStarted())
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    if (index >= SIM_BEACON_NUM)
+    {
+        return APP_RES_RESOURCE_UNAVAILABLE;
+    }
+    // Only the 0 dBm to 8 dBm range of the simulated radio
+    if (*power_p > 8)
+    {
+        *power_p = 8;
+    }
+    else if (*power_p < 0)
+    {
+        *power_p = 0;
+    }
+    return APP_RES_OK;
+}
+
+static app_res_e set_beacon_channels(uint8_t index,
+                                     app_lib_beacon_tx_channels_mask_e mask)
+{
+    if (!Sim_state_isStarted())
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    if (index >= SIM_BEACON_NUM)
+    {
+        return APP_RES_RESOURCE_UNAVAILABLE;
+    }
+    if (mask > APP_LIB_BEACON_TX_CHANNELS_ALL)
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    account();
+    m_channels[index] = mask;
+    return APP_RES_OK;
+}
+
+static app_res_e set_beacon_contents(uint_fast8_t index,
+                                     const uint8_t * bytes,
+                                     size_t num_bytes)
+{
+    if (!Sim_state_isStarted())
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    if (index >= SIM_BEACON_NUM)
+    {
+        return APP_RES_RESOURCE_UNAVAILABLE;
+    }
+    if (num_bytes > APP_LIB_BEACON_TX_MAX_NUM_BYTES)
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    account();
+    m_num_bytes[index] = (bytes == NULL) ? 0 : (uint8_t)num_bytes;
+    return APP_RES_OK;
+}
+
+void Sim_getBeaconStats(sim_beacon_stats_t * stats)
+{
+    account();
+    *stats = m_stats;
+}
+
+const void * Sim_beacon_tx_open(uint32_t version)
+{
+    if (version > APP_LIB_BEACON_TX_VERSION)
+    {
+        return NULL;
+    }
+    clear_beacons();
+    memset(&m_stats, 0, sizeof(m_stats));
+    Sim_fillUnimplemented(&m_beacon_tx,
+                          sizeof(m_beacon_tx),
+                          lib_beacon_tx_unimplemented);
+    m_beacon_tx.clearBeacons = clear_beacons;
+    m_beacon_tx.enableBeacons = enable_beacons;
+    m_beacon_tx.setBeaconInterval = set_beacon_interval;
+    m_beacon_tx.setBeaconPower = set_beacon_power;
+    m_beacon_tx.setBeaconChannels = set_beacon_channels;
+    m_beacon_tx.setBeaconContents = set_beacon_contents;
+    return &m_beacon_tx;
+}
+
+/*
+ * lib_advertiser: options are only checked
+ */
+
+static bool is_advertiser(void)
+{
+    return Sim_state_getRole() == APP_LIB_SETTINGS_ROLE_ADVERTISER;
+}
+
+static void set_router_ack_gen_cb(app_llhead_acklistener_f callback)
+{
+    m_ack_cb = callback;
+}
+
+static app_res_e set_queuing_time_hp(uint16_t time_ms)
+{
+    (void)time_ms;
+    return is_advertiser() ? APP_RES_OK : APP_RES_INVALID_CONFIGURATION;
+}
+
+static app_res_e set_options(adv_option_t * option)
+{
+    if (option == NULL)
+    {
+        return APP_RES_INVALID_NULL_POINTER;
+    }
+    return is_advertiser() ? APP_RES_OK : APP_RES_INVALID_CONFIGURATION;
+}
+
+const void * Sim_advertiser_open(uint32_t version)
+{
+    if (version > APP_LIB_ADVERTISER_VERSION)
+    {
+        return NULL;
+    }
+    m_ack_cb = NULL;
+    Sim_fillUnimplemented(&m_advertiser,
+                          sizeof(m_advertiser),
+                          lib_advertiser_unimplemented);
+    m_advertiser.setRouterAckGenCb = set_router_ack_gen_cb;
+    m_advertiser.setQueuingTimeHp = set_queuing_time_hp;
+    m_advertiser.setOptions = set_options;
+    return &m_advertiser;
+}
@@ -0,0 +1,553 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/*
+ * Simulated data library
+ *
+ * Packets given to sendData() take a data buffer until the stack has sent
+ * them, one after the other, each one taking tx_delay_us. Packets sent to
+ * the node itself are looped back to the application. Received packets the
+ * application has no room for (APP_LIB_DATA_RECEIVE_RES_NO_SPACE) are held
+ * in data buffers too, until reception is allowed again.
+ */
+
+#include <string.h>
+
+#include "sim.h"
+
+/** Maximum payload of a packet, without fragmentation */
+#define SIM_DATA_MAX_NUM_BYTES      102
+
+/** Maximum number of data buffers */
+#define SIM_DATA_MAX_BUFFERS        32
+
+/** Default maximum queuing time, in seconds */
+#define SIM_DATA_DEFAULT_QUEUING_S  1800
+
+SIM_UNIMPLEMENTED(lib_data)
+
+typedef struct
+{
+    app_lib_data_to_send_t  data;
+    /** Time sendData() was called */
+    uint64_t                queued;
+    uint8_t                 bytes[SIM_DATA_MAX_NUM_BYTES];
+} sim_tx_buffer_t;
+
+typedef struct
+{
+    app_lib_data_received_t data;
+    uint8_t                 bytes[SIM_DATA_MAX_NUM_BYTES];
+} sim_rx_buffer_t;
+
+/** Packet generator, see Sim_data_generateRx() */
+typedef struct
+{
+    uint32_t                interval_us;
+    uint8_t                 num_bytes;
+    app_addr_t              src_address;
+    uint8_t                 endpoint;
+    uint8_t                 counter;
+} sim_rx_generator_t;
+
+static app_lib_data_t                   m_data;
+
+static app_lib_data_data_received_cb_f  m_received_cb;
+static app_lib_data_data_sent_cb_f      m_sent_cb;
+static app_lib_data_new_app_config_cb_f m_new_app_config_cb;
+
+static uint8_t                          m_num_buffers;
+static uint32_t                         m_tx_delay_us;
+
+/** Packets waiting to be sent, FIFO */
+static sim_tx_buffer_t                  m_tx[SIM_DATA_MAX_BUFFERS];
+static uint8_t                          m_tx_first;
+static uint8_t                          m_tx_count;
+
+/** Packets waiting for the application to allow reception, FIFO */
+static sim_rx_buffer_t                  m_rx[SIM_DATA_MAX_BUFFERS];
+static uint8_t                          m_rx_first;
+static uint8_t                          m_rx_count;
+static bool                             m_reception_allowed;
+
+static sim_rx_generator_t               m_generator;
+
+static uint8_t                          m_app_config[
+                                            APP_LIB_DATA_MAX_APP_CONFIG_NUM_BYTES];
+static uint8_t                          m_app_config_seq;
+static uint16_t                         m_diag_interval;
+
+static uint16_t                         m_queuing_time[2];
+
+static sim_data_stats_t                 m_stats;
+static sim_data_tx_f                    m_tx_listener;
+
+static uint8_t buffers_in_use(void)
+{
+    return m_tx_count + m_rx_count;
+}
+
+static void update_high_water(void)
+{
+    if (buffers_in_use() > m_stats.buffers_high_water)
+    {
+        m_stats.buffers_high_water = buffers_in_use();
+    }
+}
+
+static app_res_e set_data_received_cb(app_lib_data_data_received_cb_f cb)
+{
+    m_received_cb = cb;
+    return APP_RES_OK;
+}
+
+static app_res_e set_data_sent_cb(app_lib_data_data_sent_cb_f cb)
+{
+    m_sent_cb = cb;
+    return APP_RES_OK;
+}
+
+static app_res_e set_new_app_config_cb(app_lib_data_new_app_config_cb_f cb)
+{
+    m_new_app_config_cb = cb;
+    return APP_RES_OK;
+}
+
+static app_lib_data_data_size_t get_data_max_num_bytes(void)
+{
+    app_lib_data_data_size_t size = {
+        .max_data_size = SIM_DATA_MAX_NUM_BYTES,
+        .max_fragment_size = SIM_DATA_MAX_NUM_BYTES,
+    };
+    return size;
+}
+
+static size_t get_num_buffers(void)
+{
+    return m_num_buffers;
+}
+
+static app_res_e get_num_free_buffers(size_t * num_buffers_p)
+{
+    if (!Sim_state_isStarted())
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    *num_buffers_p = m_num_buffers - buffers_in_use();
+    return APP_RES_OK;
+}
+
+/** Deliver a packet to the application, false if it has no room for it */
+static bool deliver(const app_lib_data_received_t * data)
+{
+    if (m_received_cb == NULL)
+    {
+        return true;
+    }
+    if (m_received_cb(data) == APP_LIB_DATA_RECEIVE_RES_NO_SPACE)
+    {
+        return false;
+    }
+    m_stats.rx_handled++;
+    return true;
+}
+
+/** Keep a packet until reception is allowed again */
+static bool hold(const app_lib_data_received_t * data)
+{
+    if (buffers_in_use() == m_num_buffers)
+    {
+        m_stats.rx_dropped++;
+        return false;
+    }
+
+    sim_rx_buffer_t * buffer =
+        &m_rx[(m_rx_first + m_rx_count) % SIM_DATA_MAX_BUFFERS];
+    buffer->data = *data;
+    memcpy(buffer->bytes, data->bytes, data->num_bytes);
+    buffer->data.bytes = buffer->bytes;
+    // Fragment information is not kept
+    buffer->data.fragment_info = NULL;
+    m_rx_count++;
+    update_high_water();
+    return true;
+}
+
+static void deliver_held(void * arg)
+{
+    (void)arg;
+    while (m_reception_allowed && (m_rx_count > 0))
+    {
+        if (!deliver(&m_rx[m_rx_first].data))
+        {
+            m_reception_allowed = false;
+            break;
+        }
+        m_rx_first = (m_rx_first + 1) % SIM_DATA_MAX_BUFFERS;
+        m_rx_count--;
+    }
+}
+
+bool Sim_data_receive(const app_lib_data_received_t * data)
+{
+    // Packets are delivered in order: none can overtake the held ones
+    if (m_reception_allowed && (m_rx_count == 0))
+    {
+        if (deliver(data))
+        {
+            return true;
+        }
+        m_reception_allowed = false;
+    }
+    return hold(data);
+}
+
+static void allow_reception(bool allow)
+{
+    m_reception_allowed = allow;
+    if (allow && (m_rx_count > 0))
+    {
+        // The stack delivers held packets later, not from this call
+        Sim_cancelEvent(deliver_held);
+        Sim_addEvent(0, deliver_held, NULL);
+    }
+}
+
+static void loopback(const sim_tx_buffer_t * buffer)
+{
+    app_lib_data_received_t data = {
+        .bytes = buffer->data.bytes,
+        .num_bytes = buffer->data.num_bytes,
+        .src_address = buffer->data.dest_address,
+        .delay = 0,
+        .qos = buffer->data.qos,
+        .src_endpoint = buffer->data.src_endpoint,
+        .dest_endpoint = buffer->data.dest_endpoint,
+        .hops = 0,
+        .dest_address = buffer->data.dest_address,
+        .mac_src_address = buffer->data.dest_address,
+        .tx_power = 0,
+        .rssi = 0,
+        .delay_hp = 0,
+        .fragment_info = NULL,
+    };
+    m_stats.rx_packets++;
+    Sim_data_receive(&data);
+}
+
+static void tx_done(void * arg)
+{
+    (void)arg;
+    sim_tx_buffer_t buffer = m_tx[m_tx_first];
+    buffer.data.bytes = buffer.bytes;
+    m_tx_first = (m_tx_first + 1) % SIM_DATA_MAX_BUFFERS;
+    m_tx_count--;
+
+    if (m_tx_count > 0)
+    {
+        Sim_addEvent(m_tx_delay_us, tx_done, NULL);
+    }
+
+    if ((buffer.data.flags & APP_LIB_DATA_SEND_FLAG_TRACK) &&
+        (m_sent_cb != NULL))
+    {
+        app_lib_data_sent_status_t status = {
+            .dest_address = buffer.data.dest_address,
+            // In 1/128 s
+            .queue_time = (uint32_t)((Sim_now() - buffer.queued) * 128 /
+                                     1000000u),
+            .tracking_id = buffer.data.tracking_id,
+            .src_endpoint = buffer.data.src_endpoint,
+            .dest_endpoint = buffer.data.dest_endpoint,
+            .success = true,
+        };
+        m_sent_cb(&status);
+    }
+
+    if (buffer.data.dest_address == Sim_state_getNodeAddress())
+    {
+        loopback(&buffer);
+    }
+}
+
+static app_lib_data_send_res_e send_data(const app_lib_data_to_send_t * data)
+{
+    app_lib_data_send_res_e res = APP_LIB_DATA_SEND_RES_SUCCESS;
+
+    if (!Sim_state_isStarted())
+    {
+        res = APP_LIB_DATA_SEND_RES_INVALID_STACK_STATE;
+    }
+    else if ((data->num_bytes == 0) ||
+             (data->num_bytes > SIM_DATA_MAX_NUM_BYTES))
+    {
+        res = APP_LIB_DATA_SEND_RES_INVALID_NUM_BYTES;
+    }
+    else if (data->qos > APP_LIB_DATA_QOS_HIGH)
+    {
+        res = APP_LIB_DATA_SEND_RES_INVALID_QOS;
+    }
+    else if (buffers_in_use() == m_num_buffers)
+    {
+        res = APP_LIB_DATA_SEND_RES_OUT_OF_MEMORY;
+    }
+
+    if (res != APP_LIB_DATA_SEND_RES_SUCCESS)
+    {
+        m_stats.tx_refused++;
+        return res;
+    }
+
+    sim_tx_buffer_t * buffer =
+        &m_tx[(m_tx_first + m_tx_count) % SIM_DATA_MAX_BUFFERS];
+    buffer->data = *data;
+    buffer->queued = Sim_now();
+    memcpy(buffer->bytes, data->bytes, data->num_bytes);
+    if (m_tx_count++ == 0)
+    {
+        Sim_addEvent(m_tx_delay_us, tx_done, NULL);
+    }
+    update_high_water();
+
+    m_stats.tx_packets++;
+    m_stats.tx_bytes += data->num_bytes;
+    if (m_tx_listener != NULL)
+    {
+        m_tx_listener(data);
+    }
+    return res;
+}
+
+static void generate_rx(void * arg)
+{
+    (void)arg;
+    uint8_t bytes[SIM_DATA_MAX_NUM_BYTES];
+    memset(bytes, m_generator.counter++, m_generator.num_bytes);
+
+    app_lib_data_received_t data = {
+        .bytes = bytes,
+        .num_bytes = m_generator.num_bytes,
+        .src_address = m_generator.src_address,
+        .delay = 0,
+        .qos = APP_LIB_DATA_QOS_NORMAL,
+        .src_endpoint = m_generator.endpoint,
+        .dest_endpoint = m_generator.endpoint,
+        .hops = 1,
+        .dest_address = Sim_state_getNodeAddress(),
+        .mac_src_address = m_generator.src_address,
+        .tx_power = 8,
+        .rssi = -60,
+        .delay_hp = 0,
+        .fragment_info = NULL,
+    };
+    m_stats.rx_packets++;
+    if (Sim_state_isStarted())
+    {
+        Sim_data_receive(&data);
+    }
+    else
+    {
+        m_stats.rx_dropped++;
+    }
+
+    Sim_addEvent(m_generator.interval_us, generate_rx, NULL);
+}
+
+void Sim_data_generateRx(uint32_t interval_us,
+                         uint8_t num_bytes,
+                         app_addr_t src_address,
+                         uint8_t endpoint)
+{
+    Sim_cancelEvent(generate_rx);
+    if (num_bytes > SIM_DATA_MAX_NUM_BYTES)
+    {
+        num_bytes = SIM_DATA_MAX_NUM_BYTES;
+    }
+    m_generator.interval_us = interval_us;
+    m_generator.num_bytes = num_bytes;
+    m_generator.src_address = src_address;
+    m_generator.endpoint = endpoint;
+    if (interval_us > 0)
+    {
+        Sim_addEvent(interval_us, generate_rx, NULL);
+    }
+}
+
+static app_lib_data_app_config_res_e read_app_config(uint8_t * bytes,
+                                                     uint8_t * seq,
+                                                     uint16_t * interval)
+{
+    if ((bytes == NULL) || (seq == NULL) || (interval == NULL))
+    {
+        return APP_LIB_DATA_APP_CONFIG_RES_INVALID_NULL_POINTER;
+    }
+    memcpy(bytes, m_app_config, sizeof(m_app_config));
+    *seq = m_app_config_seq;
+    *interval = m_diag_interval;
+    return APP_LIB_DATA_APP_CONFIG_RES_SUCCESS;
+}
+
+static size_t get_app_config_num_bytes(void)
+{
+    return sizeof(m_app_config);
+}
+
+static app_res_e set_max_msg_queuing_time(app_lib_data_qos_e priority,
+                                          uint16_t time)
+{
+    if ((priority > APP_LIB_DATA_QOS_HIGH) || (time < 2))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    m_queuing_time[priority] = time;
+    return APP_RES_OK;
+}
+
+static app_res_e get_max_msg_queuing_time(app_lib_data_qos_e priority,
+                                          uint16_t * time_p)
+{
+    if (priority > APP_LIB_DATA_QOS_HIGH)
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    *time_p = m_queuing_time[priority];
+    return APP_RES_OK;
+}
+
+static void notify_app_config(void * arg)
+{
+    (void)arg;
+    if (m_new_app_config_cb != NULL)
+    {
+        m_new_app_config_cb(m_app_config, m_app_config_seq, m_diag_interval);
+    }
+}
+
+/** App config is only written by sinks, the change is spread by the stack */
+static app_lib_data_app_config_res_e check_sink(void)
+{
+    app_lib_settings_role_t role = Sim_state_getRole();
+    if ((role != APP_LIB_SETTINGS_ROLE_SINK_LE) &&
+        (role != APP_LIB_SETTINGS_ROLE_SINK_LL))
+    {
+        return APP_LIB_DATA_APP_CONFIG_RES_INVALID_ROLE;
+    }
+    return APP_LIB_DATA_APP_CONFIG_RES_SUCCESS;
+}
+
+static void app_config_updated(void)
+{
+    m_app_config_seq++;
+    Sim_cancelEvent(notify_app_config);
+    Sim_addEvent(0, notify_app_config, NULL);
+}
+
+static app_lib_data_app_config_res_e write_app_config_data(
+                                                    const uint8_t * bytes)
+{
+    app_lib_data_app_config_res_e res = check_sink();
+    if (res != APP_LIB_DATA_APP_CONFIG_RES_SUCCESS)
+    {
+        return res;
+    }
+    if (bytes == NULL)
+    {
+        return APP_LIB_DATA_APP_CONFIG_RES_INVALID_NULL_POINTER;
+    }
+    memcpy(m_app_config, bytes, sizeof(m_app_config));
+    app_config_updated();
+    return res;
+}
+
+static app_lib_data_app_config_res_e write_diagnostic_interval(
+                                                    uint16_t interval)
+{
+    app_lib_data_app_config_res_e res = check_sink();
+    if (res != APP_LIB_DATA_APP_CONFIG_RES_SUCCESS)
+    {
+        return res;
+    }
+    switch (interval)
+    {
+        case 0:
+        case 30:
+        case 60:
+        case 120:
+        case 300:
+        case 600:
+        case 1800:
+            break;
+        default:
+            return APP_LIB_DATA_APP_CONFIG_RES_INVALID_INTERVAL;
+    }
+    m_diag_interval = interval;
+    app_config_updated();
+    return res;
+}
+
+static app_res_e set_fragment_mode(const app_lib_data_fragmented_mode_e mode)
+{
+    // Packets are never fragmented in the simulation
+    (void)mode;
+    return APP_RES_OK;
+}
+
+void Sim_getDataStats(sim_data_stats_t * stats)
+{
+    *stats = m_stats;
+}
+
+void Sim_data_setTxListener(sim_data_tx_f cb)
+{
+    m_tx_listener = cb;
+}
+
+void Sim_data_init(const sim_config_t * config)
+{
+    m_num_buffers = config->num_buffers;
+    if (m_num_buffers > SIM_DATA_MAX_BUFFERS)
+    {
+        m_num_buffers = SIM_DATA_MAX_BUFFERS;
+    }
+    m_tx_delay_us = config->tx_delay_us;
+    m_tx_first = 0;
+    m_tx_count = 0;
+    m_rx_first = 0;
+    m_rx_count = 0;
+    m_reception_allowed = true;
+    // Like a sink provisioned with an empty app config, so it can start
+    memset(m_app_config, 0, sizeof(m_app_config));
+    m_app_config_seq = 0;
+    m_diag_interval = 0;
+    m_queuing_time[APP_LIB_DATA_QOS_NORMAL] = SIM_DATA_DEFAULT_QUEUING_S;
+    m_queuing_time[APP_LIB_DATA_QOS_HIGH] = SIM_DATA_DEFAULT_QUEUING_S;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+const void * Sim_data_open(uint32_t version)
+{
+    if (version > APP_LIB_DATA_VERSION)
+    {
+        return NULL;
+    }
+    Sim_fillUnimplemented(&m_data, sizeof(m_data), lib_data_unimplemented);
+    m_data.setDataReceivedCb = set_data_received_cb;
+    m_data.setDataSentCb = set_data_sent_cb;
+    m_data.setNewAppConfigCb = set_new_app_config_cb;
+    m_data.getDataMaxNumBytes = get_data_max_num_bytes;
+    m_data.getNumBuffers = get_num_buffers;
+    m_data.getNumFreeBuffers = get_num_free_buffers;
+    m_data.sendData = send_data;
+    m_data.allowReception = allow_reception;
+    m_data.readAppConfig = read_app_config;
+    m_data.getAppConfigNumBytes = get_app_config_num_bytes;
+    m_data.setMaxMsgQueuingTime = set_max_msg_queuing_time;
+    m_data.getMaxMsgQueuingTime = get_max_msg_queuing_time;
+    m_data.writeAppConfigData = write_app_config_data;
+    m_data.writeDiagnosticInterval = write_diagnostic_interval;
+    m_data.setFragmentMode = set_fragment_mode;
+    return &m_data;
+}
@@ -0,0 +1,56 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/*
+ * Libraries API_Open() requires but the simulated code does not use
+ *
+ * Hardware, radio configuration and memory area libraries only trap: any call
+ * stops the simulation with the name of the library.
+ */
+
+#include "sim.h"
+
+SIM_UNIMPLEMENTED(lib_hw)
+SIM_UNIMPLEMENTED(lib_radio_cfg)
+SIM_UNIMPLEMENTED(lib_memory_area)
+
+static app_lib_hardware_t       m_hw;
+static app_lib_radio_cfg_t      m_radio_cfg;
+static app_lib_memory_area_t    m_memory_area;
+
+const void * Sim_hw_open(uint32_t version)
+{
+    if (version > APP_LIB_HARDWARE_VERSION)
+    {
+        return NULL;
+    }
+    Sim_fillUnimplemented(&m_hw, sizeof(m_hw), lib_hw_unimplemented);
+    return &m_hw;
+}
+
+const void * Sim_radio_cfg_open(uint32_t version)
+{
+    if (version > APP_LIB_RADIO_CFG_VERSION)
+    {
+        return NULL;
+    }
+    Sim_fillUnimplemented(&m_radio_cfg,
+                          sizeof(m_radio_cfg),
+                          lib_radio_cfg_unimplemented);
+    return &m_radio_cfg;
+}
+
+const void * Sim_memory_area_open(uint32_t version)
+{
+    if (version > APP_LIB_MEMORY_AREA_VERSION)
+    {
+        return NULL;
+    }
+    Sim_fillUnimplemented(&m_memory_area,
+                          sizeof(m_memory_area),
+                          lib_memory_area_unimplemented);
+    return &m_memory_area;
+}
@@ -0,0 +1,261 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/*
+ * Simulated OTAP library
+ *
+ * The scratchpad is kept in RAM and written in sequence. Its contents are not
+ * checked like the stack does (header, firmware signatures): a complete
+ * scratchpad is always valid and its CRC is computed over all its bytes. The
+ * bootloader never processes it.
+ */
+
+#include <string.h>
+
+#include "sim.h"
+#include "crc.h"
+
+/** Size of the scratchpad area */
+#define SIM_OTAP_MAX_NUM_BYTES      (256 * 1024)
+
+/** Largest write accepted at once */
+#define SIM_OTAP_MAX_BLOCK_NUM_BYTES 1024
+
+SIM_UNIMPLEMENTED(lib_otap)
+
+static app_lib_otap_t           m_otap;
+
+static uint8_t                  m_scratchpad[SIM_OTAP_MAX_NUM_BYTES];
+/** Expected size of the scratchpad, 0 if none */
+static size_t                   m_num_bytes;
+/** Bytes written so far */
+static size_t                   m_written;
+static bool                     m_ongoing;
+static app_lib_otap_seq_t       m_seq;
+static uint16_t                 m_crc;
+static app_lib_otap_type_e      m_type;
+
+static app_lib_otap_seq_t       m_target_seq;
+static uint16_t                 m_target_crc;
+static app_lib_otap_action_e    m_target_action;
+static uint8_t                  m_target_delay;
+
+static size_t get_max_num_bytes(void)
+{
+    return sizeof(m_scratchpad);
+}
+
+static size_t get_num_bytes(void)
+{
+    return (m_type == APP_LIB_OTAP_TYPE_BLANK) ? 0 : m_num_bytes;
+}
+
+static size_t get_max_block_num_bytes(void)
+{
+    return SIM_OTAP_MAX_BLOCK_NUM_BYTES;
+}
+
+static app_lib_otap_seq_t get_seq(void)
+{
+    return m_seq;
+}
+
+static uint16_t get_crc(void)
+{
+    return (m_type == APP_LIB_OTAP_TYPE_BLANK) ? 0 : m_crc;
+}
+
+static app_lib_otap_type_e get_type(void)
+{
+    return m_type;
+}
+
+static app_lib_otap_status_e get_status(void)
+{
+    return APP_LIB_OTAP_STATUS_NEW;
+}
+
+static size_t get_processed_num_bytes(void)
+{
+    return 0;
+}
+
+static app_lib_otap_seq_t get_processed_seq(void)
+{
+    return 0;
+}
+
+static uint16_t get_processed_crc(void)
+{
+    return 0;
+}
+
+static uint32_t get_processed_area_id(void)
+{
+    return 0;
+}
+
+static bool is_valid(void)
+{
+    return m_type != APP_LIB_OTAP_TYPE_BLANK;
+}
+
+static bool is_processed(void)
+{
+    return false;
+}
+
+static bool is_set_to_be_processed(void)
+{
+    return m_type == APP_LIB_OTAP_TYPE_PROCESS;
+}
+
+static app_res_e read_scratchpad(uint32_t start,
+                                 size_t num_bytes,
+                                 void * bytes)
+{
+    if (m_type == APP_LIB_OTAP_TYPE_BLANK)
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    if ((start > m_num_bytes) || (num_bytes > m_num_bytes - start))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    memcpy(bytes, &m_scratchpad[start], num_bytes);
+    return APP_RES_OK;
+}
+
+static app_res_e clear_scratchpad(void)
+{
+    m_ongoing = false;
+    m_num_bytes = 0;
+    m_written = 0;
+    m_type = APP_LIB_OTAP_TYPE_BLANK;
+    return APP_RES_OK;
+}
+
+static app_res_e begin_scratchpad(size_t num_bytes, app_lib_otap_seq_t seq)
+{
+    if ((num_bytes == 0) || (num_bytes > sizeof(m_scratchpad)) ||
+        (num_bytes % 16 != 0))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    clear_scratchpad();
+    m_num_bytes = num_bytes;
+    m_seq = seq;
+    m_ongoing = true;
+    return APP_RES_OK;
+}
+
+static app_lib_otap_write_res_e write_scratchpad(uint32_t start,
+                                                 size_t num_bytes,
+                                                 const void * bytes)
+{
+    if (!m_ongoing)
+    {
+        return APP_LIB_OTAP_WRITE_RES_NOT_ONGOING;
+    }
+    if (bytes == NULL)
+    {
+        return APP_LIB_OTAP_WRITE_RES_INVALID_NULL_BYTES;
+    }
+    if (start != m_written)
+    {
+        return APP_LIB_OTAP_WRITE_RES_INVALID_START;
+    }
+    if ((num_bytes == 0) ||
+        (num_bytes > SIM_OTAP_MAX_BLOCK_NUM_BYTES) ||
+        (num_bytes > m_num_bytes - m_written))
+    {
+        return APP_LIB_OTAP_WRITE_RES_INVALID_NUM_BYTES;
+    }
+
+    memcpy(&m_scratchpad[start], bytes, num_bytes);
+    m_written += num_bytes;
+    if (m_written < m_num_bytes)
+    {
+        return APP_LIB_OTAP_WRITE_RES_OK;
+    }
+
+    m_ongoing = false;
+    m_crc = Crc_fromBuffer(m_scratchpad, (uint32_t)m_num_bytes);
+    m_type = APP_LIB_OTAP_TYPE_PRESENT;
+    return APP_LIB_OTAP_WRITE_RES_COMPLETED_OK;
+}
+
+static app_res_e set_to_be_processed(void)
+{
+    if (m_type == APP_LIB_OTAP_TYPE_BLANK)
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    m_type = APP_LIB_OTAP_TYPE_PROCESS;
+    return APP_RES_OK;
+}
+
+static app_res_e set_target_scratchpad_and_action(
+                                        app_lib_otap_seq_t target_sequence,
+                                        uint16_t target_crc,
+                                        app_lib_otap_action_e action,
+                                        uint8_t delay)
+{
+    if (action > APP_LIB_OTAP_ACTION_LEGACY)
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    m_target_seq = target_sequence;
+    m_target_crc = target_crc;
+    m_target_action = action;
+    m_target_delay = delay;
+    return APP_RES_OK;
+}
+
+static app_res_e get_target_scratchpad_and_action(
+                                        app_lib_otap_seq_t * target_sequence,
+                                        uint16_t * target_crc,
+                                        app_lib_otap_action_e * action,
+                                        uint8_t * delay)
+{
+    *target_sequence = m_target_seq;
+    *target_crc = m_target_crc;
+    // MSAP passes a uint8_t here: the stack only writes one byte
+    *(uint8_t *)action = (uint8_t)m_target_action;
+    *delay = m_target_delay;
+    return APP_RES_OK;
+}
+
+const void * Sim_otap_open(uint32_t version)
+{
+    if (version > APP_LIB_OTAP_VERSION)
+    {
+        return NULL;
+    }
+    Sim_fillUnimplemented(&m_otap, sizeof(m_otap), lib_otap_unimplemented);
+    m_otap.getMaxNumBytes = get_max_num_bytes;
+    m_otap.getNumBytes = get_num_bytes;
+    m_otap.getMaxBlockNumBytes = get_max_block_num_bytes;
+    m_otap.getSeq = get_seq;
+    m_otap.getCrc = get_crc;
+    m_otap.getType = get_type;
+    m_otap.getStatus = get_status;
+    m_otap.getProcessedNumBytes = get_processed_num_bytes;
+    m_otap.getProcessedSeq = get_processed_seq;
+    m_otap.getProcessedCrc = get_processed_crc;
+    m_otap.getProcessedAreaId = get_processed_area_id;
+    m_otap.isValid = is_valid;
+    m_otap.isProcessed = is_processed;
+    m_otap.isSetToBeProcessed = is_set_to_be_processed;
+    m_otap.read = read_scratchpad;
+    m_otap.clear = clear_scratchpad;
+    m_otap.begin = begin_scratchpad;
+    m_otap.write = write_scratchpad;
+    m_otap.setToBeProcessed = set_to_be_processed;
+    m_otap.setTargetScratchpadAndAction = set_target_scratchpad_and_action;
+    m_otap.getTargetScratchpadAndAction = get_target_scratchpad_and_action;
+    return &m_otap;
+}
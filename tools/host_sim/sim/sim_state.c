@@ -0,0 +1,991 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/*
+ * Simulated state, settings and sleep libraries
+ *
+ * Settings are kept in RAM. Unlike the real stack, stopping the stack does
+ * not reboot the node: the shutdown callback is called and the simulation
+ * goes on with the stack stopped.
+ */
+
+#include <string.h>
+
+#include "sim.h"
+
+/** Network channels of the simulated radio (2.4 GHz profile) */
+#define SIM_CHANNEL_MIN         1
+#define SIM_CHANNEL_MAX         40
+
+/** Access cycle limits, in milliseconds */
+#define SIM_AC_MIN              2000
+#define SIM_AC_MAX              8000
+
+/** Maximum number of neighbors */
+#define SIM_MAX_NBORS           16
+
+SIM_UNIMPLEMENTED(lib_state)
+SIM_UNIMPLEMENTED(lib_settings)
+SIM_UNIMPLEMENTED(lib_sleep)
+
+typedef struct
+{
+    app_addr_t                      node_address;
+    app_lib_settings_net_addr_t     network_address;
+    app_lib_settings_net_channel_t  network_channel;
+    app_lib_settings_role_t         role;
+    bool                            role_set;
+    uint8_t                         authentication_key[
+                                        APP_LIB_SETTINGS_AES_KEY_NUM_BYTES];
+    uint8_t                         encryption_key[
+                                        APP_LIB_SETTINGS_AES_KEY_NUM_BYTES];
+    uint8_t                         feature_lock_key[
+                                        APP_LIB_SETTINGS_AES_KEY_NUM_BYTES];
+    uint32_t                        feature_lock_bits;
+    uint16_t                        ac_min;
+    uint16_t                        ac_max;
+    uint16_t                        offline_scan;
+    uint32_t                        channel_map;
+    /** One bit per channel, channel 1 is bit 0 */
+    uint8_t                         reserved_channels[
+                                        (SIM_CHANNEL_MAX + 7) / 8];
+} sim_settings_t;
+
+static app_lib_state_t                  m_state;
+static app_lib_settings_t               m_settings_lib;
+static app_lib_sleep_t                  m_sleep;
+
+static sim_settings_t                   m_settings;
+
+static bool                             m_started;
+static uint8_t                          m_energy;
+static uint8_t                          m_sink_cost;
+
+static app_lib_state_nbor_info_t        m_nbors[SIM_MAX_NBORS];
+static uint32_t                         m_num_nbors;
+
+static app_lib_state_on_beacon_cb_f     m_beacon_cb;
+static app_lib_state_on_scan_nbors_cb_f m_scan_nbors_cb;
+static app_lib_state_on_scan_start_cb_f m_scan_start_cb;
+static app_lib_state_route_changed_cb_f m_route_cb;
+static app_lib_settings_is_group_cb_f   m_group_cb;
+static uint32_t                         m_scan_duration_us;
+static uint32_t                         m_default_scan_us;
+static bool                             m_scanning;
+static uint64_t                         m_scan_start;
+static sim_scan_start_f                 m_scan_listener;
+static sim_state_stats_t                m_stats;
+
+/** Stack sleep, see lib_sleep */
+static app_lib_sleep_stack_state_e      m_sleep_state;
+static uint32_t                         m_sleep_time_s;
+static uint64_t                         m_sleep_end;
+static applib_wakeup_callback_f         m_wakeup_cb;
+static applib_on_sleep_callback_f       m_on_sleep_cb;
+
+static void reset_settings(void)
+{
+    memset(&m_settings, 0, sizeof(m_settings));
+    memset(m_settings.authentication_key, 0xff,
+           sizeof(m_settings.authentication_key));
+    memset(m_settings.encryption_key, 0xff,
+           sizeof(m_settings.encryption_key));
+    memset(m_settings.feature_lock_key, 0xff,
+           sizeof(m_settings.feature_lock_key));
+    m_settings.feature_lock_bits = 0xffffffff;
+    // Default role of the stack
+    m_settings.role = APP_LIB_SETTINGS_ROLE_AUTOROLE_LE;
+}
+
+void Sim_state_init(const sim_config_t * config)
+{
+    reset_settings();
+    m_settings.node_address = config->node_address;
+    m_settings.network_address = config->network_address;
+    m_settings.network_channel = config->network_channel;
+    m_settings.role = config->role;
+    m_settings.role_set = true;
+    m_started = config->started;
+    m_energy = 0;
+    m_sink_cost = 0;
+    m_num_nbors = 0;
+    m_default_scan_us = config->scan_duration_us;
+    m_scan_duration_us = m_default_scan_us;
+    m_scanning = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_sleep_state = APP_LIB_SLEEP_STOPPED;
+}
+
+bool Sim_state_isStarted(void)
+{
+    return m_started && (m_sleep_state != APP_LIB_SLEEP_STARTED);
+}
+
+app_addr_t Sim_state_getNodeAddress(void)
+{
+    return m_settings.node_address;
+}
+
+app_lib_settings_role_t Sim_state_getRole(void)
+{
+    return m_settings.role;
+}
+
+static bool is_sink(void)
+{
+    return (m_settings.role == APP_LIB_SETTINGS_ROLE_SINK_LE) ||
+           (m_settings.role == APP_LIB_SETTINGS_ROLE_SINK_LL);
+}
+
+/*
+ * lib_state
+ */
+
+static uint8_t get_stack_state(void)
+{
+    uint8_t state = APP_LIB_STATE_STARTED;
+    if (!Sim_state_isStarted())
+    {
+        state |= APP_LIB_STATE_STOPPED;
+    }
+    if (m_settings.node_address == 0)
+    {
+        state |= APP_LIB_STATE_NODE_ADDRESS_NOT_SET;
+    }
+    if (m_settings.network_address == 0)
+    {
+        state |= APP_LIB_STATE_NETWORK_ADDRESS_NOT_SET;
+    }
+    if (m_settings.network_channel == 0)
+    {
+        state |= APP_LIB_STATE_NETWORK_CHANNEL_NOT_SET;
+    }
+    if (!m_settings.role_set)
+    {
+        state |= APP_LIB_STATE_ROLE_NOT_SET;
+    }
+    return state;
+}
+
+static app_res_e start_stack(void)
+{
+    uint8_t state = get_stack_state();
+    if (state == APP_LIB_STATE_STARTED)
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    if (state != APP_LIB_STATE_STOPPED)
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    m_started = true;
+    return APP_RES_OK;
+}
+
+/** End of a neighbor scan: the radio is off again */
+static void scan_end(void)
+{
+    if (m_scanning)
+    {
+        m_stats.scan_us += Sim_now() - m_scan_start;
+    }
+    m_scanning = false;
+}
+
+static app_res_e stop_stack(void)
+{
+    if (!m_started)
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    Sim_system_shutdown();
+    // The real stack reboots the node here
+    m_started = false;
+    scan_end();
+    return APP_RES_OK;
+}
+
+static bool get_best_nbor(const app_lib_state_nbor_info_t ** best)
+{
+    *best = NULL;
+    for (uint32_t i = 0; i < m_num_nbors; i++)
+    {
+        if ((m_nbors[i].cost != APP_LIB_STATE_INVALID_ROUTE_COST) &&
+            ((*best == NULL) || (m_nbors[i].cost < (*best)->cost)))
+        {
+            *best = &m_nbors[i];
+        }
+    }
+    return *best != NULL;
+}
+
+static app_res_e get_route_info(app_lib_state_route_info_t * info)
+{
+    const app_lib_state_nbor_info_t * best;
+
+    memset(info, 0, sizeof(*info));
+    info->state = APP_LIB_STATE_ROUTE_STATE_INVALID;
+    info->cost = APP_LIB_STATE_INVALID_ROUTE_COST;
+    if (!Sim_state_isStarted())
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    if (is_sink())
+    {
+        info->state = APP_LIB_STATE_ROUTE_STATE_VALID;
+        info->sink = m_settings.node_address;
+        info->next_hop = m_settings.node_address;
+        info->channel = m_settings.network_channel;
+        info->cost = m_sink_cost;
+    }
+    else if (get_best_nbor(&best))
+    {
+        info->state = APP_LIB_STATE_ROUTE_STATE_VALID;
+        info->next_hop = best->address;
+        info->channel = best->channel;
+        info->cost = best->cost + 1;
+    }
+    return APP_RES_OK;
+}
+
+static uint8_t get_route_count(size_t * count_p)
+{
+    app_lib_state_route_info_t info;
+    get_route_info(&info);
+    *count_p = (info.state == APP_LIB_STATE_ROUTE_STATE_VALID) ? 1 : 0;
+    return (uint8_t)*count_p;
+}
+
+static uint16_t get_diag_interval(void)
+{
+    return 0;
+}
+
+static app_res_e get_access_cycle(uint16_t * ac_value_p)
+{
+    if (!Sim_state_isStarted())
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    *ac_value_p = (m_settings.ac_min != 0) ? m_settings.ac_min : SIM_AC_MIN;
+    return APP_RES_OK;
+}
+
+static app_res_e set_on_scan_nbors_cb(app_lib_state_on_scan_nbors_cb_f cb)
+{
+    m_scan_nbors_cb = cb;
+    return APP_RES_OK;
+}
+
+static app_res_e set_on_scan_start_cb(app_lib_state_on_scan_start_cb_f cb)
+{
+    m_scan_start_cb = cb;
+    return APP_RES_OK;
+}
+
+static void scan_done(void * arg)
+{
+    Sim_state_scanDone(arg != NULL);
+}
+
+void Sim_state_scanDone(bool app_originated)
+{
+    scan_end();
+    if (m_scan_nbors_cb != NULL)
+    {
+        app_lib_state_neighbor_scan_info_t info = {
+            .scan_type = app_originated ? SCAN_TYPE_APP_ORIGINATED :
+                                          SCAN_TYPE_STACK_ORIGINATED,
+            .complete = true,
+        };
+        m_scan_nbors_cb(&info);
+    }
+}
+
+static app_res_e start_scan_nbors(void)
+{
+    if (!Sim_state_isStarted() || m_scanning)
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    m_scanning = true;
+    m_scan_start = Sim_now();
+    m_stats.scans++;
+    if (m_scan_listener != NULL)
+    {
+        m_scan_listener(m_scan_duration_us);
+    }
+    if (m_scan_start_cb != NULL)
+    {
+        app_lib_state_on_scan_start_info_t info = {
+            .scan_type = SCAN_TYPE_APP_ORIGINATED,
+        };
+        m_scan_start_cb(&info);
+    }
+    // Non-NULL argument: scan requested by the application
+    Sim_addEvent(m_scan_duration_us, scan_done, &m_scanning);
+    return APP_RES_OK;
+}
+
+static app_res_e stop_scan_nbors(void)
+{
+    if (!m_scanning)
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    Sim_cancelEvent(scan_done);
+    scan_end();
+    if (m_scan_nbors_cb != NULL)
+    {
+        app_lib_state_neighbor_scan_info_t info = {
+            .scan_type = SCAN_TYPE_APP_ORIGINATED,
+            .complete = false,
+        };
+        m_scan_nbors_cb(&info);
+    }
+    return APP_RES_OK;
+}
+
+static app_res_e set_scan_duration(uint32_t duration_us)
+{
+    m_scan_duration_us = (duration_us == APP_LIB_STATE_DEFAULT_SCAN) ?
+                            m_default_scan_us : duration_us;
+    return APP_RES_OK;
+}
+
+static app_res_e get_nbors(app_lib_state_nbor_list_t * nbors_list)
+{
+    if (!Sim_state_isStarted())
+    {
+        nbors_list->number_nbors = 0;
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    if (nbors_list->number_nbors > m_num_nbors)
+    {
+        nbors_list->number_nbors = m_num_nbors;
+    }
+    memcpy(nbors_list->nbors,
+           m_nbors,
+           nbors_list->number_nbors * sizeof(app_lib_state_nbor_info_t));
+    return APP_RES_OK;
+}
+
+void Sim_state_setNbors(const app_lib_state_nbor_info_t * nbors,
+                        uint32_t count)
+{
+    if (count > SIM_MAX_NBORS)
+    {
+        count = SIM_MAX_NBORS;
+    }
+    memcpy(m_nbors, nbors, count * sizeof(app_lib_state_nbor_info_t));
+    m_num_nbors = count;
+    if (m_route_cb != NULL)
+    {
+        m_route_cb();
+    }
+}
+
+static app_res_e set_on_beacon_cb(app_lib_state_on_beacon_cb_f cb)
+{
+    m_beacon_cb = cb;
+    return APP_RES_OK;
+}
+
+void Sim_state_receiveBeacon(const app_lib_state_beacon_rx_t * beacon)
+{
+    if ((m_beacon_cb != NULL) && Sim_state_isStarted())
+    {
+        m_stats.beacons++;
+        m_beacon_cb(beacon);
+    }
+}
+
+void Sim_state_setScanListener(sim_scan_start_f cb)
+{
+    m_scan_listener = cb;
+}
+
+void Sim_getStateStats(sim_state_stats_t * stats)
+{
+    *stats = m_stats;
+    if (m_scanning)
+    {
+        stats->scan_us += Sim_now() - m_scan_start;
+    }
+}
+
+static app_res_e get_energy(uint8_t * energy_p)
+{
+    *energy_p = m_energy;
+    return APP_RES_OK;
+}
+
+static app_res_e set_energy(uint8_t energy)
+{
+    m_energy = energy;
+    return APP_RES_OK;
+}
+
+static app_res_e get_sink_cost(uint8_t * cost_p)
+{
+    if (!is_sink())
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    *cost_p = m_sink_cost;
+    return APP_RES_OK;
+}
+
+static app_res_e set_sink_cost(const uint8_t cost)
+{
+    if (!is_sink())
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    m_sink_cost = cost;
+    return APP_RES_OK;
+}
+
+static app_res_e set_route_cb(const app_lib_state_route_changed_cb_f cb,
+                              uint32_t unused)
+{
+    (void)unused;
+    m_route_cb = cb;
+    return APP_RES_OK;
+}
+
+static app_res_e get_install_quality(app_lib_state_install_quality_t * qual)
+{
+    app_lib_state_route_info_t info;
+    if (get_route_info(&info) != APP_RES_OK)
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    qual->error_codes = APP_LIB_STATE_INSTALL_QUALITY_ERROR_NONE;
+    if (info.state != APP_LIB_STATE_ROUTE_STATE_VALID)
+    {
+        qual->error_codes |= APP_LIB_STATE_INSTALL_QUALITY_ERROR_NOROUTE;
+    }
+    if (!is_sink() && (m_num_nbors < 2))
+    {
+        qual->error_codes |= APP_LIB_STATE_INSTALL_QUALITY_ERROR_NONBORS;
+    }
+    qual->quality = (qual->error_codes == 0) ? 255 : 0;
+    return APP_RES_OK;
+}
+
+const void * Sim_state_open(uint32_t version)
+{
+    if (version > APP_LIB_STATE_VERSION)
+    {
+        return NULL;
+    }
+    Sim_fillUnimplemented(&m_state, sizeof(m_state), lib_state_unimplemented);
+    m_state.startStack = start_stack;
+    m_state.stopStack = stop_stack;
+    m_state.getStackState = get_stack_state;
+    m_state.getRouteCount = get_route_count;
+    m_state.getDiagInterval = get_diag_interval;
+    m_state.getAccessCycle = get_access_cycle;
+    m_state.setOnScanNborsCb = set_on_scan_nbors_cb;
+    m_state.startScanNbors = start_scan_nbors;
+    m_state.getNbors = get_nbors;
+    m_state.setOnBeaconCb = set_on_beacon_cb;
+    m_state.getEnergy = get_energy;
+    m_state.setEnergy = set_energy;
+    m_state.getSinkCost = get_sink_cost;
+    m_state.setSinkCost = set_sink_cost;
+    m_state.getRouteInfo = get_route_info;
+    m_state.setRouteCb = set_route_cb;
+    m_state.setScanDuration = set_scan_duration;
+    m_state.stopScanNbors = stop_scan_nbors;
+    m_state.getInstallQual = get_install_quality;
+    m_state.setOnScanStartCb = set_on_scan_start_cb;
+    return &m_state;
+}
+
+/*
+ * lib_settings
+ */
+
+/** Settings the stack uses while running can only change when stopped */
+#define CHECK_STOPPED()                                                     \
+    do                                                                      \
+    {                                                                       \
+        if (m_started)                                                      \
+        {                                                                   \
+            return APP_RES_INVALID_STACK_STATE;                             \
+        }                                                                   \
+    } while (0)
+
+static bool is_key_set(const uint8_t * key)
+{
+    for (uint8_t i = 0; i < APP_LIB_SETTINGS_AES_KEY_NUM_BYTES; i++)
+    {
+        if (key[i] != 0xff)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static app_res_e get_key(const uint8_t * key, uint8_t * key_p)
+{
+    if (key_p == NULL)
+    {
+        return APP_RES_INVALID_NULL_POINTER;
+    }
+    if (!is_key_set(key))
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    memcpy(key_p, key, APP_LIB_SETTINGS_AES_KEY_NUM_BYTES);
+    return APP_RES_OK;
+}
+
+static app_res_e set_key(uint8_t * key, const uint8_t * key_p)
+{
+    if (key_p == NULL)
+    {
+        // Clear the key
+        memset(key, 0xff, APP_LIB_SETTINGS_AES_KEY_NUM_BYTES);
+    }
+    else
+    {
+        memcpy(key, key_p, APP_LIB_SETTINGS_AES_KEY_NUM_BYTES);
+    }
+    return APP_RES_OK;
+}
+
+static app_res_e reset_all(void)
+{
+    CHECK_STOPPED();
+    reset_settings();
+    return APP_RES_OK;
+}
+
+static app_res_e get_feature_lock_bits(uint32_t * bits_p)
+{
+    *bits_p = m_settings.feature_lock_bits;
+    return APP_RES_OK;
+}
+
+static app_res_e set_feature_lock_bits(uint32_t bits)
+{
+    m_settings.feature_lock_bits = bits;
+    return APP_RES_OK;
+}
+
+static app_res_e get_feature_lock_key(uint8_t * key_p)
+{
+    // The key itself cannot be read, only whether it is set
+    (void)key_p;
+    return is_key_set(m_settings.feature_lock_key) ?
+                APP_RES_OK : APP_RES_INVALID_CONFIGURATION;
+}
+
+static app_res_e set_feature_lock_key(const uint8_t * key_p)
+{
+    return set_key(m_settings.feature_lock_key, key_p);
+}
+
+static bool is_valid_node_address(app_addr_t addr)
+{
+    // Broadcast, anysink and multicast addresses are reserved
+    return (addr != 0) && (addr < 0x80000000) && (addr != APP_ADDR_ANYSINK);
+}
+
+static bool is_valid_network_address(app_lib_settings_net_addr_t addr)
+{
+    return (addr != 0) && (addr <= 0xfffffe);
+}
+
+static bool is_valid_network_channel(uint8_t channel)
+{
+    return (channel >= SIM_CHANNEL_MIN) && (channel <= SIM_CHANNEL_MAX);
+}
+
+static bool is_valid_node_role(app_lib_settings_role_t role)
+{
+    switch (role)
+    {
+        case APP_LIB_SETTINGS_ROLE_SINK_LE:
+        case APP_LIB_SETTINGS_ROLE_SINK_LL:
+        case APP_LIB_SETTINGS_ROLE_HEADNODE_LE:
+        case APP_LIB_SETTINGS_ROLE_HEADNODE_LL:
+        case APP_LIB_SETTINGS_ROLE_SUBNODE_LE:
+        case APP_LIB_SETTINGS_ROLE_SUBNODE_LL:
+        case APP_LIB_SETTINGS_ROLE_AUTOROLE_LE:
+        case APP_LIB_SETTINGS_ROLE_AUTOROLE_LL:
+        case APP_LIB_SETTINGS_ROLE_ADVERTISER:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static app_res_e get_node_address(app_addr_t * addr_p)
+{
+    if (m_settings.node_address == 0)
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    *addr_p = m_settings.node_address;
+    return APP_RES_OK;
+}
+
+static app_res_e set_node_address(app_addr_t addr)
+{
+    CHECK_STOPPED();
+    if (!is_valid_node_address(addr))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    m_settings.node_address = addr;
+    return APP_RES_OK;
+}
+
+static app_res_e get_network_address(app_lib_settings_net_addr_t * addr_p)
+{
+    if (addr_p == NULL)
+    {
+        return APP_RES_INVALID_NULL_POINTER;
+    }
+    if (m_settings.network_address == 0)
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    *addr_p = m_settings.network_address;
+    return APP_RES_OK;
+}
+
+static app_res_e set_network_address(app_lib_settings_net_addr_t addr)
+{
+    CHECK_STOPPED();
+    if (!is_valid_network_address(addr))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    m_settings.network_address = addr;
+    return APP_RES_OK;
+}
+
+static app_res_e get_network_channel(app_lib_settings_net_channel_t * ch_p)
+{
+    if (ch_p == NULL)
+    {
+        return APP_RES_INVALID_NULL_POINTER;
+    }
+    if (m_settings.network_channel == 0)
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    *ch_p = m_settings.network_channel;
+    return APP_RES_OK;
+}
+
+static app_res_e set_network_channel(app_lib_settings_net_channel_t channel)
+{
+    CHECK_STOPPED();
+    if (!is_valid_network_channel(channel))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    m_settings.network_channel = channel;
+    return APP_RES_OK;
+}
+
+static app_res_e get_node_role(app_lib_settings_role_t * role_p)
+{
+    if (role_p == NULL)
+    {
+        return APP_RES_INVALID_NULL_POINTER;
+    }
+    if (!m_settings.role_set)
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    *role_p = m_settings.role;
+    return APP_RES_OK;
+}
+
+static app_res_e set_node_role(app_lib_settings_role_t role)
+{
+    CHECK_STOPPED();
+    if (!is_valid_node_role(role))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    m_settings.role = role;
+    m_settings.role_set = true;
+    return APP_RES_OK;
+}
+
+static app_res_e get_authentication_key(uint8_t * key_p)
+{
+    return get_key(m_settings.authentication_key, key_p);
+}
+
+static app_res_e set_authentication_key(const uint8_t * key_p)
+{
+    CHECK_STOPPED();
+    return set_key(m_settings.authentication_key, key_p);
+}
+
+static app_res_e get_encryption_key(uint8_t * key_p)
+{
+    return get_key(m_settings.encryption_key, key_p);
+}
+
+static app_res_e set_encryption_key(const uint8_t * key_p)
+{
+    CHECK_STOPPED();
+    return set_key(m_settings.encryption_key, key_p);
+}
+
+static app_res_e get_ac_range(uint16_t * ac_min_value_p,
+                              uint16_t * ac_max_value_p)
+{
+    if (m_settings.ac_min == 0)
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    *ac_min_value_p = m_settings.ac_min;
+    *ac_max_value_p = m_settings.ac_max;
+    return APP_RES_OK;
+}
+
+static app_res_e set_ac_range(uint16_t ac_min_value, uint16_t ac_max_value)
+{
+    if ((ac_min_value == 0) && (ac_max_value == 0))
+    {
+        // Back to automatic access cycle
+        m_settings.ac_min = 0;
+        m_settings.ac_max = 0;
+        return APP_RES_OK;
+    }
+    if ((ac_min_value < SIM_AC_MIN) || (ac_max_value > SIM_AC_MAX) ||
+        (ac_min_value > ac_max_value))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    m_settings.ac_min = ac_min_value;
+    m_settings.ac_max = ac_max_value;
+    return APP_RES_OK;
+}
+
+static app_res_e get_ac_range_limits(uint16_t * min_value_p,
+                                     uint16_t * max_value_p)
+{
+    *min_value_p = SIM_AC_MIN;
+    *max_value_p = SIM_AC_MAX;
+    return APP_RES_OK;
+}
+
+static app_res_e get_offline_scan(uint16_t * max_scan_p)
+{
+    if (m_settings.offline_scan == 0)
+    {
+        return APP_RES_INVALID_CONFIGURATION;
+    }
+    *max_scan_p = m_settings.offline_scan;
+    return APP_RES_OK;
+}
+
+static app_res_e set_offline_scan(uint16_t max_scan)
+{
+    m_settings.offline_scan = max_scan;
+    return APP_RES_OK;
+}
+
+static app_res_e get_channel_map(uint32_t * channelmap_p)
+{
+    *channelmap_p = m_settings.channel_map;
+    return APP_RES_OK;
+}
+
+static app_res_e set_channel_map(uint32_t channelmap)
+{
+    CHECK_STOPPED();
+    m_settings.channel_map = channelmap;
+    return APP_RES_OK;
+}
+
+static app_res_e get_network_channel_limits(uint16_t * min_value_p,
+                                            uint16_t * max_value_p)
+{
+    *min_value_p = SIM_CHANNEL_MIN;
+    *max_value_p = SIM_CHANNEL_MAX;
+    return APP_RES_OK;
+}
+
+static app_res_e register_group_query(app_lib_settings_is_group_cb_f cb)
+{
+    m_group_cb = cb;
+    return APP_RES_OK;
+}
+
+static app_res_e get_reserved_channels(uint8_t * channels_p,
+                                       size_t num_bytes)
+{
+    if (num_bytes > sizeof(m_settings.reserved_channels))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    memcpy(channels_p, m_settings.reserved_channels, num_bytes);
+    return APP_RES_OK;
+}
+
+static app_res_e set_reserved_channels(const uint8_t * channels_p,
+                                       size_t num_bytes)
+{
+    if (num_bytes > sizeof(m_settings.reserved_channels))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    memset(m_settings.reserved_channels, 0,
+           sizeof(m_settings.reserved_channels));
+    memcpy(m_settings.reserved_channels, channels_p, num_bytes);
+    return APP_RES_OK;
+}
+
+const void * Sim_settings_open(uint32_t version)
+{
+    if (version > APP_LIB_SETTINGS_VERSION)
+    {
+        return NULL;
+    }
+    Sim_fillUnimplemented(&m_settings_lib, sizeof(m_settings_lib),
+                          lib_settings_unimplemented);
+    m_settings_lib.resetAll = reset_all;
+    m_settings_lib.getFeatureLockBits = get_feature_lock_bits;
+    m_settings_lib.setFeatureLockBits = set_feature_lock_bits;
+    m_settings_lib.getFeatureLockKey = get_feature_lock_key;
+    m_settings_lib.setFeatureLockKey = set_feature_lock_key;
+    m_settings_lib.getNodeAddress = get_node_address;
+    m_settings_lib.setNodeAddress = set_node_address;
+    m_settings_lib.getNetworkAddress = get_network_address;
+    m_settings_lib.setNetworkAddress = set_network_address;
+    m_settings_lib.getNetworkChannel = get_network_channel;
+    m_settings_lib.setNetworkChannel = set_network_channel;
+    m_settings_lib.getNodeRole = get_node_role;
+    m_settings_lib.setNodeRole = set_node_role;
+    m_settings_lib.getAuthenticationKey = get_authentication_key;
+    m_settings_lib.setAuthenticationKey = set_authentication_key;
+    m_settings_lib.getEncryptionKey = get_encryption_key;
+    m_settings_lib.setEncryptionKey = set_encryption_key;
+    m_settings_lib.getAcRange = get_ac_range;
+    m_settings_lib.setAcRange = set_ac_range;
+    m_settings_lib.getOfflineScan = get_offline_scan;
+    m_settings_lib.setOfflineScan = set_offline_scan;
+    m_settings_lib.getChannelMap = get_channel_map;
+    m_settings_lib.setChannelMap = set_channel_map;
+    m_settings_lib.getNetworkChannelLimits = get_network_channel_limits;
+    m_settings_lib.getAcRangeLimits = get_ac_range_limits;
+    m_settings_lib.registerGroupQuery = register_group_query;
+    m_settings_lib.getReservedChannels = get_reserved_channels;
+    m_settings_lib.setReservedChannels = set_reserved_channels;
+    m_settings_lib.isValidNetworkAddress = is_valid_network_address;
+    m_settings_lib.isValidNetworkChannel = is_valid_network_channel;
+    m_settings_lib.isValidNodeAddress = is_valid_node_address;
+    m_settings_lib.isValidNodeRole = is_valid_node_role;
+    return &m_settings_lib;
+}
+
+/*
+ * lib_sleep: the stack is stopped while sleeping
+ */
+
+static void wakeup(void * arg)
+{
+    (void)arg;
+    m_sleep_state = APP_LIB_SLEEP_STOPPED;
+    if (m_wakeup_cb != NULL)
+    {
+        m_wakeup_cb();
+    }
+}
+
+static app_res_e sleep_stack_for_time(uint32_t seconds,
+                                      uint32_t appconf_wait_s)
+{
+    (void)appconf_wait_s;
+    if (!m_started || (m_sleep_state != APP_LIB_SLEEP_STOPPED))
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    if (seconds == 0)
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    m_sleep_state = APP_LIB_SLEEP_STARTED;
+    m_sleep_time_s = seconds;
+    m_sleep_end = Sim_now() + (uint64_t)seconds * 1000000u;
+    Sim_addEvent((uint64_t)seconds * 1000000u, wakeup, NULL);
+    if (m_on_sleep_cb != NULL)
+    {
+        m_on_sleep_cb();
+    }
+    return APP_RES_OK;
+}
+
+static app_res_e wakeup_stack(void)
+{
+    if (m_sleep_state != APP_LIB_SLEEP_STARTED)
+    {
+        return APP_RES_INVALID_STACK_STATE;
+    }
+    Sim_cancelEvent(wakeup);
+    Sim_addEvent(0, wakeup, NULL);
+    return APP_RES_OK;
+}
+
+static app_lib_sleep_stack_state_e get_sleep_state(void)
+{
+    return m_sleep_state;
+}
+
+static uint32_t get_stack_wakeup(void)
+{
+    if (m_sleep_state != APP_LIB_SLEEP_STARTED)
+    {
+        return 0;
+    }
+    return (uint32_t)((m_sleep_end - Sim_now()) / 1000000u);
+}
+
+static void set_on_wakeup_cb(applib_wakeup_callback_f callback)
+{
+    m_wakeup_cb = callback;
+}
+
+static uint32_t get_sleep_latest_gotosleep(void)
+{
+    return m_sleep_time_s;
+}
+
+static void set_on_sleep_cb(applib_on_sleep_callback_f callback)
+{
+    m_on_sleep_cb = callback;
+}
+
+const void * Sim_sleep_open(uint32_t version)
+{
+    if (version > APP_LIB_LONGSLEEP_VERSION)
+    {
+        return NULL;
+    }
+    Sim_fillUnimplemented(&m_sleep, sizeof(m_sleep), lib_sleep_unimplemented);
+    m_sleep.sleepStackforTime = sleep_stack_for_time;
+    m_sleep.wakeupStack = wakeup_stack;
+    m_sleep.getSleepState = get_sleep_state;
+    m_sleep.getStackWakeup = get_stack_wakeup;
+    m_sleep.setOnWakeupCb = set_on_wakeup_cb;
+    m_sleep.getSleepLatestGotosleep = get_sleep_latest_gotosleep;
+    m_sleep.setOnSleepCb = set_on_sleep_cb;
+    return &m_sleep;
+}
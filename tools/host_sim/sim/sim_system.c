@@ -0,0 +1,257 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/*
+ * Simulated system, time and storage libraries
+ */
+
+#include <string.h>
+
+#include "sim.h"
+
+/** Size of the persistent storage area */
+#define SIM_PERSISTENT_SIZE     64
+
+SIM_UNIMPLEMENTED(lib_system)
+SIM_UNIMPLEMENTED(lib_time)
+SIM_UNIMPLEMENTED(lib_storage)
+
+static app_lib_system_t             m_system;
+static app_lib_time_t               m_time;
+static app_lib_storage_t            m_storage;
+
+/** Periodic callback of the application */
+static app_lib_system_periodic_cb_f m_periodic_cb;
+/** Set when the periodic callback is changed from the callback itself */
+static bool                         m_periodic_updated;
+
+static app_lib_system_shutdown_cb_f m_shutdown_cb;
+
+static uint32_t                     m_critical_nesting;
+
+/** Deep sleep disabled since m_ds_disabled_since */
+static bool                         m_ds_disabled;
+static uint64_t                     m_ds_disabled_since;
+static uint64_t                     m_ds_disabled_us;
+
+static uint8_t                      m_persistent[SIM_PERSISTENT_SIZE];
+
+static void periodic_event(void * arg)
+{
+    (void)arg;
+    m_periodic_updated = false;
+    uint32_t next = m_periodic_cb();
+    if (!m_periodic_updated && (next != APP_LIB_SYSTEM_STOP_PERIODIC))
+    {
+        Sim_addEvent(next, periodic_event, NULL);
+    }
+}
+
+static app_res_e set_periodic_cb(app_lib_system_periodic_cb_f work_cb,
+                                 uint32_t initial_delay_us,
+                                 uint32_t execution_time_us)
+{
+    (void)execution_time_us;
+    Sim_cancelEvent(periodic_event);
+    m_periodic_cb = work_cb;
+    m_periodic_updated = true;
+    if (work_cb != NULL)
+    {
+        Sim_addEvent(initial_delay_us, periodic_event, NULL);
+    }
+    return APP_RES_OK;
+}
+
+static app_res_e set_startup_cb(app_lib_system_startup_cb_f cb)
+{
+    (void)cb;
+    return APP_RES_OK;
+}
+
+static app_res_e set_shutdown_cb(app_lib_system_shutdown_cb_f cb)
+{
+    m_shutdown_cb = cb;
+    return APP_RES_OK;
+}
+
+static void enter_critical_section(void)
+{
+    m_critical_nesting++;
+}
+
+static void exit_critical_section(void)
+{
+    if (m_critical_nesting == 0)
+    {
+        Sim_abort("lib_system: critical section exited more than entered");
+    }
+    m_critical_nesting--;
+}
+
+static app_res_e disable_deep_sleep(bool disable)
+{
+    if (disable && !m_ds_disabled)
+    {
+        m_ds_disabled_since = Sim_now();
+    }
+    else if (!disable && m_ds_disabled)
+    {
+        m_ds_disabled_us += Sim_now() - m_ds_disabled_since;
+    }
+    m_ds_disabled = disable;
+    return APP_RES_OK;
+}
+
+uint64_t Sim_system_getDsDisabledTime(void)
+{
+    if (m_ds_disabled)
+    {
+        return m_ds_disabled_us + Sim_now() - m_ds_disabled_since;
+    }
+    return m_ds_disabled_us;
+}
+
+static app_res_e get_radio_info(app_lib_system_radio_info_t * info_p,
+                                size_t info_num_bytes)
+{
+    if (info_num_bytes < sizeof(app_lib_system_radio_info_t))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    info_p->hardware_magic = APP_LIB_SYSTEM_HARDWARE_MAGIC_NRF52840;
+    info_p->protocol_profile = APP_LIB_SYSTEM_PROTOCOL_PROFILE_ISM_24GHZ;
+    return APP_RES_OK;
+}
+
+void Sim_system_shutdown(void)
+{
+    if (m_shutdown_cb != NULL)
+    {
+        m_shutdown_cb();
+    }
+}
+
+const void * Sim_system_open(uint32_t version)
+{
+    if (version > APP_LIB_SYSTEM_VERSION)
+    {
+        return NULL;
+    }
+    Sim_fillUnimplemented(&m_system, sizeof(m_system),
+                          lib_system_unimplemented);
+    m_system.setStartupCb = set_startup_cb;
+    m_system.setShutdownCb = set_shutdown_cb;
+    m_system.setPeriodicCb = set_periodic_cb;
+    m_system.enterCriticalSection = enter_critical_section;
+    m_system.exitCriticalSection = exit_critical_section;
+    m_system.disableDeepSleep = disable_deep_sleep;
+    m_system.getRadioInfo = get_radio_info;
+    return &m_system;
+}
+
+/*
+ * High precision timestamps are in microseconds, so they wrap around after
+ * 71 minutes. Coarse ones are in 1/128 s.
+ */
+
+static app_lib_time_timestamp_hp_t get_timestamp_hp(void)
+{
+    return (app_lib_time_timestamp_hp_t)Sim_now();
+}
+
+static app_lib_time_timestamp_coarse_t get_timestamp_coarse(void)
+{
+    return (app_lib_time_timestamp_coarse_t)(Sim_now() * 128 / 1000000u);
+}
+
+static uint32_t get_timestamp_s(void)
+{
+    return (uint32_t)(Sim_now() / 1000000u);
+}
+
+static app_lib_time_timestamp_hp_t add_us_to_timestamp_hp(
+                                    app_lib_time_timestamp_hp_t base,
+                                    uint32_t time_to_add_us)
+{
+    return base + time_to_add_us;
+}
+
+static bool is_timestamp_hp_before(app_lib_time_timestamp_hp_t time1,
+                                   app_lib_time_timestamp_hp_t time2)
+{
+    return (int32_t)(time1 - time2) < 0;
+}
+
+static uint32_t get_time_difference_us(app_lib_time_timestamp_hp_t time1,
+                                       app_lib_time_timestamp_hp_t time2)
+{
+    return is_timestamp_hp_before(time1, time2) ? time2 - time1 :
+                                                  time1 - time2;
+}
+
+static uint32_t get_max_delay_hp_us(void)
+{
+    // Half of the range, for comparisons to stay valid
+    return INT32_MAX;
+}
+
+const void * Sim_time_open(uint32_t version)
+{
+    if (version > APP_LIB_TIME_VERSION)
+    {
+        return NULL;
+    }
+    Sim_fillUnimplemented(&m_time, sizeof(m_time), lib_time_unimplemented);
+    m_time.getTimestampHp = get_timestamp_hp;
+    m_time.getTimestampCoarse = get_timestamp_coarse;
+    m_time.getTimestampS = get_timestamp_s;
+    m_time.addUsToHpTimestamp = add_us_to_timestamp_hp;
+    m_time.isHpTimestampBefore = is_timestamp_hp_before;
+    m_time.getTimeDiffUs = get_time_difference_us;
+    m_time.getMaxHpDelay = get_max_delay_hp_us;
+    return &m_time;
+}
+
+static app_res_e write_persistent(const void * bytes, size_t num_bytes)
+{
+    if (num_bytes > sizeof(m_persistent))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    memcpy(m_persistent, bytes, num_bytes);
+    return APP_RES_OK;
+}
+
+static app_res_e read_persistent(void * bytes, size_t num_bytes)
+{
+    if (num_bytes > sizeof(m_persistent))
+    {
+        return APP_RES_INVALID_VALUE;
+    }
+    memcpy(bytes, m_persistent, num_bytes);
+    return APP_RES_OK;
+}
+
+static size_t get_persistent_max_size(void)
+{
+    return sizeof(m_persistent);
+}
+
+const void * Sim_storage_open(uint32_t version)
+{
+    if (version > APP_LIB_STORAGE_VERSION)
+    {
+        return NULL;
+    }
+    Sim_fillUnimplemented(&m_storage, sizeof(m_storage),
+                          lib_storage_unimplemented);
+    m_storage.writePersistent = write_persistent;
+    m_storage.readPersistent = read_persistent;
+    m_storage.getPersistentMaxSize = get_persistent_max_size;
+    // Like erased flash
+    memset(m_persistent, 0xff, sizeof(m_persistent));
+    return &m_storage;
+}
@@ -0,0 +1,638 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# waps_loadgen.py - Load generator for the dual-MCU (WAPS) serial protocol
+#
+# Requires:
+#   - Python 3 v3.5 or newer
+
+"""Load generator for the dual-MCU (WAPS) serial protocol
+
+Replays request sequences against a node (waps_sim, or a real device on a
+serial port already configured to the right baudrate) and reports frames per
+second, confirmation latency percentiles, timeouts and retransmissions.
+
+Scenarios:
+  dsap        DSAP-DATA_TX requests, up to --window of them in flight
+  poll        data sent to the node itself, then its indications polled
+  scratchpad  streamed scratchpad upload (MSAP-SCRATCHPAD_STREAM_*), and the
+              block by block upload for comparison
+  replay      frames read from a file, one per line, in hexadecimal: function
+              code, frame id and payload (length and CRC are added)
+  all         dsap, poll and scratchpad, then the node side handling times
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import binascii
+import os
+import random
+import select
+import signal
+import struct
+import subprocess
+import sys
+import termios
+import time
+import tty
+
+SLIP_END = 0xC0
+SLIP_ESC = 0xDB
+SLIP_ESC_END = 0xDC
+SLIP_ESC_ESC = 0xDD
+
+DATA_TX_REQ = 0x01
+DATA_TX_IND = 0x02
+DATA_RX_IND = 0x03
+POLL_REQ = 0x04
+STACK_START_REQ = 0x05
+STACK_STOP_REQ = 0x06
+STACK_STATE_IND = 0x07
+SCRATCHPAD_START_REQ = 0x17
+SCRATCHPAD_BLOCK_REQ = 0x18
+FUNC_STATS_READ_REQ = 0x51
+STREAM_START_REQ = 0x52
+STREAM_BLOCK_REQ = 0x53
+
+CNF = 0x80
+INDICATIONS = (DATA_TX_IND, DATA_RX_IND, STACK_STATE_IND, 0x1D, 0x10, 0x21,
+               0x22, 0x23, 0x24, 0x25)
+
+SCRATCHPAD_BLOCK_MAX = 112
+
+STREAM_SUCCESS = 0
+STREAM_COMPLETED_OK = 1
+STREAM_OUT_OF_SEQUENCE = 5
+
+BAUDS = {9600: termios.B9600, 19200: termios.B19200, 38400: termios.B38400,
+         57600: termios.B57600, 115200: termios.B115200,
+         230400: termios.B230400, 460800: termios.B460800,
+         921600: termios.B921600, 1000000: termios.B1000000}
+
+
+def crc16(data):
+    """CRC of util/crc.c: CCITT polynomial, initial value 0xffff"""
+    return binascii.crc_hqx(bytes(data), 0xFFFF)
+
+
+def slip(data):
+    out = bytearray([SLIP_END])
+    for b in data:
+        if b == SLIP_END:
+            out += bytes([SLIP_ESC, SLIP_ESC_END])
+        elif b == SLIP_ESC:
+            out += bytes([SLIP_ESC, SLIP_ESC_ESC])
+        else:
+            out.append(b)
+    out.append(SLIP_END)
+    return bytes(out)
+
+
+class Frame:
+    def __init__(self, sfunc, sfid, payload, stamp=0.0):
+        self.sfunc = sfunc
+        self.sfid = sfid
+        self.payload = bytes(payload)
+        self.stamp = stamp
+
+    def encode(self):
+        body = bytes([self.sfunc, self.sfid, len(self.payload)]) + self.payload
+        return slip(body + struct.pack('<H', crc16(body)))
+
+
+class Link:
+    """SLIP framing over a serial port or pseudo terminal"""
+
+    def __init__(self, path, baudrate, wakeup=0):
+        self.wakeup = bytes([SLIP_END]) * wakeup
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        tty.setraw(self.fd)
+        if baudrate in BAUDS:
+            attr = termios.tcgetattr(self.fd)
+            attr[4] = attr[5] = BAUDS[baudrate]
+            termios.tcsetattr(self.fd, termios.TCSANOW, attr)
+        self.rx = bytearray()
+        self.escaped = False
+        self.frames = []
+        self.crc_errors = 0
+        self.bytes_out = 0
+        self.bytes_in = 0
+
+    def close(self):
+        os.close(self.fd)
+
+    def send(self, frame):
+        # Bytes lost while an auto-powered UART wakes up
+        data = self.wakeup + frame.encode()
+        self.bytes_out += len(data)
+        while data:
+            select.select([], [self.fd], [], 1.0)
+            try:
+                n = os.write(self.fd, data)
+            except BlockingIOError:
+                continue
+            data = data[n:]
+
+    def _byte(self, b, stamp):
+        if b == SLIP_END:
+            if len(self.rx) >= 5:
+                body, crc = bytes(self.rx[:-2]), self.rx[-2:]
+                if (struct.unpack('<H', crc)[0] != crc16(body) or
+                        body[2] != len(body) - 3):
+                    self.crc_errors += 1
+                else:
+                    self.frames.append(Frame(body[0], body[1], body[3:],
+                                             stamp))
+            self.rx.clear()
+            self.escaped = False
+        elif b == SLIP_ESC:
+            self.escaped = True
+        else:
+            if self.escaped:
+                b = {SLIP_ESC_END: SLIP_END, SLIP_ESC_ESC: SLIP_ESC}.get(b, b)
+                self.escaped = False
+            self.rx.append(b)
+
+    def pump(self, timeout):
+        """Read what is available, waiting at most timeout seconds"""
+        r, _, _ = select.select([self.fd], [], [], max(timeout, 0))
+        if not r:
+            return
+        try:
+            data = os.read(self.fd, 4096)
+        except BlockingIOError:
+            return
+        stamp = time.monotonic()
+        self.bytes_in += len(data)
+        for b in data:
+            self._byte(b, stamp)
+
+    def take(self, match):
+        for i, f in enumerate(self.frames):
+            if match(f):
+                return self.frames.pop(i)
+        return None
+
+    def wait(self, match, timeout):
+        end = time.monotonic() + timeout
+        while True:
+            f = self.take(match)
+            if f is not None:
+                return f
+            left = end - time.monotonic()
+            if left <= 0:
+                return None
+            self.pump(left)
+
+
+class Stats:
+    def __init__(self, name):
+        self.name = name
+        self.latencies = []
+        self.frames = 0
+        self.timeouts = 0
+        self.retries = 0
+        self.refused = 0
+        self.payload = 0
+        self.start = time.monotonic()
+        self.end = None
+        self.notes = []
+
+    def done(self):
+        self.end = time.monotonic()
+
+    def report(self, link):
+        elapsed = (self.end or time.monotonic()) - self.start
+        lat = sorted(self.latencies)
+
+        def pct(p):
+            if not lat:
+                return float('nan')
+            return 1000 * lat[min(len(lat) - 1, int(p / 100 * len(lat)))]
+
+        print('[%s]' % self.name)
+        print('  frames:     %d in %.3f s, %.1f frames/s'
+              % (self.frames, elapsed, self.frames / elapsed if elapsed else 0))
+        if self.payload:
+            print('  payload:    %d bytes, %.0f bytes/s'
+                  % (self.payload, self.payload / elapsed if elapsed else 0))
+        print('  latency:    p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, '
+              'max %.2f ms (%d samples)'
+              % (pct(50), pct(90), pct(99),
+                 1000 * lat[-1] if lat else float('nan'), len(lat)))
+        print('  drops:      %d timeouts, %d retransmissions, %d refused'
+              % (self.timeouts, self.retries, self.refused))
+        for note in self.notes:
+            print('  ' + note)
+        if link.crc_errors:
+            print('  crc errors: %d (whole run)' % link.crc_errors)
+
+
+class Node:
+    """Request / confirmation helpers"""
+
+    def __init__(self, link, timeout):
+        self.link = link
+        self.timeout = timeout
+        self.sfid = 0
+
+    def next_sfid(self):
+        self.sfid = (self.sfid + 1) & 0xFF
+        return self.sfid
+
+    def request(self, sfunc, payload, stats=None):
+        req = Frame(sfunc, self.next_sfid(), payload)
+        sent = time.monotonic()
+        self.link.send(req)
+        cnf = self.link.wait(
+            lambda f: f.sfunc == (sfunc | CNF) and f.sfid == req.sfid,
+            self.timeout)
+        if stats is not None:
+            stats.frames += 1
+            if cnf is None:
+                stats.timeouts += 1
+            else:
+                stats.latencies.append(cnf.stamp - sent)
+        return cnf
+
+    def poll(self, stats=None, limit=100000):
+        """Poll and acknowledge indications, return them"""
+        received = []
+        cnf = self.request(POLL_REQ, b'', stats)
+        if cnf is None or not cnf.payload or cnf.payload[0] == 0:
+            return received
+        asked = cnf.stamp
+        while len(received) < limit:
+            ind = self.link.wait(lambda f: f.sfunc in INDICATIONS,
+                                 self.timeout)
+            if ind is None:
+                if stats is not None:
+                    stats.timeouts += 1
+                break
+            if stats is not None:
+                stats.frames += 1
+                stats.latencies.append(ind.stamp - asked)
+            received.append(ind)
+            more = ind.payload[0] if ind.payload else 0
+            asked = time.monotonic()
+            self.link.send(Frame(ind.sfunc | CNF, ind.sfid,
+                                 bytes([1 if more else 0])))
+            if not more:
+                break
+        return received
+
+    def drain(self):
+        while self.poll():
+            pass
+        self.link.frames.clear()
+
+    def start_stack(self):
+        cnf = self.request(STACK_START_REQ, bytes([0]))
+        return cnf is not None and cnf.payload[:1] in (b'\x00', b'\x01')
+
+    def stop_stack(self):
+        cnf = self.request(STACK_STOP_REQ, b'')
+        return cnf is not None
+
+
+def data_tx_payload(apdu_id, dst, apdu, tx_ind):
+    return struct.pack('<HBIBBBB', apdu_id, 1, dst, 1, 0,
+                       1 if tx_ind else 0, len(apdu)) + apdu
+
+
+def scenario_dsap(node, args, tx_ind=False, dst=None, name='dsap',
+                  poller=None):
+    """Send data, calling poller every window of confirmations: with
+    indications, the node runs out of memory if they are not polled"""
+    stats = Stats(name)
+    link = node.link
+    dst = args.dst if dst is None else dst
+    apdu = bytes(random.getrandbits(8) for _ in range(args.size))
+    inflight = {}
+    # Packets to send, refused ones are sent again after a pause
+    pending = list(range(args.count))
+    hold_until = 0.0
+    confirmed = 0
+    progress = time.monotonic()
+    while pending or inflight:
+        now = time.monotonic()
+        while pending and len(inflight) < args.window and now >= hold_until:
+            apdu_id = pending.pop(0)
+            sfid = node.next_sfid()
+            link.send(Frame(DATA_TX_REQ, sfid,
+                            data_tx_payload(apdu_id, dst, apdu, tx_ind)))
+            inflight[sfid] = (time.monotonic(), apdu_id)
+            stats.frames += 1
+        link.pump(0.005)
+        now = time.monotonic()
+        while True:
+            cnf = link.take(lambda f: f.sfunc == DATA_TX_REQ | CNF and
+                            f.sfid in inflight)
+            if cnf is None:
+                break
+            t, apdu_id = inflight.pop(cnf.sfid)
+            stats.latencies.append(cnf.stamp - t)
+            confirmed += 1
+            if cnf.payload[2] != 0:
+                # Stack buffers full: back off, like a gateway would
+                stats.refused += 1
+                stats.retries += 1
+                pending.insert(0, apdu_id)
+                hold_until = now + args.backoff
+            else:
+                stats.payload += len(apdu)
+                progress = now
+        for sfid, (t, apdu_id) in list(inflight.items()):
+            # Requests waiting over 300 ms are discarded by the node
+            if now - t > node.timeout:
+                del inflight[sfid]
+                stats.timeouts += 1
+                stats.retries += 1
+                pending.insert(0, apdu_id)
+        if poller is not None and (confirmed >= args.window or
+                                   now < hold_until):
+            confirmed = 0
+            poller()
+        if now - progress > 5.0:
+            stats.notes.append('stalled, %d packets not sent'
+                               % (len(pending) + len(inflight)))
+            break
+    stats.done()
+    return stats
+
+
+def scenario_poll(node, args):
+    # Packets to the node itself come back as received data
+    node.drain()
+    stats = Stats('poll')
+    kinds = {}
+
+    def poll():
+        inds = node.poll(stats)
+        for ind in inds:
+            kinds[ind.sfunc] = kinds.get(ind.sfunc, 0) + 1
+        return inds
+
+    sent = scenario_dsap(node, args, tx_ind=True, dst=args.own_address,
+                         name='poll: data sent', poller=poll)
+    expected = 2 * args.count
+    idle_since = time.monotonic()
+    while sum(kinds.values()) < expected:
+        if poll():
+            idle_since = time.monotonic()
+        elif time.monotonic() - idle_since > 2.0:
+            stats.notes.append('%d indications missing'
+                               % (expected - sum(kinds.values())))
+            break
+        else:
+            # Loopback packets still being sent
+            time.sleep(0.02)
+    stats.done()
+    stats.notes.append('indications: ' + ', '.join(
+        '0x%02x x%d' % k for k in sorted(kinds.items())))
+    return [sent, stats]
+
+
+def scenario_stream(node, args):
+    stats = Stats('scratchpad stream')
+    link = node.link
+    size = args.scratchpad
+    data = bytes(random.getrandbits(8) for _ in range(size))
+    block = SCRATCHPAD_BLOCK_MAX
+    blocks = [data[i:i + block] for i in range(0, size, block)]
+    cnf = node.request(STREAM_START_REQ,
+                       struct.pack('<IBHB', size, args.seq, crc16(data),
+                                   args.ack_interval))
+    if cnf is None or cnf.payload[0] != 0:
+        stats.notes.append('start refused: %r' % (cnf and cnf.payload))
+        stats.done()
+        return stats
+    window, ack_interval = cnf.payload[1], cnf.payload[2]
+    stats.notes.append('window %d, ack interval %d, %d blocks'
+                       % (window, ack_interval, len(blocks)))
+    acked = 0
+    next_seq = 0
+    sent_at = {}
+    highest = -1
+    last_progress = time.monotonic()
+    result = None
+    while result is None:
+        while next_seq < len(blocks) and next_seq < acked + window:
+            payload = struct.pack('<HB', next_seq, len(blocks[next_seq]))
+            link.send(Frame(STREAM_BLOCK_REQ, node.next_sfid(),
+                            payload + blocks[next_seq]))
+            if next_seq <= highest:
+                stats.retries += 1
+            highest = max(highest, next_seq)
+            sent_at[next_seq] = time.monotonic()
+            stats.frames += 1
+            next_seq += 1
+        link.pump(0.02)
+        while True:
+            cnf = link.take(lambda f: f.sfunc == STREAM_BLOCK_REQ | CNF)
+            if cnf is None:
+                break
+            res, seq, _ = struct.unpack('<BHH', cnf.payload[:5])
+            if seq - 1 in sent_at:
+                stats.latencies.append(cnf.stamp - sent_at[seq - 1])
+            if seq > acked:
+                acked = seq
+                last_progress = time.monotonic()
+            if res == STREAM_OUT_OF_SEQUENCE:
+                next_seq = seq
+            elif res == STREAM_COMPLETED_OK:
+                result = res
+            elif res != STREAM_SUCCESS:
+                result = res
+                stats.notes.append('stream failed: result %d' % res)
+        if result is None and time.monotonic() - last_progress > node.timeout:
+            # Lost acknowledgement or blocks: go back to the last one acked
+            stats.timeouts += 1
+            next_seq = acked
+            last_progress = time.monotonic()
+            if stats.timeouts > 50:
+                stats.notes.append('stream stalled at block %d' % acked)
+                break
+    stats.done()
+    if result == STREAM_COMPLETED_OK:
+        stats.payload = size
+    return stats
+
+
+def scenario_blocks(node, args):
+    stats = Stats('scratchpad blocks')
+    size = args.scratchpad
+    data = bytes(random.getrandbits(8) for _ in range(size))
+    cnf = node.request(SCRATCHPAD_START_REQ, struct.pack('<IB', size,
+                                                        args.seq))
+    if cnf is None or cnf.payload[0] != 0:
+        stats.notes.append('start refused: %r' % (cnf and cnf.payload))
+        stats.done()
+        return stats
+    offset = 0
+    while offset < size:
+        chunk = data[offset:offset + SCRATCHPAD_BLOCK_MAX]
+        cnf = node.request(SCRATCHPAD_BLOCK_REQ,
+                           struct.pack('<IB', offset, len(chunk)) + chunk,
+                           stats)
+        if cnf is None:
+            stats.retries += 1
+            continue
+        if cnf.payload[0] > 1:
+            stats.notes.append('block failed: result %d' % cnf.payload[0])
+            break
+        offset += len(chunk)
+    stats.done()
+    if offset >= size:
+        stats.payload = size
+    return stats
+
+
+def scenario_scratchpad(node, args):
+    node.stop_stack()
+    node.drain()
+    return [scenario_stream(node, args), scenario_blocks(node, args)]
+
+
+def scenario_replay(node, args):
+    stats = Stats('replay')
+    frames = []
+    lost = {}
+    with open(args.file) as f:
+        for line in f:
+            line = line.split('#')[0].strip()
+            if line:
+                raw = bytes.fromhex(line)
+                frames.append(Frame(raw[0], raw[1], raw[2:]))
+    for _ in range(args.loops):
+        for req in frames:
+            sent = time.monotonic()
+            node.link.send(req)
+            stats.frames += 1
+            if req.sfunc & CNF:
+                continue
+            cnf = node.link.wait(
+                lambda f, r=req: f.sfunc == (r.sfunc | CNF) and
+                f.sfid == r.sfid, node.timeout)
+            if cnf is None:
+                stats.timeouts += 1
+                lost[req.sfunc] = lost.get(req.sfunc, 0) + 1
+            else:
+                stats.latencies.append(cnf.stamp - sent)
+    stats.done()
+    if lost:
+        stats.notes.append('not confirmed: ' + ', '.join(
+            '0x%02x x%d' % k for k in sorted(lost.items())))
+    return stats
+
+
+def node_handling(node, funcs):
+    """Handling time on the node side, if built with WAPS_FUNC_STATS"""
+    print('[node handling time]')
+    for func in funcs:
+        cnf = node.request(FUNC_STATS_READ_REQ, bytes([func]))
+        if cnf is None or cnf.payload[0] != 0:
+            print('  0x%02x: unavailable' % func)
+            continue
+        _, _, calls, total, longest = struct.unpack('<BBIII', cnf.payload)
+        print('  0x%02x: %d requests, %.1f us mean, %d us max'
+              % (func, calls, total / calls if calls else 0, longest))
+
+
+def spawn(command):
+    proc = subprocess.Popen(command, stdout=subprocess.PIPE,
+                            universal_newlines=True)
+    for line in proc.stdout:
+        if line.startswith('Serial port:'):
+            return proc, line.split(':', 1)[1].strip()
+    raise RuntimeError('%s did not open a serial port' % command[0])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.
+                                     RawDescriptionHelpFormatter)
+    parser.add_argument('-p', '--port', help='serial port of the node')
+    parser.add_argument('--spawn', metavar='SIM',
+                        help='start this simulator and use its serial port; '
+                        'arguments after -- are given to it')
+    parser.add_argument('-b', '--baudrate', type=int, default=125000)
+    parser.add_argument('--wakeup', type=int, default=0,
+                        help='bytes sent before each frame to wake up a '
+                        'node with UART auto-power')
+    parser.add_argument('-n', '--count', type=int, default=200,
+                        help='data packets to send')
+    parser.add_argument('-w', '--window', type=int, default=4,
+                        help='data requests in flight')
+    parser.add_argument('-s', '--size', type=int, default=40,
+                        help='data payload size')
+    parser.add_argument('--backoff', type=float, default=0.02,
+                        help='pause after a refused data request, seconds')
+    parser.add_argument('--dst', type=lambda x: int(x, 0), default=2,
+                        help='destination of the data')
+    parser.add_argument('--own-address', type=lambda x: int(x, 0),
+                        default=1, help='address of the node')
+    parser.add_argument('--scratchpad', type=int, default=16384,
+                        help='scratchpad size, multiple of 16')
+    parser.add_argument('--ack-interval', type=int, default=0)
+    parser.add_argument('--seq', type=int, default=1)
+    parser.add_argument('--timeout', type=float, default=0.3,
+                        help='confirmation timeout in seconds')
+    parser.add_argument('--file', help='frames to replay')
+    parser.add_argument('--loops', type=int, default=1)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('scenario', choices=['dsap', 'poll', 'scratchpad',
+                                             'replay', 'all'])
+    parser.add_argument('sim_args', nargs='*', help=argparse.SUPPRESS)
+    args = parser.parse_args()
+    random.seed(args.seed)
+
+    proc = None
+    port = args.port
+    if args.spawn:
+        proc, port = spawn([args.spawn, '-b', str(args.baudrate)] +
+                           args.sim_args)
+    if port is None:
+        parser.error('--port or --spawn is needed')
+
+    link = Link(port, args.baudrate, args.wakeup)
+    node = Node(link, args.timeout)
+    results = []
+    try:
+        node.drain()
+        if args.scenario in ('dsap', 'poll', 'all'):
+            if not node.start_stack():
+                print('warning: stack start not confirmed')
+            node.drain()
+        if args.scenario in ('dsap', 'all'):
+            results.append(scenario_dsap(node, args))
+            node.drain()
+        if args.scenario in ('poll', 'all'):
+            results += scenario_poll(node, args)
+        if args.scenario in ('scratchpad', 'all'):
+            results += scenario_scratchpad(node, args)
+        if args.scenario == 'replay':
+            if not args.file:
+                parser.error('replay needs --file')
+            results.append(scenario_replay(node, args))
+        for stats in results:
+            stats.report(link)
+        print('[link]\n  %d bytes sent, %d bytes received'
+              % (link.bytes_out, link.bytes_in))
+        if args.scenario == 'all':
+            node_handling(node, [DATA_TX_REQ, POLL_REQ, STREAM_BLOCK_REQ,
+                                 SCRATCHPAD_BLOCK_REQ])
+    finally:
+        link.close()
+        if proc is not None:
+            proc.send_signal(signal.SIGINT)
+            out, _ = proc.communicate(timeout=5)
+            sys.stdout.write(out)
+    failed = any(s.payload == 0 and s.name.startswith('scratchpad')
+                 for s in results)
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,176 @@
+/* Copyright 2017 Wirepas Ltd. All Rights Reserved.
+ *
+ * See file LICENSE.txt for full license details.
+ *
+ */
+
+/*
+ * Dual-MCU (WAPS) node on the host
+ *
+ * Runs libraries/dualmcu with its SLIP UART protocol and its DSAP, MSAP and
+ * CSAP services over a pseudo terminal, against the simulated stack
+ * libraries of sim/. A host (waps_loadgen.py, or a gateway sink service) is
+ * connected to the serial port it prints.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <getopt.h>
+
+#include "sim.h"
+#include "hal_sim.h"
+#include "dualmcu_lib.h"
+
+/** Free RAM given to the WAPS item pool, see waps_item.c */
+#define SIM_FREE_RAM_BYTES      4096
+
+/** Linker symbols of the firmware: __bss_end__ and __ram_end__ are defined
+ *  to the bounds of this array from the makefile */
+uint32_t sim_free_ram[SIM_FREE_RAM_BYTES / sizeof(uint32_t)];
+uint32_t * m_used_app_ram_end;
+
+static uint32_t m_baudrate = UART_BAUDRATE;
+
+void App_init(const app_global_functions_t * functions)
+{
+    (void)functions;
+    // The reference dualmcu_app also sets up local provisioning here
+    Dualmcu_lib_init(m_baudrate, UART_FLOWCONTROL);
+}
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    Sim_stop();
+}
+
+static void usage(const char * name)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -L <path>     symbolic link to the serial port\n"
+        "  -b <baud>     baudrate (default %u)\n"
+        "  -u            unpaced serial port, ignore the baudrate\n"
+        "  -a <addr>     node address\n"
+        "  -n <addr>     network address\n"
+        "  -c <channel>  network channel\n"
+        "  -r <role>     node role, as in app_lib_settings_role_e\n"
+        "  -s            stack started at boot\n"
+        "  -t <us>       time to send a packet, in microseconds\n"
+        "  -i <ms>       generate a received packet every <ms>\n"
+        "  -l <bytes>    size of the generated packets (default 20)\n"
+        "  -d <s>        run for <s> seconds, default until SIGINT\n",
+        name, UART_BAUDRATE);
+}
+
+static void report(void)
+{
+    sim_time_stats_t time;
+    sim_data_stats_t data;
+    hal_sim_usart_stats_t usart;
+
+    Sim_getTimeStats(&time);
+    Sim_getDataStats(&data);
+    Hal_sim_usartGetStats(&usart);
+
+    double elapsed_s = time.elapsed_us / 1e6;
+    printf("\n--- waps_sim report ---\n");
+    printf("elapsed:         %.3f s\n", elapsed_s);
+    printf("cpu:             %.3f s (%.2f %%), %u events, longest %u us\n",
+           time.cpu_us / 1e6,
+           elapsed_s > 0 ? 100.0 * time.cpu_us / time.elapsed_us : 0.0,
+           time.events,
+           time.max_event_us);
+    printf("deep sleep off:  %.3f s\n", time.ds_disabled_us / 1e6);
+    printf("uart tx:         %u bytes, %u lost, %u refused writes\n",
+           usart.tx_bytes, usart.tx_lost, usart.tx_refused);
+    printf("uart rx:         %u bytes, %u lost while off, %u wake-ups\n",
+           usart.rx_bytes, usart.rx_lost, usart.wakeup_edges);
+    printf("uart on:         %.3f s, %u irq assertions\n",
+           usart.enabled_us / 1e6, usart.irq_asserted);
+    printf("data tx:         %u packets, %u bytes, %u refused\n",
+           data.tx_packets, data.tx_bytes, data.tx_refused);
+    printf("data rx:         %u packets, %u handled, %u dropped\n",
+           data.rx_packets, data.rx_handled, data.rx_dropped);
+    printf("data buffers:    %u used at most\n", data.buffers_high_water);
+}
+
+int main(int argc, char * argv[])
+{
+    sim_config_t config = SIM_CONFIG_DEFAULT;
+    const char * link = NULL;
+    bool paced = true;
+    uint32_t rx_interval_ms = 0;
+    uint8_t rx_len = 20;
+    uint64_t duration_us = UINT64_MAX;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "L:b:ua:n:c:r:st:i:l:d:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'L':
+                link = optarg;
+                break;
+            case 'b':
+                m_baudrate = strtoul(optarg, NULL, 0);
+                break;
+            case 'u':
+                paced = false;
+                break;
+            case 'a':
+                config.node_address = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                config.network_address = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                config.network_channel = strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                config.role = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                config.started = true;
+                break;
+            case 't':
+                config.tx_delay_us = strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                rx_interval_ms = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                rx_len = strtoul(optarg, NULL, 0);
+                break;
+            case 'd':
+                duration_us = strtoull(optarg, NULL, 0) * 1000000u;
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    m_used_app_ram_end = sim_free_ram;
+
+    Sim_init(false, &config);
+    if (!Hal_sim_usartOpen(link, paced))
+    {
+        return EXIT_FAILURE;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    Sim_start();
+    if (rx_interval_ms > 0)
+    {
+        Sim_data_generateRx(rx_interval_ms * 1000u, rx_len, 0x2, 1);
+    }
+    Sim_run(duration_us);
+
+    report();
+    Hal_sim_usartClose();
+    return EXIT_SUCCESS;
+}
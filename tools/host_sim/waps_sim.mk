@@ -0,0 +1,26 @@
+# Dual-MCU node on the host, see Readme.md
+
+TOOL := waps_sim
+
+# Same settings as source/reference_apps/dualmcu_app
+uart_br ?= 125000
+uart_fc ?= false
+
+CFLAGS += -DUART_BAUDRATE=$(uart_br)
+CFLAGS += -DUART_FLOWCONTROL=$(uart_fc)
+
+DUALMCU_LIB=yes
+
+# Handling times and link counters, read back by waps_loadgen.py
+waps_func_stats ?= yes
+waps_diagnostics ?= yes
+
+# Free RAM of waps_item.c, from the firmware linker script symbols
+LDFLAGS += -Wl,--defsym=__bss_end__=sim_free_ram
+LDFLAGS += -Wl,--defsym=__ram_end__=sim_free_ram+4096
+
+SRCS += waps_sim.c \
+        hal/usart.c \
+        hal/io.c
+
+include host.mk
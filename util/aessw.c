@@ -26,6 +26,11 @@ const uint8_t aes_plaintext_null[AES_128_KEY_BLOCK_SIZE] =
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
 };
 
+void aes_initKey(aes_128_key_t * key_ptr, const uint8_t * key128_ptr)
+{
+    AES_init_ctx(&key_ptr->ctx, key128_ptr);
+}
+
 void aes_setupStream(aes_data_stream_t * stream_ptr,
                      const uint8_t * key128_ptr,
                      const uint8_t * iv_ctr_ptr)
@@ -33,6 +38,38 @@ void aes_setupStream(aes_data_stream_t * stream_ptr,
     // store key and iv_ctr to 32-bit aligned words
     memcpy(&stream_ptr->key[0], key128_ptr, AES_128_KEY_BLOCK_SIZE);
     memcpy(&stream_ptr->iv_ctr[0], iv_ctr_ptr, AES_128_KEY_BLOCK_SIZE);
+    stream_ptr->key_ctx = NULL;
+}
+
+void aes_setupStreamKey(aes_data_stream_t * stream_ptr,
+                        const aes_128_key_t * key_ptr,
+                        const uint8_t * iv_ctr_ptr)
+{
+    // Raw key is not needed, the expanded one is referenced instead
+    memset(&stream_ptr->key[0], 0, AES_128_KEY_BLOCK_SIZE);
+    memcpy(&stream_ptr->iv_ctr[0], iv_ctr_ptr, AES_128_KEY_BLOCK_SIZE);
+    stream_ptr->key_ctx = key_ptr;
+}
+
+/**
+ * \brief   Get the expanded key of a stream
+ * \param   stream_ptr
+ *          The stream
+ * \param   tmp_ptr
+ *          Storage for the key, expanded there if the stream references
+ *          no expanded key
+ * \return  The expanded key to use
+ */
+static const struct AES_ctx * get_key_ctx(const aes_data_stream_t * stream_ptr,
+                                          struct AES_ctx * tmp_ptr)
+{
+    if (stream_ptr->key_ctx != NULL)
+    {
+        return &stream_ptr->key_ctx->ctx;
+    }
+
+    AES_init_ctx(tmp_ptr, (const uint8_t * )stream_ptr->key);
+    return tmp_ptr;
 }
 
 /**
@@ -63,13 +100,13 @@ static void aes_omac1GenerateSubkey(uint8_t * tgt_ptr, const uint8_t * src_ptr)
     }
 }
 
-void aes_initOmac1(aes_omac1_state_t * state_ptr, const uint8_t * mic_key_ptr)
+/**
+ * \brief   Derive OMAC1 subkeys of a state whose key is set up
+ */
+static void aes_omac1DeriveSubkeys(aes_omac1_state_t * state_ptr)
 {
     uint8_t dummy_out[AES_128_KEY_BLOCK_SIZE]; // This data is discarded
 
-    aes_setupStream(&state_ptr->data,
-                    mic_key_ptr,
-                    aes_plaintext_null);
     aes_crypto128Ctr(&state_ptr->data,
                      aes_plaintext_null,
                      dummy_out,
@@ -81,6 +118,23 @@ void aes_initOmac1(aes_omac1_state_t * state_ptr, const uint8_t * mic_key_ptr)
     aes_omac1GenerateSubkey(state_ptr->hl2.bytes, state_ptr->hl1.bytes);
 }
 
+void aes_initOmac1(aes_omac1_state_t * state_ptr, const uint8_t * mic_key_ptr)
+{
+    aes_setupStream(&state_ptr->data,
+                    mic_key_ptr,
+                    aes_plaintext_null);
+    aes_omac1DeriveSubkeys(state_ptr);
+}
+
+void aes_initOmac1Key(aes_omac1_state_t * state_ptr,
+                      const aes_128_key_t * mic_key_ptr)
+{
+    aes_setupStreamKey(&state_ptr->data,
+                       mic_key_ptr,
+                       aes_plaintext_null);
+    aes_omac1DeriveSubkeys(state_ptr);
+}
+
 void aes_omac1(aes_omac1_state_t * state,
                uint8_t * mic_out_ptr,
                uint_fast8_t mic_out_bytes,
@@ -91,9 +145,8 @@ void aes_omac1(aes_omac1_state_t * state,
     uint32_t * final_xor_mask;
     uint32_t i;
     uint8_t * cbc_stream;
-    struct AES_ctx ctx;
-
-    AES_init_ctx(&ctx, (const uint8_t * )state->data.key);
+    struct AES_ctx tmp_ctx;
+    const struct AES_ctx * ctx = get_key_ctx(&state->data, &tmp_ctx);
 
     state->data.aes_out[0] = 0;
     state->data.aes_out[1] = 0;
@@ -147,40 +200,49 @@ void aes_omac1(aes_omac1_state_t * state,
         }
 
         memcpy(state->data.aes_out, state->data.aes_in, AES_BLOCKLEN);
-        AES_ECB_encrypt(&ctx, (uint8_t *)state->data.aes_out);
+        AES_ECB_encrypt(ctx, (uint8_t *)state->data.aes_out);
     } // while (bytecount)
 
     // write out OMAC1 MAC:
     memcpy(mic_out_ptr, state->data.aes_out, mic_out_bytes);
 }
 
+/**
+ * \brief   Generate the next CTR keystream block in aes_out and increment
+ *          iv_ctr
+ */
+static void aes_ctrNextBlock(aes_data_stream_t * stream_ptr,
+                             const struct AES_ctx * ctx)
+{
+    memcpy(&stream_ptr->aes_out[0], stream_ptr->iv_ctr, AES_BLOCKLEN);
+    AES_ECB_encrypt(ctx, (uint8_t *)&stream_ptr->aes_out[0]);
+
+    // Update 128-bit iv_ctr by basic increment:
+    if (++(stream_ptr->iv_ctr[0]) == 0)
+    {
+        if (++(stream_ptr->iv_ctr[1]) == 0)
+        {
+            if (++(stream_ptr->iv_ctr[2]) == 0)
+            {
+                ++(stream_ptr->iv_ctr[3]);
+            }
+        }
+    }
+}
+
 void aes_crypto128Ctr(aes_data_stream_t * stream_ptr,
                       const uint8_t * intext_ptr,
                       uint8_t * outtext_ptr,
                       size_t bytecount)
 {
-    struct AES_ctx ctx;
-
-    AES_init_ctx(&ctx, (const uint8_t * )stream_ptr->key);
+    struct AES_ctx tmp_ctx;
+    const struct AES_ctx * ctx = get_key_ctx(stream_ptr, &tmp_ctx);
 
     // Repeat ECB crunching for 16 byte data blocks.
     // No padding required even if the final block is not full.
     while (bytecount)
     {
-        memcpy(&stream_ptr->aes_out[0], stream_ptr->iv_ctr, AES_BLOCKLEN);
-        AES_ECB_encrypt(&ctx, (uint8_t *)&stream_ptr->aes_out[0]);
-
-        // Update 128-bit iv_ctr by basic increment:
-        if (++(stream_ptr->iv_ctr[0]) == 0)
-        {
-            if (++(stream_ptr->iv_ctr[1]) == 0)
-            {
-                if (++(stream_ptr->iv_ctr[2]) == 0)
-                {
-                    ++(stream_ptr->iv_ctr[3]);
-                }
-            }
-        }
+        aes_ctrNextBlock(stream_ptr, ctx);
 
         // Implement final XORing for CTR mode.
         // One AES run can handle 1 to 16 bytes.
@@ -194,3 +256,229 @@ void aes_crypto128Ctr(aes_data_stream_t * stream_ptr,
         // Repeat AES if unhandled bytes
     } // while (bytecount)
 }
+
+/**
+ * \brief Progress of a single pass OMAC1 + CTR operation
+ */
+typedef struct
+{
+    aes_omac1_state_t * omac1;          // OMAC1 state, CBC block in aes_in
+    const struct AES_ctx * mic_ctx;     // Expanded MIC key
+    aes_data_stream_t * stream;         // CTR stream, keystream in aes_out
+    const struct AES_ctx * enc_ctx;     // Expanded encryption key
+    size_t mac_remaining;               // MAC input bytes not absorbed yet
+    uint_fast8_t mac_pos;               // Bytes in the current CBC block
+    uint_fast8_t ks_pos;                // Keystream bytes used in aes_out
+} aes_omac1_ctr_t;
+
+static void aes_omac1CtrStart(aes_omac1_ctr_t * run,
+                              size_t mac_bytes,
+                              struct AES_ctx * tmp_mic_ctx,
+                              struct AES_ctx * tmp_enc_ctx)
+{
+    run->mic_ctx = get_key_ctx(&run->omac1->data, tmp_mic_ctx);
+    run->enc_ctx = get_key_ctx(run->stream, tmp_enc_ctx);
+    run->mac_remaining = mac_bytes;
+    run->mac_pos = 0;
+    run->ks_pos = AES_BLOCKLEN;
+    memset(run->omac1->data.aes_out, 0, AES_BLOCKLEN);
+}
+
+/**
+ * \brief   Add a byte to the MAC, the CBC block is encrypted once full unless
+ *          it is the final one
+ */
+static void aes_omac1CtrAbsorb(aes_omac1_ctr_t * run, uint8_t byte)
+{
+    aes_data_stream_t * cbc = &run->omac1->data;
+
+    ((uint8_t *)cbc->aes_in)[run->mac_pos++] = byte;
+    run->mac_remaining--;
+
+    if (run->mac_pos == AES_BLOCKLEN && run->mac_remaining > 0)
+    {
+        for (uint_fast8_t i = 0 ; i <= 3 ; i++)
+        {
+            cbc->aes_out[i] ^= cbc->aes_in[i];
+        }
+        AES_ECB_encrypt(run->mic_ctx, (uint8_t *)cbc->aes_out);
+        run->mac_pos = 0;
+    }
+}
+
+/**
+ * \brief   Encrypt or decrypt text and add the plain text to the MAC. Text is
+ *          handled in chunks that cross no CBC nor keystream block boundary
+ */
+static void aes_omac1CtrText(aes_omac1_ctr_t * run,
+                             const uint8_t * intext_ptr,
+                             uint8_t * outtext_ptr,
+                             size_t text_bytes,
+                             bool decrypt)
+{
+    aes_data_stream_t * cbc = &run->omac1->data;
+
+    while (text_bytes)
+    {
+        uint8_t * block = (uint8_t *)cbc->aes_in + run->mac_pos;
+        const uint8_t * keystream;
+        uint_fast8_t bytes;
+
+        if (run->ks_pos == AES_BLOCKLEN)
+        {
+            aes_ctrNextBlock(run->stream, run->enc_ctx);
+            run->ks_pos = 0;
+        }
+        keystream = (uint8_t *)run->stream->aes_out + run->ks_pos;
+
+        bytes = min(AES_BLOCKLEN - run->mac_pos, AES_BLOCKLEN - run->ks_pos);
+        bytes = min(bytes, text_bytes);
+        text_bytes -= bytes;
+        run->mac_pos += bytes;
+        run->ks_pos += bytes;
+        run->mac_remaining -= bytes;
+
+        if (decrypt)
+        {
+            while (bytes--)
+            {
+                *block = *intext_ptr++ ^ *keystream++;
+                *outtext_ptr++ = *block++;
+            }
+        }
+        else
+        {
+            while (bytes--)
+            {
+                *block = *intext_ptr++;
+                *outtext_ptr++ = *block++ ^ *keystream++;
+            }
+        }
+
+        if (run->mac_pos == AES_BLOCKLEN && run->mac_remaining > 0)
+        {
+            for (uint_fast8_t i = 0 ; i <= 3 ; i++)
+            {
+                cbc->aes_out[i] ^= cbc->aes_in[i];
+            }
+            AES_ECB_encrypt(run->mic_ctx, (uint8_t *)cbc->aes_out);
+            run->mac_pos = 0;
+        }
+    }
+}
+
+/**
+ * \brief   Get the next keystream byte
+ */
+static uint8_t aes_omac1CtrKeystream(aes_omac1_ctr_t * run)
+{
+    if (run->ks_pos == AES_BLOCKLEN)
+    {
+        aes_ctrNextBlock(run->stream, run->enc_ctx);
+        run->ks_pos = 0;
+    }
+    return ((uint8_t *)run->stream->aes_out)[run->ks_pos++];
+}
+
+/**
+ * \brief   Process the final CBC block, padded and xored with a subkey
+ * \note    Like \ref aes_omac1, the MIC of empty input is all zeros
+ */
+static void aes_omac1CtrFinish(aes_omac1_ctr_t * run,
+                               uint8_t * mic_out_ptr,
+                               uint_fast8_t mic_bytes)
+{
+    aes_data_stream_t * cbc = &run->omac1->data;
+    uint8_t * block = (uint8_t *)cbc->aes_in;
+    uint32_t * final_xor_mask = &run->omac1->hl1.words[0];
+
+    if (run->mac_pos == 0)
+    {
+        // Nothing absorbed, aes_out is still cleared
+        memcpy(mic_out_ptr, cbc->aes_out, mic_bytes);
+        return;
+    }
+
+    if (run->mac_pos < AES_BLOCKLEN)
+    {
+        // First padding byte is always 0x80, rest are 0x00:
+        block[run->mac_pos] = 0x80;
+        memset(&block[run->mac_pos + 1], 0, AES_BLOCKLEN - run->mac_pos - 1);
+        final_xor_mask = &run->omac1->hl2.words[0];
+    }
+
+    for (uint_fast8_t i = 0 ; i <= 3 ; i++)
+    {
+        cbc->aes_out[i] ^= cbc->aes_in[i] ^ final_xor_mask[i];
+    }
+    AES_ECB_encrypt(run->mic_ctx, (uint8_t *)cbc->aes_out);
+
+    memcpy(mic_out_ptr, cbc->aes_out, mic_bytes);
+}
+
+void aes_encryptOmac1Ctr(aes_omac1_state_t * omac1_ptr,
+                         aes_data_stream_t * stream_ptr,
+                         const uint8_t * aad_ptr,
+                         size_t aad_bytes,
+                         const uint8_t * intext_ptr,
+                         uint8_t * outtext_ptr,
+                         size_t text_bytes,
+                         uint8_t * mic_out_ptr,
+                         uint_fast8_t mic_bytes)
+{
+    struct AES_ctx tmp_mic_ctx, tmp_enc_ctx;
+    aes_omac1_ctr_t run = { .omac1 = omac1_ptr, .stream = stream_ptr };
+    uint8_t mic[AES_128_KEY_BLOCK_SIZE];
+
+    aes_omac1CtrStart(&run, aad_bytes + text_bytes, &tmp_mic_ctx, &tmp_enc_ctx);
+
+    while (aad_bytes--)
+    {
+        aes_omac1CtrAbsorb(&run, *aad_ptr++);
+    }
+
+    // MAC the plain text and encrypt it in the same walk
+    aes_omac1CtrText(&run, intext_ptr, outtext_ptr, text_bytes, false);
+
+    // MIC is encrypted with the following keystream bytes
+    aes_omac1CtrFinish(&run, mic, mic_bytes);
+    for (uint_fast8_t i = 0 ; i < mic_bytes ; i++)
+    {
+        mic_out_ptr[i] = mic[i] ^ aes_omac1CtrKeystream(&run);
+    }
+}
+
+bool aes_decryptOmac1Ctr(aes_omac1_state_t * omac1_ptr,
+                         aes_data_stream_t * stream_ptr,
+                         const uint8_t * aad_ptr,
+                         size_t aad_bytes,
+                         const uint8_t * intext_ptr,
+                         uint8_t * outtext_ptr,
+                         size_t text_bytes,
+                         const uint8_t * mic_in_ptr,
+                         uint_fast8_t mic_bytes)
+{
+    struct AES_ctx tmp_mic_ctx, tmp_enc_ctx;
+    aes_omac1_ctr_t run = { .omac1 = omac1_ptr, .stream = stream_ptr };
+    uint8_t mic[AES_128_KEY_BLOCK_SIZE];
+    uint8_t diff = 0;
+
+    aes_omac1CtrStart(&run, aad_bytes + text_bytes, &tmp_mic_ctx, &tmp_enc_ctx);
+
+    while (aad_bytes--)
+    {
+        aes_omac1CtrAbsorb(&run, *aad_ptr++);
+    }
+
+    // Decrypt the text and MAC the result in the same walk
+    aes_omac1CtrText(&run, intext_ptr, outtext_ptr, text_bytes, true);
+
+    // Compare every byte so that the time does not depend on the mismatch
+    aes_omac1CtrFinish(&run, mic, mic_bytes);
+    for (uint_fast8_t i = 0 ; i < mic_bytes ; i++)
+    {
+        diff |= mic[i] ^ mic_in_ptr[i] ^ aes_omac1CtrKeystream(&run);
+    }
+
+    return diff == 0;
+}
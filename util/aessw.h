@@ -8,6 +8,10 @@
 #define AESSW_H_
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "aes.h"
 
 /** \brief AES 128 block size in bytes. */
 #define AES_128_KEY_BLOCK_SIZE 16
@@ -22,6 +26,18 @@ typedef union
     uint8_t bytes[16];
 } aes_128_t;
 
+/**
+ * \brief AES-128 keyed context
+ *
+ * Holds the expanded round keys of a key. The key expansion is done once by
+ * \ref aes_initKey and reused by every block, OMAC1 and CTR operation that
+ * is set up with the context.
+ */
+typedef struct
+{
+    struct AES_ctx ctx;      // Expanded round keys
+} aes_128_key_t;
+
 /**
  * \brief AES-128 key, input data and output data
  *
@@ -39,6 +55,7 @@ typedef struct
         uint32_t aes_in[4];  // Alias for AES input (if not iv_ctr)
     };
     uint32_t aes_out[4];     // AES-128 ECB output of last block
+    const aes_128_key_t * key_ctx; // Expanded key, or NULL to use key
 } aes_data_stream_t;
 
 /**
@@ -67,8 +84,34 @@ void aes_setupStream(aes_data_stream_t * stream_ptr,
                      const uint8_t * key128_ptr,
                      const uint8_t * iv_ctr_ptr);
 
+/**
+ * \brief   Expand an AES128 key
+ * \param   key_ptr
+ *          Pointer to aes_128_key_t to be set up
+ * \param   key128_ptr
+ *          Pointer to the secret 16-byte key, which is no longer needed
+ *          after this function returns
+ */
+void aes_initKey(aes_128_key_t * key_ptr, const uint8_t * key128_ptr);
+
+/**
+ * \brief   Setup AES128 CTR mode stream using an expanded key
+ * \param   stream_ptr
+ *          Pointer to aes_data_stream_t to be set up
+ * \param   key_ptr
+ *          Pointer to the expanded key, referenced by the stream struct. It
+ *          must remain valid as long as the stream is used
+ * \param   iv_ctr_ptr
+ *          Pointer to iv_ctr, copied to the stream struct
+ */
+void aes_setupStreamKey(aes_data_stream_t * stream_ptr,
+                        const aes_128_key_t * key_ptr,
+                        const uint8_t * iv_ctr_ptr);
+
 /**
  * \brief   Initializes an OMAC1 state
+ * \note    The key is expanded again by every \ref aes_omac1 call, use
+ *          \ref aes_initOmac1Key when the state is reused.
  * \param   state_ptr
  *          Pointer to aes_omac1_state_t to be set up
  * \param   mic_key_ptr
@@ -77,6 +120,17 @@ void aes_setupStream(aes_data_stream_t * stream_ptr,
  */
 void aes_initOmac1(aes_omac1_state_t * state_ptr, const uint8_t * mic_key_ptr);
 
+/**
+ * \brief   Initializes an OMAC1 state using an expanded key
+ * \param   state_ptr
+ *          Pointer to aes_omac1_state_t to be set up
+ * \param   mic_key_ptr
+ *          Pointer to the expanded MIC key, referenced by the state. It
+ *          must remain valid as long as the state is used
+ */
+void aes_initOmac1Key(aes_omac1_state_t * state_ptr,
+                      const aes_128_key_t * mic_key_ptr);
+
 /**
  * \brief   Calculate and write out OMAC1 (CMAC) MIC for input text
  * \note    This is a software implementation based on tiny AES.
@@ -112,4 +166,61 @@ void aes_crypto128Ctr(aes_data_stream_t * stream_ptr,
                       uint8_t * outtext_ptr,
                       size_t bytecount);
 
+/**
+ * \brief   Authenticate and encrypt in a single pass: OMAC1 (CMAC) over
+ *          aad and plain text, then CTR encryption of text and MIC
+ * \note    Result is the same as \ref aes_omac1 over aad || text followed by
+ *          \ref aes_crypto128Ctr over text || MIC, but the text is read once
+ *          and CBC-MAC and keystream blocks are computed as the walk goes.
+ *          This includes empty aad and text: as with \ref aes_omac1, the
+ *          MIC is then all zeros and not the RFC 4493 CMAC of empty input.
+ * \param   omac1_ptr     Pointer to OMAC1 state of the MIC key
+ * \param   stream_ptr    Pointer to CTR stream of the encryption key, set up
+ *                        with the initial iv_ctr
+ * \param   aad_ptr       Pointer to data authenticated but not encrypted
+ * \param   aad_bytes     Length of aad
+ * \param   intext_ptr    Pointer to plain text
+ * \param   outtext_ptr   Pointer to cipher text. Supports intext overwrite
+ * \param   text_bytes    Length of the text
+ * \param   mic_out_ptr   Pointer for writing the encrypted MIC, may directly
+ *                        follow outtext
+ * \param   mic_bytes     Amount of MIC bytes wanted (1...16)
+ */
+void aes_encryptOmac1Ctr(aes_omac1_state_t * omac1_ptr,
+                         aes_data_stream_t * stream_ptr,
+                         const uint8_t * aad_ptr,
+                         size_t aad_bytes,
+                         const uint8_t * intext_ptr,
+                         uint8_t * outtext_ptr,
+                         size_t text_bytes,
+                         uint8_t * mic_out_ptr,
+                         uint_fast8_t mic_bytes);
+
+/**
+ * \brief   Decrypt and verify in a single pass, reverse of
+ *          \ref aes_encryptOmac1Ctr
+ * \note    The MIC is compared in constant time. The decrypted text must be
+ *          discarded if the MIC does not match.
+ * \param   omac1_ptr     Pointer to OMAC1 state of the MIC key
+ * \param   stream_ptr    Pointer to CTR stream of the encryption key, set up
+ *                        with the initial iv_ctr
+ * \param   aad_ptr       Pointer to data authenticated but not encrypted
+ * \param   aad_bytes     Length of aad
+ * \param   intext_ptr    Pointer to cipher text
+ * \param   outtext_ptr   Pointer to plain text. Supports intext overwrite
+ * \param   text_bytes    Length of the text
+ * \param   mic_in_ptr    Pointer to the received encrypted MIC
+ * \param   mic_bytes     Length of the MIC (1...16)
+ * \return  True if the MIC matches
+ */
+bool aes_decryptOmac1Ctr(aes_omac1_state_t * omac1_ptr,
+                         aes_data_stream_t * stream_ptr,
+                         const uint8_t * aad_ptr,
+                         size_t aad_bytes,
+                         const uint8_t * intext_ptr,
+                         uint8_t * outtext_ptr,
+                         size_t text_bytes,
+                         const uint8_t * mic_in_ptr,
+                         uint_fast8_t mic_bytes);
+
 #endif /* AESSW_H_ */
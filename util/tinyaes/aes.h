@@ -40,9 +40,18 @@
     #define AES_keyExpSize 176
 #endif
 
+// AES_TTABLE selects the table-driven backend (aes_ttable.c instead of aes.c)
+#ifndef AES_TTABLE
+  #define AES_TTABLE 0
+#endif
+
 struct AES_ctx
 {
+#if defined(AES_TTABLE) && (AES_TTABLE == 1)
+  uint32_t RoundKey[AES_keyExpSize / 4];
+#else
   uint8_t RoundKey[AES_keyExpSize];
+#endif
 #if (defined(CBC) && (CBC == 1)) || (defined(CTR) && (CTR == 1))
   uint8_t Iv[AES_BLOCKLEN];
 #endif
@@ -58,8 +67,8 @@ void AES_ctx_set_iv(struct AES_ctx* ctx, const uint8_t* iv);
 // buffer size is exactly AES_BLOCKLEN bytes; 
 // you need only AES_init_ctx as IV is not used in ECB 
 // NB: ECB is considered insecure for most uses
-void AES_ECB_encrypt(struct AES_ctx* ctx, uint8_t* buf);
-void AES_ECB_decrypt(struct AES_ctx* ctx, uint8_t* buf);
+void AES_ECB_encrypt(const struct AES_ctx* ctx, uint8_t* buf);
+void AES_ECB_decrypt(const struct AES_ctx* ctx, uint8_t* buf);
 
 #endif // #if defined(ECB) && (ECB == !)
 
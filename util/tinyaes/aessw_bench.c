@@ -0,0 +1,210 @@
+/*
+ * Provisioning DATA packets per second with util/aessw.c on the AES backend
+ * it is linked with, see the bench target of the Makefile.
+ *
+ * Each packet is shaped like encrypt_data() of
+ * libraries/provisioning/proxy.c: a 9-byte header (type, address, session,
+ * key index, counter) authenticated with OMAC1, then the data and a 5-byte
+ * MIC encrypted in CTR mode, with the session IV plus the packet counter as
+ * initial counter block. Three ways of doing it are compared:
+ *
+ *   per packet setup   aes_initOmac1() and aes_setupStream() for every packet,
+ *                      so both keys are expanded each time
+ *   expanded keys      aes_initKey() and aes_initOmac1Key() once, then
+ *                      aes_omac1() and aes_crypto128Ctr() per packet
+ *   single pass        expanded keys, aes_encryptOmac1Ctr() per packet
+ *
+ * All three must give the same packets. Host only: times are nanoseconds of
+ * the monotonic clock.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "aessw.h"
+
+#define PACKETS   2000
+#define ROUNDS    50
+#define WAYS      3
+#define HDR_LEN   9     // pdu_prov_hdr_t + key_index + counter
+#define MIC_LEN   5     // PROV_MIC_SIZE
+#define PDU_LEN   102   // PROV_PDU_SIZE
+
+typedef void (*encrypt_f)(uint8_t* pdu, uint8_t data_len, uint16_t counter);
+
+static const uint8_t auth_key[16] = { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+static const uint8_t enc_key[16]  = { 0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81 };
+static const uint8_t iv[16]       = { 0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff };
+
+static aes_128_key_t m_auth_key;
+static aes_128_key_t m_enc_key;
+static aes_omac1_state_t m_omac1_state;
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Session IV plus packet counter, as in encrypt_data()
+static void initial_counter(uint32_t icb[4], uint16_t counter)
+{
+  uint32_t sum;
+
+  memcpy(icb, iv, sizeof(iv));
+  sum = icb[0] + counter;
+  if (sum < icb[0])
+  {
+    if (++(icb[1]) == 0)
+    {
+      if (++(icb[2]) == 0)
+      {
+        ++(icb[3]);
+      }
+    }
+  }
+  icb[0] = sum;
+}
+
+static void fill_packet(uint8_t* pdu, uint8_t data_len, uint16_t counter)
+{
+  pdu[0] = 2;                   // PROV_PACKET_TYPE_DATA
+  memcpy(&pdu[1], "\x01\x02\x03\x04", 4);
+  pdu[5] = 7;                   // session id
+  pdu[6] = 1;                   // key index
+  memcpy(&pdu[7], &counter, 2);
+  for (unsigned i = 0; i < data_len; ++i)
+  {
+    pdu[HDR_LEN + i] = (uint8_t)(i * 31 + counter);
+  }
+}
+
+static void encrypt_per_packet(uint8_t* pdu, uint8_t data_len, uint16_t counter)
+{
+  aes_omac1_state_t omac1_state;
+  aes_data_stream_t stream;
+  uint32_t icb[4];
+
+  initial_counter(icb, counter);
+  aes_initOmac1(&omac1_state, auth_key);
+  aes_omac1(&omac1_state, &pdu[HDR_LEN + data_len], MIC_LEN, pdu, HDR_LEN + data_len);
+  aes_setupStream(&stream, enc_key, (uint8_t*)icb);
+  aes_crypto128Ctr(&stream, &pdu[HDR_LEN], &pdu[HDR_LEN], data_len + MIC_LEN);
+}
+
+static void encrypt_expanded(uint8_t* pdu, uint8_t data_len, uint16_t counter)
+{
+  aes_data_stream_t stream;
+  uint32_t icb[4];
+
+  initial_counter(icb, counter);
+  aes_omac1(&m_omac1_state, &pdu[HDR_LEN + data_len], MIC_LEN, pdu, HDR_LEN + data_len);
+  aes_setupStreamKey(&stream, &m_enc_key, (uint8_t*)icb);
+  aes_crypto128Ctr(&stream, &pdu[HDR_LEN], &pdu[HDR_LEN], data_len + MIC_LEN);
+}
+
+static void encrypt_single_pass(uint8_t* pdu, uint8_t data_len, uint16_t counter)
+{
+  aes_data_stream_t stream;
+  uint32_t icb[4];
+
+  initial_counter(icb, counter);
+  aes_setupStreamKey(&stream, &m_enc_key, (uint8_t*)icb);
+  aes_encryptOmac1Ctr(&m_omac1_state, &stream, pdu, HDR_LEN,
+                      &pdu[HDR_LEN], &pdu[HDR_LEN], data_len,
+                      &pdu[HDR_LEN + data_len], MIC_LEN);
+}
+
+static const encrypt_f ways[WAYS] = { encrypt_per_packet, encrypt_expanded, encrypt_single_pass };
+
+// Rounds alternate between the ways, and the fastest round of each way is
+// kept: the others were disturbed by other processes
+static void packets_per_s(uint8_t data_len, double rates[WAYS])
+{
+  uint8_t pdu[PDU_LEN];
+  uint64_t best[WAYS];
+
+  for (unsigned w = 0; w < WAYS; ++w)
+  {
+    best[w] = UINT64_MAX;
+  }
+  for (unsigned r = 0; r < ROUNDS; ++r)
+  {
+    for (unsigned w = 0; w < WAYS; ++w)
+    {
+      uint64_t spent = 0;
+      for (unsigned p = 0; p < PACKETS; ++p)
+      {
+        fill_packet(pdu, data_len, (uint16_t)p);
+        uint64_t start = now_ns();
+        ways[w](pdu, data_len, (uint16_t)p);
+        spent += now_ns() - start;
+      }
+      if (spent < best[w])
+      {
+        best[w] = spent;
+      }
+    }
+  }
+  for (unsigned w = 0; w < WAYS; ++w)
+  {
+    rates[w] = PACKETS * 1e9 / best[w];
+  }
+}
+
+// The three ways must give the same packet
+static int check_same(uint8_t data_len)
+{
+  uint8_t ref[PDU_LEN], pdu[PDU_LEN];
+
+  for (unsigned counter = 0; counter < 300; ++counter)
+  {
+    fill_packet(ref, data_len, counter);
+    ways[0](ref, data_len, counter);
+    for (unsigned w = 1; w < WAYS; ++w)
+    {
+      fill_packet(pdu, data_len, counter);
+      ways[w](pdu, data_len, counter);
+      if (memcmp(ref, pdu, HDR_LEN + data_len + MIC_LEN) != 0)
+      {
+        printf("packet %u of %u data bytes differs\n", counter, data_len);
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+int main(void)
+{
+  // Provisioning data lengths: typical CBOR map, then the largest one
+  const uint8_t data_lens[] = { 51, PDU_LEN - HDR_LEN - MIC_LEN };
+  int exit = 0;
+
+  aes_initKey(&m_auth_key, auth_key);
+  aes_initKey(&m_enc_key, enc_key);
+  aes_initOmac1Key(&m_omac1_state, &m_auth_key);
+
+#if AES_TTABLE == 1
+  printf("Backend: aes_ttable.c, provisioning DATA packets\n");
+#else
+  printf("Backend: aes.c, provisioning DATA packets\n");
+#endif
+
+  for (unsigned i = 0; i < sizeof(data_lens); ++i)
+  {
+    uint8_t len = data_lens[i];
+    double rates[WAYS];
+
+    exit |= check_same(len);
+    packets_per_s(len, rates);
+    printf("%3u data bytes:  per packet setup %7.1fk/s, expanded keys %7.1fk/s (x%.2f), "
+           "single pass %7.1fk/s (x%.2f)\n",
+           len, rates[0] / 1e3, rates[1] / 1e3, rates[1] / rates[0],
+           rates[2] / 1e3, rates[2] / rates[0]);
+  }
+
+  return exit;
+}
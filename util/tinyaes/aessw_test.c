@@ -0,0 +1,228 @@
+/*
+ * Tests of util/aessw.c, see the test target of the Makefile.
+ *
+ * aes_omac1 is checked against the CMAC examples of RFC 4493. The
+ * single-pass aes_encryptOmac1Ctr / aes_decryptOmac1Ctr are checked against
+ * the two-pass sequence they replace: aes_omac1 over aad || text, then
+ * aes_crypto128Ctr over text || MIC.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "aessw.h"
+
+#define MAX_AAD     40
+#define MAX_TEXT    100
+
+static const uint8_t mic_key[16] = { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+static const uint8_t enc_key[16] = { 0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81 };
+static const uint8_t iv[16]      = { 0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff };
+
+// Lengths around the 16-byte block boundaries
+static const size_t aad_lens[]  = { 0, 1, 9, 15, 16, 17, 32, 33 };
+static const size_t text_lens[] = { 0, 1, 5, 15, 16, 17, 31, 32, 33, 64, 88 };
+static const uint8_t mic_lens[] = { 1, 4, 5, 8, 15, 16 };
+
+#define COUNT(array) (sizeof(array) / sizeof(array[0]))
+
+static aes_128_key_t m_mic_key;
+static aes_128_key_t m_enc_key;
+static int m_failures;
+
+static void check(int ok, const char* what, size_t aad_len, size_t text_len, unsigned mic_len)
+{
+    if (!ok)
+    {
+        printf("FAILURE: %s, aad %u, text %u, mic %u\n",
+               what, (unsigned)aad_len, (unsigned)text_len, mic_len);
+        m_failures++;
+    }
+}
+
+static void fill(uint8_t* buf, size_t len, uint8_t seed)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        buf[i] = (uint8_t)(seed + i * 37);
+    }
+}
+
+// MIC and cipher text of the two-pass sequence, MIC after the text in out
+static void two_pass(const uint8_t* aad, size_t aad_len, const uint8_t* text, size_t text_len,
+                     uint8_t mic_len, uint8_t* out)
+{
+    aes_omac1_state_t omac1;
+    aes_data_stream_t stream;
+    uint8_t mac_in[MAX_AAD + MAX_TEXT];
+
+    memcpy(mac_in, aad, aad_len);
+    memcpy(mac_in + aad_len, text, text_len);
+    aes_initOmac1(&omac1, mic_key);
+    memcpy(out, text, text_len);
+    aes_omac1(&omac1, out + text_len, mic_len, mac_in, aad_len + text_len);
+
+    aes_setupStream(&stream, enc_key, iv);
+    aes_crypto128Ctr(&stream, out, out, text_len + mic_len);
+}
+
+static void test_case(size_t aad_len, size_t text_len, uint8_t mic_len, int expanded)
+{
+    aes_omac1_state_t omac1;
+    aes_data_stream_t stream;
+    uint8_t aad[MAX_AAD], text[MAX_TEXT];
+    uint8_t expected[MAX_TEXT + 16];
+    uint8_t out[MAX_TEXT + 16], mic[16], buf[MAX_TEXT + 16];
+
+    fill(aad, aad_len, 0x11);
+    fill(text, text_len, 0x5a);
+    two_pass(aad, aad_len, text, text_len, mic_len, expected);
+
+    if (expanded)
+    {
+        aes_initOmac1Key(&omac1, &m_mic_key);
+    }
+    else
+    {
+        aes_initOmac1(&omac1, mic_key);
+    }
+
+    // Separate buffers
+    expanded ? aes_setupStreamKey(&stream, &m_enc_key, iv) : aes_setupStream(&stream, enc_key, iv);
+    aes_encryptOmac1Ctr(&omac1, &stream, aad, aad_len, text, out, text_len, mic, mic_len);
+    check(memcmp(out, expected, text_len) == 0, "cipher text", aad_len, text_len, mic_len);
+    check(memcmp(mic, expected + text_len, mic_len) == 0, "encrypted MIC", aad_len, text_len, mic_len);
+
+    // In place, MIC right after the text
+    memcpy(buf, text, text_len);
+    expanded ? aes_setupStreamKey(&stream, &m_enc_key, iv) : aes_setupStream(&stream, enc_key, iv);
+    aes_encryptOmac1Ctr(&omac1, &stream, aad, aad_len, buf, buf, text_len, buf + text_len, mic_len);
+    check(memcmp(buf, expected, text_len + mic_len) == 0, "in place encryption", aad_len, text_len, mic_len);
+
+    // Decryption in place gives back the text and accepts the MIC
+    expanded ? aes_setupStreamKey(&stream, &m_enc_key, iv) : aes_setupStream(&stream, enc_key, iv);
+    check(aes_decryptOmac1Ctr(&omac1, &stream, aad, aad_len, buf, buf, text_len, buf + text_len, mic_len),
+          "MIC accepted", aad_len, text_len, mic_len);
+    check(memcmp(buf, text, text_len) == 0, "in place decryption", aad_len, text_len, mic_len);
+
+    // A changed MIC byte is always rejected
+    for (unsigned i = 0; i < mic_len; ++i)
+    {
+        memcpy(buf, expected, text_len + mic_len);
+        buf[text_len + i] ^= 0x01;
+        expanded ? aes_setupStreamKey(&stream, &m_enc_key, iv) : aes_setupStream(&stream, enc_key, iv);
+        check(!aes_decryptOmac1Ctr(&omac1, &stream, aad, aad_len, buf, out, text_len, buf + text_len, mic_len),
+              "changed MIC rejected", aad_len, text_len, mic_len);
+    }
+
+    // A changed text or aad byte is rejected unless the truncated MIC of
+    // the two-pass sequence happens to be the same (1 in 256 for one byte)
+    if (text_len > 0)
+    {
+        memcpy(buf, expected, text_len + mic_len);
+        buf[text_len - 1] ^= 0x80;
+        text[text_len - 1] ^= 0x80;
+        two_pass(aad, aad_len, text, text_len, mic_len, out);
+        bool same = memcmp(out + text_len, expected + text_len, mic_len) == 0;
+        expanded ? aes_setupStreamKey(&stream, &m_enc_key, iv) : aes_setupStream(&stream, enc_key, iv);
+        check(aes_decryptOmac1Ctr(&omac1, &stream, aad, aad_len, buf, out, text_len, buf + text_len, mic_len) == same,
+              "changed text", aad_len, text_len, mic_len);
+    }
+    if (aad_len > 0)
+    {
+        fill(text, text_len, 0x5a);
+        aad[0] ^= 0x01;
+        two_pass(aad, aad_len, text, text_len, mic_len, buf);
+        bool same = memcmp(buf + text_len, expected + text_len, mic_len) == 0;
+        expanded ? aes_setupStreamKey(&stream, &m_enc_key, iv) : aes_setupStream(&stream, enc_key, iv);
+        check(aes_decryptOmac1Ctr(&omac1, &stream, aad, aad_len, expected, out, text_len, expected + text_len, mic_len) == same,
+              "changed aad", aad_len, text_len, mic_len);
+    }
+}
+
+static void test_omac1_rfc4493(void)
+{
+    static const uint8_t msg[64] = { 0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+                                     0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+                                     0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+                                     0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10 };
+    static const struct
+    {
+        size_t len;
+        uint8_t mac[16];
+    } examples[] =
+    {
+        { 16, { 0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44, 0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c } },
+        { 40, { 0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27 } },
+        { 64, { 0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe } },
+    };
+    aes_omac1_state_t omac1;
+    uint8_t mac[16];
+
+    for (unsigned i = 0; i < COUNT(examples); ++i)
+    {
+        aes_initOmac1(&omac1, mic_key);
+        aes_omac1(&omac1, mac, 16, msg, examples[i].len);
+        check(memcmp(mac, examples[i].mac, 16) == 0, "RFC 4493 CMAC", 0, examples[i].len, 16);
+
+        aes_initOmac1Key(&omac1, &m_mic_key);
+        aes_omac1(&omac1, mac, 16, msg, examples[i].len);
+        check(memcmp(mac, examples[i].mac, 16) == 0, "RFC 4493 CMAC, expanded key", 0, examples[i].len, 16);
+    }
+}
+
+// Empty aad and text: the MIC is all zeros, as with aes_omac1
+static void test_empty(void)
+{
+    static const uint8_t zeros[16] = { 0 };
+    aes_omac1_state_t omac1;
+    aes_data_stream_t stream;
+    uint8_t mic[16], keystream[16];
+
+    aes_initOmac1Key(&omac1, &m_mic_key);
+    aes_omac1(&omac1, mic, 16, NULL, 0);
+    check(memcmp(mic, zeros, 16) == 0, "aes_omac1 of empty input", 0, 0, 16);
+
+    // Encrypted MIC is then the first keystream bytes
+    aes_setupStreamKey(&stream, &m_enc_key, iv);
+    aes_crypto128Ctr(&stream, zeros, keystream, 16);
+    aes_setupStreamKey(&stream, &m_enc_key, iv);
+    aes_encryptOmac1Ctr(&omac1, &stream, NULL, 0, NULL, NULL, 0, mic, 16);
+    check(memcmp(mic, keystream, 16) == 0, "all-zero MIC of empty input", 0, 0, 16);
+}
+
+int main(void)
+{
+    aes_initKey(&m_mic_key, mic_key);
+    aes_initKey(&m_enc_key, enc_key);
+
+#if AES_TTABLE == 1
+    printf("\nTesting aessw on aes_ttable.c\n\n");
+#else
+    printf("\nTesting aessw on aes.c\n\n");
+#endif
+
+    test_omac1_rfc4493();
+    test_empty();
+    for (unsigned a = 0; a < COUNT(aad_lens); ++a)
+    {
+        for (unsigned t = 0; t < COUNT(text_lens); ++t)
+        {
+            for (unsigned m = 0; m < COUNT(mic_lens); ++m)
+            {
+                test_case(aad_lens[a], text_lens[t], mic_lens[m], 1);
+                test_case(aad_lens[a], text_lens[t], mic_lens[m], 0);
+            }
+        }
+    }
+
+    // Every MIC length is rejected when wrong
+    for (uint8_t mic_len = 1; mic_len <= 16; ++mic_len)
+    {
+        test_case(9, 51, mic_len, 1);
+    }
+
+    printf("OMAC1 + CTR single pass: %s\n", m_failures == 0 ? "SUCCESS!" : "FAILURE!");
+    return m_failures != 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Cycle-counting benchmark of the AES backend it is linked with (aes.c or
+ * aes_ttable.c), see the bench target of the Makefile.
+ *
+ * Cycles are read from the time stamp counter on x86, from the DWT cycle
+ * counter on Cortex-M (to be enabled by the caller) and are nanoseconds
+ * elsewhere.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "aes.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLE_UNIT "cycles"
+static uint64_t cycles(void)
+{
+  return __rdtsc();
+}
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+#define CYCLE_UNIT "cycles"
+static uint64_t cycles(void)
+{
+  return *(volatile uint32_t *)0xE0001004; // DWT->CYCCNT
+}
+#else
+#include <time.h>
+#define CYCLE_UNIT "ns"
+static uint64_t cycles(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+#endif
+
+#define ROUNDS  1000
+#define CTR_LEN 64
+
+static const uint8_t key[32] = { 0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+                                 0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4 };
+static const uint8_t iv[16]  = { 0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff };
+
+// Keep the fastest run, the others were disturbed by interrupts or caches
+static void report(const char* name, uint64_t best, unsigned bytes)
+{
+  printf("%-16s %8lu %s/op %8.1f %s/byte\n", name, (unsigned long)best, CYCLE_UNIT,
+         (double)best / bytes, CYCLE_UNIT);
+}
+
+#define MEASURE(name, bytes, op)                     \
+  do {                                               \
+    uint64_t best = UINT64_MAX;                      \
+    for (unsigned r = 0; r < ROUNDS; ++r)            \
+    {                                                \
+      uint64_t start = cycles();                     \
+      op;                                            \
+      uint64_t spent = cycles() - start;             \
+      if (spent < best)                              \
+      {                                              \
+        best = spent;                                \
+      }                                              \
+    }                                                \
+    report(name, best, bytes);                       \
+  } while (0)
+
+int main(void)
+{
+  struct AES_ctx ctx;
+  uint8_t block[AES_BLOCKLEN] = { 0 };
+  uint8_t buf[CTR_LEN] = { 0 };
+
+#if AES_TTABLE == 1
+  printf("Backend: aes_ttable.c, AES%d\n", AES_KEYLEN * 8);
+#else
+  printf("Backend: aes.c, AES%d\n", AES_KEYLEN * 8);
+#endif
+
+  MEASURE("key expansion", AES_KEYLEN, AES_init_ctx(&ctx, key));
+#if defined(ECB) && (ECB == 1)
+  MEASURE("ECB encrypt", AES_BLOCKLEN, AES_ECB_encrypt(&ctx, block));
+  MEASURE("ECB decrypt", AES_BLOCKLEN, AES_ECB_decrypt(&ctx, block));
+#endif
+#if defined(CTR) && (CTR == 1)
+  AES_ctx_set_iv(&ctx, iv);
+  MEASURE("CTR 64 bytes", CTR_LEN, AES_CTR_xcrypt_buffer(&ctx, buf, CTR_LEN));
+#endif
+
+  // Keep the results alive
+  return (block[0] ^ buf[0]) == 0x100;
+}
@@ -272,7 +272,13 @@ static inline CborError validate_utf8_string(const void *ptr, size_t n)
     const uint8_t *buffer = (const uint8_t *)ptr;
     const uint8_t * const end = buffer + n;
     while (buffer < end) {
-        uint32_t uc = get_utf8(&buffer, end);
+        uint32_t uc;
+        if (*buffer < 0x80) {
+            buffer = skip_ascii(buffer, end);
+            if (buffer == end)
+                break;
+        }
+        uc = get_utf8(&buffer, end);
         if (uc == ~0U)
             return CborErrorInvalidUtf8TextString;
     }
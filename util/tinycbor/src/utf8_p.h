@@ -29,6 +29,68 @@
 
 #include <stdint.h>
 
+#if !defined(CBOR_NO_SIMD) && defined(__GNUC__) && defined(__SSE2__)
+#  include <emmintrin.h>
+#  define CBOR_UTF8_SSE2
+#elif !defined(CBOR_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#  include <arm_neon.h>
+#  define CBOR_UTF8_NEON
+#endif
+
+#ifdef __GNUC__
+typedef size_t __attribute__((__may_alias__)) cbor_utf8_word_t;
+#else
+typedef size_t cbor_utf8_word_t;
+#endif
+
+/* Returns a pointer to the first byte that is not ASCII, or end if there is
+ * none. ASCII is always valid UTF-8, so this only skips what get_utf8()
+ * would accept one byte at a time. */
+static inline const uint8_t *skip_ascii(const uint8_t *ptr, const uint8_t *end)
+{
+    const size_t highBits = (size_t)-1 / 0xff * 0x80;
+
+#if defined(CBOR_UTF8_SSE2)
+    while (end - ptr >= 32) {
+        __m128i v1 = _mm_loadu_si128((const __m128i *)ptr);
+        __m128i v2 = _mm_loadu_si128((const __m128i *)(ptr + 16));
+        if (_mm_movemask_epi8(_mm_or_si128(v1, v2)))
+            break;
+        ptr += 32;
+    }
+    if (end - ptr >= 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ptr));
+        if (mask)
+            return ptr + __builtin_ctz(mask);
+        ptr += 16;
+    }
+#elif defined(CBOR_UTF8_NEON)
+    while (end - ptr >= 16) {
+        if (vmaxvq_u8(vld1q_u8(ptr)) >= 0x80)
+            break;
+        ptr += 16;
+    }
+#endif
+
+    if ((size_t)(end - ptr) >= 2 * sizeof(size_t)) {
+        /* align, then check one word at a time */
+        while ((uintptr_t)ptr & (sizeof(size_t) - 1)) {
+            if (*ptr >= 0x80)
+                return ptr;
+            ++ptr;
+        }
+        while ((size_t)(end - ptr) >= sizeof(size_t)) {
+            if (*(const cbor_utf8_word_t *)ptr & highBits)
+                break;
+            ptr += sizeof(size_t);
+        }
+    }
+
+    while (ptr < end && *ptr < 0x80)
+        ++ptr;
+    return ptr;
+}
+
 static inline uint32_t get_utf8(const uint8_t **buffer, const uint8_t *end)
 {
     int charsNeeded;
@@ -0,0 +1,237 @@
+/*
+ * Validation benchmark, see the bench target of the Makefile.
+ *
+ * Checks cbor_value_validate() against the UTF-8 rows of the parser test
+ * corpus, then measures validation throughput of generated documents and of
+ * the files given on the command line.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "cbor.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MIN_BYTES     (64u * 1024 * 1024)
+#define BENCH_FLAGS         (CborValidateUtf8 | CborValidateCompleteData)
+
+struct CorpusRow {
+    const char *name;
+    const char *data;
+    size_t len;
+    CborError expected;
+};
+
+#define ROW(name, data, expected) { name, data, sizeof(data) - 1, expected }
+
+/* From tests/parser/tst_parser.cpp */
+static const struct CorpusRow corpus[] = {
+    ROW("textstringutf8-2char", "\x62\xc2\xa0", CborNoError),
+    ROW("textstringutf8-2char2", "\x64\xc2\xa0\xc2\xa9", CborNoError),
+    ROW("textstringutf8-3char", "\x63\xe2\x88\x80", CborNoError),
+    ROW("textstringutf8-4char", "\x64\xf0\x90\x88\x83", CborNoError),
+    ROW("string-utf8-chunk-split", "\x81\x7f\x61\xc2\x61\xa0\xff", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-1char", "\x61\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-2chars-1", "\x62\xc2\xc0", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-2chars-2", "\x62\xc3\xdf", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-2chars-3", "\x62\xc7\xf0", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-3chars-1", "\x63\xe0\xa0\xc0", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-3chars-2", "\x63\xe0\xc0\xa0", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-4chars-1", "\x64\xf0\x90\x80\xc0", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-4chars-2", "\x64\xf0\x90\xc0\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-4chars-3", "\x64\xf0\xc0\x80\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-hi-surrogate", "\x63\xed\xa0\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-lo-surrogate", "\x63\xed\xb0\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-surrogate-pair", "\x66\xed\xa0\x80\xed\xb0\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-non-unicode-1", "\x64\xf4\x90\x80\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-non-unicode-2", "\x65\xf8\x88\x80\x80\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-non-unicode-3", "\x66\xfc\x84\x80\x80\x80\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-non-unicode-4", "\x66\xfd\xbf\xbf\xbf\xbf\xbf", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-fe", "\x61\xfe", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-ff", "\x61\xff", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-1-2", "\x62\xc1\x81", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-1-3", "\x63\xe0\x81\x81", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-1-4", "\x64\xf0\x80\x81\x81", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-1-5", "\x65\xf8\x80\x80\x81\x81", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-1-6", "\x66\xfc\x80\x80\x80\x81\x81", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-2-3", "\x63\xe0\x82\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-2-4", "\x64\xf0\x80\x82\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-2-5", "\x65\xf8\x80\x80\x82\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-2-6", "\x66\xfc\x80\x80\x80\x82\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-3-4", "\x64\xf0\x80\xa0\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-3-5", "\x65\xf8\x80\x80\xa0\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-3-6", "\x66\xfc\x80\x80\x80\xa0\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-4-5", "\x65\xf8\x80\x84\x80\x80", CborErrorInvalidUtf8TextString),
+    ROW("invalid-utf8-overlong-4-6", "\x66\xfc\x80\x80\x84\x80\x80", CborErrorInvalidUtf8TextString),
+};
+
+static CborError validate(const uint8_t *buffer, size_t len)
+{
+    CborParser parser;
+    CborValue value;
+    CborError err = cbor_parser_init(buffer, len, 0, &parser, &value);
+    if (!err)
+        err = cbor_value_validate(&value, BENCH_FLAGS);
+    return err;
+}
+
+static int check_corpus(void)
+{
+    int failed = 0;
+    size_t i;
+    for (i = 0; i < sizeof(corpus) / sizeof(corpus[0]); ++i) {
+        CborError err = validate((const uint8_t *)corpus[i].data, corpus[i].len);
+        if (err != corpus[i].expected) {
+            fprintf(stderr, "%s: got \"%s\", expected \"%s\"\n", corpus[i].name,
+                    cbor_error_string(err), cbor_error_string(corpus[i].expected));
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(const char *name, const uint8_t *buffer, size_t len)
+{
+    CborError err = validate(buffer, len);
+    size_t loops = BENCH_MIN_BYTES / len + 1;
+    size_t i;
+    double start, elapsed;
+
+    if (err) {
+        printf("%-24s %8zu bytes  %s\n", name, len, cbor_error_string(err));
+        return;
+    }
+
+    start = now();
+    for (i = 0; i < loops; ++i)
+        validate(buffer, len);
+    elapsed = now() - start;
+
+    printf("%-24s %8zu bytes  %9.1f MB/s\n", name, len,
+           (double)len * loops / elapsed / 1e6);
+}
+
+/* Text that repeats the given sample, whole characters only */
+static size_t fill_text(char *text, size_t size, const char *sample)
+{
+    size_t sampleLen = strlen(sample);
+    size_t len = 0;
+    while (len + sampleLen <= size) {
+        memcpy(text + len, sample, sampleLen);
+        len += sampleLen;
+    }
+    return len;
+}
+
+static size_t make_string(uint8_t *buffer, size_t size, const char *sample, size_t textLen)
+{
+    static char text[64 * 1024];
+    CborEncoder encoder;
+    size_t len = fill_text(text, textLen < sizeof(text) ? textLen : sizeof(text), sample);
+    cbor_encoder_init(&encoder, buffer, size, 0);
+    cbor_encode_text_string(&encoder, text, len);
+    return cbor_encoder_get_buffer_size(&encoder, buffer);
+}
+
+/* Gateway-like payload: array of maps of short ASCII keys and values */
+static size_t make_records(uint8_t *buffer, size_t size, int count)
+{
+    CborEncoder encoder, array, map;
+    int i;
+    cbor_encoder_init(&encoder, buffer, size, 0);
+    cbor_encoder_create_array(&encoder, &array, count);
+    for (i = 0; i < count; ++i) {
+        cbor_encoder_create_map(&array, &map, 4);
+        cbor_encode_text_stringz(&map, "node");
+        cbor_encode_uint(&map, 0x10000u + i);
+        cbor_encode_text_stringz(&map, "name");
+        cbor_encode_text_stringz(&map, "sensor-node-in-building-a-floor-3");
+        cbor_encode_text_stringz(&map, "payload");
+        cbor_encode_byte_string(&map, (const uint8_t *)"0123456789abcdef", 16);
+        cbor_encode_text_stringz(&map, "status");
+        cbor_encode_text_stringz(&map, "temperature and humidity within range");
+        cbor_encoder_close_container(&array, &map);
+    }
+    cbor_encoder_close_container(&encoder, &array);
+    return cbor_encoder_get_buffer_size(&encoder, buffer);
+}
+
+/* Chunked text string of the given sample */
+static size_t make_chunked(uint8_t *buffer, size_t size, const char *sample, int count)
+{
+    CborEncoder encoder;
+    size_t len;
+    int i;
+    buffer[0] = 0x7f;
+    len = 1;
+    for (i = 0; i < count; ++i) {
+        cbor_encoder_init(&encoder, buffer + len, size - len - 1, 0);
+        cbor_encode_text_stringz(&encoder, sample);
+        len += cbor_encoder_get_buffer_size(&encoder, buffer + len);
+    }
+    buffer[len++] = 0xff;
+    return len;
+}
+
+static void run_file(const char *fname)
+{
+    static uint8_t *buffer = NULL;
+    static size_t bufsize = 0;
+    size_t len = 0;
+    FILE *in = fopen(fname, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "%s: %s\n", fname, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    while (!feof(in)) {
+        if (len == bufsize) {
+            bufsize += 64 * 1024;
+            buffer = realloc(buffer, bufsize);
+            if (buffer == NULL) {
+                fprintf(stderr, "%s: %s\n", fname, strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+        }
+        len += fread(buffer + len, 1, bufsize - len, in);
+        if (ferror(in)) {
+            fprintf(stderr, "%s: %s\n", fname, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+    }
+    fclose(in);
+    run(fname, buffer, len);
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t buffer[128 * 1024];
+    static const char ascii[] = "The quick brown fox jumps over the lazy dog. ";
+    static const char latin[] = "D\xc3\xa9j\xc3\xa0 vu, cr\xc3\xa8me br\xc3\xbbl\xc3\xa9" "e. ";
+    static const char cjk[] = "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e\xe3\x81\xae\xe6\x96\x87";
+    int i;
+
+    if (check_corpus())
+        return EXIT_FAILURE;
+    printf("parser test corpus: %zu rows OK\n", sizeof(corpus) / sizeof(corpus[0]));
+
+    run("ascii-16", buffer, make_string(buffer, sizeof(buffer), "0123456789abcdef", 16));
+    run("ascii-64k", buffer, make_string(buffer, sizeof(buffer), ascii, 64 * 1024));
+    run("latin1-64k", buffer, make_string(buffer, sizeof(buffer), latin, 64 * 1024));
+    run("cjk-64k", buffer, make_string(buffer, sizeof(buffer), cjk, 64 * 1024));
+    run("records-1000", buffer, make_records(buffer, sizeof(buffer), 1000));
+    run("chunked-ascii-1000", buffer, make_chunked(buffer, sizeof(buffer), ascii, 1000));
+
+    for (i = 1; i < argc; ++i)
+        run_file(argv[i]);
+
+    return EXIT_SUCCESS;
+}